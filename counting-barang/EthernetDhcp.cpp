@@ -0,0 +1,209 @@
+#include "EthernetDhcp.h"
+
+static const uint16_t DHCP_SERVER_PORT = 67;
+static const uint16_t DHCP_CLIENT_PORT = 68;
+static const uint32_t DHCP_MAGIC       = 0x63825363;
+static const size_t   DHCP_PKT_MAX     = 548;
+static const uint32_t RETRY_MIN_MS     = 4000;
+static const uint32_t RETRY_MAX_MS     = 32000;
+static const uint8_t  REBOOT_TRIES     = 3;   // sesudah ini lease cache dipakai selama sisa masanya
+
+enum : uint8_t { DHCPDISCOVER = 1, DHCPOFFER, DHCPREQUEST, DHCPDECLINE, DHCPACK, DHCPNAK, DHCPRELEASE };
+
+static void putIP(uint8_t* p, const IPAddress& ip){ for (int i = 0; i < 4; i++) p[i] = ip[i]; }
+static IPAddress getIP(const uint8_t* p){ return IPAddress(p[0], p[1], p[2], p[3]); }
+static uint32_t getU32(const uint8_t* p){ return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+
+const char* EthernetDhcp::stateName() const {
+  static const char* names[] = { "idle", "init", "selecting", "requesting", "rebooting", "bound", "renewing", "rebinding" };
+  return names[_state];
+}
+
+void EthernetDhcp::start(const uint8_t mac[6], const char* hostname, const Lease* cached){
+  memcpy(_mac, mac, 6);
+  strncpy(_host, hostname ? hostname : "", sizeof(_host) - 1);
+  _xid = ((uint32_t)mac[3] << 24 | (uint32_t)mac[4] << 16 | (uint32_t)mac[5] << 8) ^ micros();
+  _lease = Lease();
+  if (cached && cached->valid()) {
+    const uint64_t now = _epochMs ? _epochMs() : 0;
+    _ageKnown = now && cached->acquiredMs && now >= cached->acquiredMs;
+    const uint64_t ageS = _ageKnown ? (now - cached->acquiredMs) / 1000 : 0;
+    if (ageS >= cached->leaseS) {
+      Serial.printf("[DHCP] Cached lease expired (%lus ago)\n", (unsigned long)(ageS - cached->leaseS));
+      enter(INIT);
+      return;
+    }
+    // fast start: pakai alamat lama sekarang, konfirmasi ke server di background
+    _lease = *cached;
+    applyLease(_lease);
+    _boundAt = millis() - (uint32_t)ageS * 1000;
+    enter(REBOOTING);
+  } else {
+    enter(INIT);
+  }
+}
+
+void EthernetDhcp::stop(){ closeUdp(); _state = IDLE; }
+
+uint32_t EthernetDhcp::remainingS() const {
+  if (_state != BOUND && _state != RENEWING && _state != REBINDING) return 0;
+  uint32_t el = (uint32_t)(millis() - _boundAt) / 1000;
+  return el >= _lease.leaseS ? 0 : _lease.leaseS - el;
+}
+
+void EthernetDhcp::openUdp(){ if (!_udpOpen) { _udp.begin(DHCP_CLIENT_PORT); _udpOpen = true; } }
+void EthernetDhcp::closeUdp(){ if (_udpOpen) { _udp.stop(); _udpOpen = false; } }
+
+void EthernetDhcp::applyLease(const Lease& l){
+  Ethernet.setLocalIP(l.ip);
+  Ethernet.setSubnetMask(l.subnet);
+  Ethernet.setGatewayIP(l.gateway);
+  Ethernet.setDnsServerIP(l.dns != IPAddress(0,0,0,0) ? l.dns : l.gateway);
+}
+
+void EthernetDhcp::enter(State s){
+  _state = s; _tries = 0; _retryMs = RETRY_MIN_MS;
+  switch (s) {
+    case INIT:
+      // alamat lama tidak berlaku lagi; DISCOVER harus dari 0.0.0.0
+      Ethernet.setLocalIP(IPAddress(0,0,0,0));
+      _xid++; openUdp(); send(DHCPDISCOVER, true); _state = SELECTING; break;
+    case REBOOTING:  _xid++; openUdp(); send(DHCPREQUEST, true);  break;
+    case REQUESTING: send(DHCPREQUEST, true); break;
+    case RENEWING:   _xid++; openUdp(); send(DHCPREQUEST, false); break;
+    case REBINDING:  _xid++; openUdp(); send(DHCPREQUEST, true);  break;
+    case BOUND:      closeUdp(); break;
+    default: break;
+  }
+}
+
+void EthernetDhcp::send(uint8_t msgType, bool broadcast){
+  uint8_t p[DHCP_PKT_MAX]; memset(p, 0, 240);
+  p[0] = 1; p[1] = 1; p[2] = 6;                       // BOOTREQUEST, ethernet, hlen
+  p[4] = _xid >> 24; p[5] = _xid >> 16; p[6] = _xid >> 8; p[7] = _xid;
+  if (broadcast) p[10] = 0x80;                        // minta balasan broadcast (belum punya IP)
+  if (_state == RENEWING || _state == REBINDING) putIP(p + 12, _lease.ip); // ciaddr
+  memcpy(p + 28, _mac, 6);
+  p[236] = 0x63; p[237] = 0x82; p[238] = 0x53; p[239] = 0x63;
+
+  size_t n = 240;
+  p[n++] = 53; p[n++] = 1; p[n++] = msgType;
+  p[n++] = 61; p[n++] = 7; p[n++] = 1; memcpy(p + n, _mac, 6); n += 6;
+  size_t hl = strlen(_host);
+  if (hl) { p[n++] = 12; p[n++] = hl; memcpy(p + n, _host, hl); n += hl; }
+  if (msgType == DHCPREQUEST) {
+    const Lease& want = (_state == REQUESTING) ? _offer : _lease;
+    if (_state == REQUESTING || _state == REBOOTING) { p[n++] = 50; p[n++] = 4; putIP(p + n, want.ip); n += 4; }
+    if (_state == REQUESTING) { p[n++] = 54; p[n++] = 4; putIP(p + n, want.server); n += 4; }
+  }
+  static const uint8_t params[] = { 1, 3, 6, 51, 58, 59 };
+  p[n++] = 55; p[n++] = sizeof(params); memcpy(p + n, params, sizeof(params)); n += sizeof(params);
+  p[n++] = 255;
+  while (n < 300) p[n++] = 0;                         // beberapa server menolak paket < 300 byte
+
+  IPAddress dst = (!broadcast && _lease.server != IPAddress(0,0,0,0)) ? _lease.server : IPAddress(255,255,255,255);
+  _udp.beginPacket(dst, DHCP_SERVER_PORT);
+  _udp.write(p, n);
+  _udp.endPacket();
+  _sentAt = millis(); _tries++;
+}
+
+bool EthernetDhcp::receive(uint8_t& msgType, Lease& out){
+  int len = _udp.parsePacket();
+  if (len <= 0) return false;
+  uint8_t p[DHCP_PKT_MAX];
+  int n = _udp.read(p, len < (int)sizeof(p) ? len : sizeof(p));
+  if (n < 244 || p[0] != 2 || getU32(p + 4) != _xid || memcmp(p + 28, _mac, 6) != 0 || getU32(p + 236) != DHCP_MAGIC)
+    return false;
+
+  out = Lease(); msgType = 0;
+  out.ip = getIP(p + 16);
+  for (int i = 240; i < n; ) {
+    uint8_t opt = p[i++];
+    if (opt == 0) continue;
+    if (opt == 255 || i >= n) break;
+    uint8_t ol = p[i++];
+    if (i + ol > n) break;
+    const uint8_t* v = p + i;
+    switch (opt) {
+      case 53: msgType = v[0]; break;
+      case 1:  if (ol >= 4) out.subnet  = getIP(v); break;
+      case 3:  if (ol >= 4) out.gateway = getIP(v); break;
+      case 6:  if (ol >= 4) out.dns     = getIP(v); break;
+      case 54: if (ol >= 4) out.server  = getIP(v); break;
+      case 51: if (ol >= 4) out.leaseS  = getU32(v); break;
+      case 58: if (ol >= 4) out.t1S     = getU32(v); break;
+      case 59: if (ol >= 4) out.t2S     = getU32(v); break;
+    }
+    i += ol;
+  }
+  if (!out.t1S) out.t1S = out.leaseS / 2;
+  if (!out.t2S) out.t2S = out.leaseS / 8 * 7;
+  return msgType != 0;
+}
+
+void EthernetDhcp::loop(){
+  if (_state == IDLE) return;
+  const uint32_t now = millis();
+
+  if (_udpOpen) {
+    uint8_t type; Lease l;
+    while (receive(type, l)) {
+      if (_state == SELECTING && type == DHCPOFFER) {
+        _offer = l; _state = REQUESTING; _tries = 0; _retryMs = RETRY_MIN_MS; send(DHCPREQUEST, true);
+      } else if (type == DHCPACK && _state != SELECTING && _state != BOUND) {
+        if (l.server == IPAddress(0,0,0,0)) l.server = (_state == REQUESTING) ? _offer.server : _lease.server;
+        _lease = l; _boundAt = now;
+        _lease.acquiredMs = _epochMs ? _epochMs() : 0;
+        applyLease(_lease);
+        enter(BOUND);
+        Serial.printf("[DHCP] Bound %s, lease %lus\n", _lease.ip.toString().c_str(), (unsigned long)_lease.leaseS);
+        if (_onLease) _onLease(_lease); // juga saat renew: acquiredMs baru harus ikut tersimpan
+        return;
+      } else if (type == DHCPNAK && _state != SELECTING && _state != BOUND) {
+        Serial.println(F("[DHCP] NAK; restart discovery"));
+        _lease = Lease();
+        enter(INIT);
+        return;
+      }
+    }
+  }
+
+  const uint32_t el = (now - _boundAt) / 1000;
+  switch (_state) {
+    case BOUND:
+      if (el >= _lease.t1S) enter(RENEWING);
+      break;
+    case RENEWING:
+    case REBINDING:
+      if (el >= _lease.leaseS) { Serial.println(F("[DHCP] Lease expired")); _lease = Lease(); enter(INIT); break; }
+      if (_state == RENEWING && el >= _lease.t2S) { enter(REBINDING); break; }
+      if (now - _sentAt >= _retryMs) { _retryMs = min(_retryMs * 2, RETRY_MAX_MS); _xid++; send(DHCPREQUEST, _state == REBINDING); }
+      break;
+    case REBOOTING:
+      if (_ageKnown && el >= _lease.leaseS) { Serial.println(F("[DHCP] Lease expired")); _lease = Lease(); enter(INIT); break; }
+      if (now - _sentAt < _retryMs) break;
+      if (_tries >= REBOOT_TRIES) {
+        if (!_ageKnown) {
+          // umur lease tidak diketahui (jam belum valid / lease lama): jangan klaim alamatnya
+          Serial.println(F("[DHCP] No reply to INIT-REBOOT, lease age unknown; restart discovery"));
+          _lease = Lease(); enter(INIT);
+          break;
+        }
+        // server diam: lease cache dipakai selama sisa masanya, diperpanjang lewat RENEWING biasa
+        Serial.printf("[DHCP] No reply to INIT-REBOOT; keep cached lease (%lus left)\n", (unsigned long)(_lease.leaseS - el));
+        enter(BOUND);
+        break;
+      }
+      _retryMs = min(_retryMs * 2, RETRY_MAX_MS); _xid++; send(DHCPREQUEST, true);
+      break;
+    case SELECTING:
+    case REQUESTING:
+      if (now - _sentAt < _retryMs) break;
+      if (_state == REQUESTING && _tries >= 3) { enter(INIT); break; }
+      _retryMs = min(_retryMs * 2, RETRY_MAX_MS);
+      if (_state == SELECTING) { _xid++; send(DHCPDISCOVER, true); } else send(DHCPREQUEST, true);
+      break;
+    default: break;
+  }
+}
@@ -0,0 +1,59 @@
+#include "FanControl.h"
+#include <math.h>
+
+void FanControl::begin(int pin, Sampler sampler){
+  _pin = pin; _sampler = sampler;
+  analogWrite(_pin, 0);
+  _lastSample = millis() - _set.sampleMs; // sampel pertama di loop() berikutnya
+  _lastRamp = millis();
+}
+
+void FanControl::sample(){
+  const uint32_t t0 = micros();
+  const float c = _sampler ? _sampler() : NAN;
+  _sampleUs = micros() - t0;
+  _samples++;
+  if (isnan(c) || c < -40 || c > 125) {
+    _faults++;
+    if (_faultRun < FAULT_LIMIT) _faultRun++;
+    if (_faultRun >= FAULT_LIMIT) { _on = true; _target = 255; }
+    return;
+  }
+  _faultRun = 0; _raw = c;
+  _temp = isnan(_temp) ? c : _temp + 0.3f * (c - _temp);
+
+  if (!_on && _temp >= _set.onC) _on = true;
+  else if (_on && _temp <= _set.offC) _on = false;
+  if (!_on) { _target = 0; return; }
+  const float span = _set.fullC - _set.offC;
+  const float k = span > 0 ? (_temp - _set.offC) / span : 1;
+  _target = k >= 1 ? 255 : (uint8_t)(_set.minDuty + (255 - _set.minDuty) * (k > 0 ? k : 0));
+}
+
+void FanControl::loop(){
+  const uint32_t now = millis();
+  if (now - _lastSample >= _set.sampleMs) { _lastSample = now; sample(); }
+  if (now - _lastRamp < RAMP_MS) return;
+  const uint32_t dt = now - _lastRamp;
+  _lastRamp = now;
+  if (_duty == _target || _pin < 0) return;
+  uint32_t step = (uint32_t)_set.rampPerS * dt / 1000;
+  if (!step) step = 1;
+  // target selalu 0 atau >= minDuty; di bawah minDuty kipas berhenti, jadi daerah itu dilompati
+  int next;
+  if (_target > _duty) next = _duty < _set.minDuty ? _set.minDuty : _duty + (int)step;
+  else next = _duty - (int)step;
+  if ((_target > _duty && next > _target) || (_target < _duty && next < _target)) next = _target;
+  if (_target == 0 && next < _set.minDuty) next = 0;
+  _duty = (uint8_t)next;
+  analogWrite(_pin, _duty);
+}
+
+void FanControl::toJson(JsonObject o) const {
+  if (!isnan(_temp)) { o["temp_c"] = roundf(_temp * 10) / 10; o["raw_c"] = roundf(_raw * 10) / 10; }
+  o["duty"] = _duty; o["target"] = _target; o["on"] = _on;
+  o["faults"] = _faults; o["fail_safe"] = _faultRun >= FAULT_LIMIT;
+  o["samples"] = _samples; o["sample_us"] = _sampleUs;
+  o["on_c"] = _set.onC; o["off_c"] = _set.offC; o["full_c"] = _set.fullC;
+  o["min_duty"] = _set.minDuty; o["sample_ms"] = _set.sampleMs; o["ramp_per_s"] = _set.rampPerS;
+}
@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include <stdarg.h>
+
+// String kapasitas tetap N karakter (+NUL) di dalam objek: tanpa heap, aman disalin/di-stack.
+// Isi yang melebihi kapasitas dipotong dan truncated() = true (bukan error).
+template <size_t N>
+class FixedString {
+public:
+  FixedString() { clear(); }
+  FixedString(const char* s) { assign(s); }
+  FixedString& operator=(const char* s) { assign(s); return *this; }
+  FixedString& operator+=(const char* s) { return append(s); }
+  FixedString& operator+=(char c) { return append(&c, 1); }
+
+  void clear() { _len = 0; _s[0] = '\0'; _trunc = false; }
+  FixedString& assign(const char* s, size_t n = SIZE_MAX) { clear(); return append(s, n); }
+  // s boleh nullptr (= kosong); n = SIZE_MAX -> sampai NUL
+  FixedString& append(const char* s, size_t n = SIZE_MAX) {
+    if (!s) return *this;
+    size_t i = 0;
+    for (; i < n && s[i]; i++) {
+      if (_len >= N) { _trunc = true; break; }
+      _s[_len++] = s[i];
+    }
+    _s[_len] = '\0';
+    return *this;
+  }
+  // snprintf ke sisa kapasitas
+  FixedString& appendf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    va_list ap; va_start(ap, fmt);
+    const int n = vsnprintf(_s + _len, N + 1 - _len, fmt, ap);
+    va_end(ap);
+    if (n < 0) { _s[_len] = '\0'; return *this; }
+    if ((size_t)n > N - _len) { _trunc = true; _len = N; } else _len += n;
+    return *this;
+  }
+
+  const char* c_str() const { return _s; }
+  size_t length() const { return _len; }
+  bool isEmpty() const { return _len == 0; }
+  bool truncated() const { return _trunc; }
+  static constexpr size_t capacity() { return N; }
+  char operator[](size_t i) const { return _s[i]; }
+  bool operator==(const char* s) const { return strcmp(_s, s ? s : "") == 0; }
+  bool operator!=(const char* s) const { return !(*this == s); }
+
+private:
+  char _s[N + 1];
+  uint16_t _len;
+  bool _trunc;
+};
@@ -0,0 +1,28 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+
+// Akuntansi tulis flash LittleFS per subsistem + proyeksi umur flash.
+// Pemanggil mencatat tiap commit (file ditutup) dengan byte logis yang ditulis dan jumlah operasi
+// metadata tambahan (remove/rename). Byte fisik diperkirakan: data dibulatkan ke PAGE + satu
+// PAGE metadata per commit/operasi (LittleFS copy-on-write). Umur = kapasitas partisi x siklus
+// erase rated / laju byte fisik sejak boot (asumsi wear leveling LittleFS merata di partisi).
+// Statis: dipanggil dari modul mana pun (antrian, portal, tally, ...) tanpa instance global.
+class FlashWear {
+public:
+  enum Sub : uint8_t { QueueAppend, QueueHead, QueueCompact, QueuePrune, Config, Tally, Products, Net, SUB_COUNT };
+  static const uint16_t PAGE = 256;
+
+  static void add(Sub s, size_t bytes, uint8_t metaOps = 0);
+  static void addItems(uint32_t n);          // item yang ditangkap (pembagi byte per item)
+  static void setRatedCycles(uint32_t c) { if (c) _cycles = c; }
+  static uint64_t physBytes();
+  static const char* name(Sub s);
+  static void toJson(JsonObject o);
+
+private:
+  struct Counter { uint64_t bytes = 0, phys = 0; uint32_t commits = 0; };
+  static Counter _c[SUB_COUNT];
+  static uint32_t _items, _cycles;
+  static portMUX_TYPE _mux;
+};
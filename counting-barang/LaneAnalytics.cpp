@@ -0,0 +1,82 @@
+#include "LaneAnalytics.h"
+#include <math.h>
+
+LaneAnalytics::Lane& LaneAnalytics::slotFor(uint8_t id){
+  for (uint8_t i = 0; i < _n; i++) if (_l[i].id == id) return _l[i];
+  uint8_t i = _n;
+  if (_n < MAX_LANES) _n++;
+  else { // penuh (lane id pernah diganti): pakai ulang slot yang paling lama tanpa item
+    i = 0;
+    for (uint8_t k = 1; k < _n; k++) if (_l[k].lastItemMs < _l[i].lastItemMs) i = k;
+  }
+  _l[i] = Lane(); _l[i].id = id;
+  return _l[i];
+}
+
+const LaneAnalytics::Lane* LaneAnalytics::find(uint8_t id) const {
+  for (uint8_t i = 0; i < _n; i++) if (_l[i].id == id) return &_l[i];
+  return nullptr;
+}
+
+void LaneAnalytics::item(uint8_t id, uint32_t us){
+  Lane& l = slotFor(id);
+  const uint32_t now = millis();
+  if (l.items) {
+    // micros() presisi tapi wrap ~71 menit; jarak sepanjang itu cukup pakai millis()
+    const uint32_t gapMs = now - l.lastItemMs;
+    const uint32_t dtMs = gapMs < 3600000UL ? (us - l.lastItemUs) / 1000 : gapMs;
+    uint8_t b = 0;
+    while (b < BUCKETS - 1 && dtMs >= bucketUpperMs(b)) b++;
+    l.hist[b]++;
+  }
+  if (l.stalled) {
+    l.stalled = false;
+    const uint32_t idle = now - l.stallSinceMs;
+    l.stallMsTotal += idle;
+    if (_cb) _cb(l, false, idle);
+  }
+  l.items++; l.pending++;
+  l.lastItemMs = now; l.lastItemUs = us;
+}
+
+void LaneAnalytics::tick(){
+  const uint32_t now = millis();
+  if (now - _lastTick < 1000) return;
+  const float dtS = _lastTick ? (now - _lastTick) / 1000.0f : 1.0f;
+  _lastTick = now;
+  const float alpha = 1.0f - expf(-dtS / (_set.tauS ? _set.tauS : 1));
+  for (uint8_t i = 0; i < _n; i++) {
+    Lane& l = _l[i];
+    l.ipm += alpha * (l.pending * 60.0f / dtS - l.ipm);
+    l.pending = 0;
+    if (l.ipm >= _set.stallMinIpm) { l.armed = true; l.ipmBeforeStall = l.ipm; }
+    // macet hanya jika lane sebelumnya berjalan cukup cepat (lane yang memang diam tidak dilaporkan)
+    if (l.armed && !l.stalled && l.items && _set.stallS && now - l.lastItemMs >= _set.stallS * 1000UL) {
+      l.stalled = true; l.armed = false; l.stalls++;
+      l.stallSinceMs = l.lastItemMs;
+      if (_cb) _cb(l, true, now - l.lastItemMs);
+    }
+  }
+}
+
+uint32_t LaneAnalytics::percentileMs(const Lane& l, float p){
+  uint32_t total = 0;
+  for (uint8_t b = 0; b < BUCKETS; b++) total += l.hist[b];
+  if (!total) return 0;
+  const uint32_t rank = (uint32_t)ceilf(p * total);
+  uint32_t acc = 0;
+  for (uint8_t b = 0; b < BUCKETS; b++) if ((acc += l.hist[b]) >= rank) return bucketUpperMs(b);
+  return bucketUpperMs(BUCKETS - 1);
+}
+
+void LaneAnalytics::toJson(const Lane& l, JsonObject o) const {
+  o["ipm"] = roundf(l.ipm * 10) / 10;
+  o["items"] = l.items; o["stalled"] = l.stalled; o["stalls"] = l.stalls;
+  uint32_t stallMs = l.stallMsTotal;
+  if (l.stalled) stallMs += millis() - l.stallSinceMs;
+  o["stall_s"] = stallMs / 1000;
+  o["idle_s"] = l.items ? (millis() - l.lastItemMs) / 1000 : 0;
+  o["p50_ms"] = percentileMs(l, 0.5f); o["p90_ms"] = percentileMs(l, 0.9f);
+  JsonArray h = o["hist"].to<JsonArray>();
+  for (uint8_t b = 0; b < BUCKETS; b++) h.add(l.hist[b]);
+}
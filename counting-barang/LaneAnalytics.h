@@ -0,0 +1,51 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+
+// Statistik kecepatan lini per lane id, dihitung di perangkat:
+//   - laju EWMA (item/menit), konstanta waktu tauS, diperbarui tiap tick() 1 detik
+//   - histogram jarak antar item, bucket log2: <62 ms, <125, <250 ... <32 s, <64 s, >= 64 s
+//   - detektor macet: tidak ada item selama stallS detik padahal laju sebelumnya >= stallMinIpm
+// Event macet / jalan lagi dilaporkan lewat callback (loop()), bukan dari ISR.
+class LaneAnalytics {
+public:
+  static const uint8_t MAX_LANES = 8;
+  static const uint8_t BUCKETS   = 12;
+  static const uint16_t BUCKET0_MS = 62; // batas atas bucket pertama (~62.5 ms), tiap bucket x2
+
+  struct Settings { uint16_t stallS = 30; float stallMinIpm = 5; uint16_t tauS = 60; };
+  struct Lane {
+    uint8_t id = 0;
+    float ipm = 0;                   // EWMA item/menit
+    uint32_t items = 0;              // sejak boot
+    uint32_t hist[BUCKETS] = {};
+    bool armed = false, stalled = false;
+    uint32_t stalls = 0, stallMsTotal = 0;
+    uint32_t lastItemMs = 0, lastItemUs = 0, stallSinceMs = 0, pending = 0;
+    float ipmBeforeStall = 0;
+  };
+  // stalled = true: mulai macet (idleMs = lama tanpa item); false: jalan lagi (idleMs = lama macet)
+  using StallCallback = std::function<void(const Lane& lane, bool stalled, uint32_t idleMs)>;
+
+  void setSettings(const Settings& s) { _set = s; }
+  const Settings& settings() const { return _set; }
+  void onStall(StallCallback cb) { _cb = cb; }
+
+  void item(uint8_t id, uint32_t us);  // satu item terhitung (us = waktu tepi dari LaneCounter)
+  void tick();                         // panggil di loop(); kerja nyata sekali per detik
+  const Lane* find(uint8_t id) const;
+  // persentil dari histogram (batas atas bucket, ms); 0 jika belum ada data
+  static uint32_t percentileMs(const Lane& l, float p);
+  static uint32_t bucketUpperMs(uint8_t b) { return (uint32_t)BUCKET0_MS << b; }
+  void toJson(const Lane& l, JsonObject o) const;
+
+private:
+  Settings _set;
+  Lane _l[MAX_LANES];
+  uint8_t _n = 0;
+  uint32_t _lastTick = 0;
+  StallCallback _cb;
+
+  Lane& slotFor(uint8_t id);
+};
@@ -0,0 +1,88 @@
+#include "LaneCounter.h"
+
+void IRAM_ATTR LaneCounter::isr(void* arg){
+  Pin* p = (Pin*)arg;
+  p->self->edge(p->i, digitalRead(p->self->_cfg[p->i].pin) == HIGH, micros());
+}
+
+bool IRAM_ATTR LaneCounter::edge(uint8_t i, bool level, uint32_t nowUs){
+  LaneState& s = _ls[i];
+  if (level == s.level) return false;   // ISR CHANGE bisa terlambat membaca level; abaikan ulangan
+  s.level = level;
+  if (!level) { s.fallUs = nowUs; return false; }
+
+  const LaneConfig& c = _cfg[i];
+  LaneStats& st = _st[i];
+  if (nowUs - s.fallUs < (uint32_t)c.minPulseMs * 1000) { st.glitches++; return false; }
+  if (s.counted && nowUs - s.lastCountUs < (uint32_t)c.debounceMs * 1000) { st.bounces++; return false; }
+  s.counted = true; s.lastCountUs = nowUs;
+  st.count++;
+
+  const uint32_t h = _head.load(std::memory_order_relaxed);
+  if (h - _tail.load(std::memory_order_acquire) >= RING_EVENTS) { _dropped++; return true; }
+  _ring[h % RING_EVENTS] = Event{ i, st.count, nowUs };
+  _head.store(h + 1, std::memory_order_release);
+  return true;
+}
+
+bool LaneCounter::configure(const LaneConfig* lanes, uint8_t n){
+  if (n > MAX_LANES) return false;
+  for (uint8_t i = 0; i < n; i++) {
+    if (lanes[i].pin < 0) return false;
+    for (uint8_t j = 0; j < i; j++) if (lanes[j].pin == lanes[i].pin || lanes[j].id == lanes[i].id) return false;
+  }
+  portENTER_CRITICAL(&_mux);
+  memcpy(_pending, lanes, sizeof(LaneConfig) * n); _nPending = n;
+  portEXIT_CRITICAL(&_mux);
+  _dirty = true;
+  return true;
+}
+
+const LaneCounter::LaneConfig* LaneCounter::findById(uint8_t id) const {
+  for (uint8_t i = 0; i < _n; i++) if (_cfg[i].id == id) return &_cfg[i];
+  return nullptr;
+}
+
+bool LaneCounter::anyBlocked() const {
+  for (uint8_t i = 0; i < _n; i++) if (!_ls[i].level) return true;
+  return false;
+}
+
+void LaneCounter::applyConfig(const LaneConfig* lanes, uint8_t n, bool attach){
+  if (attach) for (uint8_t i = 0; i < _n; i++) detachInterrupt(_cfg[i].pin);
+  // ISR sudah lepas: event tersisa milik konfigurasi lama, buang
+  _tail.store(_head.load(std::memory_order_acquire), std::memory_order_release);
+
+  LaneStats st[MAX_LANES];
+  for (uint8_t i = 0; i < n; i++) {
+    const LaneConfig* old = findById(lanes[i].id);
+    if (old) st[i] = _st[old - _cfg];
+  }
+  for (uint8_t i = 0; i < n; i++) {
+    _cfg[i] = lanes[i]; _st[i] = st[i]; _ls[i] = LaneState();
+    _pins[i] = Pin{ this, i };
+  }
+  _n = n;
+  if (!attach) return;
+  for (uint8_t i = 0; i < _n; i++) {
+    pinMode(_cfg[i].pin, INPUT_PULLUP);
+    _ls[i].level = digitalRead(_cfg[i].pin) == HIGH;
+    attachInterruptArg(_cfg[i].pin, isr, &_pins[i], CHANGE);
+  }
+}
+
+void LaneCounter::loop(){
+  if (_dirty.exchange(false)) {
+    LaneConfig next[MAX_LANES]; uint8_t n;
+    portENTER_CRITICAL(&_mux);
+    memcpy(next, _pending, sizeof(LaneConfig) * _nPending); n = _nPending;
+    portEXIT_CRITICAL(&_mux);
+    applyConfig(next, n, true);
+  }
+  uint32_t t = _tail.load(std::memory_order_relaxed);
+  while (t != _head.load(std::memory_order_acquire)) {
+    const Event e = _ring[t % RING_EVENTS];
+    _tail.store(++t, std::memory_order_release);
+    if (_cb && e.lane < _n) _cb(_cfg[e.lane], e.count, e.us);
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+#include <Arduino.h>
+#include <atomic>
+#include <functional>
+
+// Hitung barang di beberapa jalur konveyor sekaligus. Semua sensor (aktif LOW, beam terputus)
+// masuk ke satu ISR GPIO (CHANGE); tiap jalur punya counter, debounce & filter pulsa sendiri.
+// Barang terhitung saat beam kembali HIGH, jika:
+//   - lebar pulsa LOW >= minPulseMs (glitch lebih pendek dibuang), dan
+//   - jarak dari hitungan sebelumnya di jalur itu >= debounceMs.
+// ISR hanya menulis ring event tetap; loop() mengambilnya dan memanggil callback.
+// Ring penuh: counter jalur tetap naik tapi event dibuang (dropped()); konsumen merekonsiliasi
+// dari `count` event berikutnya, bukan dengan menghitung jumlah callback.
+class LaneCounter {
+public:
+  static const uint8_t MAX_LANES   = 8;
+  // event yang bisa menunggu loop(): 8 jalur x 20 barang/s (pitch 50 ms) x loop() tertahan 1.5 s
+  // (erase blok LittleFS saat spill antrian + commit NVS) = 240
+  static const size_t  RING_EVENTS = 256;
+  static const size_t  TOPIC_MAX   = 24;
+
+  struct LaneConfig {
+    int pin = -1;
+    uint8_t id = 1;                // lane id di payload & antrian
+    uint16_t debounceMs = 300;
+    uint16_t minPulseMs = 0;
+    char topic[TOPIC_MAX] = "";   // suffix topic MQTT, mis. "/lane1" ("" = topic utama)
+  };
+  struct LaneStats { uint32_t count = 0, bounces = 0, glitches = 0; };
+  // count = nilai counter jalur saat barang ini terhitung, us = micros() saat beam kembali HIGH
+  using Callback = std::function<void(const LaneConfig& lane, uint32_t count, uint32_t us)>;
+
+  // konfigurasi baru diterapkan di loop() (lepas/pasang ISR); aman dipanggil dari task lain.
+  // Counter jalur dengan id yang sama dipertahankan.
+  bool configure(const LaneConfig* lanes, uint8_t n);
+  void onCount(Callback cb) { _cb = cb; }
+  void loop();
+
+  uint8_t lanes() const { return _n; }
+  const LaneConfig& lane(uint8_t i) const { return _cfg[i]; }
+  const LaneStats& stats(uint8_t i) const { return _st[i]; }
+  const LaneConfig* findById(uint8_t id) const;
+  bool anyBlocked() const;          // ada beam yang sedang terputus
+  uint32_t dropped() const { return _dropped; }
+
+  // inti capture tanpa I/O: satu perubahan level di jalur i pada waktu nowUs.
+  // Dipakai ISR; bisa juga diumpan deret pulsa simulasi. true jika barang terhitung.
+  bool edge(uint8_t i, bool level, uint32_t nowUs);
+  // untuk simulasi: pasang konfigurasi langsung tanpa GPIO
+  void applyConfig(const LaneConfig* lanes, uint8_t n, bool attach);
+
+private:
+  struct Pin { LaneCounter* self; uint8_t i; };
+  struct Event { uint8_t lane; uint32_t count; uint32_t us; };
+  struct LaneState { bool level = true; uint32_t fallUs = 0, lastCountUs = 0; bool counted = false; };
+
+  LaneConfig _cfg[MAX_LANES];
+  LaneStats  _st[MAX_LANES];
+  LaneState  _ls[MAX_LANES];  // ditulis ISR
+  Pin _pins[MAX_LANES];
+  uint8_t _n = 0;
+  Callback _cb;
+
+  Event _ring[RING_EVENTS];
+  std::atomic<uint32_t> _head{0}, _tail{0}; // head: ISR, tail: loop()
+  volatile uint32_t _dropped = 0;
+
+  LaneConfig _pending[MAX_LANES];
+  uint8_t _nPending = 0;
+  std::atomic<bool> _dirty{false};
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+
+  static void isr(void* arg);
+};
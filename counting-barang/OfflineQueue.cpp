@@ -1,95 +1,509 @@
 #include "OfflineQueue.h"
+#include "RTCClockDS3231.h"
 #include <ArduinoJson.h>
+#include <new>
+#include <stddef.h>
+
+static const uint32_t HEAD_MAGIC = 0x31485130; // "0QH1"
+
+// Kunci rekursif: enqueue() memanggil pruneIfOversize() sambil memegang kunci. Jalur async_tcp
+// (status, browse, export) menunggu paling lama READ_WAIT lalu menyerah (nilai cache / 503 / coba lagi)
+// supaya spill/compact yang lama tidak menahan task web.
+struct QueueLock {
+  SemaphoreHandle_t m; bool ok;
+  explicit QueueLock(SemaphoreHandle_t mtx, TickType_t wait = portMAX_DELAY)
+    : m(mtx), ok(!mtx || xSemaphoreTakeRecursive(mtx, wait) == pdTRUE) {}
+  ~QueueLock(){ if (m && ok) xSemaphoreGiveRecursive(m); }
+};
+static const TickType_t READ_WAIT = pdMS_TO_TICKS(50);
+
+// Baca satu baris ke buf (tanpa '\n' & spasi di ujung, selalu NUL); baris > cap-1 byte dipotong
+// (enqueue tidak pernah menulis baris sepanjang itu). Return byte yang dikonsumsi, 0 = EOF.
+static size_t readLine(File& f, char* buf, size_t cap){
+  size_t used = 0, n = 0;
+  int c;
+  while ((c = f.read()) >= 0) {
+    used++;
+    if (c == '\n') break;
+    if (n < cap - 1) buf[n++] = (char)c;
+  }
+  while (n && isspace((unsigned char)buf[n - 1])) n--;
+  buf[n] = '\0';
+  return used;
+}
+
+// salin sisa src ke dst per blok (tanpa parse); return byte tertulis
+static size_t copyRest(File& src, File& dst){
+  uint8_t buf[256];
+  size_t n, total = 0;
+  while ((n = src.read(buf, sizeof(buf))) > 0) total += dst.write(buf, n);
+  return total;
+}
+
+static uint32_t crc32(const uint8_t* p, size_t n){
+  uint32_t c = 0xFFFFFFFF;
+  while (n--) { c ^= *p++; for (int k = 0; k < 8; k++) c = (c >> 1) ^ (0xEDB88320 & (0 - (c & 1))); }
+  return ~c;
+}
 
 bool OfflineQueue::begin(const char* path, size_t maxBytes){
   _path = path; _maxBytes = maxBytes;
+  if (!_mtx) _mtx = xSemaphoreCreateRecursiveMutex();
   if (!LittleFS.begin(true)) return false;
-  if (!LittleFS.exists(_path)) { File f = LittleFS.open(_path, "w"); if (f) f.close(); }
+  QueueLock lk(_mtx);
+  const uint32_t t0 = micros();
+  recover();
+  _rec.us = micros() - t0;
+  _linesKnown = false; // dihitung sekali oleh count() pertama (bukan saat boot)
+  resetIndex();
+  return true;
+}
+
+// Titik padam yang mungkin & hasil pemulihannya:
+//  - saat append (writeLine/spill): LittleFS commit saat close -> baris utuh atau tidak ada;
+//    ekor tanpa '\n' (FS lain / baris terpotong) ditutup '\n' -> jadi baris rusak yang dilewati
+//  - saat tulis head: slot yang sedang ditulis gagal CRC -> slot lama (mundur <= ACK_EVERY event)
+//  - compact sebelum remove: .tmp dan file ada -> .tmp belum tentu lengkap, dibuang
+//  - compact setelah remove: hanya .tmp -> sudah lengkap (ditutup sebelum remove), dipakai
+//  - compact setelah rename, head belum ditulis: gen head != gen file -> head = awal data
+// Semua O(1): dua slot head, header & byte terakhir file; index dibangun malas seperti biasa.
+void OfflineQueue::recover(){
+  _rec = RecoveryStats();
+  HeadRec h{};
+  const bool haveHead = readHead(h);
+  _headSeq = haveHead ? h.seq : 0;
+
+  const String tmp = _path + ".tmp";
+  if (LittleFS.exists(tmp)) {
+    if (LittleFS.exists(_path)) { LittleFS.remove(tmp); _rec.tmpDiscarded = true; }
+    else { LittleFS.rename(tmp, _path); _rec.tmpRestored = true; }
+  }
+  if (!LittleFS.exists(_path)) {
+    // file baru: gen setelah head lama supaya head basi tidak pernah cocok
+    File f = LittleFS.open(_path, "w");
+    if (f) { FlashWear::add(FlashWear::QueueAppend, f.printf("#Q %lu\n", (unsigned long)(haveHead ? h.gen + 1 : 1))); f.close(); }
+  }
+
+  File f = LittleFS.open(_path, "r");
+  _fileGen = 0; _dataStart = 0;
+  size_t size = 0;
+  if (f) {
+    size = f.size();
+    char hdr[24];
+    const size_t used = readLine(f, hdr, sizeof(hdr));
+    if (used && !strncmp(hdr, "#Q ", 3)) { _fileGen = strtoul(hdr + 3, nullptr, 10); _dataStart = used; }
+    if (size > _dataStart && f.seek(size - 1)) _rec.tornTail = f.read() != '\n';
+    f.close();
+  }
+  if (_rec.tornTail) {
+    File a = LittleFS.open(_path, "a");
+    if (a) { a.write('\n'); a.close(); size++; FlashWear::add(FlashWear::QueueAppend, 1); }
+  }
+
+  if (haveHead && h.gen == _fileGen && h.offset >= _dataStart && h.offset <= size) _head = h.offset;
+  else { _head = _dataStart; _rec.headReset = haveHead; }
+}
+
+bool OfflineQueue::readHead(HeadRec& out) const {
+  bool found = false;
+  for (uint32_t slot = 0; slot < 2; slot++) {
+    File f = LittleFS.open(headPath(slot), "r"); if (!f) continue;
+    HeadRec r;
+    const bool full = f.read((uint8_t*)&r, sizeof(r)) == sizeof(r);
+    f.close();
+    if (!full || r.magic != HEAD_MAGIC || r.crc != crc32((const uint8_t*)&r, offsetof(HeadRec, crc))) continue;
+    if (!found || (int32_t)(r.seq - out.seq) > 0) { out = r; found = true; }
+  }
+  return found;
+}
+
+bool OfflineQueue::writeHead(size_t offset){
+  HeadRec r{ HEAD_MAGIC, _headSeq + 1, _fileGen, (uint32_t)offset, 0 };
+  r.crc = crc32((const uint8_t*)&r, offsetof(HeadRec, crc));
+  // slot bergantian: slot dengan head terakhir yang valid tidak pernah ditimpa
+  File f = LittleFS.open(headPath(r.seq), "w"); if (!f) return false;
+  const bool ok = f.write((const uint8_t*)&r, sizeof(r)) == sizeof(r);
+  f.close();
+  if (!ok) return false;
+  _headSeq = r.seq; _head = offset; _written += sizeof(r);
+  FlashWear::add(FlashWear::QueueHead, sizeof(r));
+  return true;
+}
+
+bool OfflineQueue::compact(FlashWear::Sub sub){
+  const String tmp = _path + ".tmp";
+  File src = LittleFS.open(_path, "r"); if (!src) return false;
+  File dst = LittleFS.open(tmp, "w"); if (!dst) { src.close(); return false; }
+  char hdr[24];
+  const size_t hl = snprintf(hdr, sizeof(hdr), "#Q %lu\n", (unsigned long)(_fileGen + 1));
+  const size_t live = src.size() - _head, from = _head;
+  bool ok = dst.write((const uint8_t*)hdr, hl) == hl && src.seek(_head);
+  const size_t copied = ok ? copyRest(src, dst) : 0;
+  ok = ok && copied == live;
+  src.close(); dst.close();
+  _written += hl + copied;
+  FlashWear::add(sub, hl + copied, 2); // + remove & rename
+  if (!ok) { LittleFS.remove(tmp); return false; }
+  LittleFS.remove(_path);
+  LittleFS.rename(tmp, _path);
+  _fileGen++; _dataStart = hl;
+  writeHead(hl); // padam sebelum ini: gen tidak cocok -> recover() memakai awal data
+  // offset baru = offset lama - from + hl: cursor export & tanda spill dipetakan ulang (exportChunk)
+  _gen++; _cmpFrom = from; _cmpTo = hl; _cmpPrune = sub == FlashWear::QueuePrune;
+  for (SpillMark& m : _spillLog) m.off = m.off >= from ? m.off - from + hl : SIZE_MAX;
+  resetIndex();
   return true;
 }
 
 size_t OfflineQueue::sizeBytes() const {
-  if (!LittleFS.exists(_path)) return 0;
+  QueueLock lk(_mtx, READ_WAIT); if (!lk.ok) return _lastSize;
+  if (!LittleFS.exists(_path)) return _lastSize = 0;
   File f = LittleFS.open(_path, "r"); if (!f) return 0;
-  size_t n = f.size(); f.close(); return n;
+  _lastSize = f.size(); f.close(); return _lastSize;
+}
+
+void OfflineQueue::resetIndex(){
+  _idx.clear(); _idx.push_back(_head);
+  _idxLines = 0; _idxEnd = _head;
+}
+
+void OfflineQueue::extendIndex(size_t uptoLine) const {
+  if (_idxLines > uptoLine) return;
+  File f = LittleFS.open(_path, "r"); if (!f) return;
+  if (!f.seek(_idxEnd)) { f.close(); return; }
+  uint8_t buf[256];
+  size_t pos = _idxEnd;
+  while (_idxLines <= uptoLine) {
+    size_t n = f.read(buf, sizeof(buf));
+    if (!n) { _lines = _idxLines; _linesKnown = true; break; } // EOF: penghitung berjalan mulai di sini
+    for (size_t i = 0; i < n; i++) {
+      if (buf[i] != '\n') continue;
+      _idxLines++; _idxEnd = pos + i + 1;
+      if (_idxLines % INDEX_STRIDE == 0) _idx.push_back(_idxEnd);
+    }
+    pos += n;
+  }
+  f.close();
 }
 
 size_t OfflineQueue::count() const {
-  File f = LittleFS.open(_path, "r"); if (!f) return 0; size_t n=0;
-  while (f.available()) { if (f.read()=='\n') n++; }
-  f.close(); return n;
+  QueueLock lk(_mtx, READ_WAIT); if (!lk.ok) return _lastCount;
+  if (!_linesKnown) extendIndex(SIZE_MAX); // sekali setelah boot / tulis gagal
+  return _lastCount = _lines + _ringLen;
+}
+
+bool OfflineQueue::beginFront(size_t capacity){
+  QueueLock lk(_mtx);
+  if (_ring || !capacity || !psramFound()) return false;
+  Slot* r = (Slot*)ps_malloc(capacity * sizeof(Slot));
+  if (!r) return false;
+  for (size_t i = 0; i < capacity; i++) new (&r[i]) Slot();
+  _ring = r; _ringCap = capacity; _ringHead = _ringLen = 0;
+  setFrontSettings(_front);
+  return true;
+}
+
+void OfflineQueue::setFrontSettings(const FrontSettings& s){
+  QueueLock lk(_mtx);
+  _front = s;
+  if (_front.maxUndurable < 1) _front.maxUndurable = 1;
+  if (_ringCap && _front.maxUndurable > _ringCap) _front.maxUndurable = _ringCap;
+  // batas baru yang lebih kecil ditegakkan loop() (bisa dipanggil dari handler HTTP)
+}
+
+void OfflineQueue::loop(){
+  if (!_ringLen) return;
+  QueueLock lk(_mtx);
+  if (_ringLen && (_ringLen >= _front.maxUndurable || millis() - _ring[_ringHead].at >= _front.spillAfterMs)) spill();
+}
+
+bool OfflineQueue::spill(){
+  QueueLock lk(_mtx);
+  if (!_ringLen) return true;
+  File f = LittleFS.open(_path, "a"); if (!f) return false;
+  // satu kali buka file untuk seluruh ring; event yang gagal ditulis tetap di ring (spill berikut)
+  char line[LINE_MAX];
+  SpillMark m{ f.size(), _ringSeq, 0 };
+  size_t bytes = 0;
+  bool ok = true;
+  while (_ringLen && ok) {
+    const size_t len = toLine(ringAt(0), line, sizeof(line));
+    ok = len && f.write((const uint8_t*)line, len) == len && f.write('\n') == 1; // len 0: ditolak enqueue, tidak terjadi
+    if (ok) { ringPop(); m.n++; bytes += len + 1; }
+  }
+  f.close();
+  _written += bytes; FlashWear::add(FlashWear::QueueAppend, bytes);
+  _fst.spills++; _fst.spilled += m.n;
+  if (ok) addLines(m.n); else _linesKnown = false; // baris terpotong: hitung ulang
+  // cursor export yang sudah mengirim sebagian event ini dari ring melewatinya di file
+  if (m.n) _spillLog[_spillN++ % SPILL_LOG] = m;
+  pruneIfOversize();
+  return ok;
+}
+
+bool OfflineQueue::parseLine(const char* line, size_t len, ScanEvent& e){
+  JsonDocument d;
+  if (deserializeJson(d, line, len)) return false;
+  e = ScanEvent{ (const char*)d["ip_address"], (uint32_t)d["count"], eventTs(d.as<JsonVariantConst>()), d["lane"] | (uint8_t)1 };
+  return true;
+}
+
+uint64_t OfflineQueue::eventTs(JsonVariantConst line){
+  if (line["ts"].is<uint64_t>()) return line["ts"].as<uint64_t>();
+  return RTCClockDS3231::parseLocal(line["tanggal"].as<const char*>(), line["waktu"].as<const char*>());
+}
+
+const char* OfflineQueue::csvHeader(){ return "ip_address,count,tanggal,waktu,lane,ts\n"; }
+
+size_t OfflineQueue::toCsv(const ScanEvent& e, char* out, size_t cap){
+  char tgl[11], jam[9]; RTCClockDS3231::formatLocal(e.ts, tgl, jam);
+  const int n = snprintf(out, cap, "%s,%lu,%s,%s,%u,%llu\n", e.ip_address.c_str(), (unsigned long)e.count,
+                         tgl, jam, (unsigned)e.lane, (unsigned long long)e.ts);
+  return (n < 0 || (size_t)n >= cap) ? 0 : n;
+}
+
+size_t OfflineQueue::readRange(size_t from, size_t limit, std::function<void(size_t idx, const ScanEvent&)> fn) const {
+  QueueLock lk(_mtx, READ_WAIT); if (!lk.ok) return SIZE_MAX;
+  if (!_linesKnown) extendIndex(SIZE_MAX);
+  const size_t lines = _lines, total = lines + _ringLen;
+  if (from >= total || !limit) return total;
+  extendIndex(from); // index cukup sampai titik lompat
+
+  File f = from < lines ? LittleFS.open(_path, "r") : File();
+  if (f) {
+    // lompat ke titik index terdekat, lalu lewati sisa baris (< INDEX_STRIDE)
+    size_t line = (from / INDEX_STRIDE) * INDEX_STRIDE;
+    f.seek(_idx[from / INDEX_STRIDE]);
+    char s[LINE_MAX];
+    while (line < from && readLine(f, s, sizeof(s))) line++;
+    while (line < lines && line < from + limit) {
+      if (!readLine(f, s, sizeof(s))) break;
+      ScanEvent e;
+      if (s[0] && parseLine(s, strlen(s), e)) fn(line, e);
+      line++;
+    }
+    f.close();
+  }
+  // indeks lines..total-1 = ring
+  for (size_t i = from > lines ? from : lines; i < total && i < from + limit; i++) fn(i, ringAt(i - lines));
+  return total;
+}
+
+size_t OfflineQueue::exportChunk(ExportCursor& cur, uint8_t* buf, size_t maxLen) const {
+  QueueLock lk(_mtx, READ_WAIT); if (!lk.ok) return EXPORT_BUSY;
+  if (!cur.started) {
+    cur.started = true; cur.gen = _gen; cur.offset = _head; cur.pendLen = cur.pendOff = 0;
+    cur.ringSeq = cur.spillSeq = _ringSeq; cur.spillN = _spillN;
+    if (cur.csv) { cur.pendLen = strlen(csvHeader()); memcpy(cur.pending, csvHeader(), cur.pendLen); }
+  }
+  size_t n = 0;
+  auto drain = [&](){
+    size_t k = cur.pendLen - cur.pendOff; if (k > maxLen - n) k = maxLen - n;
+    memcpy(buf + n, cur.pending + cur.pendOff, k); n += k; cur.pendOff += k;
+    if (cur.pendOff == cur.pendLen) cur.pendLen = cur.pendOff = 0;
+  };
+  drain();
+  if (cur.pendLen || cur.done) return n;
+
+  // compact tepat satu kali sejak chunk terakhir: petakan ulang. Cursor di bagian yang dibuang
+  // lanjut dari awal data bila bagian itu sudah terkirim (flush), tapi tidak bila di-prune.
+  if (cur.gen + 1 == _gen && (cur.offset >= _cmpFrom || !_cmpPrune)) {
+    cur.offset = cur.offset >= _cmpFrom ? cur.offset - _cmpFrom + _cmpTo : _cmpTo; cur.gen = _gen;
+  }
+  // baris yang dilewati tidak bisa dipastikan lagi (prune, compact berulang, log spill terlampaui):
+  // akhiri dengan baris penutup agar klien tahu export tidak lengkap
+  const char* cut = cur.gen + 1 == _gen && _cmpPrune ? "pruned" : cur.gen != _gen ? "rewritten"
+                  : (_spillN - cur.spillN > SPILL_LOG && (int32_t)(cur.ringSeq - cur.spillSeq) > 0) ? "spill" : nullptr;
+  if (cut) {
+    const int k = snprintf(cur.pending, sizeof(cur.pending), cur.csv ? "#truncated,%s,%lu\n" : "{\"truncated\":true,\"reason\":\"%s\",\"exported\":%lu}\n",
+                           cut, (unsigned long)cur.lines);
+    cur.pendLen = k > 0 ? k : 0; cur.done = true;
+    drain();
+    return n;
+  }
+
+  File f = LittleFS.open(_path, "r");
+  // append sejak EOF terakhir (spill/direct): kembali ke file dulu
+  if (cur.inRing && f && f.size() > cur.offset) cur.inRing = false;
+  if (!cur.inRing) {
+    if (!f) return n;
+    f.seek(cur.offset);
+    // baris hasil spill yang event-nya sudah diekspor dari ring (seq < ringSeq) dilewati
+    auto spillSkip = [&]() -> uint32_t {
+      for (uint32_t k = _spillN - cur.spillN > SPILL_LOG ? _spillN - SPILL_LOG : cur.spillN; k != _spillN; k++) {
+        const SpillMark& m = _spillLog[k % SPILL_LOG];
+        if (m.off == cur.offset && (int32_t)(cur.ringSeq - m.seq) > 0) { const uint32_t d = cur.ringSeq - m.seq; return d < m.n ? d : m.n; }
+      }
+      return 0;
+    };
+    char s[LINE_MAX];
+    bool eof = false;
+    while (n < maxLen) {
+      if (!cur.skip) cur.skip = spillSkip();
+      const size_t used = readLine(f, s, sizeof(s));
+      if (!used) { eof = true; break; }
+      cur.offset += used;
+      if (cur.skip) { cur.skip--; continue; }
+      const size_t len = strlen(s); if (!len) continue;
+      if (cur.csv) { ScanEvent e; if (!parseLine(s, len, e)) continue; cur.pendLen = toCsv(e, cur.pending, sizeof(cur.pending)); }
+      else         { memcpy(cur.pending, s, len); cur.pending[len] = '\n'; cur.pendLen = len + 1; }
+      cur.lines++;
+      drain();
+      if (cur.pendLen) break;
+    }
+    f.close();
+    if (!eof) return n;
+    cur.inRing = true;
+    if ((int32_t)(cur.ringSeq - _ringSeq) < 0) cur.ringSeq = _ringSeq;
+    cur.spillN = _spillN; cur.spillSeq = _ringSeq; // spill berikutnya berisi seq >= spillSeq
+  }
+  f.close();
+  // ring: event yang sudah terkirim (drain) sejak chunk terakhir dilewati
+  while (n < maxLen) {
+    if ((int32_t)(cur.ringSeq - _ringSeq) < 0) cur.ringSeq = _ringSeq;
+    const uint32_t k = cur.ringSeq - _ringSeq;
+    if (k >= _ringLen) break;
+    const ScanEvent& e = ringAt(k);
+    cur.ringSeq++;
+    if (cur.csv) cur.pendLen = toCsv(e, cur.pending, sizeof(cur.pending));
+    else if (size_t len = toLine(e, cur.pending, sizeof(cur.pending) - 1)) { cur.pending[len] = '\n'; cur.pendLen = len + 1; }
+    if (cur.pendLen) cur.lines++;
+    drain();
+    if (cur.pendLen) break;
+  }
+  return n;
 }
 
-bool OfflineQueue::writeLine(const String& line){
+bool OfflineQueue::writeLine(const char* line, size_t len){
   File f = LittleFS.open(_path, "a"); if (!f) return false;
-  bool ok = (f.print(line) && f.print('\n'));
-  f.close(); return ok;
+  bool ok = (f.write((const uint8_t*)line, len) == len && f.write('\n') == 1);
+  _written += len + 1; FlashWear::add(FlashWear::QueueAppend, len + 1);
+  f.close();
+  if (ok) addLines(1); else _linesKnown = false; // baris terpotong menyatu dengan berikutnya
+  return ok;
 }
 
 bool OfflineQueue::pruneIfOversize(){
-  size_t sz = sizeBytes();
+  const size_t sz = sizeBytes();
   if (sz <= _maxBytes) return true;
-  // buang 20% terdepan
-  size_t target = (size_t)(sz * 0.8f);
-  File src = LittleFS.open(_path, "r"); if (!src) return false;
-  File tmp = LittleFS.open(String(_path)+".tmp", "w"); if (!tmp){ src.close(); return false; }
-  // skip awal sampai ukuran ~target
-  size_t skipped=0; String line;
-  while (src.available() && skipped < (sz - target)){
-    line = src.readStringUntil('\n'); skipped += line.length()+1;
-  }
-  // copy sisanya
-  while (src.available()){
-    line = src.readStringUntil('\n'); tmp.print(line); tmp.print('\n');
+  // data hidup > 80% batas: geser head melewati event tertua (= dibuang), lalu compact
+  const size_t target = (size_t)(_maxBytes * 0.8f);
+  if (sz - _head > target) {
+    File src = LittleFS.open(_path, "r"); if (!src) return false;
+    src.seek(_head);
+    size_t pos = _head, dropped = 0; char line[LINE_MAX];
+    while (sz - pos > target) {
+      const size_t used = readLine(src, line, sizeof(line)); if (!used) break;
+      pos += used; dropped++;
+    }
+    src.close();
+    if (!writeHead(pos)) return false;
+    addLines(-(long)dropped);
   }
-  src.close(); tmp.close();
-  LittleFS.remove(_path);
-  LittleFS.rename(String(_path)+".tmp", _path);
-  return true;
+  return compact(FlashWear::QueuePrune);
 }
 
-bool OfflineQueue::enqueue(const ScanEvent& e){
+size_t OfflineQueue::toLine(const ScanEvent& e, char* out, size_t cap){
   JsonDocument d;
-  d["ip_address"]  = e.ip_address;
+  d["ip_address"]  = e.ip_address.c_str();
   d["count"] = e.count;
-  d["tanggal"]     = e.tanggal;
-  d["waktu"]       = e.waktu;
-  String line; serializeJson(d, line);
-  if (!writeLine(line)) return false;
+  d["ts"]          = e.ts;
+  d["lane"]        = e.lane;
+  const size_t len = serializeJson(d, out, cap);
+  return (!len || len >= cap - 1) ? 0 : len; // 0 = tidak muat (terpotong)
+}
+
+bool OfflineQueue::enqueue(const ScanEvent& e){
+  // baris > LINE_MAX (mis. kode penuh karakter yang di-escape) tidak pernah bisa ditulis/dibaca:
+  // tolak di depan, sebelum masuk ring, dan hitung (frontStats().rejected)
+  char line[LINE_MAX];
+  const size_t len = toLine(e, line, sizeof(line));
+  QueueLock lk(_mtx);
+  if (!len) { _fst.rejected++; return false; }
+  if (_ringLen < _ringCap) {
+    Slot& s = _ring[(_ringHead + _ringLen) % _ringCap];
+    s.e = e; s.at = millis(); _ringLen++;
+    if (_ringLen >= _front.maxUndurable) spill(); // batas event yang belum tahan padam
+    return true;
+  }
+  // tanpa ring (atau ring penuh karena spill gagal): langsung ke flash
+  _fst.direct++;
+  if (!writeLine(line, len)) return false;
   pruneIfOversize();
   return true;
 }
 
+// publishOne (MQTT, bisa memblok sampai timeout socket) dipanggil TANPA kunci: batch disalin di
+// bawah kunci, dipublish, lalu kunci diambil lagi untuk memajukan ring/head. Bila di antaranya
+// event sudah dipindah (spill) atau file ditulis ulang (prune/compact), batch tidak dimajukan di
+// sini -> event dikirim ulang dari tempat barunya (at-least-once, sama seperti padam).
 size_t OfflineQueue::flush(std::function<bool(const ScanEvent&)> publishOne, size_t maxPerCall){
-  File src = LittleFS.open(_path, "r"); if (!src) return 0;
-  File tmp = LittleFS.open(String(_path)+".tmp", "w"); if (!tmp){ src.close(); return 0; }
-
-  size_t flushed=0; String line;
-  while (src.available()){
-    line = src.readStringUntil('\n'); line.trim(); if (!line.length()) continue;
-
-    // parse JSON line
-    JsonDocument d; DeserializationError err = deserializeJson(d, line);
-    bool ok = false;
-    if (!err){
-      ScanEvent e { (const char*)d["ip_address"], (uint32_t)d["count"], (const char*)d["tanggal"], (const char*)d["waktu"] };
-      ok = publishOne(e);
+  size_t flushed=0;
+  // ring dulu: tanpa tulis flash; publish gagal = broker belum siap, file juga ditunda
+  while (flushed < maxPerCall) {
+    size_t k = 0; uint32_t seq0;
+    {
+      QueueLock lk(_mtx);
+      seq0 = _ringSeq;
+      while (k < _ringLen && k < FLUSH_BATCH && flushed + k < maxPerCall) { _batch[k].e = ringAt(k); k++; }
+    }
+    if (!k) break;
+    size_t ok = 0;
+    while (ok < k && publishOne(_batch[ok].e)) ok++;
+    {
+      QueueLock lk(_mtx);
+      while (_ringLen && (uint32_t)(_ringSeq - seq0) < ok) { ringPop(); _fst.drained++; }
     }
+    flushed += ok;
+    if (ok < k) return flushed;
+  }
+  if (flushed >= maxPerCall) return flushed;
 
-    if (ok) {
-      flushed++;
-      if (flushed >= maxPerCall) {
-        // salin sisa baris apa adanya
-        while (src.available()) { String rest = src.readStringUntil('\n'); tmp.print(rest); tmp.print('\n'); }
-        break;
+  // file tidak ditulis ulang: head maju per batch, disimpan tiap ACK_EVERY baris (kelipatan
+  // FLUSH_BATCH); baris rusak ikut dilewati
+  size_t unacked = 0, size = 0;
+  uint32_t gen = 0;
+  bool advanced = false;
+  while (flushed < maxPerCall) {
+    size_t k = 0, from;
+    {
+      QueueLock lk(_mtx);
+      File src = LittleFS.open(_path, "r"); if (!src) break;
+      size = src.size();
+      if (_head >= size || !src.seek(_head)) { src.close(); break; } // tidak ada yang tertunda: tanpa tulis
+      from = _head; gen = _fileGen;
+      char line[LINE_MAX];
+      size_t pos = _head, valid = 0;
+      while (k < FLUSH_BATCH && flushed + valid < maxPerCall) {
+        const size_t used = readLine(src, line, sizeof(line)); if (!used) break;
+        pos += used;
+        const size_t len = strlen(line);
+        Pending& p = _batch[k++];
+        p.valid = len && parseLine(line, len, p.e); p.end = pos;
+        if (p.valid) valid++;
       }
-    } else {
-      // tulis kembali yang gagal
-      tmp.print(line); tmp.print('\n');
+      src.close();
+    }
+    if (!k) break;
+    size_t done = 0;
+    for (; done < k; done++) {
+      if (_batch[done].valid && !publishOne(_batch[done].e)) break; // broker belum siap: head tetap di baris ini
+      if (_batch[done].valid) flushed++;
+    }
+    QueueLock lk(_mtx);
+    if (_fileGen != gen || _head != from) { unacked = 0; break; } // prune/compact di antaranya (head sudah ditulis)
+    if (done) {
+      _head = _batch[done - 1].end; advanced = true;
+      addLines(-(long)done);
+      if ((unacked += done) >= ACK_EVERY) { writeHead(_head); unacked = 0; }
     }
+    if (done < k) break;
   }
-  src.close(); tmp.close();
-  LittleFS.remove(_path);
-  LittleFS.rename(String(_path)+".tmp", _path);
+  if (!advanced) return flushed;
+  QueueLock lk(_mtx);
+  if (unacked) writeHead(_head);
+  resetIndex();
+  // bagian terkirim >= separuh file (atau semua terkirim): compact, biaya salin teramortisasi
+  if (_fileGen == gen && _head - _dataStart >= (size - _dataStart) / 2) compact();
   return flushed;
-}
\ No newline at end of file
+}
@@ -2,24 +2,138 @@
 #include <Arduino.h>
 #include <LittleFS.h>
 #include <functional>
+#include <vector>
+#include <ArduinoJson.h>
+#include "FixedString.h"
+#include "FlashWear.h"
 
 struct ScanEvent {
-  String ip_address;
+  FixedString<15> ip_address;
   uint32_t count;
-  String tanggal; // YYYY-MM-DD
-  String waktu;   // HH:mm:ss
+  uint64_t ts;    // epoch ms (UTC); tanggal/waktu lokal diformat saat serialisasi
+  uint8_t lane = 1; // lane id LaneCounter (baris antrian lama tanpa "lane" = 1)
 };
 
 class OfflineQueue {
 public:
+  // panjang maksimum satu baris antrian/CSV (baris lebih panjang tidak pernah ditulis enqueue)
+  static const size_t LINE_MAX = 512;
+  // Posisi export streaming; valid selama file tidak di-compact (gen). Setelah EOF file, export
+  // lanjut ke ring RAM (ringSeq = nomor urut berikutnya yang belum diekspor). Baris yang di-append
+  // di tengah export (spill/direct) ikut terkirim tepat sekali: bagian spill yang sudah diekspor
+  // dari ring dilewati (skip). Bila itu tidak bisa dijamin, export diakhiri baris penutup
+  // {"truncated":true,...} / "#truncated,..." (bukan berhenti diam-diam).
+  struct ExportCursor { uint32_t gen=0; size_t offset=0; bool csv=false; bool started=false;
+                        bool inRing=false, done=false; uint32_t ringSeq=0, spillN=0, spillSeq=0, skip=0, lines=0;
+                        char pending[LINE_MAX + 1]; uint16_t pendLen=0, pendOff=0; };
+
+  // Tier depan di RAM (PSRAM): event masuk ring dulu dan baru ditulis ke flash (spill) bila
+  // event tertua sudah menunggu spillAfterMs atau ring berisi maxUndurable event. Saat listrik
+  // padam, yang hilang maksimal maxUndurable event (dan tidak lebih tua dari spillAfterMs).
+  // flush() menguras ring lebih dulu, lalu file; urutan antar tier tidak dijamin (event membawa ts).
+  struct FrontSettings { uint32_t spillAfterMs = 30000; uint16_t maxUndurable = 256; };
+  // rejected = event ditolak enqueue karena barisnya > LINE_MAX (tidak masuk antrian sama sekali)
+  struct FrontStats { uint32_t spills = 0, spilled = 0, drained = 0, direct = 0, rejected = 0; };
+
+  // Format tahan padam: file NDJSON hanya di-append; event yang sudah terkirim tidak dihapus dari
+  // file tapi ditandai lewat "head" (offset baris pertama yang belum terkirim) di dua slot
+  // bergantian <path>.h0/.h1 (seq + CRC, slot rusak diabaikan). Head disimpan tiap ACK_EVERY
+  // publish -> padam di tengah flush mengulang maksimal ACK_EVERY event. Bagian yang sudah
+  // terkirim dibuang oleh compact(): tulis .tmp (baris header "#Q <gen>") -> hapus file -> rename.
+  // begin() memulihkan dari titik padam mana pun tanpa memindai file (O(1), lihat recover()).
+  static const uint8_t ACK_EVERY = 16;
+  struct RecoveryStats { uint32_t us = 0; bool tmpRestored = false, tmpDiscarded = false, headReset = false, tornTail = false; };
+
   bool begin(const char* path="/scan_queue.ndjson", size_t maxBytes=1024*1024);
-  bool enqueue(const ScanEvent& e);
-  // publishOne harus return true jika MQTT publish sukses
+  const RecoveryStats& recoveryStats() const { return _rec; }
+  // setelah begin(); ring hanya di PSRAM -> false (tanpa tier depan) jika PSRAM tidak ada
+  bool beginFront(size_t capacity);
+  void setFrontSettings(const FrontSettings& s); // maxUndurable dibatasi 1..kapasitas
+  const FrontSettings& frontSettings() const { return _front; }
+  const FrontStats& frontStats() const { return _fst; }
+  size_t frontCount() const { return _ringLen; }
+  size_t frontCapacity() const { return _ringCap; }
+  void loop();              // spill berdasarkan umur, panggil tiap loop()
+  bool spill();             // tulis seluruh ring ke flash sekarang (mis. sebelum restart)
+
+  bool enqueue(const ScanEvent& e); // false = ditolak (baris > LINE_MAX) / tulis flash gagal
+  // publishOne harus return true jika MQTT publish sukses; gagal = berhenti (sisanya di flush berikut).
+  // Dipanggil tanpa kunci antrian (hanya dari satu task, mis. loop).
   size_t flush(std::function<bool(const ScanEvent&)> publishOne, size_t maxPerCall=200);
-  size_t count() const;     // perkiraan jumlah baris
-  size_t sizeBytes() const; // ukuran file
+  // count/sizeBytes/readRange/exportChunk aman dari async_tcp: kunci ditunggu maksimal ~50 ms,
+  // lalu nilai terakhir / SIZE_MAX (sibuk) / EXPORT_BUSY
+  size_t count() const;     // jumlah event: baris file (penghitung berjalan) + ring
+  size_t sizeBytes() const; // ukuran file (termasuk bagian terkirim yang belum di-compact)
+  size_t headOffset() const { return _head; }
+  uint64_t bytesWritten() const { return _written; } // total byte ditulis ke flash sejak boot
+
+  // baca event [from, from+limit) tanpa memuat file (file dulu, lalu ring); return total saat ini
+  // (SIZE_MAX = antrian sibuk, coba lagi)
+  size_t readRange(size_t from, size_t limit, std::function<void(size_t idx, const ScanEvent&)> fn) const;
+  // isi buf dengan potongan export (NDJSON/CSV); return 0 jika selesai (setelah baris penutup bila terpotong)
+  static const size_t EXPORT_BUSY = 0xFFFFFFFF; // = RESPONSE_TRY_AGAIN AsyncWebServer: panggil lagi nanti
+  size_t exportChunk(ExportCursor& cur, uint8_t* buf, size_t maxLen) const;
+
+  static bool parseLine(const char* line, size_t len, ScanEvent& e);
+  static size_t lineBytes(const ScanEvent& e) { char b[LINE_MAX]; const size_t n = toLine(e, b, sizeof(b)); return n ? n + 1 : 0; }
+  static size_t toCsv(const ScanEvent& e, char* out, size_t cap); // return panjang (0 = tidak muat)
+  static const char* csvHeader();
+  // baris lama tanpa "ts" ({tanggal, waktu} lokal) tetap terbaca
+  static uint64_t eventTs(JsonVariantConst line);
+
 private:
   String _path; size_t _maxBytes=0;
-  bool writeLine(const String& line);
+  SemaphoreHandle_t _mtx = nullptr; // enqueue/flush (loop) vs browse/export (async_tcp)
+
+  // sparse index: offset byte awal baris ke-(k*INDEX_STRIDE), dibangun malas & diperpanjang saat append
+  static const size_t INDEX_STRIDE = 64;
+  mutable std::vector<uint32_t> _idx;
+  mutable size_t _idxLines=0, _idxEnd=0;
+  uint64_t _written=0;
+  uint32_t _gen=0; // naik hanya saat compact; [_cmpFrom, EOF) lama pindah ke _cmpTo
+  size_t _cmpFrom=0, _cmpTo=0; bool _cmpPrune=false;
+  void resetIndex(); // index dihitung dari _head (head maju / compact)
+  void extendIndex(size_t uptoLine) const; // SIZE_MAX = sampai EOF
+  // jumlah baris file [_head, EOF): dihitung sekali (scan pertama setelah boot), lalu dijaga
+  // append/flush/prune -> count() O(1)
+  mutable size_t _lines=0; mutable bool _linesKnown=false;
+  mutable size_t _lastCount=0, _lastSize=0; // dijawab saat kunci sibuk
+  void addLines(long d) { if (_linesKnown) _lines += d; }
+
+  // ring tier depan (PSRAM), dilindungi _mtx; _ringSeq = nomor urut event di _ringHead
+  struct Slot { ScanEvent e; uint32_t at; };
+  Slot* _ring = nullptr;
+  size_t _ringCap = 0, _ringHead = 0, _ringLen = 0;
+  uint32_t _ringSeq = 0;
+  FrontSettings _front;
+  FrontStats _fst;
+  // spill terakhir: baris mulai offset off = event ring seq [seq, seq+n) -> cursor export yang
+  // sudah mengirim sebagian event itu dari ring tahu berapa baris yang dilewati di file
+  struct SpillMark { size_t off; uint32_t seq, n; };
+  static const uint8_t SPILL_LOG = 8;
+  SpillMark _spillLog[SPILL_LOG];
+  uint32_t _spillN = 0;
+  const ScanEvent& ringAt(size_t i) const { return _ring[(_ringHead + i) % _ringCap].e; }
+  void ringPop() { _ringHead = (_ringHead + 1) % _ringCap; _ringLen--; _ringSeq++; }
+
+  // batch flush(): disalin di bawah kunci, dipublish tanpa kunci; ACK_EVERY kelipatannya
+  static const uint8_t FLUSH_BATCH = 8;
+  struct Pending { ScanEvent e; size_t end; bool valid; };
+  Pending _batch[FLUSH_BATCH];
+  static_assert(ACK_EVERY % FLUSH_BATCH == 0, "head ditulis di batas batch");
+
+  static size_t toLine(const ScanEvent& e, char* out, size_t cap); // NDJSON tanpa '\n'; 0 = tidak muat
+  bool writeLine(const char* line, size_t len);
   bool pruneIfOversize();   // buang baris tertua sampai <= _maxBytes
-};
\ No newline at end of file
+
+  // head & generasi file (header "#Q <gen>"; file lama tanpa header = gen 0, data mulai offset 0)
+  struct HeadRec { uint32_t magic, seq, gen, offset, crc; };
+  size_t _head=0, _dataStart=0;
+  uint32_t _fileGen=0, _headSeq=0;
+  RecoveryStats _rec;
+  String headPath(uint32_t seq) const { return _path + ((seq & 1) ? ".h1" : ".h0"); }
+  bool readHead(HeadRec& out) const;   // slot valid dengan seq terbaru
+  bool writeHead(size_t offset);
+  void recover();
+  bool compact(FlashWear::Sub sub = FlashWear::QueueCompact); // buang [_dataStart, _head) lewat .tmp + rename
+};
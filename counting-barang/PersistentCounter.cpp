@@ -0,0 +1,156 @@
+#include "PersistentCounter.h"
+#include <esp_attr.h>
+#include <esp_system.h>
+#include <stddef.h>
+
+namespace {
+// salinan total di RTC slow memory; tidak di-nol-kan saat soft reset
+struct __attribute__((packed)) RtcShadow {
+  uint32_t magic; uint8_t n;
+  struct __attribute__((packed)) { uint8_t id; uint32_t total; } s[PersistentCounter::MAX_IDS];
+  uint32_t crc;
+};
+RTC_NOINIT_ATTR RtcShadow rtcShadow;
+const uint32_t RTC_MAGIC = 0x50434E54; // "PCNT"
+}
+
+static uint32_t fnv1a32(const void* p, size_t n){
+  const uint8_t* b = (const uint8_t*)p;
+  uint32_t h = 2166136261UL;
+  while (n--) { h ^= *b++; h *= 16777619UL; }
+  return h;
+}
+
+static void journalKey(uint32_t seq, char* key){
+  snprintf(key, 4, "j%u", (unsigned)(seq % PersistentCounter::JOURNAL_SLOTS));
+}
+
+const char* PersistentCounter::sourceName(Source s){
+  switch (s) {
+    case Source::Flash:     return "flash";
+    case Source::RtcMemory: return "rtc";
+    default:                return "none";
+  }
+}
+
+bool PersistentCounter::begin(const char* ns){
+  const uint32_t t0 = micros();
+  _open = _nvs.begin(ns, false);
+  if (_open) restoreFlash();
+  if (restoreRtc()) _stats.restored = Source::RtcMemory;
+  saveRtc();
+  _stats.restoreUs = micros() - t0;
+  Serial.printf("[COUNT] Restore %s: %u id, seq %lu (%lu us)\n", sourceName(_stats.restored), _n,
+                (unsigned long)_seq, (unsigned long)_stats.restoreUs);
+  return _open;
+}
+
+void PersistentCounter::restoreFlash(){
+  Checkpoint ck;
+  if (_nvs.getBytesLength("ck") == sizeof(ck) && _nvs.getBytes("ck", &ck, sizeof(ck)) == sizeof(ck) &&
+      memcmp(ck.magic, "PCK1", 4) == 0 && ck.n <= MAX_IDS && ck.crc == fnv1a32(&ck, offsetof(Checkpoint, crc))) {
+    _seq = _ckptSeq = ck.seq;
+    for (uint8_t i = 0; i < ck.n; i++) slotFor(ck.s[i].id)->total = ck.s[i].total;
+    _stats.restored = Source::Flash;
+  }
+  // record journal sesudah checkpoint; record lebih lama (seq <= checkpoint) sudah tercakup
+  for (uint8_t j = 0; j < JOURNAL_SLOTS; j++) {
+    char key[4]; journalKey(j, key);
+    if (!_nvs.isKey(key)) continue;
+    const uint64_t r = _nvs.getULong64(key, 0);
+    const uint32_t seq = r >> 32;
+    if (!r || seq <= _ckptSeq) continue;
+    slotFor((r >> 24) & 0xFF)->total += r & 0xFFFFFF;
+    if (seq > _seq) _seq = seq;
+    _stats.restored = Source::Flash;
+  }
+  for (uint8_t i = 0; i < _n; i++) _s[i].committed = _s[i].total;
+}
+
+bool PersistentCounter::restoreRtc(){
+  const esp_reset_reason_t why = esp_reset_reason();
+  if (why == ESP_RST_POWERON || why == ESP_RST_BROWNOUT || why == ESP_RST_UNKNOWN) return false;
+  if (rtcShadow.magic != RTC_MAGIC || rtcShadow.n > MAX_IDS ||
+      rtcShadow.crc != fnv1a32(&rtcShadow, offsetof(RtcShadow, crc))) return false;
+  bool newer = false;
+  for (uint8_t i = 0; i < rtcShadow.n; i++) {
+    Slot* s = slotFor(rtcShadow.s[i].id);
+    if (rtcShadow.s[i].total > s->total) { s->total = rtcShadow.s[i].total; newer = true; } // selisih = pending, di-commit nanti
+  }
+  return newer;
+}
+
+void PersistentCounter::saveRtc(){
+  rtcShadow.magic = RTC_MAGIC; rtcShadow.n = _n;
+  for (uint8_t i = 0; i < _n; i++) { rtcShadow.s[i].id = _s[i].id; rtcShadow.s[i].total = _s[i].total; }
+  rtcShadow.crc = fnv1a32(&rtcShadow, offsetof(RtcShadow, crc));
+}
+
+PersistentCounter::Slot* PersistentCounter::find(uint8_t id){
+  for (uint8_t i = 0; i < _n; i++) if (_s[i].id == id) return &_s[i];
+  return nullptr;
+}
+
+PersistentCounter::Slot* PersistentCounter::slotFor(uint8_t id){
+  if (Slot* s = find(id)) return s;
+  if (_n < MAX_IDS) { _s[_n] = Slot{ id, 0, 0, _use }; return &_s[_n++]; }
+  // penuh (lane id pernah diganti): singkirkan id yang paling lama tidak bertambah,
+  // lalu checkpoint supaya record journal id itu tidak ikut di-replay
+  uint8_t old = 0;
+  for (uint8_t i = 1; i < _n; i++) if (_s[i].lastUse < _s[old].lastUse) old = i;
+  _s[old] = Slot{ id, 0, 0, _use };
+  if (_open) writeCheckpoint();
+  return &_s[old];
+}
+
+uint32_t PersistentCounter::get(uint8_t id) const {
+  for (uint8_t i = 0; i < _n; i++) if (_s[i].id == id) return _s[i].total;
+  return 0;
+}
+
+uint32_t PersistentCounter::add(uint8_t id, uint32_t delta){
+  Slot* s = slotFor(id);
+  s->total += delta; s->lastUse = ++_use;
+  _stats.counts += delta; _lastAdd = millis();
+  saveRtc();
+  if (s->total - s->committed >= COMMIT_EVERY) writeRecord(*s);
+  return s->total;
+}
+
+void PersistentCounter::loop(){
+  if (_lastAdd && millis() - _lastAdd >= COMMIT_MS) { commit(); _lastAdd = 0; }
+}
+
+bool PersistentCounter::commit(){
+  bool ok = true;
+  for (uint8_t i = 0; i < _n; i++) if (_s[i].total != _s[i].committed) ok &= writeRecord(_s[i]);
+  return ok;
+}
+
+bool PersistentCounter::writeRecord(Slot& s){
+  if (!_open) return false;
+  while (s.total != s.committed) {
+    const uint32_t delta = min(s.total - s.committed, (uint32_t)0xFFFFFF);
+    char key[4]; journalKey(++_seq, key);
+    if (!_nvs.putULong64(key, ((uint64_t)_seq << 32) | ((uint64_t)s.id << 24) | delta)) { _seq--; return false; }
+    s.committed += delta;
+    _stats.journalWrites++; _stats.flashBytes += NVS_ENTRY_BYTES;
+    // ring penuh: checkpoint dulu sebelum record berikutnya menimpa slot yang belum tercakup
+    if (_seq - _ckptSeq >= JOURNAL_SLOTS && !writeCheckpoint()) return false;
+  }
+  return true;
+}
+
+bool PersistentCounter::writeCheckpoint(){
+  Checkpoint ck = {};
+  memcpy(ck.magic, "PCK1", 4);
+  ck.seq = _seq; ck.n = _n;
+  for (uint8_t i = 0; i < _n; i++) { ck.s[i].id = _s[i].id; ck.s[i].total = _s[i].total; }
+  ck.crc = fnv1a32(&ck, offsetof(Checkpoint, crc));
+  if (_nvs.putBytes("ck", &ck, sizeof(ck)) != sizeof(ck)) return false;
+  _ckptSeq = _seq;
+  for (uint8_t i = 0; i < _n; i++) _s[i].committed = _s[i].total;
+  // blob NVS: entry header + entry indeks + data per 32 byte
+  _stats.checkpoints++; _stats.flashBytes += NVS_ENTRY_BYTES * (2 + (sizeof(ck) + NVS_ENTRY_BYTES - 1) / NVS_ENTRY_BYTES);
+  return true;
+}
@@ -0,0 +1,63 @@
+#pragma once
+#include <Arduino.h>
+#include <Preferences.h>
+
+// Counter kumulatif per lane id yang selamat dari reboot, dengan tulis flash seminimal mungkin.
+//   - Journal: tiap commit menulis satu record u64 (seq 32 | id 8 | delta 24) ke ring
+//     JOURNAL_SLOTS key NVS ("j0".."j15"); satu record = satu entry NVS 32 byte.
+//   - Checkpoint: blob "ck" berisi total semua id, ditulis tiap kali ring penuh
+//     (sebelum slot tertua ditimpa). Restore = checkpoint + record dengan seq > seq checkpoint.
+//   - Commit terjadi saat pending satu id mencapai COMMIT_EVERY, atau COMMIT_MS setelah
+//     hitungan terakhir. Listrik putus kehilangan < COMMIT_EVERY hitungan per id.
+//   - Salinan di RTC memory (tahan soft reset / panic / watchdog, tidak tahan power-on):
+//     setelah soft reset hitungan yang belum di-commit pun pulih.
+// NVS sendiri menulis append-only & merotasi page, jadi tulisan tersebar di seluruh partisi.
+class PersistentCounter {
+public:
+  static const uint8_t  MAX_IDS        = 8;
+  static const uint8_t  JOURNAL_SLOTS  = 16;
+  static const uint32_t COMMIT_EVERY   = 16;
+  static const uint32_t COMMIT_MS      = 10000;
+  static const size_t   NVS_ENTRY_BYTES = 32;
+
+  enum class Source : uint8_t { None, Flash, RtcMemory };
+  struct Stats {
+    uint32_t counts = 0;         // hitungan sejak boot
+    uint32_t journalWrites = 0, checkpoints = 0;
+    uint32_t flashBytes = 0;     // perkiraan byte entry NVS yang ditulis sejak boot
+    Source restored = Source::None;
+    uint32_t restoreUs = 0;
+  };
+
+  bool begin(const char* ns = "counter");
+  uint32_t add(uint8_t id, uint32_t delta = 1); // return total baru
+  uint32_t get(uint8_t id) const;
+  void loop();      // commit berbasis waktu
+  bool commit();    // tulis semua pending sekarang (mis. sebelum restart terencana)
+  const Stats& stats() const { return _stats; }
+  uint32_t lossBound() const { return COMMIT_EVERY - 1; } // maks hitungan hilang per id saat listrik putus
+  // byte flash per hitungan; bandingkan dengan NVS_ENTRY_BYTES (tulis counter tiap hitungan)
+  float writeAmplification() const { return _stats.counts ? (float)_stats.flashBytes / _stats.counts : 0; }
+  static const char* sourceName(Source s);
+
+private:
+  struct Slot { uint8_t id; uint32_t total, committed, lastUse; };
+  struct __attribute__((packed)) Checkpoint {
+    char magic[4]; uint32_t seq; uint8_t n; struct __attribute__((packed)) { uint8_t id; uint32_t total; } s[MAX_IDS]; uint32_t crc;
+  };
+
+  Preferences _nvs;
+  bool _open = false;
+  Slot _s[MAX_IDS];
+  uint8_t _n = 0;
+  uint32_t _seq = 0, _ckptSeq = 0, _use = 0, _lastAdd = 0;
+  Stats _stats;
+
+  Slot* find(uint8_t id);
+  Slot* slotFor(uint8_t id); // buat bila belum ada; id terlama tersingkir bila penuh
+  bool writeRecord(Slot& s);
+  bool writeCheckpoint();
+  void restoreFlash();
+  bool restoreRtc();
+  void saveRtc();
+};
@@ -1,9 +1,11 @@
 #include "RTCClockDS3231.h"
-#include <WiFi.h>
-#include <time.h> 
+#include <esp_timer.h>
 
-bool RTCClockDS3231::begin(){
+int32_t RTCClockDS3231::_tzS = RTCClockDS3231::DEFAULT_TZ_S;
+
+bool RTCClockDS3231::begin(int sqwPin){
   if (!_rtc.begin()) return false;
+  startClock(sqwPin);
   return true;
 }
 
@@ -14,26 +16,254 @@ bool RTCClockDS3231::isValid(){
 }
 
 void RTCClockDS3231::nowLocal(String& tanggal, String& waktu){
-  DateTime n = _rtc.now();
-  // Anggap RTC sudah berisi WIB (paling aman untuk offline). Jika ingin RTC diset UTC, ubah offset di sini.
-  char buf1[16], buf2[16];
-  snprintf(buf1, sizeof(buf1), "%04d-%02d-%02d", n.year(), n.month(), n.day());
-  snprintf(buf2, sizeof(buf2), "%02d:%02d:%02d", n.hour(), n.minute(), n.second());
+  char buf1[11], buf2[9];
+  formatLocal(nowMs(), buf1, buf2);
   tanggal = buf1; waktu = buf2;
 }
 
-bool RTCClockDS3231::syncFromNTPAndSetRTC(uint32_t timeoutMs){
-  if (WiFi.status() != WL_CONNECTED) return false;
-  configTime(7*3600, 0, "pool.ntp.org", "time.nist.gov"); // UTC+7
-  const uint32_t t0 = millis();
-  struct tm info{};
-  while (millis()-t0 < timeoutMs){ if (getLocalTime(&info, 200)) break; }
-  if (info.tm_year == 0) return false;
-  DateTime dt(info.tm_year + 1900, info.tm_mon+1, info.tm_mday, info.tm_hour, info.tm_min, info.tm_sec);
-  _rtc.adjust(dt);
+float RTCClockDS3231::getTemp(){
+  return _rtc.getTemperature();
+}
+
+// ---------------- timebase ms ----------------
+
+void ClockDiscipline::anchor(int64_t us, uint64_t epochUs){
+  _baseUs = us; _baseEpochUs = epochUs; _valid = true;
+  _edgeUs = 0; _edgeSec = 0; // tepi berikutnya hanya set fase, laju dihitung mulai tepi sesudahnya
+}
+
+uint64_t ClockDiscipline::at(int64_t us) const {
+  const int64_t dt = us - _baseUs;
+  return _baseEpochUs + dt - dt * _ppb / 1000000000LL;
+}
+
+void ClockDiscipline::edge(int64_t us, uint64_t epochSec){
+  const uint64_t rtcUs = epochSec * 1000000ULL;
+  if (_valid) _lastErrUs = (int64_t)(at(us) - rtcUs);
+  if (_edgeUs && epochSec > _edgeSec && epochSec - _edgeSec <= 600) {
+    const int64_t dRtc = (int64_t)(epochSec - _edgeSec) * 1000000LL, dTimer = us - _edgeUs;
+    const int64_t inst = (dTimer - dRtc) * 1000000000LL / dRtc;
+    if (inst > -500000 && inst < 500000) _ppb += (int32_t)((inst - _ppb) / 8); // > 500 ppm = tepi terlewat
+  }
+  _edgeUs = us; _edgeSec = epochSec;
+  _baseUs = us; _baseEpochUs = rtcUs; _valid = true;
+}
+
+// tanggal <-> jumlah hari sejak 1970-01-01 (kalender Gregorian proleptik)
+static int32_t daysFromCivil(int y, unsigned m, unsigned d){
+  y -= m <= 2;
+  const int era = (y >= 0 ? y : y - 399) / 400;
+  const unsigned yoe = (unsigned)(y - era * 400);
+  const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+  return era * 146097 + (int32_t)(yoe * 365 + yoe / 4 - yoe / 100 + doy) - 719468;
+}
+
+static void civilFromDays(int32_t z, int& y, unsigned& m, unsigned& d){
+  z += 719468;
+  const int era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = (unsigned)(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = (int)yoe + era * 400 + (m <= 2);
+}
+
+void RTCClockDS3231::formatLocal(uint64_t epochMs, char* tanggal, char* waktu){
+  const int64_t local = (int64_t)(epochMs / 1000) + _tzS;
+  const int32_t days = (int32_t)(local / 86400), sec = (int32_t)(local % 86400);
+  int y; unsigned m, d;
+  civilFromDays(days, y, m, d);
+  snprintf(tanggal, 11, "%04d-%02u-%02u", y, m, d);
+  snprintf(waktu, 9, "%02d:%02d:%02d", (int)(sec / 3600), (int)(sec / 60 % 60), (int)(sec % 60));
+}
+
+uint64_t RTCClockDS3231::parseLocal(const char* tanggal, const char* waktu){
+  int y; unsigned mo, d, h, mi, se;
+  if (!tanggal || !waktu || sscanf(tanggal, "%d-%u-%u", &y, &mo, &d) != 3 || sscanf(waktu, "%u:%u:%u", &h, &mi, &se) != 3) return 0;
+  const int64_t local = (int64_t)daysFromCivil(y, mo, d) * 86400 + h * 3600 + mi * 60 + se;
+  return local > _tzS ? (uint64_t)(local - _tzS) * 1000 : 0;
+}
+
+void IRAM_ATTR RTCClockDS3231::sqwIsr(void* arg){
+  RTCClockDS3231* self = (RTCClockDS3231*)arg;
+  portENTER_CRITICAL_ISR(&self->_mux);
+  self->_sqwUs = esp_timer_get_time();
+  self->_sqwEdges++;
+  portEXIT_CRITICAL_ISR(&self->_mux);
+}
+
+bool RTCClockDS3231::readRtcSec(uint64_t& epochSec){
+  DateTime n = _rtc.now();
+  _cs.rtcReads++; _lastRead = millis();
+  if (n.year() < 2020 || n.year() > 2099) return false;
+  epochSec = n.unixtime() - _tzS;
   return true;
 }
 
-float RTCClockDS3231::getTemp(){
-  return _rtc.getTemperature();
-}
\ No newline at end of file
+// RTC dibaca sekali (fase +-0.5 s); dengan SQW fase dikunci ke tepi detik berikutnya
+void RTCClockDS3231::startClock(int sqwPin){
+  _sqwPin = sqwPin;
+  uint64_t sec;
+  if (readRtcSec(sec)) {
+    portENTER_CRITICAL(&_mux);
+    _clk.anchor(esp_timer_get_time(), sec * 1000000ULL + 500000);
+    portEXIT_CRITICAL(&_mux);
+  }
+  if (_sqwPin < 0) return;
+  _rtc.writeSqwPinMode(DS3231_SquareWave1Hz);
+  pinMode(_sqwPin, INPUT_PULLUP);
+  // register detik DS3231 naik pada tepi turun SQW 1 Hz
+  attachInterruptArg(_sqwPin, sqwIsr, this, FALLING);
+  _cs.sqw = true;
+}
+
+uint64_t RTCClockDS3231::nowMs(){
+  if (!_clk.valid()) return 0;
+  const int64_t us = esp_timer_get_time();
+  portENTER_CRITICAL(&_mux);
+  const uint64_t raw = _clk.at(us);
+  uint64_t ms = (uint64_t)((int64_t)raw - correctionAt(raw)) / 1000;
+  if (ms < _lastMs) ms = _lastMs; // koreksi fase mundur ditahan, jam tidak pernah mundur
+  else _lastMs = ms;
+  portEXIT_CRITICAL(&_mux);
+  return ms;
+}
+
+void RTCClockDS3231::loopClock(){
+  if (_wrPending && loopWrite()) return; // menunggu batas detik; jangan baca RTC yang akan ditimpa
+  if (_sqwPin < 0) {
+    // tanpa SQW: cek kasar tiap menit, lompat hanya bila beda > 1 s
+    if (millis() - _lastRead < 60000UL) return;
+    uint64_t sec;
+    if (!readRtcSec(sec)) return;
+    const int64_t now = esp_timer_get_time();
+    const int64_t err = (int64_t)(_clk.at(now) / 1000000ULL) - (int64_t)sec;
+    if (_clk.valid() && err >= -1 && err <= 1) return;
+    // beda 2 s = drift esp_timer vs RTC sejak fase terakhir: fase di-snap, koreksi tetap
+    // (seperti tepi SQW). Lebih jauh = RTC diubah dari luar: koreksi ikut bergeser.
+    const bool drift = _clk.valid() && err >= -2 && err <= 2;
+    int64_t jump = 0;
+    portENTER_CRITICAL(&_mux);
+    if (drift) _clk.anchor(now, sec * 1000000ULL + 500000);
+    else jump = rawStep(now, sec * 1000000ULL + 500000);
+    portEXIT_CRITICAL(&_mux);
+    _cs.steps++;
+    if (jump && _stepCb) _stepCb(jump);
+    return;
+  }
+
+  int64_t us; uint32_t edges;
+  portENTER_CRITICAL(&_mux);
+  us = _sqwUs; edges = _sqwEdges;
+  portEXIT_CRITICAL(&_mux);
+  if (edges == _seenEdges) return;
+  const uint32_t n = edges - _seenEdges;
+  _seenEdges = edges; _cs.edges += n;
+
+  uint64_t sec;
+  if (_needRead || millis() - _lastRead >= 600000UL) {
+    // detik RTC dibaca via I2C hanya pada tepi pertama, setelah adjust & tiap 10 menit;
+    // harus sebelum tepi berikutnya, jadi lewati bila loop() tertahan terlalu lama
+    if (esp_timer_get_time() - us > 800000 || !readRtcSec(sec)) { _needRead = true; return; }
+    _needRead = false;
+  } else {
+    sec = _clk.edgeSec() + n;
+  }
+  const bool phased = _clk.edgeSec() != 0;
+  portENTER_CRITICAL(&_mux);
+  _clk.edge(us, sec);
+  const int64_t err = _clk.lastErrUs();
+  const bool step = phased && (err > 1000000 || err < -1000000);
+  if (step) _corrErrUs -= err; // fase melompat (RTC diubah dari luar): koreksi ikut bergeser
+  portEXIT_CRITICAL(&_mux);
+  _cs.ppb = _clk.ppb();
+  _cs.lastErrUs = (int32_t)(err > 2000000000LL ? 2000000000LL : err < -2000000000LL ? -2000000000LL : err);
+  if (phased && abs(_cs.lastErrUs) > abs(_cs.maxErrUs)) _cs.maxErrUs = _cs.lastErrUs;
+  if (err > 1000000 || err < -1000000) _cs.steps++;
+  if (step && _stepCb) _stepCb(err);
+}
+
+// ---------------- koreksi SNTP & tulis RTC ----------------
+
+int64_t RTCClockDS3231::modelAt(uint64_t raw) const {
+  return _corrErrUs + (_corrRefUs ? (int64_t)(raw - _corrRefUs) * _corrPpb / 1000000000LL : 0);
+}
+
+int64_t RTCClockDS3231::slewLeft(uint64_t raw) const {
+  if (!_slewUs) return 0;
+  const int64_t done = raw > _slewAtUs ? (int64_t)(raw - _slewAtUs) * SLEW_PPM / 1000000 : 0;
+  if (_slewUs > 0) return _slewUs > done ? _slewUs - done : 0;
+  return -_slewUs > done ? _slewUs + done : 0;
+}
+
+int64_t RTCClockDS3231::rawStep(int64_t us, uint64_t newRaw){
+  if (!_clk.valid()) { _clk.anchor(us, newRaw); _lastMs = 0; return 0; }
+  const uint64_t rawOld = _clk.at(us);
+  const int64_t jump = (int64_t)(rawOld - newRaw);
+  _corrErrUs = modelAt(rawOld) - jump; _corrRefUs = newRaw;
+  _slewUs = slewLeft(rawOld); _slewAtUs = newRaw;
+  _clk.anchor(us, newRaw);
+  return jump;
+}
+
+uint64_t RTCClockDS3231::rawUs(){
+  if (!_clk.valid()) return 0;
+  const int64_t us = esp_timer_get_time();
+  portENTER_CRITICAL(&_mux);
+  const uint64_t raw = _clk.at(us);
+  portEXIT_CRITICAL(&_mux);
+  return raw;
+}
+
+int64_t RTCClockDS3231::correctionUs(){
+  const uint64_t raw = rawUs();
+  portENTER_CRITICAL(&_mux);
+  const int64_t c = correctionAt(raw);
+  portEXIT_CRITICAL(&_mux);
+  return c;
+}
+
+void RTCClockDS3231::setCorrection(int64_t errUs, uint64_t refRawUs, int32_t ppb, bool slew){
+  if (ppb > MAX_PPB) ppb = MAX_PPB; else if (ppb < -MAX_PPB) ppb = -MAX_PPB;
+  const uint64_t raw = rawUs();
+  portENTER_CRITICAL(&_mux);
+  const int64_t before = raw ? correctionAt(raw) : 0;
+  _corrErrUs = errUs; _corrRefUs = refRawUs; _corrPpb = ppb; _slewUs = 0;
+  if (slew && raw) { _slewUs = before - correctionAt(raw); _slewAtUs = raw; } // selisih dilunasi bertahap
+  else _lastMs = 0;                                                          // step: boleh mundur
+  portEXIT_CRITICAL(&_mux);
+}
+
+void RTCClockDS3231::setTzOffsetS(int32_t s){
+  if (s == _tzS) return;
+  const uint64_t now = nowMs();
+  _tzS = s;
+  if (now) writeRtc(now); // isi RTC = waktu lokal; tanpa ditulis ulang, pembacaan berikut salah zona
+}
+
+void RTCClockDS3231::writeRtc(uint64_t epochMs){
+  _wrBaseUs = esp_timer_get_time();
+  _wrEpochUs = epochMs * 1000ULL;
+  _wrPending = true;
+}
+
+// true = masih menunggu. DS3231 mulai menghitung detik baru sejak register ditulis, jadi
+// tulis tepat setelah batas detik (sisa fase = error RTC, ditutup koreksi perangkat lunak)
+bool RTCClockDS3231::loopWrite(){
+  const int64_t us = esp_timer_get_time();
+  const uint64_t t = _wrEpochUs + (us - _wrBaseUs);
+  if (t % 1000000ULL > 30000 && us - _wrBaseUs < 5000000) return true;
+  const uint64_t sec = t / 1000000ULL;
+  _rtc.adjust(DateTime((uint32_t)(sec + _tzS)));
+  portENTER_CRITICAL(&_mux);
+  const int64_t jump = rawStep(us, sec * 1000000ULL);
+  _seenEdges = _sqwEdges; // tepi sebelum tulis tidak dipakai
+  portEXIT_CRITICAL(&_mux);
+  _wrPending = false; _needRead = true; _lastRead = millis();
+  _cs.rtcWrites++;
+  Serial.printf("[RTC] Ditulis, geser %lld ms\n", (long long)(jump / 1000));
+  if (jump && _stepCb) _stepCb(jump);
+  return false;
+}
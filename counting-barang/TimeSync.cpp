@@ -0,0 +1,271 @@
+#include "TimeSync.h"
+#include "FlashWear.h"
+#include <LittleFS.h>
+#include <esp_timer.h>
+#include <math.h>
+
+static const uint64_t NTP_UNIX_DELTA = 2208988800ULL; // detik 1900-01-01 .. 1970-01-01
+
+static void toNtp(uint64_t epochUs, uint8_t* b){
+  const uint32_t sec = (uint32_t)(epochUs / 1000000ULL + NTP_UNIX_DELTA);
+  const uint32_t frac = (uint32_t)(((epochUs % 1000000ULL) << 32) / 1000000ULL);
+  for (int i = 0; i < 4; i++) { b[i] = sec >> (24 - 8 * i); b[4 + i] = frac >> (24 - 8 * i); }
+}
+
+static uint64_t fromNtp(const uint8_t* b){
+  uint32_t sec = 0, frac = 0;
+  for (int i = 0; i < 4; i++) { sec = (sec << 8) | b[i]; frac = (frac << 8) | b[4 + i]; }
+  uint64_t s = sec;
+  if (sec < 0x80000000UL) s += 1ULL << 32; // era 1 (setelah 2036-02-07)
+  return (s - NTP_UNIX_DELTA) * 1000000ULL + (((uint64_t)frac * 1000000ULL) >> 32);
+}
+
+static int32_t clamp32(int64_t v){ return (int32_t)(v > INT32_MAX ? INT32_MAX : v < INT32_MIN ? INT32_MIN : v); }
+
+// ---------------- DriftEstimator ----------------
+
+void DriftEstimator::add(uint32_t tSec, int64_t errUs){
+  if (_n && tSec <= _t[idx(_n - 1)]) clear(); // jam server mundur: riwayat tidak bisa dipakai
+  _t[_head] = tSec; _e[_head] = errUs;
+  _head = (_head + 1) % N;
+  if (_n < N) _n++;
+}
+
+void DriftEstimator::shift(int64_t deltaUs){
+  for (uint8_t i = 0; i < _n; i++) _e[idx(i)] += deltaUs;
+}
+
+uint32_t DriftEstimator::spanS() const {
+  return _n < 2 ? 0 : _t[idx(_n - 1)] - _t[idx(0)];
+}
+
+bool DriftEstimator::fit(double& slope, double& icept) const {
+  if (_n < 2) return false;
+  const uint32_t t0 = _t[idx(0)];
+  double mx = 0, my = 0;
+  for (uint8_t i = 0; i < _n; i++) { mx += _t[idx(i)] - t0; my += (double)_e[idx(i)]; }
+  mx /= _n; my /= _n;
+  double sxx = 0, sxy = 0;
+  for (uint8_t i = 0; i < _n; i++) {
+    const double dx = (_t[idx(i)] - t0) - mx;
+    sxx += dx * dx; sxy += dx * ((double)_e[idx(i)] - my);
+  }
+  if (sxx <= 0) return false;
+  slope = sxy / sxx; icept = my - slope * mx;
+  return true;
+}
+
+int32_t DriftEstimator::ppb() const {
+  double slope, icept;
+  if (!fit(slope, icept)) return 0;
+  return (int32_t)lround(slope * 1000.0); // us per detik = ppm
+}
+
+int64_t DriftEstimator::residualUs() const {
+  double slope, icept;
+  if (!fit(slope, icept)) return 0;
+  const uint32_t t0 = _t[idx(0)];
+  double ss = 0;
+  for (uint8_t i = 0; i < _n; i++) {
+    const double r = (double)_e[idx(i)] - (icept + slope * (_t[idx(i)] - t0));
+    ss += r * r;
+  }
+  return (int64_t)sqrt(ss / _n);
+}
+
+void DriftEstimator::toJson(JsonArray a) const {
+  for (uint8_t i = 0; i < _n; i++) { JsonArray s = a.add<JsonArray>(); s.add(_t[idx(i)]); s.add(_e[idx(i)]); }
+}
+
+void DriftEstimator::fromJson(JsonArrayConst a){
+  clear();
+  for (JsonArrayConst s : a) add(s[0] | 0UL, s[1] | (int64_t)0);
+}
+
+// ---------------- TimeSync ----------------
+
+void TimeSync::begin(RTCClockDS3231& rtc, const char* path){
+  _rtc = &rtc; _path = path;
+  load();
+  RTCClockDS3231::initTz(_set.tzMin * 60);
+  // raw melompat (RTC ditulis): riwayat offset digeser supaya kemiringan tetap benar
+  _rtc->onRawStep([this](int64_t jumpUs){ _est.shift(-jumpUs); save(); });
+}
+
+bool TimeSync::requestSettings(const Settings& s){
+  if (!s.server[0] || s.intervalMin < 1 || s.intervalMin > 1440 || s.thresholdMs < 10 || s.thresholdMs > 60000 ||
+      s.maxDelayMs < 10 || s.maxDelayMs > 2000 || s.tzMin < -720 || s.tzMin > 840) return false;
+  portENTER_CRITICAL(&_mux);
+  _pend = s; _pendReady = true;
+  portEXIT_CRITICAL(&_mux);
+  return true;
+}
+
+void TimeSync::applySettings(){
+  portENTER_CRITICAL(&_mux);
+  const Settings s = _pend; _pendReady = false;
+  portEXIT_CRITICAL(&_mux);
+  if (strcmp(s.server, _set.server) != 0) { _syncReq = true; _backoffMs = RETRY_MS; }
+  if (_st.lastSyncMs && s.intervalMin != _set.intervalMin) _nextMs = _st.lastSyncMs + s.intervalMin * 60000UL;
+  _set = s;
+  _rtc->setTzOffsetS(_set.tzMin * 60);
+  save();
+}
+
+void TimeSync::loop(bool wifiUp, bool ethUp){
+  if (_pendReady) applySettings();
+  const uint32_t now = millis();
+  switch (_state) {
+    case State::Idle:
+      if (_syncReq) { _syncReq = false; _nextMs = now; }
+      // raw belum terkunci (boot / sesudah tulis RTC): sampel akan membawa error fase ke koreksi
+      if ((int32_t)(now - _nextMs) < 0 || (!wifiUp && !ethUp) || !_rtc->phaseLocked()) return;
+      _tries = 0; _haveBest = false;
+      break;
+    case State::Wait:
+      if (!receive() && now - _sentMs < REPLY_TIMEOUT_MS) return;
+      if (++_tries >= BURST) { finishBurst(); return; }
+      _state = State::Gap;
+      return;
+    case State::Gap:
+      if (now - _sentMs < BURST_GAP_MS) return;
+      break;
+  }
+  // permintaan berikutnya dalam burst
+  if (send(wifiUp, ethUp)) _state = State::Wait;
+  else if (++_tries >= BURST) finishBurst();
+  else { _sentMs = now; _state = State::Gap; }
+}
+
+bool TimeSync::send(bool wifiUp, bool ethUp){
+  UDP* u = wifiUp ? (UDP*)&_wifiUdp : ethUp ? (UDP*)&_ethUdp : nullptr;
+  if (!u) return false;
+  if (u != _udp) {
+    if (_udp) _udp->stop();
+    _udp = u;
+    if (!_udp->begin(LOCAL_PORT)) { _udp = nullptr; return false; }
+    _st.nic = wifiUp ? "wifi" : "eth";
+  }
+  uint8_t pkt[48];
+  while (_udp->parsePacket() > 0) _udp->read(pkt, sizeof(pkt)); // balasan basi
+  // nama host di-resolve library di beginPacket (DNS bisa menahan loop sebentar); T1 sesudahnya
+  if (!_udp->beginPacket(_set.server, NTP_PORT)) return false;
+  memset(pkt, 0, sizeof(pkt));
+  pkt[0] = 0x23; // LI 0, versi 4, mode 3 (client)
+  _t1Us = esp_timer_get_time(); _t1Raw = _rtc->rawUs();
+  toNtp(_t1Raw ? _t1Raw : (uint64_t)_t1Us, _txStamp); // cukup unik walau RTC belum valid
+  memcpy(pkt + 40, _txStamp, 8);
+  _udp->write(pkt, sizeof(pkt));
+  if (!_udp->endPacket()) return false;
+  _st.requests++; _sentMs = millis();
+  return true;
+}
+
+// true = balasan untuk permintaan ini sudah diterima (valid atau ditolak)
+bool TimeSync::receive(){
+  const int n = _udp ? _udp->parsePacket() : 0;
+  if (n <= 0) return false;
+  const int64_t t4Us = esp_timer_get_time();
+  const uint64_t t4Raw = _rtc->rawUs();
+  uint8_t p[48];
+  if (n < 48 || _udp->read(p, sizeof(p)) != 48) return false;
+  if (memcmp(p + 24, _txStamp, 8) != 0) return false; // bukan balasan permintaan terakhir
+  // mode 4 (server), LI 3 = server belum sinkron, stratum 0 = kiss-o'-death
+  if ((p[0] & 7) != 4 || (p[0] >> 6) == 3 || p[1] == 0 || p[1] > 15) { _st.rejected++; return true; }
+  const uint64_t t2 = fromNtp(p + 32), t3 = fromNtp(p + 40);
+  int64_t rtt = (t4Us - _t1Us) - (int64_t)(t3 - t2);
+  if (rtt < 0) rtt = 0;
+  if (rtt > _set.maxDelayMs * 1000LL) { _st.rejected++; return true; }
+  Sample s;
+  s.delayUs = (uint32_t)rtt; s.stratum = p[1];
+  s.usAt = t4Us; s.rawAt = _t1Raw ? t4Raw : 0;
+  s.serverAt = t3 + rtt / 2;                           // waktu server pada T4
+  s.offsetUs = s.rawAt ? (int64_t)(s.serverAt - s.rawAt) : 0; // = ((T2-T1)+(T3-T4))/2
+  if (!_haveBest || s.delayUs < _best.delayUs) { _best = s; _haveBest = true; }
+  return true;
+}
+
+void TimeSync::finishBurst(){
+  _state = State::Idle;
+  const uint32_t interval = _set.intervalMin * 60000UL;
+  if (!_haveBest) {
+    _st.failures++;
+    _nextMs = millis() + _backoffMs;
+    Serial.printf("[TIME] Sync gagal (%s), ulang %lu s\n", _set.server, (unsigned long)(_backoffMs / 1000));
+    _backoffMs = min(_backoffMs * 2, interval);
+    return;
+  }
+  apply(_best);
+  _st.syncs++; _st.lastSyncMs = millis();
+  _nextMs = _st.lastSyncMs + interval; _backoffMs = RETRY_MS;
+  save();
+}
+
+void TimeSync::apply(const Sample& s){
+  _st.delayUs = s.delayUs; _st.stratum = s.stratum;
+  const uint64_t serverNowUs = s.serverAt + (esp_timer_get_time() - s.usAt);
+  if (!s.rawAt) {
+    // RTC belum pernah valid (baterai habis / modul baru): tulis langsung, koreksi lama tidak berlaku
+    _st.offsetUs = _st.rtcErrUs = 0;
+    _est.clear();
+    _rtc->setCorrection(0, 0, 0, false);
+    _rtc->writeRtc(serverNowUs / 1000);
+    Serial.println("[TIME] RTC di-set dari SNTP");
+    return;
+  }
+  const int64_t err = -s.offsetUs;                         // raw RTC - server
+  const int64_t corrBefore = _rtc->correctionUs();
+  _st.rtcErrUs = clamp32(err);
+  _st.offsetUs = clamp32(s.offsetUs + corrBefore);         // error jam terkoreksi sebelum sinkron ini
+  _est.add((uint32_t)(s.serverAt / 1000000ULL), err);
+  // offset diambil langsung dari pengukuran; laju dari estimator, atau nilai tersimpan sampai siap
+  const int32_t ppb = _est.ready() ? _est.ppb() : _rtc->correctionPpb();
+  const int64_t limit = _set.thresholdMs * 1000LL;
+  _rtc->setCorrection(err, s.rawAt, ppb, llabs(_st.offsetUs) <= limit);
+  if (llabs(err) > limit) _rtc->writeRtc(serverNowUs / 1000);
+  Serial.printf("[TIME] Sync %s: offset %ld us, RTC %ld us, delay %lu us, drift %.3f ppm\n", _st.nic,
+                (long)_st.offsetUs, (long)_st.rtcErrUs, (unsigned long)s.delayUs, ppb / 1000.0);
+}
+
+void TimeSync::load(){
+  File f = LittleFS.open(_path, "r");
+  if (!f) return;
+  JsonDocument d;
+  if (!deserializeJson(d, f)) {
+    if (d["server"].is<const char*>()) strlcpy(_set.server, d["server"], sizeof(_set.server));
+    _set.intervalMin = d["interval_min"] | _set.intervalMin;
+    _set.thresholdMs = d["threshold_ms"] | _set.thresholdMs;
+    _set.maxDelayMs = d["max_delay_ms"] | _set.maxDelayMs;
+    _set.tzMin = d["tz_min"] | _set.tzMin;
+    _rtc->setCorrection(d["err_us"] | (int64_t)0, d["ref_us"] | (uint64_t)0, d["ppb"] | 0, false);
+    _est.fromJson(d["samples"].as<JsonArrayConst>());
+  }
+  f.close();
+}
+
+void TimeSync::save(){
+  JsonDocument d;
+  d["server"] = _set.server; d["interval_min"] = _set.intervalMin; d["threshold_ms"] = _set.thresholdMs;
+  d["max_delay_ms"] = _set.maxDelayMs; d["tz_min"] = _set.tzMin;
+  // koreksi persisten: error RTC = err_us + (raw - ref_us) * ppb / 1e9
+  d["ppb"] = _rtc->correctionPpb(); d["err_us"] = _rtc->correctionErrUs(); d["ref_us"] = _rtc->correctionRefUs();
+  _est.toJson(d["samples"].to<JsonArray>());
+  File f = LittleFS.open(_path, "w");
+  if (!f) return;
+  FlashWear::add(FlashWear::Config, serializeJson(d, f)); f.close();
+}
+
+void TimeSync::toJson(JsonObject o){
+  o["server"] = _set.server; o["interval_min"] = _set.intervalMin; o["threshold_ms"] = _set.thresholdMs;
+  o["max_delay_ms"] = _set.maxDelayMs; o["tz_min"] = _set.tzMin;
+  o["synced"] = _st.syncs > 0;
+  if (_st.lastSyncMs) o["last_sync_s"] = (millis() - _st.lastSyncMs) / 1000;
+  o["next_s"] = _state != State::Idle ? 0 : (int32_t)(_nextMs - millis()) > 0 ? (_nextMs - millis()) / 1000 : 0;
+  o["nic"] = _st.nic; o["stratum"] = _st.stratum;
+  o["offset_ms"] = _st.offsetUs / 1000.0; o["rtc_err_ms"] = _st.rtcErrUs / 1000.0; o["delay_ms"] = _st.delayUs / 1000.0;
+  o["correction_ms"] = _rtc->correctionUs() / 1000.0;
+  o["drift_ppm"] = _rtc->correctionPpb() / 1000.0;
+  o["drift_ready"] = _est.ready(); o["samples"] = _est.count(); o["fit_rms_ms"] = _est.residualUs() / 1000.0;
+  o["syncs"] = _st.syncs; o["failures"] = _st.failures; o["requests"] = _st.requests; o["rejected"] = _st.rejected;
+  o["rtc_writes"] = _rtc->clockStats().rtcWrites;
+}
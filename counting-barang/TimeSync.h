@@ -0,0 +1,102 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <WiFi.h>
+#include <Ethernet.h>
+#include "RTCClockDS3231.h"
+
+// Estimasi laju drift RTC dari riwayat offset SNTP. Murni aritmetika (tanpa I/O).
+//   add(t, err): err = raw RTC - waktu server (us) pada epoch detik t
+//   ppb(): kemiringan least squares N sampel terakhir (+ = RTC lebih cepat)
+//   shift(d): RTC ditulis ulang (raw melompat d) -> sampel lama digeser supaya deret tetap kontinu
+class DriftEstimator {
+public:
+  static const uint8_t N = 8;
+  static const uint32_t MIN_SPAN_S = 4 * 3600; // laju baru dipercaya setelah rentang sampel >= 4 jam
+
+  void add(uint32_t tSec, int64_t errUs);
+  void shift(int64_t deltaUs);
+  void clear() { _n = 0; _head = 0; }
+  uint8_t count() const { return _n; }
+  uint32_t spanS() const;
+  bool ready() const { return _n >= 3 && spanS() >= MIN_SPAN_S; }
+  int32_t ppb() const;
+  int64_t residualUs() const;                    // RMS sisa fit (kualitas estimasi)
+  void toJson(JsonArray a) const;                // [[t, err], ...] urut lama -> baru
+  void fromJson(JsonArrayConst a);
+private:
+  uint32_t _t[N] = {};
+  int64_t _e[N] = {};
+  uint8_t _n = 0, _head = 0;                     // _head = slot tulis berikutnya
+  uint8_t idx(uint8_t i) const { return (uint8_t)((_head + N - _n + i) % N); } // i = 0 tertua
+  bool fit(double& slope, double& icept) const;  // err = icept + slope * (t - t0)
+};
+
+// Layanan waktu di belakang layar: SNTP berkala lewat NIC yang sedang up (Wi-Fi dulu,
+// lalu Ethernet), tanpa blocking di loop(). Tiap sinkron = burst BURST permintaan, diambil
+// yang round-trip terpendek (error asimetri jalur paling kecil).
+// Hasil: koreksi perangkat lunak di RTCClockDS3231 (offset + laju drift, disimpan di /time.json
+// sehingga berlaku lagi setelah reboot); RTC sendiri ditulis hanya bila error > ambang.
+class TimeSync {
+public:
+  static const uint16_t NTP_PORT = 123, LOCAL_PORT = 4123;
+  static const uint8_t BURST = 4;
+  static const uint32_t REPLY_TIMEOUT_MS = 1500, BURST_GAP_MS = 2000, RETRY_MS = 60000;
+
+  struct Settings {
+    char server[48] = "pool.ntp.org";
+    uint16_t intervalMin = 60;      // jarak antar sinkron
+    uint16_t thresholdMs = 500;     // tulis RTC bila error RTC melewati ini
+    uint16_t maxDelayMs = 250;      // sampel dengan round-trip lebih lama dibuang
+    int16_t tzMin = 420;            // zona waktu lokal, menit dari UTC
+  };
+  struct Stats {
+    uint32_t syncs = 0, failures = 0, requests = 0, rejected = 0;
+    uint32_t lastSyncMs = 0;        // millis() sinkron sukses terakhir (0 = belum)
+    int32_t offsetUs = 0;           // server - jam terkoreksi sebelum sinkron terakhir
+    int32_t rtcErrUs = 0;           // raw RTC - server
+    uint32_t delayUs = 0;
+    uint8_t stratum = 0;
+    const char* nic = "";
+  };
+
+  void begin(RTCClockDS3231& rtc, const char* path = "/time.json"); // sebelum rtc.begin()
+  // panggil tiap loop(); wifiUp/ethUp = NIC yang boleh dipakai
+  void loop(bool wifiUp, bool ethUp);
+  // dari handler HTTP (task lain): diterapkan di loop(); false jika nilai tidak valid
+  bool requestSettings(const Settings& s);
+  void requestSync() { _syncReq = true; }
+  const Settings& settings() const { return _set; }
+  const Stats& stats() const { return _st; }
+  const DriftEstimator& estimator() const { return _est; }
+  void toJson(JsonObject o);
+
+private:
+  enum class State : uint8_t { Idle, Wait, Gap };
+  RTCClockDS3231* _rtc = nullptr;
+  String _path;
+  Settings _set, _pend;
+  volatile bool _pendReady = false, _syncReq = false;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  Stats _st;
+  DriftEstimator _est;
+
+  WiFiUDP _wifiUdp;
+  EthernetUDP _ethUdp;
+  UDP* _udp = nullptr;
+  State _state = State::Idle;
+  uint32_t _nextMs = 0, _sentMs = 0, _backoffMs = RETRY_MS;
+  uint8_t _tries = 0;
+  uint8_t _txStamp[8];              // transmit timestamp kita, harus kembali sebagai originate
+  uint64_t _t1Raw = 0; int64_t _t1Us = 0;
+  bool _haveBest = false;
+  struct Sample { int64_t offsetUs; uint32_t delayUs; uint64_t rawAt; int64_t usAt; uint64_t serverAt; uint8_t stratum; } _best;
+
+  bool send(bool wifiUp, bool ethUp);
+  bool receive();
+  void finishBurst();
+  void apply(const Sample& s);
+  void applySettings();
+  void load();
+  void save();
+};
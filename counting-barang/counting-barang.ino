@@ -3,16 +3,44 @@
   Fitur:
     - Wi-Fi prioritas, fallback Ethernet (W5500).
     - Konfigurasi lewat DualNICPortal (Wi-Fi/Ethernet + mDNS).
-    - MQTT publish payload JSON: {ip_address, kode_barang, tanggal, waktu}.
-    - Antrian offline (LittleFS NDJSON); auto-flush saat online.
-    - DS3231 untuk tanggal/waktu (WIB). Fallback NTP jika tersedia.
+    - MQTT publish payload JSON: {ip_address, count, tanggal, waktu, ts, lane} ke <topic><suffix lane>.
+    - Multi-jalur: s/d 8 sensor (LaneCounter), masing-masing counter, debounce, lane id & suffix topic.
+    - count kumulatif per lane id tahan reboot (PersistentCounter: journal NVS + RTC memory);
+      listrik putus kehilangan < 16 hitungan per jalur.
+    - Analitik lini per jalur (LaneAnalytics): laju EWMA item/menit, histogram jarak antar item,
+      deteksi macet. Publish ringkas: <topic>/rate tiap rate_s detik, <topic>/stall saat macet/jalan.
+    - Antrian offline dua tingkat: ring di PSRAM dulu, ditulis ke LittleFS (NDJSON) hanya bila
+      outage > spill_after_s atau ring berisi max_undurable event; auto-flush (RAM dulu) saat online.
+      File hanya di-append; yang terkirim ditandai head (.h0/.h1) lalu di-compact, sehingga padam
+      di titik mana pun tidak menghilangkan antrian (duplikat maks 16 event), pemulihan boot O(1).
+    - Tulis flash LittleFS dihitung per subsistem (FlashWear) -> status.flash: byte, perkiraan byte
+      fisik, byte per item & proyeksi umur flash dari FLASH_RATED_CYCLES (NVS counter: status.counter).
+    - DS3231 untuk tanggal/waktu (zona waktu diatur, default WIB). TimeSync: SNTP berkala lewat
+      Wi-Fi/Ethernet, estimasi drift RTC, koreksi disimpan di /time.json; RTC ditulis hanya bila
+      error > threshold_ms.
+    - Item dicap epoch ms (ts) pada tepi sensor, dari esp_timer yang dikunci ke RTC (tepi SQW 1 Hz
+      bila RTC_SQW_PIN terpasang), tanpa baca I2C per item; tanggal/waktu diformat saat publish/export.
+    - Kipas (FanControl) di slot loop(): suhu disampel tiap sample_ms, histeresis on_c/off_c,
+      duty PWM proporsional s/d full_c dengan ramp; suhu & duty di status.fan.
     - Endpoint extra:
-        POST /api/queue/flush  -> {flushed: <n>}
+        POST /api/queue/flush  -> 202 {job}; hasil di GET /api/jobs/<id> -> {flushed: <n>}
+        GET  /api/queue/events?from=&limit= -> {total, from, limit, items[]}
+        GET  /api/queue/export?format=csv   -> seluruh antrian (NDJSON default), streaming
+        POST /api/queue/settings {spill_after_s, max_undurable} -> disimpan
+        GET  /api/lanes                     -> {lanes:[{id, pin, debounce_ms, min_pulse_ms, topic, count, ...}]}
+        POST /api/lanes {lanes:[{id, pin, debounce_ms, min_pulse_ms, topic}]} -> disimpan, berlaku di loop()
+        POST /api/analytics/settings {stall_s, stall_min_ipm, tau_s, rate_s} -> disimpan
+        POST /api/time {server, interval_min, threshold_ms, max_delay_ms, tz_min, sync} -> disimpan
+        POST /api/fan {on_c, off_c, full_c, min_duty, sample_ms, ramp_per_s} -> disimpan
     - Status UI menampilkan jumlah item & size antrian.
   Catatan:
     - Ubah pin sesuai wiring Anda di bagian "=== KONFIGURASI PIN ===".
     - Pastikan board: Seeed XIAO ESP32S3, core ESP32 >= 2.0.14.
     - Library: ESPAsyncWebServer, Ethernet, PubSubClient, ArduinoJson, RTClib.
+    - Test & benchmark di host (shim Arduino, LittleFS = direktori): test/ (CMake), mis.
+      cmake -S test -B build && cmake --build build && ctest --test-dir build; ./build/bench_queue_cb
+    - Simulator lini (setup()/loop() sketch ini, millis() virtual, pulsa sensor per jalur, link Wi-Fi/Ethernet
+      putus-sambung, broker mati): ./build/sim_line_cb [skenario] -> item hilang/duplikat/terlambat & antrian.
 */
 
 #include <Arduino.h>
@@ -23,19 +51,29 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include <time.h>
+#include <memory>
 
 #include "DualNICPortal.h"
 #include "OfflineQueue.h"
+#include "LaneCounter.h"
+#include "PersistentCounter.h"
+#include "LaneAnalytics.h"
 #include "RTCClockDS3231.h"
+#include "TimeSync.h"
+#include "FanControl.h"
+#include "FlashWear.h"
 
 // ====================== KONFIGURASI PIN ======================
 // SESUAIKAN dengan wiring Anda! Nilai di bawah hanyalah contoh.
-#define SENSOR_PIN 2
+#define SENSOR_PIN 2      // jalur 1 default; jalur lain lewat /api/lanes
 #define LED_PIN_STATUS 43
 #define LED_PIN_TRIG 1
 #define FAN_PIN 3
+#define RTC_SQW_PIN -1   // pin SQW DS3231 (1 Hz) jika disambung; -1 = tanpa SQW (resync kasar tiap menit)
 
 static const size_t QUEUE_MAX_BYTES = 512 * 1024;
+static const size_t QUEUE_RAM_EVENTS = 2048;  // kapasitas ring antrian di PSRAM
+static const uint32_t FLASH_RATED_CYCLES = 100000; // siklus erase rated flash modul (proyeksi umur)
 uint32_t lastLEDBlink = 0;
 bool ledBlinkState = false;
 
@@ -44,9 +82,6 @@ bool ledBlinkState = false;
 #define PIN_W5500_CS     4
 #define W5500_RST   -1
 
-float temp = 0;
-uint32_t itemCount = 0;
-int lastSensorState = HIGH;
 
 
 // mDNS hostname
@@ -61,24 +96,48 @@ WiFiClient     wifiClient;
 EthernetClient ethClient;
 PubSubClient   mqtt;
 OfflineQueue   queue;
+LaneCounter    lanes;
+PersistentCounter counter;
+LaneAnalytics  analytics;
+uint16_t rateS = 60;  // interval publish <topic>/rate (0 = mati)
+
+// event macet menunggu MQTT (dipublish dari loop saat mutex didapat); tertua dibuang bila penuh
+struct StallMsg { uint8_t lane; bool stalled; uint32_t idleMs; float ipm; uint64_t ts; };
+static const uint8_t STALL_PENDING = 8;
+StallMsg stallQ[STALL_PENDING];
+uint8_t stallHead = 0, stallLen = 0;
 RTCClockDS3231 rtc;
-
-String activeIP(){
-  if (WiFi.status() == WL_CONNECTED) return WiFi.localIP().toString();
+TimeSync       timeSync;
+FanControl     fan;
+
+// ---- Boot paralel: jaringan, NTP & MQTT berjalan di background, capture langsung hidup ----
+// Semua dalam ms sejak reset (0 = belum terjadi); diekspos di /api/status -> boot
+struct BootTimes { uint32_t captureReady=0, firstCapture=0, wifi=0, eth=0, ntp=0, mqtt=0; } bootT;
+// PubSubClient dipakai loop() (publish/flush) dan mqttTask (connect) -> wajib lewat mutex ini
+SemaphoreHandle_t mqttMutex = nullptr;
+
+// dipanggil per event -> format ke buffer tetap (tanpa String/heap)
+FixedString<15> activeIP(){
+  IPAddress ip(0, 0, 0, 0);
+  if (WiFi.status() == WL_CONNECTED) ip = WiFi.localIP();
 #ifdef ETHERNET_H
-  if (Ethernet.linkStatus() == LinkON) return Ethernet.localIP().toString();
+  else if (Ethernet.linkStatus() == LinkON) ip = Ethernet.localIP();
 #endif
-  return String("0.0.0.0");
+  FixedString<15> s; s.appendf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  return s;
 }
 
 static bool ensureMqttConnected() {
   // Pilih transport (Wi-Fi lebih dulu, jika tidak ada pakai Ethernet)
   if (!portal.selectClient(mqtt, wifiClient, ethClient)) return false;
 
-  // Set server dari konfigurasi
-  const AppConfig& cfg = portal.config();
+  // Set server dari konfigurasi (salinan snapshot: connect bisa lama, dan
+  // PubSubClient menyimpan pointer host, jadi string-nya harus tetap hidup)
+  const AppConfig cfg = portal.config();
   if (cfg.mqtt_host.isEmpty() || cfg.mqtt_port == 0) return false;
-  mqtt.setServer(cfg.mqtt_host.c_str(), cfg.mqtt_port);
+  static String mqttHost;
+  mqttHost = cfg.mqtt_host;
+  mqtt.setServer(mqttHost.c_str(), cfg.mqtt_port);
 
   Serial.print("Menghubungkan ke MQTT ");
   Serial.print(cfg.mqtt_host);
@@ -103,13 +162,52 @@ static bool ensureMqttConnected() {
 bool publishEvent(const ScanEvent& e){
   const AppConfig& cfg = portal.config();
   JsonDocument d;
-  d["ip_address"]  = e.ip_address;
+  d["ip_address"]  = e.ip_address.c_str();
   d["count"] = e.count;
-  d["tanggal"]     = e.tanggal;
-  d["waktu"]       = e.waktu;
-  String buf; 
-  serializeJson(d, buf);
-  return mqtt.publish(cfg.mqtt_topic.c_str(), buf.c_str(), true);
+  char tgl[11], jam[9]; RTCClockDS3231::formatLocal(e.ts, tgl, jam);
+  d["tanggal"]     = tgl;
+  d["waktu"]       = jam;
+  d["ts"]          = e.ts;
+  d["lane"]        = e.lane;
+  char buf[256];
+  const size_t n = serializeJson(d, buf, sizeof(buf));
+  if (n >= sizeof(buf) - 1) return false;
+  // suffix topic diambil dari konfigurasi jalur saat ini (juga untuk event dari antrian)
+  const LaneCounter::LaneConfig* lc = lanes.findById(e.lane);
+  FixedString<127> topic(cfg.mqtt_topic.c_str());
+  if (lc) topic += lc->topic;
+  return mqtt.publish(topic.c_str(), buf, true);
+}
+
+// dipanggil di loop() saat mutex MQTT dipegang & terhubung
+static void publishAnalytics(){
+  static uint32_t lastRate = 0;
+  const String base = portal.config().mqtt_topic;
+  while (stallLen) {
+    const StallMsg& m = stallQ[stallHead];
+    JsonDocument d;
+    d["ip_address"] = activeIP().c_str(); d["lane"] = m.lane; d["event"] = m.stalled ? "stall" : "resume";
+    d["idle_s"] = m.idleMs / 1000; d["ipm"] = roundf(m.ipm * 10) / 10;
+    char tgl[11], jam[9]; RTCClockDS3231::formatLocal(m.ts, tgl, jam);
+    d["tanggal"] = tgl; d["waktu"] = jam; d["ts"] = m.ts;
+    String out; serializeJson(d, out);
+    if (!mqtt.publish((base + "/stall").c_str(), out.c_str(), false)) return;
+    stallHead = (stallHead + 1) % STALL_PENDING; stallLen--;
+  }
+  if (!rateS || millis() - lastRate < rateS * 1000UL) return;
+  lastRate = millis();
+  // {"ip_address":..,"ipm":{"<lane>":x},"stalled":[lane..]}
+  JsonDocument d;
+  d["ip_address"] = activeIP().c_str();
+  JsonObject ipm = d["ipm"].to<JsonObject>();
+  JsonArray stalled = d["stalled"].to<JsonArray>();
+  for (uint8_t i = 0; i < lanes.lanes(); i++) {
+    const LaneAnalytics::Lane* a = analytics.find(lanes.lane(i).id);
+    ipm[String(lanes.lane(i).id)] = a ? roundf(a->ipm * 10) / 10 : 0;
+    if (a && a->stalled) stalled.add(a->id);
+  }
+  String out; serializeJson(d, out);
+  mqtt.publish((base + "/rate").c_str(), out.c_str(), false);
 }
 
 static size_t flushQueueLimited(size_t maxItems = 200) {
@@ -118,67 +216,390 @@ static size_t flushQueueLimited(size_t maxItems = 200) {
   }, maxItems);
 }
 
+// Publish langsung bila MQTT siap & tidak sedang dipakai mqttTask; selain itu masuk antrian
+static bool publishOrEnqueue(const ScanEvent& ev){
+  FlashWear::addItems(1); // satu event antrian (ev.count = nilai hitung, bukan jumlah baris)
+  bool sent = false;
+  if (xSemaphoreTake(mqttMutex, 0) == pdTRUE) {
+    if (mqtt.connected()) sent = publishEvent(ev);
+    xSemaphoreGive(mqttMutex);
+  }
+  if (!sent && !queue.enqueue(ev)) Serial.println("[QUEUE] event dibuang: baris > LINE_MAX / flash penuh");
+  return sent;
+}
+
+// Connect MQTT di task terpisah: PubSubClient::connect bisa blocking beberapa detik
+static void mqttTask(void*){
+  for (;;) {
+    if (!portal.booting() && xSemaphoreTake(mqttMutex, portMAX_DELAY) == pdTRUE) {
+      if (!mqtt.connected() && ensureMqttConnected() && !bootT.mqtt) bootT.mqtt = millis();
+      xSemaphoreGive(mqttMutex);
+    }
+    vTaskDelay(pdMS_TO_TICKS(3000));
+  }
+}
+
+// count jalur (LaneCounter, sejak boot) terakhir yang sudah masuk PersistentCounter, per lane id
+static struct LaneSeen { uint8_t id; bool used; uint32_t count; } laneSeen[LaneCounter::MAX_LANES];
+
+static uint32_t laneGap(uint8_t id, uint32_t count){
+  LaneSeen* s = nullptr;
+  for (LaneSeen& x : laneSeen) if (x.used && x.id == id) { s = &x; break; }
+  if (!s) for (LaneSeen& x : laneSeen) if (!x.used || !lanes.findById(x.id)) { x = LaneSeen{ id, true, 0 }; s = &x; break; }
+  if (!s) return 1;
+  const uint32_t gap = count > s->count ? count - s->count : count; // mundur: jalur dipasang ulang, counter mulai 0
+  s->count = count;
+  return gap;
+}
+
+// Konfigurasi jalur (/lanes.json); default satu jalur di SENSOR_PIN
+static const char* LANES_CFG = "/lanes.json";
+
+static uint8_t lanesFromJson(JsonArrayConst arr, LaneCounter::LaneConfig* out, String& err){
+  uint8_t n = 0;
+  for (JsonObjectConst o : arr) {
+    if (n >= LaneCounter::MAX_LANES) { err = "maks 8 jalur"; return 0; }
+    LaneCounter::LaneConfig& c = out[n];
+    c = LaneCounter::LaneConfig();
+    const long pin = o["pin"] | -1L, id = o["id"] | (long)(n + 1);
+    const long deb = o["debounce_ms"] | 300L, minPulse = o["min_pulse_ms"] | 0L;
+    if (pin < 0 || pin > 48 || id < 1 || id > 255 || deb < 0 || deb > 60000 || minPulse < 0 || minPulse > 60000) {
+      err = "pin 0..48, id 1..255, debounce_ms & min_pulse_ms 0..60000"; return 0;
+    }
+    c.pin = pin; c.id = id; c.debounceMs = deb; c.minPulseMs = minPulse;
+    strlcpy(c.topic, o["topic"] | "", sizeof(c.topic));
+    n++;
+  }
+  if (!n) err = "minimal satu jalur";
+  return n;
+}
+
+static void loadLanesCfg(){
+  LaneCounter::LaneConfig cfg[LaneCounter::MAX_LANES];
+  uint8_t n = 0;
+  File f = LittleFS.open(LANES_CFG, "r");
+  if (f) {
+    JsonDocument d; String err;
+    if (!deserializeJson(d, f)) n = lanesFromJson(d["lanes"].as<JsonArrayConst>(), cfg, err);
+    f.close();
+  }
+  if (!n) { cfg[0] = LaneCounter::LaneConfig(); cfg[0].pin = SENSOR_PIN; n = 1; }
+  if (!lanes.configure(cfg, n)) Serial.println("[LANE] Konfigurasi jalur ditolak (pin/id ganda)");
+}
+
+static void lanesToJson(JsonArray arr, bool withStats){
+  for (uint8_t i = 0; i < lanes.lanes(); i++) {
+    const LaneCounter::LaneConfig& c = lanes.lane(i);
+    JsonObject o = arr.add<JsonObject>();
+    o["id"] = c.id; o["pin"] = c.pin; o["debounce_ms"] = c.debounceMs; o["min_pulse_ms"] = c.minPulseMs;
+    o["topic"] = c.topic;
+    if (!withStats) continue;
+    const LaneCounter::LaneStats& st = lanes.stats(i);
+    o["count"] = st.count; o["bounces"] = st.bounces; o["glitches"] = st.glitches;
+    o["total"] = counter.get(c.id);
+    if (const LaneAnalytics::Lane* a = analytics.find(c.id)) analytics.toJson(*a, o);
+  }
+}
+
+// Setelan analitik (/analytics.json)
+static const char* ANALYTICS_CFG = "/analytics.json";
+static void loadAnalyticsCfg(){
+  File f = LittleFS.open(ANALYTICS_CFG, "r");
+  if (!f) return;
+  JsonDocument d;
+  if (!deserializeJson(d, f)) {
+    LaneAnalytics::Settings st = analytics.settings();
+    st.stallS = d["stall_s"] | st.stallS; st.stallMinIpm = d["stall_min_ipm"] | st.stallMinIpm;
+    st.tauS = d["tau_s"] | st.tauS; rateS = d["rate_s"] | rateS;
+    analytics.setSettings(st);
+  }
+  f.close();
+}
+
+static void analyticsCfgToJson(JsonObject o){
+  const LaneAnalytics::Settings& st = analytics.settings();
+  o["stall_s"] = st.stallS; o["stall_min_ipm"] = st.stallMinIpm; o["tau_s"] = st.tauS; o["rate_s"] = rateS;
+}
+
+// Setelan tier RAM antrian (/queue.json)
+static const char* QUEUE_CFG = "/queue.json";
+static bool queueCfgFromJson(JsonVariantConst d, OfflineQueue::FrontSettings& s){
+  const uint32_t spillS = d["spill_after_s"] | s.spillAfterMs / 1000;
+  const uint32_t maxU = d["max_undurable"] | (uint32_t)s.maxUndurable;
+  if (spillS > 3600 || maxU < 1 || maxU > 65535) return false;
+  s.spillAfterMs = spillS * 1000; s.maxUndurable = maxU;
+  return true;
+}
+static void loadQueueCfg(){
+  File f = LittleFS.open(QUEUE_CFG, "r");
+  if (!f) return;
+  JsonDocument d;
+  OfflineQueue::FrontSettings s = queue.frontSettings();
+  if (!deserializeJson(d, f) && queueCfgFromJson(d, s)) queue.setFrontSettings(s);
+  f.close();
+}
+
+// Setelan kipas (/fan.json)
+static const char* FAN_CFG = "/fan.json";
+static bool fanCfgFromJson(JsonVariantConst d, FanControl::Settings& s){
+  s.onC = d["on_c"] | s.onC; s.offC = d["off_c"] | s.offC; s.fullC = d["full_c"] | s.fullC;
+  s.minDuty = d["min_duty"] | s.minDuty; s.sampleMs = d["sample_ms"] | s.sampleMs; s.rampPerS = d["ramp_per_s"] | s.rampPerS;
+  return FanControl::valid(s);
+}
+static void loadFanCfg(){
+  File f = LittleFS.open(FAN_CFG, "r");
+  if (!f) return;
+  JsonDocument d;
+  FanControl::Settings s = fan.settings();
+  if (!deserializeJson(d, f) && fanCfgFromJson(d, s)) fan.setSettings(s);
+  f.close();
+}
+
+// Langkah boot jaringan yang tersisa, dipanggil tiap loop() (non-blocking)
+static void bootNetworkLoop(){
+  const bool wifiUp = WiFi.status() == WL_CONNECTED;
+  const bool ethUp = !portal.booting() && portal.ethernetLinkUp() && Ethernet.localIP() != IPAddress(0,0,0,0);
+  if (!bootT.wifi && wifiUp) bootT.wifi = millis();
+  if (!bootT.eth && ethUp) bootT.eth = millis();
+  timeSync.loop(wifiUp, ethUp);
+  if (!bootT.ntp && timeSync.stats().syncs) bootT.ntp = millis();
+}
+
 
 // =================== SETUP / LOOP ============================
 void setup() {
   Serial.begin(115200);
-  delay(500);
   Serial.println("\n[BOOT] Counter is Ready");
-  pinMode(SENSOR_PIN, INPUT_PULLUP);
+  mqttMutex = xSemaphoreCreateMutex();
   pinMode(LED_PIN_TRIG, OUTPUT);
   pinMode(LED_PIN_STATUS, OUTPUT);
   queue.begin(QUEUE_FILE, QUEUE_MAX_BYTES);
+  if (!queue.beginFront(QUEUE_RAM_EVENTS)) Serial.println("[QUEUE] PSRAM tidak ada, antrian langsung ke flash");
+  loadQueueCfg();
+  FlashWear::setRatedCycles(FLASH_RATED_CYCLES);
+  counter.begin();   // total per jalur dari NVS (+ RTC memory setelah soft reset)
 
   // Portal jaringan (Wi-Fi/Ethernet + UI)
   portal.setStatusAugmenter([](JsonDocument& root){
     // Tambahkan statistik antrian di /api/status -> ui
     root["queue"]["count"] = queue.count();
+    FlashWear::toJson(root["flash"].to<JsonObject>());
     root["queue"]["bytes"] = queue.sizeBytes();
+    const OfflineQueue::FrontStats& qf = queue.frontStats();
+    JsonObject ram = root["queue"]["ram"].to<JsonObject>();
+    ram["count"] = queue.frontCount(); ram["capacity"] = queue.frontCapacity();
+    ram["spill_after_s"] = queue.frontSettings().spillAfterMs / 1000; ram["max_undurable"] = queue.frontSettings().maxUndurable;
+    ram["spills"] = qf.spills; ram["spilled"] = qf.spilled; ram["drained"] = qf.drained; ram["direct"] = qf.direct; root["queue"]["rejected"] = qf.rejected;
+    root["queue"]["head"] = queue.headOffset();
+    const OfflineQueue::RecoveryStats& rs = queue.recoveryStats();
+    JsonObject rec = root["queue"]["recovery"].to<JsonObject>();
+    rec["us"] = rs.us; rec["tmp_restored"] = rs.tmpRestored; rec["tmp_discarded"] = rs.tmpDiscarded;
+    rec["head_reset"] = rs.headReset; rec["torn_tail"] = rs.tornTail;
+    JsonObject b = root["boot"].to<JsonObject>();
+    b["capture_ready_ms"] = bootT.captureReady; b["first_capture_ms"] = bootT.firstCapture;
+    b["wifi_ms"] = bootT.wifi; b["eth_ms"] = bootT.eth; b["ntp_ms"] = bootT.ntp; b["mqtt_ms"] = bootT.mqtt;
+    lanesToJson(root["lanes"].to<JsonArray>(), true);
+    root["lanes_dropped"] = lanes.dropped();
+    const PersistentCounter::Stats& cs = counter.stats();
+    JsonObject pc = root["counter"].to<JsonObject>();
+    pc["restored"] = PersistentCounter::sourceName(cs.restored); pc["restore_us"] = cs.restoreUs;
+    pc["journal_writes"] = cs.journalWrites; pc["checkpoints"] = cs.checkpoints;
+    pc["flash_bytes"] = cs.flashBytes; pc["bytes_per_count"] = counter.writeAmplification();
+    pc["loss_bound"] = counter.lossBound();
+    analyticsCfgToJson(root["analytics"].to<JsonObject>());
+    const RTCClockDS3231::ClockStats& ck = rtc.clockStats();
+    JsonObject cl = root["clock"].to<JsonObject>();
+    cl["now_ms"] = rtc.nowMs(); cl["sqw"] = ck.sqw; cl["edges"] = ck.edges; cl["rtc_reads"] = ck.rtcReads;
+    cl["steps"] = ck.steps; cl["ppb"] = ck.ppb; cl["last_err_us"] = ck.lastErrUs; cl["max_err_us"] = ck.maxErrUs;
+    timeSync.toJson(root["time"].to<JsonObject>());
+    fan.toJson(root["fan"].to<JsonObject>());
+  });
+  bool routesOk = true; // route yang gagal masuk tabel tidak bisa dipanggil: harus terlihat di log boot
+  routesOk &= portal.addRoute("POST", "/api/queue/flush", [](const ApiRequest& rq, String& contentType, int& code){
+    // flush jalan di loop() (satu penulis file antrian), 100 item per putaran s/d 500
+    bool co = false;
+    uint32_t id = portal.postJob("queue", "", [total = size_t(0)](String& out, int& rc) mutable {
+      if (xSemaphoreTake(mqttMutex, 0) != pdTRUE) return false; // mqttTask sedang connect, coba lagi
+      size_t n = mqtt.connected() ? flushQueueLimited(100) : 0;
+      xSemaphoreGive(mqttMutex);
+      total += n;
+      if (n == 100 && total < 500) return false;
+      JsonDocument d; d["flushed"] = total; serializeJson(d, out);
+      return true;
+    }, &co);
+    return portal.jobAccepted(id, co, code);
+  });
+  routesOk &= portal.addRoute("POST", "/api/queue/settings", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    OfflineQueue::FrontSettings s = queue.frontSettings();
+    if (!queueCfgFromJson(d, s)) { code = 400; return String("{\"error\":\"spill_after_s 0..3600, max_undurable >= 1\"}"); }
+    queue.setFrontSettings(s); // spill karena batas baru dikerjakan loop()
+    JsonDocument r;
+    r["spill_after_s"] = queue.frontSettings().spillAfterMs / 1000; r["max_undurable"] = queue.frontSettings().maxUndurable;
+    File f = LittleFS.open(QUEUE_CFG, "w");
+    if (f) { FlashWear::add(FlashWear::Config, serializeJson(r, f)); f.close(); }
+    String out; serializeJson(r, out); return out;
+  });
+  routesOk &= portal.addRoute("GET", "/api/queue/events", [](const ApiRequest& rq, String& contentType, int& code){
+    long from = rq.argInt("from"), limit = rq.argInt("limit");
+    if (from < 0) from = 0;
+    if (limit <= 0) limit = 50;
+    if (limit > 200) limit = 200;
+    JsonDocument d;
+    JsonArray items = d["items"].to<JsonArray>();
+    size_t total = queue.readRange(from, limit, [&](size_t idx, const ScanEvent& e){
+      JsonObject o = items.add<JsonObject>();
+      o["idx"] = idx; o["ip_address"] = e.ip_address.c_str(); o["count"] = e.count;
+      char tgl[11], jam[9]; RTCClockDS3231::formatLocal(e.ts, tgl, jam);
+      o["tanggal"] = tgl; o["waktu"] = jam; o["ts"] = e.ts; o["lane"] = e.lane;
+    });
+    if (total == SIZE_MAX) { code = 503; return String("{\"error\":\"antrian sibuk, coba lagi\"}"); }
+    d["total"] = total; d["from"] = from; d["limit"] = limit;
+    String out; serializeJson(d, out); return out;
+  });
+  routesOk &= portal.addStreamRoute("GET", "/api/queue/export", [](const ApiRequest& rq, String& contentType, int& code){
+    auto cur = std::make_shared<OfflineQueue::ExportCursor>();
+    cur->csv = rq.argIs("format", "csv");
+    contentType = cur->csv ? "text/csv" : "application/x-ndjson";
+    return DualNICPortal::ChunkFiller([cur](uint8_t* buf, size_t maxLen){ return queue.exportChunk(*cur, buf, maxLen); });
+  });
+
+  routesOk &= portal.addRoute("GET", "/api/lanes", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    lanesToJson(d["lanes"].to<JsonArray>(), true);
+    String out; serializeJson(d, out); return out;
+  });
+  routesOk &= portal.addRoute("POST", "/api/lanes", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    LaneCounter::LaneConfig cfg[LaneCounter::MAX_LANES];
+    String err;
+    const uint8_t n = lanesFromJson(d["lanes"].as<JsonArrayConst>(), cfg, err);
+    if (!n || !lanes.configure(cfg, n)) {
+      code = 400;
+      JsonDocument e; e["error"] = err.length() ? err : String("pin / id jalur ganda");
+      String out; serializeJson(e, out); return out;
+    }
+    File f = LittleFS.open(LANES_CFG, "w");
+    if (f) { FlashWear::add(FlashWear::Config, serializeJson(d, f)); f.close(); }
+    JsonDocument r; r["lanes"] = n; r["applied"] = "loop";
+    String out; serializeJson(r, out); return out;
+  });
+
+  routesOk &= portal.addRoute("POST", "/api/analytics/settings", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    LaneAnalytics::Settings st = analytics.settings();
+    const long stall = d["stall_s"] | (long)st.stallS, tau = d["tau_s"] | (long)st.tauS, rate = d["rate_s"] | (long)rateS;
+    const float minIpm = d["stall_min_ipm"] | st.stallMinIpm;
+    if (stall < 0 || stall > 3600 || tau < 5 || tau > 3600 || rate < 0 || rate > 3600 || minIpm < 0) {
+      code = 400; return String("{\"error\":\"stall_s 0..3600, tau_s 5..3600, rate_s 0..3600, stall_min_ipm >= 0\"}");
+    }
+    st.stallS = stall; st.tauS = tau; st.stallMinIpm = minIpm; rateS = rate;
+    analytics.setSettings(st);
+    JsonDocument r; analyticsCfgToJson(r.to<JsonObject>());
+    File f = LittleFS.open(ANALYTICS_CFG, "w");
+    if (f) { FlashWear::add(FlashWear::Config, serializeJson(r, f)); f.close(); }
+    String out; serializeJson(r, out); return out;
   });
-  portal.setExtraApiHandler([](const String& path, const String& method, const String& body,
-                               const String& ctx, String& contentType, int& code, String& out)->bool {
-    if (path == "/api/queue/flush" && method == "POST") {
-      size_t n = flushQueueLimited(500);
-      JsonDocument d; d["flushed"] = n; serializeJson(d, out);
-      contentType = "application/json"; code = 200; return true;
+
+  routesOk &= portal.addRoute("POST", "/api/time", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    TimeSync::Settings s = timeSync.settings();
+    if (d["server"].is<const char*>()) strlcpy(s.server, d["server"], sizeof(s.server));
+    s.intervalMin = d["interval_min"] | s.intervalMin; s.thresholdMs = d["threshold_ms"] | s.thresholdMs;
+    s.maxDelayMs = d["max_delay_ms"] | s.maxDelayMs; s.tzMin = d["tz_min"] | s.tzMin;
+    if (!timeSync.requestSettings(s)) {
+      code = 400; return String("{\"error\":\"interval_min 1..1440, threshold_ms 10..60000, max_delay_ms 10..2000, tz_min -720..840\"}");
+    }
+    if (d["sync"] | false) timeSync.requestSync();
+    return String("{\"ok\":true}"); // diterapkan di loop()
+  });
+
+  routesOk &= portal.addRoute("POST", "/api/fan", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    FanControl::Settings s = fan.settings();
+    if (!fanCfgFromJson(d, s)) {
+      code = 400; return String("{\"error\":\"off_c < on_c <= full_c, sample_ms 100..60000, ramp_per_s > 0\"}");
     }
-    return false;
+    fan.setSettings(s);
+    JsonDocument r; JsonObject o = r.to<JsonObject>();
+    o["on_c"] = s.onC; o["off_c"] = s.offC; o["full_c"] = s.fullC;
+    o["min_duty"] = s.minDuty; o["sample_ms"] = s.sampleMs; o["ramp_per_s"] = s.rampPerS;
+    File f = LittleFS.open(FAN_CFG, "w");
+    if (f) { FlashWear::add(FlashWear::Config, serializeJson(r, f)); f.close(); }
+    String out; serializeJson(r, out); return out;
   });
 
-  portal.begin();
+  if (!routesOk) Serial.println("[BOOT] ERROR: route API gagal didaftarkan (lihat [HTTP] di atas)");
 
-  // RTC
-  if (!rtc.begin()) Serial.println("RTC init failed");
-  if (!rtc.isValid()) Serial.println("RTC not valid – set via NTP when Wi‑Fi up");
-  Serial.println(rtc.syncFromNTPAndSetRTC(10000) ? "[RTC] Success Sync Time": "[RTC] Failed Sync Time" );
+  portal.setClock([](){ return rtc.nowMs(); }); // umur lease DHCP tersimpan
+  portal.begin();     // non-blocking; Wi-Fi/Ethernet selesai di portal.loop()
 
-  // MQTT client basic callbacks (opsional)
-  ensureMqttConnected();
+  // Sensor jalur (LittleFS sudah di-mount oleh portal); ISR dipasang di lanes.loop() pertama
+  loadLanesCfg();
+  loadAnalyticsCfg();
+  analytics.onStall([](const LaneAnalytics::Lane& l, bool stalled, uint32_t idleMs){
+    Serial.printf("[LINE] Jalur %u %s (%lu s)\n", l.id, stalled ? "macet" : "jalan lagi", (unsigned long)(idleMs / 1000));
+    if (stallLen == STALL_PENDING) { stallHead = (stallHead + 1) % STALL_PENDING; stallLen--; }
+    StallMsg& m = stallQ[(stallHead + stallLen++) % STALL_PENDING];
+    m.lane = l.id; m.stalled = stalled; m.idleMs = idleMs; m.ipm = l.ipmBeforeStall;
+    m.ts = rtc.nowMs();
+  });
+  lanes.onCount([](const LaneCounter::LaneConfig& lane, uint32_t laneCount, uint32_t us){
+    if (!bootT.firstCapture) bootT.firstCapture = millis();
+    // selisih count jalur, bukan +1: event yang terbuang saat ring penuh tetap masuk total
+    const uint32_t count = counter.add(lane.id, laneGap(lane.id, laneCount)); // kumulatif, tidak mundur saat reboot
+    analytics.item(lane.id, us);
+    // cap waktu di tepi sensor, bukan saat loop() sempat memproses
+    const uint64_t now = rtc.nowMs();
+    const uint64_t ts = now ? now - (micros() - us) / 1000 : 0;
+    ScanEvent ev{ activeIP(), count, ts, lane.id };
+    bool sent = publishOrEnqueue(ev);
+    if (!sent) {
+      Serial.printf("[QUEUE] Enqueued: lane %u #%lu\n", lane.id, (unsigned long)count);
+    } else {
+      Serial.printf("[MQTT] Sent: lane %u #%lu\n", lane.id, (unsigned long)count);
+    }
+  });
+
+  // RTC; zona waktu & koreksi tersimpan dimuat dulu (RTC berisi waktu lokal zona itu).
+  // SNTP berjalan di bootNetworkLoop() begitu ada NIC yang up.
+  timeSync.begin(rtc);
+  if (!rtc.begin(RTC_SQW_PIN)) Serial.println("RTC init failed");
+  if (!rtc.isValid()) Serial.println("RTC not valid – set via SNTP when network up");
+  loadFanCfg();
+  fan.begin(FAN_PIN, [](){ return rtc.getTemp(); });
+
+  // MQTT client basic callbacks (opsional); connect dilakukan mqttTask
   mqtt.setCallback([](char*, uint8_t*, unsigned int){});
+  xTaskCreatePinnedToCore(mqttTask, "mqtt_conn", 4096, nullptr, 1, nullptr, 0);
 
+  bootT.captureReady = millis();
   Serial.printf("[INFO] Web UI: http://%s.local/\n", MDNS_HOST);
-  Serial.println("[READY] Scan kode untuk menguji...");
+  Serial.printf("[READY] Capture aktif %lu ms setelah reset\n", (unsigned long)bootT.captureReady);
 }
 
 uint32_t lastFlushCheck  = 0;
 
 void loop() {
   portal.loop();     // wajib dipanggil
-  checkSensor();
-  temp = rtc.getTemp();
-  // Serial.println(temp);
-
-  if (temp >= 50 ){
-    analogWrite(FAN_PIN, 255);
-    // Serial.println("FAN ON");
-    delay(1000);
-  }else if(temp <= 30){
-    analogWrite(FAN_PIN, 0);
-    // Serial.println("FAN OFF");
-    delay(1000);
-  }
-
-  if (!mqtt.loop()) {
+  lanes.loop();      // event jalur dari ISR -> publish/antrian
+  counter.loop();    // commit hitungan pending ke NVS setelah jalur diam
+  analytics.tick();  // laju EWMA & deteksi macet, sekali per detik
+  digitalWrite(LED_PIN_TRIG, lanes.anyBlocked() ? LOW : HIGH);
+  bootNetworkLoop();
+  rtc.loopClock();
+  fan.loop();        // sampel suhu tiap sample_ms, histeresis & ramp PWM kipas; tanpa delay
+  queue.loop();      // ring PSRAM -> flash bila outage melewati spill_after_s / max_undurable
+
+  // MQTT sedang dipegang mqttTask (connect) -> lewati putaran ini, capture tetap jalan
+  bool mqttAlive = false, mqttLocked = (xSemaphoreTake(mqttMutex, 0) == pdTRUE);
+  if (mqttLocked) mqttAlive = mqtt.loop();
+  if (!mqttAlive) {
     if (millis() - lastLEDBlink >= 1000) {
       lastLEDBlink = millis();
       ledBlinkState = !ledBlinkState;
@@ -189,35 +610,13 @@ void loop() {
     // mqtt.loop(); // tetap jalankan loop MQTT saat connected
   }
   // Coba flush antrian tiap 2 detik saat online
-  if (mqtt.connected() && (millis() - lastFlushCheck > 2000)) {
+  if (mqttLocked && mqtt.connected() && (millis() - lastFlushCheck > 2000)) {
     lastFlushCheck = millis();
     size_t n = flushQueueLimited(100);
     if (n) Serial.printf("[QUEUE] Flushed %u items\n", (unsigned)n);
   }
+  if (mqttLocked && mqtt.connected()) publishAnalytics();
+  if (mqttLocked) xSemaphoreGive(mqttMutex);
 
   delay(2);
 }
-
- void checkSensor() {
-    int sensorState = digitalRead(SENSOR_PIN);
-
-    // Serial.println(sensorState);
-    digitalWrite(LED_PIN_TRIG, sensorState);
-
-    
-    if (lastSensorState == LOW && sensorState == HIGH) {
-      itemCount++;
-      String tgl, jam; rtc.nowLocal(tgl, jam);
-      ScanEvent ev{ activeIP(), itemCount, tgl, jam };
-      bool sent = false;
-      if (mqtt.connected()) sent = publishEvent(ev);
-      if (!sent) {
-        queue.enqueue(ev);
-        Serial.printf("[QUEUE] Enqueued: %lu\n", (unsigned long)itemCount);
-      } else {
-        Serial.printf("[MQTT] Sent: %lu\n", (unsigned long) itemCount);
-      }
-      delay(300); // Debounce
-    } 
-    lastSensorState =  sensorState;
-  }
\ No newline at end of file
@@ -0,0 +1,159 @@
+#include "BarcodeParse.h"
+
+namespace BarcodeParse {
+
+static const char GS = 0x1D; // FNC1 di data GS1
+
+// Subset tabel AI GS1 yang relevan untuk gudang/produksi; urut tidak penting (dicari linear, kecil)
+static const AiDef AI_TABLE[] = {
+  { "00",  2, 18, 18, true,  "sscc"        },
+  { "01",  2, 14, 14, true,  "gtin"        },
+  { "02",  2, 14, 14, true,  "content"     },
+  { "10",  2,  0, 20, false, "lot"         },
+  { "11",  2,  6,  6, true,  "prod_date"   },
+  { "13",  2,  6,  6, true,  "pack_date"   },
+  { "15",  2,  6,  6, true,  "best_before" },
+  { "17",  2,  6,  6, true,  "expiry"      },
+  { "21",  2,  0, 20, false, "serial"      },
+  { "30",  2,  0,  8, true,  "count"       },
+  { "37",  2,  0,  8, true,  "count"       },
+  { "240", 3,  0, 30, false, nullptr       },
+  { "241", 3,  0, 30, false, nullptr       },
+  { "400", 3,  0, 30, false, nullptr       },
+  { "310", 4,  6,  6, true,  nullptr       }, // berat bersih kg, digit ke-4 = posisi desimal
+  { "9",   2,  0, 90, false, nullptr       }, // 90..99 internal perusahaan
+};
+
+static bool isDigit(char c){ return c >= '0' && c <= '9'; }
+
+static bool allDigits(const char* p, size_t n){
+  for (size_t i = 0; i < n; i++) if (!isDigit(p[i])) return false;
+  return n > 0;
+}
+
+bool gs1CheckDigit(const char* d, size_t n){
+  if (n < 2 || !allDigits(d, n)) return false;
+  unsigned sum = 0;
+  // dari kanan (tanpa cek digit): bobot 3,1,3,...
+  for (size_t i = 0; i + 1 < n; i++) sum += (d[n - 2 - i] - '0') * ((i & 1) ? 1 : 3);
+  return (10 - sum % 10) % 10 == (unsigned)(d[n - 1] - '0');
+}
+
+static bool validDate(const char* p){
+  const int mm = (p[2] - '0') * 10 + (p[3] - '0'), dd = (p[4] - '0') * 10 + (p[5] - '0');
+  return mm >= 1 && mm <= 12 && dd <= 31; // DD = 00: akhir bulan
+}
+
+// AI di posisi p (n digit tersedia); digit AI harus numerik semua
+static const AiDef* lookupAi(const char* p, size_t n){
+  for (const AiDef& d : AI_TABLE) {
+    const size_t pl = strlen(d.ai);
+    if (n < d.aiLen || strncmp(p, d.ai, pl) != 0 || !allDigits(p, d.aiLen)) continue;
+    return &d;
+  }
+  return nullptr;
+}
+
+static Error checkField(const Field& f){
+  const AiDef& d = *f.def;
+  if (f.len == 0 || f.len > d.maxLen || (d.fixed && f.len != d.fixed)) return Error::BadLength;
+  if (d.numeric && !allDigits(f.value, f.len)) return Error::BadChar;
+  if (d.fixed == 6 && d.numeric && d.aiLen == 2 && d.ai[0] == '1' && !validDate(f.value)) return Error::BadDate;
+  if ((d.fixed == 14 || d.fixed == 18) && !gs1CheckDigit(f.value, f.len)) return Error::CheckDigit;
+  return Error::None;
+}
+
+// "(01)095...(17)251231(10)LOT"
+static Error parseBracketed(const char* s, size_t len, Result& r){
+  size_t i = 0;
+  while (i < len) {
+    if (s[i] != '(') return Error::UnknownAI;
+    const char* close = (const char*)memchr(s + i, ')', len - i);
+    if (!close) return Error::UnknownAI;
+    const char* ai = s + i + 1; const size_t aiLen = close - ai;
+    const AiDef* d = lookupAi(ai, aiLen);
+    if (!d || d->aiLen != aiLen) return Error::UnknownAI;
+    const char* v = close + 1;
+    const char* end = (const char*)memchr(v, '(', s + len - v);
+    if (!end) end = s + len;
+    if (r.nFields >= MAX_FIELDS) return Error::TooManyFields;
+    Field& f = r.fields[r.nFields++];
+    f = { d, ai, (uint8_t)aiLen, v, (uint8_t)min((size_t)255, (size_t)(end - v)) };
+    Error e = checkField(f); if (e != Error::None) return e;
+    i = end - s;
+  }
+  return Error::None;
+}
+
+// element string mentah: AI panjang tetap langsung bersambung, variabel diakhiri GS
+static Error parseRaw(const char* s, size_t len, Result& r){
+  size_t i = 0;
+  while (i < len) {
+    if (s[i] == GS) { i++; continue; }
+    const AiDef* d = lookupAi(s + i, len - i);
+    if (!d) return Error::UnknownAI;
+    const char* ai = s + i; const char* v = ai + d->aiLen;
+    size_t vl;
+    if (d->fixed) vl = min((size_t)d->fixed, (size_t)(s + len - v));
+    else { const char* g = (const char*)memchr(v, GS, s + len - v); vl = (g ? g : s + len) - v; }
+    if (r.nFields >= MAX_FIELDS) return Error::TooManyFields;
+    Field& f = r.fields[r.nFields++];
+    f = { d, ai, d->aiLen, v, (uint8_t)min((size_t)255, vl) };
+    Error e = checkField(f); if (e != Error::None) return e;
+    i = (v - s) + vl;
+  }
+  return Error::None;
+}
+
+bool parse(const char* s, size_t len, Result& r){
+  r = Result();
+  bool gs1 = false;
+  // symbology identifier AIM "]Xn" (jika diaktifkan di modul)
+  if (len >= 3 && s[0] == ']') {
+    gs1 = (s[1] == 'C' && s[2] == '1') || (s[1] == 'd' && s[2] == '2') || (s[1] == 'Q' && s[2] == '3') || (s[1] == 'e' && s[2] == '0');
+    s += 3; len -= 3;
+  }
+  if (len && s[0] == GS) { gs1 = true; s++; len--; }
+  r.data = s; r.len = len;
+
+  if (gs1 || (len && s[0] == '(')) {
+    r.sym = Symbology::GS1;
+    r.err = (s[0] == '(') ? parseBracketed(s, len, r) : parseRaw(s, len, r);
+    if (r.err == Error::None && r.nFields == 0) r.err = Error::BadLength;
+    return r.valid();
+  }
+  if (allDigits(s, len) && (len == 8 || len == 12 || len == 13)) {
+    r.sym = len == 8 ? Symbology::EAN8 : len == 12 ? Symbology::UPCA : Symbology::EAN13;
+    if (!gs1CheckDigit(s, len)) r.err = Error::CheckDigit;
+  }
+  return r.valid();
+}
+
+const Field* Result::find(const char* name) const {
+  for (uint8_t i = 0; i < nFields; i++) if (fields[i].def->name && strcmp(fields[i].def->name, name) == 0) return &fields[i];
+  return nullptr;
+}
+
+const char* symbologyName(Symbology s){
+  switch (s) {
+    case Symbology::EAN8:  return "ean8";
+    case Symbology::UPCA:  return "upca";
+    case Symbology::EAN13: return "ean13";
+    case Symbology::GS1:   return "gs1";
+    default:               return "other";
+  }
+}
+
+const char* errorName(Error e){
+  switch (e) {
+    case Error::None:          return "none";
+    case Error::CheckDigit:    return "check_digit";
+    case Error::UnknownAI:     return "unknown_ai";
+    case Error::BadLength:     return "bad_length";
+    case Error::BadChar:       return "bad_char";
+    case Error::BadDate:       return "bad_date";
+    default:                   return "too_many_fields";
+  }
+}
+
+} // namespace BarcodeParse
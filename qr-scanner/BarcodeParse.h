@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+
+// Validasi & parsing kode hasil scan tanpa alokasi: semua field menunjuk ke buffer input.
+//   - EAN-8 / UPC-A / EAN-13 (numerik 8/12/13 digit): cek digit GS1 mod-10.
+//   - GS1 (GS1-128, DataMatrix, QR): dikenali dari prefix AIM (]C1 ]d2 ]Q3 ]e0), FNC1/GS di depan,
+//     atau bentuk manusia "(01)...(17)...". AI dipecah memakai tabel AI (panjang tetap/variabel).
+//   - Selain itu (kode internal bebas): Symbology::Other, tidak bisa divalidasi -> valid.
+namespace BarcodeParse {
+
+enum class Symbology : uint8_t { Other, EAN8, UPCA, EAN13, GS1 };
+
+enum class Error : uint8_t {
+  None,
+  CheckDigit,   // cek digit EAN/UPC/GTIN/SSCC salah
+  UnknownAI,    // AI tidak ada di tabel
+  BadLength,    // data AI terlalu pendek/panjang
+  BadChar,      // non-digit pada AI numerik
+  BadDate,      // YYMMDD tidak valid
+  TooManyFields
+};
+
+struct AiDef {
+  const char* ai;    // prefix AI; AI 4 digit (310n) & 9x memakai aiLen > strlen(ai)
+  uint8_t aiLen;     // jumlah digit AI
+  uint8_t fixed;     // panjang data tetap (0 = variabel, diakhiri GS)
+  uint8_t maxLen;
+  bool numeric;
+  const char* name;  // nama field ringkas di payload (nullptr = hanya di objek gs1)
+};
+
+struct Field {
+  const AiDef* def;
+  const char* ai; uint8_t aiLen;   // digit AI di input
+  const char* value; uint8_t len;  // data (tidak diakhiri '\0')
+};
+
+static const size_t MAX_FIELDS = 8;
+static const size_t MAX_FIELD_LEN = 90; // AI 9x
+
+struct Result {
+  Symbology sym = Symbology::Other;
+  Error err = Error::None;
+  const char* data = nullptr; size_t len = 0; // kode tanpa prefix AIM
+  Field fields[MAX_FIELDS]; uint8_t nFields = 0;
+  bool valid() const { return err == Error::None; }
+  const Field* find(const char* name) const;  // by AiDef::name
+};
+
+// true jika kode valid (atau tidak bisa divalidasi); detail di out
+bool parse(const char* s, size_t len, Result& out);
+bool gs1CheckDigit(const char* digits, size_t n); // digit terakhir = cek digit mod-10
+const char* symbologyName(Symbology s);
+const char* errorName(Error e);
+
+} // namespace BarcodeParse
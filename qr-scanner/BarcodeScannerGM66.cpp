@@ -2,36 +2,262 @@
 
 void BarcodeScannerGM66::begin(HardwareSerial& ser, int rxPin, int txPin, uint32_t baud, int trigPin){
   _s = &ser;
-  _s->begin(baud, SERIAL_8N1, rxPin, txPin);
+  _s->setRxBufferSize(UART_RX_BUF); // harus sebelum begin()
+  _baud = baud ? baud : 9600;
+  _s->begin(_baud, SERIAL_8N1, rxPin, txPin);
+  _s->onReceiveError([this](auto){ _stats.uartErrors.fetch_add(1, std::memory_order_relaxed); });
+  _s->onReceive([this](){ drainUart(); }); // FIFO penuh / RX timeout (jeda antar kode)
   _trig = trigPin;
   if (_trig >= 0){ pinMode(_trig, OUTPUT); digitalWrite(_trig, HIGH); } // HIGH idle
-  _buf.reserve(128);
+  if (!baud && !detectBaud()) { _s->updateBaudRate(_baud = 9600); Serial.println(F("[GM66] No reply, assume 9600")); }
+  uint8_t flags;
+  if (readZone(ZONE_FLAGS, &flags, 1)) _mode = flags & 0x03;
 }
 
 void BarcodeScannerGM66::triggerOnce(uint16_t lowMs){
-  if (_trig < 0) return;
+  if (_trig < 0) { const uint8_t go = 1; writeZone(ZONE_TRIGGER, &go, 1); return; }
   digitalWrite(_trig, LOW);
   delay(lowMs);
   digitalWrite(_trig, HIGH);
 }
 
-void BarcodeScannerGM66::handleLine(const String& line){
-  String s = line; s.trim();
-  if (!s.length()) return;
-  const uint32_t now = millis();
-  if (s == _last && (now - _lastMs) < _debounceMs) return; // debounce duplikat cepat
-  _last = s; _lastMs = now;
-  if (_cb) _cb(s);
+// ---- protokol ----
+uint16_t BarcodeScannerGM66::crc16(const uint8_t* p, size_t n){
+  uint16_t crc = 0;
+  while (n--) {
+    crc ^= (uint16_t)*p++ << 8;
+    for (int k = 0; k < 8; k++) crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : crc << 1;
+  }
+  return crc;
 }
 
-void BarcodeScannerGM66::loop(){
-  if (!_s) return;
-  while (_s->available()){
-    char c = (char)_s->read();
-    if (c == '\r' || c == '\n'){
-      if (_buf.length()) { handleLine(_buf); _buf = ""; }
+size_t BarcodeScannerGM66::buildCommand(uint8_t type, uint16_t addr, const uint8_t* data, uint8_t len, uint8_t* out, size_t cap){
+  const size_t total = 6 + len + 2;
+  if (total > cap) return 0;
+  out[0] = 0x7E; out[1] = 0x00; out[2] = type; out[3] = len;
+  out[4] = addr >> 8; out[5] = addr & 0xFF;
+  if (len) memcpy(out + 6, data, len);
+  const uint16_t crc = crc16(out + 2, 4 + len);
+  out[6 + len] = crc >> 8; out[7 + len] = crc & 0xFF;
+  return total;
+}
+
+int BarcodeScannerGM66::parseResponse(const uint8_t* p, size_t n, const uint8_t** data, uint8_t* len){
+  if (n < 4) return 0;
+  if (p[0] != 0x02 || p[1] != 0x00) return -1;
+  const size_t total = 4 + p[3] + 2;
+  if (n < total) return 0;
+  const uint16_t crc = ((uint16_t)p[total - 2] << 8) | p[total - 1];
+  if (crc16(p + 2, 2 + p[3]) != crc) return -1;
+  *data = p + 4; *len = p[3];
+  return (int)total;
+}
+
+bool BarcodeScannerGM66::transact(const uint8_t* cmd, size_t n, uint8_t* out, uint8_t outCap, uint8_t* outLen){
+  if (!_s) return false;
+  _respLen.store(0, std::memory_order_relaxed);
+  _cmdActive.store(true, std::memory_order_release);
+  _s->write(cmd, n);
+  bool ok = false;
+  const uint32_t t0 = millis();
+  while (millis() - t0 < CMD_TIMEOUT_MS) {
+    const uint8_t have = _respLen.load(std::memory_order_acquire);
+    const uint8_t* data; uint8_t len;
+    const int r = parseResponse(_resp, have, &data, &len);
+    if (r < 0) break;
+    if (r > 0) {
+      ok = (_resp[2] == 0x00);
+      if (ok && out) { const uint8_t k = len < outCap ? len : outCap; memcpy(out, data, k); if (outLen) *outLen = k; }
+      break;
+    }
+    delay(2);
+  }
+  _cmdActive.store(false, std::memory_order_release);
+  if (ok) _stats.cmdOk++; else _stats.cmdFail++;
+  return ok;
+}
+
+bool BarcodeScannerGM66::readZone(uint16_t addr, uint8_t* out, uint8_t n){
+  uint8_t cmd[16]; uint8_t got = 0;
+  const size_t len = buildCommand(0x07, addr, &n, 1, cmd, sizeof(cmd));
+  return transact(cmd, len, out, n, &got) && got == n;
+}
+
+bool BarcodeScannerGM66::writeZone(uint16_t addr, const uint8_t* data, uint8_t n){
+  uint8_t cmd[24];
+  const size_t len = buildCommand(0x08, addr, data, n, cmd, sizeof(cmd));
+  return len && transact(cmd, len, nullptr, 0, nullptr);
+}
+
+bool BarcodeScannerGM66::saveSettings(){
+  uint8_t cmd[16]; const uint8_t zero = 0;
+  const size_t len = buildCommand(0x09, 0x0000, &zero, 1, cmd, sizeof(cmd));
+  return transact(cmd, len, nullptr, 0, nullptr);
+}
+
+uint32_t BarcodeScannerGM66::detectBaud(){
+  static const uint32_t BAUDS[] = { 115200, 9600, 57600, 38400, 19200 };
+  uint8_t flags;
+  for (uint32_t b : BAUDS) {
+    _s->updateBaudRate(b);
+    if (readZone(ZONE_FLAGS, &flags, 1)) { _baud = b; Serial.printf("[GM66] Detected %lu baud\n", (unsigned long)b); return b; }
+  }
+  return 0;
+}
+
+bool BarcodeScannerGM66::setBaud(uint32_t baud){
+  if (!baud) return false;
+  const uint16_t div = (3000000UL + baud / 2) / baud;
+  const uint8_t v[2] = { (uint8_t)(div & 0xFF), (uint8_t)(div >> 8) };
+  const uint32_t old = _baud;
+  if (!writeZone(ZONE_BAUD, v, 2)) return false; // jawaban masih di baud lama
+  _s->flush(); delay(20);
+  _s->updateBaudRate(baud);
+  uint8_t flags;
+  if (!readZone(ZONE_FLAGS, &flags, 1)) { _s->updateBaudRate(old); return false; }
+  _baud = baud;
+  return saveSettings();
+}
+
+bool BarcodeScannerGM66::setMode(Mode m){
+  uint8_t flags;
+  if (!readZone(ZONE_FLAGS, &flags, 1)) return false;
+  flags = (flags & ~0x03) | (m & 0x03);
+  if (!writeZone(ZONE_FLAGS, &flags, 1) || !saveSettings()) return false;
+  _mode = m;
+  return true;
+}
+
+bool BarcodeScannerGM66::validReadTiming(long readMs, long intervalMs){
+  if (readMs < -1 || (readMs > 0 && readMs < READ_MS_MIN) || readMs > TIMING_MS_MAX) return false; // < 100 ms = 0 = tanpa batas
+  return intervalMs >= -1 && intervalMs <= TIMING_MS_MAX;
+}
+
+bool BarcodeScannerGM66::setReadTiming(long readMs, long intervalMs){
+  if (!validReadTiming(readMs, intervalMs)) return false;
+  uint8_t v[2]; // 0x0005, 0x0006
+  if ((readMs < 0 || intervalMs < 0) && !readZone(ZONE_READ_TIME, v, 2)) return false;
+  if (readMs >= 0) v[0] = readMs / 100;
+  if (intervalMs >= 0) v[1] = intervalMs / 100;
+  return writeZone(ZONE_READ_TIME, v, 2) && saveSettings();
+}
+
+// ---- task event UART ----
+void BarcodeScannerGM66::drainUart(){
+  uint8_t chunk[64];
+  int avail;
+  while ((avail = _s->available()) > 0) {
+    size_t n = _s->read(chunk, min((size_t)avail, sizeof(chunk)));
+    if (!n) break;
+    _stats.bytes.fetch_add(n, std::memory_order_relaxed);
+    if (_cmdActive.load(std::memory_order_acquire)) {
+      // respons protokol: mulai di header 0x02, panjang dari byte len; sisanya milik scan
+      uint8_t have = _respLen.load(std::memory_order_relaxed);
+      uint32_t other = 0;
+      for (size_t i = 0; i < n; i++) {
+        const bool done = have >= 4 && have >= 4 + _resp[3] + 2;
+        if ((have == 0 && chunk[i] != 0x02) || done || have == sizeof(_resp)) { feed((char)chunk[i]); other++; continue; }
+        _resp[have++] = chunk[i];
+      }
+      _respLen.store(have, std::memory_order_release);
+      if (other) _stats.interleaved.fetch_add(other, std::memory_order_relaxed);
+      continue;
+    }
+    for (size_t i = 0; i < n; i++) feed((char)chunk[i]);
+  }
+}
+
+void BarcodeScannerGM66::feed(char c){
+  if (c == '\r' || c == '\n') { commitLine(); return; }
+  if (_lineLen == 0 && (c == ' ' || c == '\t')) return; // trim kiri
+  if (_lineLen < CODE_MAX) _line[_lineLen++] = c;
+  else _lineOver = true;
+}
+
+void BarcodeScannerGM66::commitLine(){
+  while (_lineLen && (_line[_lineLen - 1] == ' ' || _line[_lineLen - 1] == '\t')) _lineLen--; // trim kanan
+  if (_lineLen) {
+    if (_lineOver) _stats.truncated.fetch_add(1, std::memory_order_relaxed);
+    const uint16_t head = _head.load(std::memory_order_relaxed);
+    const uint16_t used = head - _tail.load(std::memory_order_acquire);
+    if (used >= RING_CODES) {
+      _stats.dropped.fetch_add(1, std::memory_order_relaxed);
     } else {
-      if (_buf.length() < 200) _buf += c;
+      Code& k = _ring[head % RING_CODES];
+      memcpy(k.text, _line, _lineLen); k.text[_lineLen] = '\0';
+      k.len = _lineLen; k.ms = millis();
+      _head.store(head + 1, std::memory_order_release);
+      if (used + 1 > _stats.ringPeak) _stats.ringPeak = used + 1;
     }
   }
-}
\ No newline at end of file
+  _lineLen = 0; _lineOver = false;
+}
+
+// ---- loop() ----
+void BarcodeScannerGM66::setDedup(uint32_t windowMs, uint8_t size){
+  if (size < 1) size = 1;
+  if (size > DEDUP_MAX) size = DEDUP_MAX;
+  _dedupWindowReq = windowMs; _dedupSizeReq = size;
+  _dedupDirty = true;
+}
+
+void BarcodeScannerGM66::dedupEvictOldest(){
+  DedupSlot* old = nullptr;
+  for (auto& s : _dedup) if (s.state == SLOT_LIVE && (!old || (int32_t)(s.ms - old->ms) < 0)) old = &s;
+  if (old) { old->state = SLOT_DEAD; _dedupLive--; }
+}
+
+// Tombstone menumpuk -> probe makin panjang; bangun ulang tabel dari entri yang masih hidup
+void BarcodeScannerGM66::dedupRehash(uint32_t now){
+  DedupSlot keep[DEDUP_MAX]; size_t n = 0;
+  for (auto& s : _dedup) if (s.state == SLOT_LIVE && now - s.ms < _dedupWindowMs && n < DEDUP_MAX) keep[n++] = s;
+  for (auto& s : _dedup) s.state = SLOT_EMPTY;
+  for (size_t k = 0; k < n; k++) {
+    size_t idx = keep[k].hash % DEDUP_SLOTS;
+    while (_dedup[idx].state != SLOT_EMPTY) idx = (idx + 1) % DEDUP_SLOTS;
+    _dedup[idx] = keep[k];
+  }
+  _dedupLive = n;
+}
+
+// Kunci = hash 32-bit: dua kode berbeda tertukar hanya jika hash-nya bertabrakan (~1/2^32).
+bool BarcodeScannerGM66::dedupSeen(uint32_t hash, uint32_t now){
+  int freeIdx = -1;
+  size_t i = 0;
+  for (; i < DEDUP_SLOTS; i++) {
+    const size_t idx = (hash + i) % DEDUP_SLOTS;
+    DedupSlot& s = _dedup[idx];
+    if (s.state == SLOT_EMPTY) { if (freeIdx < 0) freeIdx = idx; break; }
+    if (s.state == SLOT_LIVE && now - s.ms >= _dedupWindowMs) { s.state = SLOT_DEAD; _dedupLive--; }
+    if (s.state == SLOT_DEAD) { if (freeIdx < 0) freeIdx = idx; continue; }
+    if (s.hash == hash) return true; // window dihitung dari terbit pertama, tidak diperpanjang
+  }
+  if (_dedupLive >= _dedupSize) dedupEvictOldest();
+  if (freeIdx < 0) return false; // tidak terjadi: live <= DEDUP_MAX < DEDUP_SLOTS
+  DedupSlot& s = _dedup[freeIdx];
+  s.hash = hash; s.ms = now; s.state = SLOT_LIVE; _dedupLive++;
+  if (i > DEDUP_PROBE_MAX) dedupRehash(now);
+  return false;
+}
+
+void BarcodeScannerGM66::handleCode(const Code& k){
+  uint32_t h = 2166136261u;
+  for (uint16_t i = 0; i < k.len; i++) h = (h ^ (uint8_t)k.text[i]) * 16777619u;
+  if (dedupSeen(h, k.ms)) { _stats.duplicates++; return; }
+  _stats.codes++;
+  if (_cb) _cb(k.text, k.len);
+}
+
+void BarcodeScannerGM66::loop(){
+  if (!_s) return;
+  if (_dedupDirty) { // setelan baru dari portal: mulai dari tabel kosong
+    _dedupWindowMs = _dedupWindowReq; _dedupSize = _dedupSizeReq; _dedupDirty = false;
+    for (auto& s : _dedup) s.state = SLOT_EMPTY;
+    _dedupLive = 0;
+  }
+  uint16_t tail = _tail.load(std::memory_order_relaxed);
+  while (tail != _head.load(std::memory_order_acquire)) {
+    handleCode(_ring[tail % RING_CODES]); // slot baru dilepas setelah callback selesai
+    _tail.store(++tail, std::memory_order_release);
+  }
+}
@@ -1,24 +1,118 @@
 #pragma once
 #include <Arduino.h>
+#include <atomic>
 #include <functional>
 
+// Byte GM66 diambil task event UART (HardwareSerial::onReceive), bukan polling di loop():
+// baris (CR/LF) dirakit di buffer tetap lalu masuk ring kode; loop() hanya mengambil kode jadi.
+// Tidak ada alokasi heap per scan. Setelan modul lewat protokol serial GM66 (zone bit):
+//   perintah: 7E 00 <type> <len> <addrH> <addrL> <data..> <crcH> <crcL>  (07 baca, 08 tulis, 09 simpan)
+//   respons : 02 00 <status> <len> <data..> <crcH> <crcL>                 (status 00 = OK)
+// CRC = CRC-CCITT/XModem atas byte setelah header 2 byte s/d akhir data.
 class BarcodeScannerGM66 {
 public:
-  using Callback = std::function<void(const String& kode)>;
+  static const size_t CODE_MAX    = 200;  // kode lebih panjang dipotong
+  static const size_t RING_CODES  = 16;   // kode jadi yang bisa menunggu loop()
+  static const size_t UART_RX_BUF = 1024; // buffer RX driver UART
+  static const size_t DEDUP_MAX   = 32;   // kode berbeda maksimal yang diingat untuk dedup
+  static const uint32_t CMD_TIMEOUT_MS = 120;
 
+  enum Mode : uint8_t { MODE_MANUAL = 0, MODE_COMMAND = 1, MODE_CONTINUOUS = 2, MODE_SENSOR = 3 };
+  static const uint16_t ZONE_FLAGS     = 0x0000; // bit1-0: mode kerja
+  static const uint16_t ZONE_TRIGGER   = 0x0002; // tulis 1 = mulai baca (mode command)
+  static const uint16_t ZONE_READ_TIME = 0x0005; // lama satu baca, x100 ms (0 = tanpa batas)
+  static const uint16_t ZONE_INTERVAL  = 0x0006; // jeda antar baca, x100 ms
+  static const uint16_t ZONE_BAUD      = 0x002A; // 2 byte LE: 3000000 / baud
+
+  // kode hanya valid selama callback berjalan (slot ring dipakai ulang sesudahnya)
+  using Callback = std::function<void(const char* kode, size_t len)>;
+
+  // yang ditulis task UART atomik: dibaca loop()/handler HTTP di core lain
+  struct Stats {
+    std::atomic<uint32_t> bytes{0};       // byte diterima
+    uint32_t codes = 0;                   // kode diteruskan ke aplikasi
+    uint32_t duplicates = 0;              // dibuang dedup
+    std::atomic<uint32_t> dropped{0};     // hilang karena ring penuh (loop() tertahan terlalu lama)
+    std::atomic<uint32_t> truncated{0};   // kode > CODE_MAX
+    std::atomic<uint32_t> uartErrors{0};  // overflow FIFO/buffer, framing, parity
+    std::atomic<uint32_t> interleaved{0}; // byte scan yang tiba di tengah transaksi protokol (tetap dirakit)
+    uint8_t  ringPeak = 0;                // isi ring tertinggi
+    uint32_t cmdOk = 0, cmdFail = 0; // transaksi protokol (timeout/CRC/status != 0 = fail)
+  };
+
+  // baud = 0: deteksi otomatis (detectBaud), jatuh ke 9600 pabrik bila modul tidak menjawab
   void begin(HardwareSerial& ser, int rxPin, int txPin, uint32_t baud=9600, int trigPin=-1);
   void onScan(Callback cb) { _cb = cb; }
   void loop();
 
-  void setDebounceMs(uint32_t ms) { _debounceMs = ms; }
-  void triggerOnce(uint16_t lowMs=50); // aktifkan kalau trigPin terpasang
+  // kode yang sama dalam windowMs sejak terbit pertama dibuang; berlaku untuk size kode berbeda
+  // terakhir (A,B,A,B tetap tertahan). Aman dipanggil dari task lain: diterapkan di loop().
+  void setDedup(uint32_t windowMs, uint8_t size);
+  void setDebounceMs(uint32_t ms) { setDedup(ms, _dedupSizeReq); }
+  uint32_t dedupWindowMs() const { return _dedupWindowReq; }
+  uint8_t dedupSize() const { return _dedupSizeReq; }
+  void triggerOnce(uint16_t lowMs=50); // pin trigger jika terpasang, selain itu perintah serial
+
+  // ---- protokol (blocking s/d CMD_TIMEOUT_MS per transaksi; panggil dari setup()/job loop()) ----
+  uint32_t baud() const { return _baud; }
+  int mode() const { return _mode; }  // -1 = belum terbaca
+  uint32_t detectBaud();              // 0 jika modul tidak menjawab di baud manapun
+  bool setBaud(uint32_t baud);        // tulis modul, pindah UART, verifikasi, simpan flash modul
+  bool setMode(Mode m);
+  // -1 = nilai di modul dipertahankan (zone dibaca dulu). readMs 0 = tanpa batas, selain itu
+  // READ_MS_MIN..TIMING_MS_MAX; intervalMs 0..TIMING_MS_MAX; resolusi 100 ms. Di luar rentang -> false
+  static const int32_t READ_MS_MIN = 100, TIMING_MS_MAX = 25500;
+  static bool validReadTiming(long readMs, long intervalMs);
+  bool setReadTiming(long readMs, long intervalMs);
+  bool readZone(uint16_t addr, uint8_t* out, uint8_t n);
+  bool writeZone(uint16_t addr, const uint8_t* data, uint8_t n);
+  bool saveSettings();                // zone bit -> flash internal modul
+
+  // framing murni (tanpa I/O)
+  static uint16_t crc16(const uint8_t* p, size_t n);
+  static size_t buildCommand(uint8_t type, uint16_t addr, const uint8_t* data, uint8_t len, uint8_t* out, size_t cap);
+  // return panjang frame (> 0), 0 = belum lengkap, -1 = rusak (header/CRC)
+  static int parseResponse(const uint8_t* p, size_t n, const uint8_t** data, uint8_t* len);
+  const Stats& stats() const { return _stats; }
 
 private:
+  struct Code { char text[CODE_MAX + 1]; uint16_t len; uint32_t ms; };
+
   HardwareSerial* _s = nullptr;
   int _trig=-1;
-  String _buf;
+  uint32_t _baud = 0;
+  int _mode = -1;
   Callback _cb;
-  String _last; uint32_t _lastMs=0, _debounceMs=800;
+  Stats _stats;
+
+  // sisi task UART (produsen)
+  char _line[CODE_MAX]; uint16_t _lineLen = 0; bool _lineOver = false;
+  // ring SPSC: _head ditulis task UART, _tail ditulis loop()
+  Code _ring[RING_CODES];
+  std::atomic<uint16_t> _head{0}, _tail{0};
+  // transaksi protokol: selama _cmdActive frame respons (02 00 ..) masuk _resp; byte sebelum
+  // header / sesudah frame lengkap tetap ke perakit baris (scan di mode continuous tidak hilang)
+  std::atomic<bool> _cmdActive{false};
+  uint8_t _resp[64]; std::atomic<uint8_t> _respLen{0};
+
+  // sisi loop() (konsumen): set dedup open addressing (linear probing) atas hash FNV-1a kode,
+  // kapasitas 2x DEDUP_MAX supaya load factor <= 0.5. DEAD = kedaluwarsa/digusur (tombstone).
+  enum : uint8_t { SLOT_EMPTY, SLOT_LIVE, SLOT_DEAD };
+  struct DedupSlot { uint32_t hash = 0; uint32_t ms = 0; uint8_t state = SLOT_EMPTY; };
+  static const size_t DEDUP_SLOTS = DEDUP_MAX * 2;
+  static const size_t DEDUP_PROBE_MAX = 8; // probe lebih panjang -> rehash
+  DedupSlot _dedup[DEDUP_SLOTS];
+  uint8_t _dedupLive = 0;
+  uint32_t _dedupWindowMs = 800; uint8_t _dedupSize = 8;
+  volatile uint32_t _dedupWindowReq = 800; volatile uint8_t _dedupSizeReq = 8;
+  volatile bool _dedupDirty = false;
 
-  void handleLine(const String& line);
+  void drainUart();
+  bool transact(const uint8_t* cmd, size_t n, uint8_t* out, uint8_t outCap, uint8_t* outLen);
+  void feed(char c);
+  void commitLine();
+  void handleCode(const Code& k);
+  bool dedupSeen(uint32_t hash, uint32_t now); // true = duplikat; jika tidak, kode dicatat
+  void dedupEvictOldest();
+  void dedupRehash(uint32_t now);
 };
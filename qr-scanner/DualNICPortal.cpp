@@ -1,4 +1,6 @@
 #include "DualNICPortal.h"
+#include "FlashWear.h"
+#include <memory>
 
 
 // ---- MQTT probe state (non-blocking terhadap AsyncWebServer) ----
@@ -71,6 +73,13 @@ extern const char INDEX_HTML[] PROGMEM = R"HTML(<!doctype html>
         <label>Password</label>
         <input id="passInput" type="password" placeholder="••••••">
       </div>
+      <div>
+        <label>IP Wi-Fi</label>
+        <select id="wifiIpMode"><option value="dhcp">DHCP</option><option value="cached">Pakai IP terakhir (cepat)</option><option value="static">Static</option></select>
+      </div>
+      <div><label>IP Static</label><input id="wifiIP" placeholder="192.168.1.60"></div>
+      <div><label>Gateway</label><input id="wifiGW" placeholder="192.168.1.1"></div>
+      <div><label>Subnet</label><input id="wifiSN" placeholder="255.255.255.0"></div>
       <div style="align-self:end">
         <button id="connectBtn">Sambungkan</button>
       </div>
@@ -78,8 +87,9 @@ extern const char INDEX_HTML[] PROGMEM = R"HTML(<!doctype html>
   </section>
 
   <section class="card" id="ethCard">
-    <h3>Ethernet (Static)</h3>
+    <h3>Ethernet</h3>
     <div class="grid">
+      <div><label>Mode</label><select id="ethMode"><option value="dhcp">DHCP</option><option value="static">Static</option></select></div>
       <div><label>IP Address</label><input id="ethIP" placeholder="192.168.1.50"></div>
       <div><label>Gateway</label><input id="ethGW" placeholder="192.168.1.1"></div>
       <div><label>Subnet</label><input id="ethSN" placeholder="255.255.255.0"></div>
@@ -105,10 +115,82 @@ extern const char INDEX_HTML[] PROGMEM = R"HTML(<!doctype html>
     <h3>Antrian Offline</h3>
     <div class="row">
       <button id="flushQueue">Flush ke MQTT</button>
+      <a class="btn" style="text-decoration:none" href="/api/queue/export?format=csv">Export CSV</a>
+      <a class="btn" style="text-decoration:none" href="/api/queue/export">Export NDJSON</a>
       <span class="hint">Akan mengirim item antrian jika MQTT sedang terhubung.</span>
     </div>
   </section>
 
+  <section class="card hide" id="scannerCard">
+    <h3>Scanner</h3>
+    <div class="grid">
+      <div><label>Jendela dedup (ms)</label><input id="dedupWin" type="number" min="0" placeholder="600"></div>
+      <div><label>Jumlah kode diingat</label><input id="dedupSize" type="number" min="1" max="32" placeholder="8"></div>
+      <div><label>Validasi EAN/UPC/GS1</label><select id="scanValidate"><option value="1">Tolak kode rusak</option><option value="0">Terima semua</option></select></div>
+      <div style="align-self:end"><button id="saveDedup">Simpan</button></div>
+    </div>
+    <div class="grid" style="margin-top:12px">
+      <div><label>Mode modul</label><select id="scanMode"><option value="continuous">Continuous</option><option value="sensor">Sensor</option><option value="command">Command</option><option value="manual">Manual</option></select></div>
+      <div><label>Jeda antar baca (ms)</label><input id="scanInterval" type="number" min="0" step="100" placeholder="0"></div>
+      <div style="align-self:end"><button id="saveScanner">Terapkan ke modul</button></div>
+    </div>
+    <div class="row" style="margin-top:12px">
+      <input id="prodFile" type="file" accept=".csv,text/csv">
+      <button id="uploadProducts">Upload tabel produk</button>
+      <span class="hint">CSV per baris: kode,sku</span>
+    </div>
+    <div class="hint" id="scannerStat"></div>
+  </section>
+
+  <section class="card hide" id="lanesCard">
+    <h3>Jalur Sensor</h3>
+    <div class="hint" id="lanesStat"></div>
+    <label style="margin-top:12px">Konfigurasi (JSON)</label>
+    <textarea id="lanesCfg" rows="4" style="width:100%;font-family:monospace" placeholder='[{"id":1,"pin":2,"debounce_ms":300,"min_pulse_ms":0,"topic":"/lane1"}]'></textarea>
+    <div class="row" style="margin-top:8px">
+      <button id="saveLanes">Simpan jalur</button>
+      <span class="hint">Maks 8 jalur; counter jalur dengan id sama dipertahankan.</span>
+    </div>
+  </section>
+
+  <section class="card hide" id="tallyCard">
+    <h3>Tally Shift</h3>
+    <div class="grid">
+      <div><label>Jam mulai shift</label><input id="tallyShifts" placeholder="06:00,14:00,22:00"></div>
+      <div><label>Publish ringkasan (detik, 0 = mati)</label><input id="tallyPublish" type="number" min="0" placeholder="300"></div>
+      <div><label>Snapshot (detik)</label><input id="tallySnapshot" type="number" min="10" placeholder="60"></div>
+      <div><label>Uplink</label><select id="tallySummaryOnly"><option value="0">Per scan + ringkasan</option><option value="1">Ringkasan saja</option></select></div>
+      <div style="align-self:end"><button id="saveTally">Simpan</button></div>
+    </div>
+    <div class="hint" id="tallyStat"></div>
+    <div class="hint" id="tallyTop"></div>
+  </section>
+
+  <section class="card hide" id="timeCard">
+    <h3>Waktu (SNTP)</h3>
+    <div class="grid">
+      <div><label>Server NTP</label><input id="ntpServer" placeholder="pool.ntp.org"></div>
+      <div><label>Interval sinkron (menit)</label><input id="ntpInterval" type="number" min="1" max="1440" placeholder="60"></div>
+      <div><label>Ambang tulis RTC (ms)</label><input id="ntpThreshold" type="number" min="10" max="60000" placeholder="500"></div>
+      <div><label>Zona waktu (menit dari UTC)</label><input id="tzMin" type="number" min="-720" max="840" placeholder="420"></div>
+      <div style="align-self:end"><button id="saveTime">Simpan</button> <button id="syncTime">Sinkron sekarang</button></div>
+    </div>
+    <div class="hint" id="timeStat"></div>
+  </section>
+
+  <section class="card hide" id="fanCard">
+    <h3>Kipas</h3>
+    <div class="grid">
+      <div><label>Nyala pada (°C)</label><input id="fanOn" type="number" step="0.5" placeholder="50"></div>
+      <div><label>Mati pada (°C)</label><input id="fanOff" type="number" step="0.5" placeholder="30"></div>
+      <div><label>Penuh pada (°C)</label><input id="fanFull" type="number" step="0.5" placeholder="50"></div>
+      <div><label>Duty minimum (0-255)</label><input id="fanMin" type="number" min="0" max="255" placeholder="80"></div>
+      <div><label>Sampel suhu (ms)</label><input id="fanSample" type="number" min="100" max="60000" placeholder="1000"></div>
+      <div style="align-self:end"><button id="saveFan">Simpan</button></div>
+    </div>
+    <div class="hint" id="fanStat"></div>
+  </section>
+
   <section class="card">
     <h3>AP & Reset</h3>
     <div class="row">
@@ -124,6 +206,17 @@ const $ = sel => document.querySelector(sel);
 const api = (p, opt={}) => fetch(p, Object.assign({headers:{'Content-Type':'application/json'}}, opt));
 const setIfIdle = (el, v) => { if (!el) return; if (document.activeElement === el) return; el.value = v ?? ''; };
 let uiMode = 'wifi';
+// handler berat dijalankan device sebagai job: 202 + id, lalu poll /api/jobs/<id> sampai selesai
+async function apiJob(p, opt){
+  let r = await api(p, opt); const j = await r.json();
+  if (r.status !== 202) return {ok:r.ok, status:r.status, j};
+  for(;;){
+    await new Promise(res=>setTimeout(res, 500));
+    r = await api('/api/jobs/' + j.job); const s = await r.json();
+    if (!r.ok) return {ok:false, status:r.status, j:s};
+    if (s.state === 'done') return {ok:s.code>=200 && s.code<300, status:s.code, j:s.result||{}};
+  }
+}
 function fmtMs(ms){ if(ms<=0) return '—'; const s=Math.ceil(ms/1000); const m=Math.floor(s/60); const r=s%60; return `${m}:${String(r).padStart(2,'0')}`; }
 
 async function refreshStatus(){
@@ -138,12 +231,16 @@ async function refreshStatus(){
     $('#apStat').textContent = j.ap.active ? ('AP: ' + j.ap.ssid) : 'AP: nonaktif';
     $('#mdnsStat').textContent = 'mDNS: ' + (j.mdns?.host ? (j.mdns.host + '.local') : '—');
     $('#apTimer').textContent = 'AP Auto-Off: ' + fmtMs(j.ap.remaining_ms||0);
-    $('#queueStat').textContent = `Queue: ${j.queue?.count||0} (${j.queue?.bytes||0}B)`;
+    $('#queueStat').textContent = `Queue: ${j.queue?.count||0} (RAM ${j.queue?.ram?.count||0}, ${j.queue?.bytes||0}B)`;
 
     const ssidInput = $('#ssidSaved');
     if (ssidInput && ssidInput !== document.activeElement){
       if (ssidInput.value === '' || ssidInput.value === (j.wifi.ssid || '')) ssidInput.value = j.wifi.ssid || '';
     }
+    const wifiIpMode = $('#wifiIpMode');
+    if (wifiIpMode && wifiIpMode !== document.activeElement) wifiIpMode.value = j.wifi.ip_mode || 'dhcp';
+    const ethMode = $('#ethMode');
+    if (ethMode && ethMode !== document.activeElement) ethMode.value = j.cfg.eth_mode || 'dhcp';
     $('#ethIP').value = j.cfg.eth_ip||'';
     $('#ethGW').value = j.cfg.eth_gateway||'';
     $('#ethSN').value = j.cfg.eth_subnet||'';
@@ -167,6 +264,50 @@ async function refreshStatus(){
       if (mqTopic.value === '' || mqTopic.value === (j.mqtt.topic || '')) mqTopic.value = j.mqtt.topic || '';
     }
 
+    $('#lanesCard').classList.toggle('hide', !j.lanes);
+    if (j.lanes){
+      $('#lanesStat').textContent = j.lanes.map(l=>`Jalur ${l.id} (GPIO ${l.pin}): ${l.total??l.count}` + (l.total!==undefined ? ` (${l.count} sejak boot)` : '') + (l.ipm!==undefined ? ` · ${l.ipm} item/menit` + (l.stalled ? ` · MACET ${l.idle_s} s` : '') : '') + (l.bounces||l.glitches ? ` · ditolak ${l.bounces+l.glitches}` : '')).join(' · ');
+      setIfIdle($('#lanesCfg'), JSON.stringify(j.lanes.map(({id,pin,debounce_ms,min_pulse_ms,topic})=>({id,pin,debounce_ms,min_pulse_ms,topic}))));
+      if (j.counter) $('#lanesStat').textContent += ` · pulih dari ${j.counter.restored} · ${j.counter.bytes_per_count.toFixed(1)} B flash/hitungan`;
+    }
+    $('#tallyCard').classList.toggle('hide', !j.tally);
+    if (j.tally){
+      setIfIdle($('#tallyShifts'), j.tally.shifts);
+      setIfIdle($('#tallyPublish'), j.tally.publish_s);
+      setIfIdle($('#tallySnapshot'), j.tally.snapshot_s);
+      setIfIdle($('#tallySummaryOnly'), j.tally.summary_only ? '1' : '0');
+      $('#tallyStat').textContent = `Shift ${j.tally.shift} (${j.tally.date||'—'}) · ${j.tally.total} scan · ${j.tally.unique} kode` + (j.tally.overflow ? ` · ${j.tally.overflow} tidak tercatat (tabel penuh)` : '');
+      const t = await (await api('/api/tally?limit=10')).json();
+      $('#tallyTop').textContent = (t.items||[]).map(i=>`${i.kode}${i.sku!==undefined?' ['+i.sku+']':''} ×${i.count}`).join(' · ');
+    }
+    $('#timeCard').classList.toggle('hide', !j.time);
+    if (j.time){
+      const t = j.time;
+      setIfIdle($('#ntpServer'), t.server);
+      setIfIdle($('#ntpInterval'), t.interval_min);
+      setIfIdle($('#ntpThreshold'), t.threshold_ms);
+      setIfIdle($('#tzMin'), t.tz_min);
+      $('#timeStat').textContent = (t.synced ? `Sinkron ${t.last_sync_s} s lalu via ${t.nic} (stratum ${t.stratum}) · offset ${t.offset_ms.toFixed(1)} ms · delay ${t.delay_ms.toFixed(1)} ms` : 'Belum sinkron')
+        + ` · drift RTC ${t.drift_ppm.toFixed(3)} ppm` + (t.drift_ready ? '' : ` (estimasi, ${t.samples} sampel)`) + ` · RTC ditulis ${t.rtc_writes}×` + (t.failures ? ` · gagal ${t.failures}` : '');
+    }
+    $('#fanCard').classList.toggle('hide', !j.fan);
+    if (j.fan){
+      setIfIdle($('#fanOn'), j.fan.on_c); setIfIdle($('#fanOff'), j.fan.off_c); setIfIdle($('#fanFull'), j.fan.full_c);
+      setIfIdle($('#fanMin'), j.fan.min_duty); setIfIdle($('#fanSample'), j.fan.sample_ms);
+      $('#fanStat').textContent = (j.fan.temp_c !== undefined ? `Suhu ${j.fan.temp_c} °C` : 'Suhu —') + ` · duty ${Math.round(j.fan.duty*100/255)}%`
+        + (j.fan.fail_safe ? ' · SENSOR GAGAL, kipas penuh' : '') + (j.fan.faults ? ` · ${j.fan.faults} baca gagal` : '');
+    }
+    // kartu scanner hanya untuk perangkat yang melaporkan j.scanner
+    $('#scannerCard').classList.toggle('hide', !j.scanner);
+    if (j.scanner){
+      setIfIdle($('#dedupWin'), j.scanner.dedup_window_ms);
+      setIfIdle($('#dedupSize'), j.scanner.dedup_size);
+      setIfIdle($('#scanValidate'), j.scanner.validate ? '1' : '0');
+      const modes = ['manual','command','continuous','sensor'];
+      if (j.scanner.mode >= 0) setIfIdle($('#scanMode'), modes[j.scanner.mode]);
+      $('#scannerStat').textContent = `Kode: ${j.scanner.codes} · duplikat ditahan: ${j.scanner.duplicates} · ditolak: ${j.scanner.rejected||0} · drop: ${j.scanner.dropped} · ${j.scanner.baud} baud · produk: ${j.products?.count||0}`;
+    }
+
     $('#wifiCard').classList.toggle('hide', uiMode !== 'wifi');
     $('#ethCard').classList.toggle('hide', uiMode !== 'ethernet');
   }catch(e){console.warn(e)}
@@ -174,8 +315,8 @@ async function refreshStatus(){
 
 $('#scanBtn')?.addEventListener('click', async ()=>{
   const tb = $('#scanBody'); tb.innerHTML = '<tr><td colspan=4 class="muted">Memindai...</td></tr>';
-  const r = await api('/api/scan'); const j = await r.json();
-  if(!j.aps || !j.aps.length){ tb.innerHTML = '<tr><td colspan=4 class="muted">Tidak ada jaringan ditemukan.</td></tr>'; return; }
+  const {ok, j} = await apiJob('/api/scan');
+  if(!ok || !j.aps || !j.aps.length){ tb.innerHTML = '<tr><td colspan=4 class="muted">Tidak ada jaringan ditemukan.</td></tr>'; return; }
   tb.innerHTML = '';
   j.aps.sort((a,b)=>b.rssi-a.rssi).forEach(ap=>{
     const tr = document.createElement('tr');
@@ -188,19 +329,18 @@ $('#scanBtn')?.addEventListener('click', async ()=>{
 $('#connectBtn')?.addEventListener('click', async ()=>{
   const ssid = $('#ssidSaved').value.trim(); const pass = $('#passInput').value;
   if(!ssid){ alert('Isi SSID terlebih dahulu.'); return; }
-  const r = await api('/api/wifi/connect',{method:'POST',body:JSON.stringify({ssid,pass})});
-  const ok = r.ok; const j = await r.json();
-  alert(ok? 'Wi-Fi tersambung.':'Gagal: '+(j.error||r.status));
+  const ip_mode = $('#wifiIpMode').value, ip = $('#wifiIP').value.trim(), gateway = $('#wifiGW').value.trim(), subnet = $('#wifiSN').value.trim();
+  const {ok, status, j} = await apiJob('/api/wifi/connect',{method:'POST',body:JSON.stringify({ssid,pass,ip_mode,ip,gateway,subnet})});
+  alert(ok? 'Wi-Fi tersambung.':'Gagal: '+(j.error||status));
   refreshStatus();
 });
 $('#discBtn')?.addEventListener('click', async ()=>{ await api('/api/wifi/disconnect',{method:'POST'}); refreshStatus(); });
 
 $('#saveEth')?.addEventListener('click', async ()=>{
-  const ip=$('#ethIP').value.trim(), gw=$('#ethGW').value.trim(), sn=$('#ethSN').value.trim();
-  if(!ip||!sn){ alert('IP dan Subnet wajib diisi.'); return; }
-  const r = await api('/api/eth/set',{method:'POST',body:JSON.stringify({ip,gateway,subnet})});
-  const ok = r.ok; const j = await r.json();
-  alert(ok? 'Ethernet diterapkan.':'Gagal: '+(j.error||r.status));
+  const mode=$('#ethMode').value, ip=$('#ethIP').value.trim(), gw=$('#ethGW').value.trim(), sn=$('#ethSN').value.trim();
+  if(mode==='static' && (!ip||!sn)){ alert('IP dan Subnet wajib diisi.'); return; }
+  const {ok, status, j} = await apiJob('/api/eth/set',{method:'POST',body:JSON.stringify({mode,ip,gateway:gw,subnet:sn})});
+  alert(ok? 'Ethernet diterapkan.':'Gagal: '+(j.error||status));
   setTimeout(refreshStatus, 1000);
 });
 
@@ -222,9 +362,65 @@ $('#saveMQTT').addEventListener('click', async ()=>{
 
 // offline queue UI akan memanggil endpoint ekstra yang kamu tambahkan di sketch
 $('#flushQueue')?.addEventListener('click', async ()=>{
-  const r = await api('/api/queue/flush',{method:'POST'});
+  const {ok, status, j} = await apiJob('/api/queue/flush',{method:'POST'});
+  alert(ok? 'Flushed: ' + (j.flushed||0) : 'Gagal: '+(j.error||status));
+  refreshStatus();
+});
+
+$('#saveDedup')?.addEventListener('click', async ()=>{
+  const window_ms=Number($('#dedupWin').value||0), size=Number($('#dedupSize').value||1), validate=$('#scanValidate').value==='1';
+  const r = await api('/api/scanner/settings',{method:'POST',body:JSON.stringify({window_ms,size,validate})});
   const j = await r.json();
-  alert('Flushed: ' + (j.flushed||0));
+  alert(r.ok? 'Setelan scanner disimpan.':'Gagal: '+(j.error||r.status));
+  refreshStatus();
+});
+
+$('#saveScanner')?.addEventListener('click', async ()=>{
+  const mode=$('#scanMode').value, interval_ms=Number($('#scanInterval').value||0);
+  const {ok, status, j} = await apiJob('/api/scanner/config',{method:'POST',body:JSON.stringify({mode,interval_ms})});
+  alert(ok? 'Setelan modul tersimpan.':'Gagal: '+(j.error||status));
+  refreshStatus();
+});
+
+$('#uploadProducts')?.addEventListener('click', async ()=>{
+  const f = $('#prodFile').files[0];
+  if(!f){ alert('Pilih file CSV (kode,sku).'); return; }
+  const {ok, status, j} = await apiJob('/api/products',{method:'POST',headers:{'Content-Type':'text/csv'},body:f});
+  alert(ok? `Tabel produk: ${j.count} entri (${j.bad_lines} baris rusak, ${j.duplicates} duplikat)`:'Gagal: '+(j.error||status));
+  refreshStatus();
+});
+
+$('#saveLanes')?.addEventListener('click', async ()=>{
+  let lanes; try { lanes = JSON.parse($('#lanesCfg').value); } catch(e){ alert('JSON jalur tidak valid'); return; }
+  const r = await api('/api/lanes',{method:'POST',body:JSON.stringify({lanes})});
+  const j = await r.json();
+  alert(r.ok? `${j.lanes} jalur disimpan.`:'Gagal: '+(j.error||r.status));
+  refreshStatus();
+});
+
+$('#saveTally')?.addEventListener('click', async ()=>{
+  const shifts=$('#tallyShifts').value.trim(), publish_s=Number($('#tallyPublish').value||0), snapshot_s=Number($('#tallySnapshot').value||60), summary_only=$('#tallySummaryOnly').value==='1';
+  const r = await api('/api/tally/settings',{method:'POST',body:JSON.stringify({shifts,publish_s,snapshot_s,summary_only})});
+  const j = await r.json();
+  alert(r.ok? 'Setelan tally disimpan.':'Gagal: '+(j.error||r.status));
+  refreshStatus();
+});
+
+async function saveTime(sync){
+  const server=$('#ntpServer').value.trim()||'pool.ntp.org', interval_min=Number($('#ntpInterval').value||60), threshold_ms=Number($('#ntpThreshold').value||500), tz_min=Number($('#tzMin').value||420);
+  const r = await api('/api/time',{method:'POST',body:JSON.stringify({server,interval_min,threshold_ms,tz_min,sync})});
+  const j = await r.json();
+  alert(r.ok? (sync ? 'Sinkron dimulai.' : 'Setelan waktu disimpan.') : 'Gagal: '+(j.error||r.status));
+  refreshStatus();
+}
+$('#saveTime')?.addEventListener('click', ()=>saveTime(false));
+$('#syncTime')?.addEventListener('click', ()=>saveTime(true));
+
+$('#saveFan')?.addEventListener('click', async ()=>{
+  const body={on_c:Number($('#fanOn').value||50), off_c:Number($('#fanOff').value||30), full_c:Number($('#fanFull').value||50), min_duty:Number($('#fanMin').value||80), sample_ms:Number($('#fanSample').value||1000)};
+  const r = await api('/api/fan',{method:'POST',body:JSON.stringify(body)});
+  const j = await r.json();
+  alert(r.ok? 'Setelan kipas disimpan.':'Gagal: '+(j.error||r.status));
   refreshStatus();
 });
 
@@ -250,7 +446,7 @@ refreshStatus();
 
 // ================== ctor ==================
 DualNICPortal::DualNICPortal(const Pins& pins, const char* mdnsHost, const char* configPath)
-: _pins(pins), _mdnsHost(mdnsHost), _configPath(configPath), _mqttTest() {
+: _pins(pins), _mdnsHost(mdnsHost), _configPath(configPath), _mqttTest(), _cfg(new AppConfig()) {
   // nothing
 }
 
@@ -258,26 +454,49 @@ DualNICPortal::DualNICPortal(const Pins& pins, const char* mdnsHost, const char*
 void DualNICPortal::begin(){
   pinMode(LED_PIN, OUTPUT);
   digitalWrite(LED_PIN, LOW);
-  delay(100);
+  if (!_cfgWriteMtx) _cfgWriteMtx = xSemaphoreCreateMutex();
+  if (!_jobMtx) _jobMtx = xSemaphoreCreateMutex();
+  // arena request dialokasikan sekali di awal (heap masih utuh), dipakai ulang tiap request
+  if (!_ethArena.capacity()) _ethArena.init(ARENA_BYTES);
+  if (!_asyncArena.capacity()) _asyncArena.init(ARENA_BYTES);
+  _routesFrozen = true;
+  Serial.printf("[HTTP] %u route aplikasi, tabel %u slot\n", (unsigned)_routeCount, (unsigned)_routeCap);
   loadConfig();
+  loadWiFiCache();
   setupAPIfNoCred();
-  if (!_cfg.wifi_ssid.isEmpty()) {
-    if (connectWiFiBlocking(30000)) {
-      startMDNSIfNeeded();
-      if (_apSSID.length() > 0) _apOffAt = millis() + _AP_DEFAULT_MINUTES * 60000UL;
-    }else if (ethernetBeginStatic()) {
-      startMDNSIfNeeded();
-      Serial.println("[ETH] Ethernet Connected");
-      // serveEthernet();
-    }
-    else apEnableForMinutes(_AP_DEFAULT_MINUTES);
+  if (!config().wifi_ssid.isEmpty()) {
+    startWiFi();
+    _bootWifiPending = true;
+    _bootWifiStart = millis();
   }
   setupAsyncRoutes();
 }
 
+void DualNICPortal::bootLoop(){
+  if (!_bootWifiPending) return;
+  if (WiFi.status() == WL_CONNECTED) {
+    _bootWifiPending = false;
+    Serial.printf("[WiFi] Connected after %lu ms\n", (unsigned long)(millis() - _bootWifiStart));
+    updateWiFiCache();
+    startMDNSIfNeeded();
+    if (_apSSID.length() > 0) _apOffAt = millis() + _AP_DEFAULT_MINUTES * 60000UL;
+    return;
+  }
+  if (millis() - _bootWifiStart < _BOOT_WIFI_TIMEOUT_MS) return;
+
+  _bootWifiPending = false;
+  Serial.println(F("[WiFi] Failed."));
+  if (ethernetBegin()) {
+    startMDNSIfNeeded();
+    Serial.println("[ETH] Ethernet Connected");
+  }
+  else apEnableForMinutes(_AP_DEFAULT_MINUTES);
+}
+
 void DualNICPortal::loop(){
 
   serveEthernet();      // <-- ini harus dipanggil di setiap loop
+  sampleHeap();
   if (_pendingRestart) { delay(200); ESP.restart(); }
 
   // AP auto-off
@@ -286,8 +505,16 @@ void DualNICPortal::loop(){
     apDisable();
   }
 
-  // Wi-Fi watchdog
-  wifiWatchdogLoop();
+  // Boot Wi-Fi (non-blocking) lalu watchdog setelah fase boot selesai
+  wifiFastLoop();
+  if (_bootWifiPending) bootLoop();
+  else wifiWatchdogLoop();
+
+  // DHCP Ethernet: konfirmasi lease cache / renew (non-blocking)
+  _dhcp.loop();
+
+  // job dari handler HTTP (wifi connect, eth set, flush antrian, ...)
+  runJobs();
 
 
   // ---- MQTT probe dijalankan di sini, bukan di handler HTTP ----
@@ -338,64 +565,147 @@ bool DualNICPortal::ethernetLinkUp() const{
   return Ethernet.linkStatus() == LinkON;
 }
 
-AppConfig& DualNICPortal::config(){ return _cfg; }
-
 void DualNICPortal::setExtraApiHandler(ExtraApiHandler fn){ _extraHandler = fn; }
 void DualNICPortal::setStatusAugmenter(StatusAugmenter fn){ _statusAugmenter = fn; }
 
 // ================== internals ==================
+// ---- File config (schema 2) ----
+// Baris 1: "CFG <schema> <len> <crc32 hex>\n", lalu <len> byte JSON. File lama (JSON polos) = schema 1.
+// Simpan: tulis .tmp -> config lama jadi .bak -> rename .tmp (rename LittleFS atomik).
+static const unsigned CFG_SCHEMA = 2;
+static const size_t CFG_MAX_BYTES = 4096;
+
+static uint32_t crc32(const uint8_t* p, size_t n){
+  uint32_t crc = 0xFFFFFFFFu;
+  while (n--) { crc ^= *p++; for (int k = 0; k < 8; k++) crc = (crc >> 1) ^ (0xEDB88320u & (0u - (crc & 1))); }
+  return ~crc;
+}
+
+// baca & verifikasi satu file config; false jika tidak ada / rusak
+static bool readConfigFile(const String& path, JsonDocument& doc, bool& legacy){
+  if (!LittleFS.exists(path)) return false;
+  File f = LittleFS.open(path, "r"); if (!f) return false;
+  legacy = (f.peek() == '{');
+  if (legacy) { DeserializationError err = deserializeJson(doc, f); f.close(); return !err; }
+  String hdr = f.readStringUntil('\n');
+  unsigned schema = 0, len = 0; unsigned long crc = 0;
+  if (sscanf(hdr.c_str(), "CFG %u %u %lx", &schema, &len, &crc) != 3 || schema != CFG_SCHEMA || len > CFG_MAX_BYTES) {
+    f.close(); Serial.printf("[CFG] Bad header: %s\n", path.c_str()); return false;
+  }
+  std::unique_ptr<char[]> body(new char[len + 1]);
+  size_t got = f.readBytes(body.get(), len); body[got] = '\0';
+  f.close();
+  if (got != len || crc32((const uint8_t*)body.get(), len) != crc) { Serial.printf("[CFG] CRC mismatch: %s\n", path.c_str()); return false; }
+  return !deserializeJson(doc, body.get(), len);
+}
+
 void DualNICPortal::loadConfig(){
   if (!LittleFS.begin(true)) {
     Serial.println(F("[FS] LittleFS mount failed (formatted)."));
   }
-  if (!LittleFS.exists(_configPath)) {
-    Serial.println(F("[CFG] No config file, using defaults."));
-    return;
-  }
-  File f = LittleFS.open(_configPath, "r");
-  if (!f) { Serial.println(F("[CFG] Open config failed.")); return; }
-  JsonDocument doc;
-  DeserializationError err = deserializeJson(doc, f);
-  f.close();
-  if (err) {
-    Serial.printf("[CFG] JSON parse error: %s\n", err.c_str());
-    return;
-  }
-  _cfg.wifi_ssid   = doc["wifi_ssid"].as<String>();
-  _cfg.wifi_pass   = doc["wifi_pass"].as<String>();
-  _cfg.eth_ip      = doc["eth_ip"].as<String>();
-  _cfg.eth_gateway = doc["eth_gateway"].as<String>();
-  _cfg.eth_subnet  = doc["eth_subnet"].as<String>();
-  _cfg.mqtt_host   = doc["mqtt_host"].as<String>();
-  _cfg.mqtt_port   = doc["mqtt_port"] | 1883;
-  _cfg.mqtt_user   = doc["mqtt_user"].as<String>();
-  _cfg.mqtt_pass   = doc["mqtt_pass"].as<String>();
-  _cfg.mqtt_topic  = doc["mqtt_topic"].as<String>();
-  Serial.println(F("[CFG] Loaded."));
+  JsonDocument doc; bool legacy = false;
+  if (readConfigFile(_configPath, doc, legacy)) Serial.println(F("[CFG] Loaded."));
+  else if (readConfigFile(_configPath + ".bak", doc, legacy)) Serial.println(F("[CFG] Config invalid/missing; loaded backup."));
+  else { Serial.println(F("[CFG] No config file, using defaults.")); return; }
+
+  AppConfig* n = new AppConfig();
+  n->wifi_ssid = doc["wifi_ssid"].as<String>();
+  n->wifi_pass = doc["wifi_pass"].as<String>();
+  n->wifi_ip_mode = doc["wifi_ip_mode"] | "dhcp";
+  n->wifi_ip = doc["wifi_ip"].as<String>();
+  n->wifi_gateway = doc["wifi_gateway"].as<String>();
+  n->wifi_subnet = doc["wifi_subnet"].as<String>();
+  n->eth_mode = doc["eth_mode"].as<String>();
+  n->eth_ip = doc["eth_ip"].as<String>();
+  n->eth_gateway = doc["eth_gateway"].as<String>();
+  n->eth_subnet = doc["eth_subnet"].as<String>();
+  n->mqtt_host = doc["mqtt_host"].as<String>();
+  n->mqtt_port = doc["mqtt_port"] | 1883;
+  n->mqtt_user = doc["mqtt_user"].as<String>();
+  n->mqtt_pass = doc["mqtt_pass"].as<String>();
+  n->mqtt_topic = doc["mqtt_topic"].as<String>();
+  if (!publishConfig(n)) { delete n; return; }
+  if (legacy) { Serial.println(F("[CFG] Migrating to schema 2.")); saveConfig(*n); }
 }
 
-bool DualNICPortal::saveConfig(){
+bool DualNICPortal::saveConfig(const AppConfig& c){
   JsonDocument doc;
-  doc["wifi_ssid"] = _cfg.wifi_ssid;
-  doc["wifi_pass"] = _cfg.wifi_pass;
-  doc["eth_ip"] = _cfg.eth_ip;
-  doc["eth_gateway"] = _cfg.eth_gateway;
-  doc["eth_subnet"] = _cfg.eth_subnet;
-  doc["mqtt_host"] = _cfg.mqtt_host;
-  doc["mqtt_port"] = _cfg.mqtt_port;
-  doc["mqtt_user"] = _cfg.mqtt_user;
-  doc["mqtt_pass"] = _cfg.mqtt_pass;
-  doc["mqtt_topic"] = _cfg.mqtt_topic;
-  File f = LittleFS.open(_configPath, "w");
+  doc["wifi_ssid"] = c.wifi_ssid;
+  doc["wifi_pass"] = c.wifi_pass;
+  doc["wifi_ip_mode"] = c.wifi_ip_mode;
+  doc["wifi_ip"] = c.wifi_ip;
+  doc["wifi_gateway"] = c.wifi_gateway;
+  doc["wifi_subnet"] = c.wifi_subnet;
+  doc["eth_mode"] = c.eth_mode;
+  doc["eth_ip"] = c.eth_ip;
+  doc["eth_gateway"] = c.eth_gateway;
+  doc["eth_subnet"] = c.eth_subnet;
+  doc["mqtt_host"] = c.mqtt_host;
+  doc["mqtt_port"] = c.mqtt_port;
+  doc["mqtt_user"] = c.mqtt_user;
+  doc["mqtt_pass"] = c.mqtt_pass;
+  doc["mqtt_topic"] = c.mqtt_topic;
+  String body; serializeJson(doc, body);
+  char hdr[48];
+  snprintf(hdr, sizeof(hdr), "CFG %u %u %08lx\n", CFG_SCHEMA, (unsigned)body.length(),
+           (unsigned long)crc32((const uint8_t*)body.c_str(), body.length()));
+
+  const String tmp = _configPath + ".tmp", bak = _configPath + ".bak";
+  File f = LittleFS.open(tmp, "w");
   if (!f) { Serial.println(F("[CFG] Save open failed.")); return false; }
-  size_t n = serializeJson(doc, f);
+  bool ok = f.print(hdr) == strlen(hdr) && f.print(body) == body.length();
   f.close();
-  Serial.printf("[CFG] Saved %u bytes.\n", (unsigned)n);
-  return n > 0;
+  FlashWear::add(FlashWear::Config, strlen(hdr) + body.length(), 3); // + remove .bak, 2x rename
+  if (!ok) { LittleFS.remove(tmp); Serial.println(F("[CFG] Save write failed.")); return false; }
+
+  // putus daya di antara dua rename: loadConfig() memakai .bak
+  LittleFS.remove(bak);
+  if (LittleFS.exists(_configPath)) LittleFS.rename(_configPath, bak);
+  ok = LittleFS.rename(tmp, _configPath);
+  Serial.printf("[CFG] Saved %u bytes.\n", (unsigned)body.length());
+  return ok;
+}
+
+// snapshot lama dibebaskan setelah grace period (pembaca hanya memegangnya selama satu request/loop);
+// return slot kosong, atau nullptr jika semua masih dalam grace period
+DualNICPortal::RetiredCfg* DualNICPortal::retiredSlot(){
+  const uint32_t now = millis();
+  RetiredCfg* slot = nullptr;
+  for (auto& r : _retiredCfg) {
+    if (r.p && now - r.at >= _CFG_GRACE_MS) { delete r.p; r.p = nullptr; }
+    if (!r.p && !slot) slot = &r;
+  }
+  return slot;
+}
+
+bool DualNICPortal::publishConfig(const AppConfig* next){
+  RetiredCfg* slot = retiredSlot();
+  if (!slot) return false; // snapshot dalam grace period tidak pernah di-free: tolak update
+  const AppConfig* old = _cfg.exchange(next, std::memory_order_acq_rel);
+  if (old) { slot->p = old; slot->at = millis(); }
+  return true;
+}
+
+bool DualNICPortal::updateConfig(std::function<void(AppConfig&)> fn, bool* busy){
+  if (busy) *busy = false;
+  xSemaphoreTake(_cfgWriteMtx, portMAX_DELAY);
+  if (!retiredSlot()) {
+    xSemaphoreGive(_cfgWriteMtx);
+    Serial.println(F("[CFG] Update beruntun: snapshot lama masih dipakai, coba lagi."));
+    if (busy) *busy = true;
+    return false;
+  }
+  AppConfig* next = new AppConfig(config());
+  fn(*next);
+  publishConfig(next); // slot pasti ada: penulis diserialkan _cfgWriteMtx
+  bool ok = saveConfig(*next);
+  xSemaphoreGive(_cfgWriteMtx);
+  return ok;
 }
 
 void DualNICPortal::setupAPIfNoCred(){
-  if (_cfg.wifi_ssid.length() == 0) {
+  const AppConfig& cfg = config();
+  if (cfg.wifi_ssid.length() == 0) {
     _apSSID = "Device-Barcode";
     WiFi.mode(WIFI_AP_STA);
     WiFi.softAP(_apSSID.c_str(), "12345678");
@@ -405,32 +715,85 @@ void DualNICPortal::setupAPIfNoCred(){
   }
 }
 
-bool DualNICPortal::connectWiFiBlocking(uint32_t timeoutMs){
-  if (_cfg.wifi_ssid.isEmpty()) return false;
-  WiFi.mode(WIFI_STA);
+void DualNICPortal::loadWiFiCache(){
+  File f = LittleFS.open(_wifiCachePath, "r"); if (!f) return;
+  JsonDocument d; DeserializationError err = deserializeJson(d, f); f.close();
+  if (err) return;
+  _wifiCache.ssid = d["ssid"].as<String>();
+  _wifiCache.channel = d["ch"] | 0;
+  String b = d["bssid"].as<String>();
+  if (sscanf(b.c_str(), "%hhx:%hhx:%hhx:%hhx:%hhx:%hhx", &_wifiCache.bssid[0], &_wifiCache.bssid[1], &_wifiCache.bssid[2],
+             &_wifiCache.bssid[3], &_wifiCache.bssid[4], &_wifiCache.bssid[5]) != 6) _wifiCache.channel = 0;
+  _wifiCache.ip.fromString(d["ip"].as<String>());  _wifiCache.gw.fromString(d["gw"].as<String>());
+  _wifiCache.sn.fromString(d["sn"].as<String>());  _wifiCache.dns.fromString(d["dns"].as<String>());
+}
+
+void DualNICPortal::updateWiFiCache(){
+  const AppConfig& cfg = config();
+  const uint8_t* b = WiFi.BSSID();
+  if (!b) return;
+  const int32_t ch = WiFi.channel();
+  const IPAddress ip = WiFi.localIP(), gw = WiFi.gatewayIP(), sn = WiFi.subnetMask(), dns = WiFi.dnsIP();
+  if (_wifiCache.ssid == cfg.wifi_ssid && _wifiCache.channel == ch && memcmp(_wifiCache.bssid, b, 6) == 0 &&
+      _wifiCache.ip == ip && _wifiCache.gw == gw && _wifiCache.sn == sn && _wifiCache.dns == dns) return; // hemat tulis flash
+  _wifiCache.ssid = cfg.wifi_ssid; memcpy(_wifiCache.bssid, b, 6); _wifiCache.channel = ch;
+  _wifiCache.ip = ip; _wifiCache.gw = gw; _wifiCache.sn = sn; _wifiCache.dns = dns;
+
+  JsonDocument d;
+  d["ssid"] = _wifiCache.ssid; d["bssid"] = WiFi.BSSIDstr(); d["ch"] = ch;
+  d["ip"] = ip.toString(); d["gw"] = gw.toString(); d["sn"] = sn.toString(); d["dns"] = dns.toString();
+  File f = LittleFS.open(_wifiCachePath, "w"); if (!f) return;
+  FlashWear::add(FlashWear::Net, serializeJson(d, f)); f.close();
+  Serial.printf("[WiFi] Cache updated: %s ch%d\n", WiFi.BSSIDstr().c_str(), (int)ch);
+}
+
+void DualNICPortal::applyWiFiIPConfig(bool fast){
+  const AppConfig& cfg = config();
+  IPAddress ip, gw, sn;
+  if (cfg.wifi_ip_mode == "static" && ip.fromString(cfg.wifi_ip) && sn.fromString(cfg.wifi_subnet)) {
+    gw.fromString(cfg.wifi_gateway);
+    WiFi.config(ip, gw, sn, gw);
+  } else if (fast && cfg.wifi_ip_mode == "cached" && _wifiCache.ip != IPAddress(0,0,0,0)) {
+    // lewati DHCP: pakai lagi lease terakhir (opsional; risiko konflik jika lease sudah dipakai host lain)
+    WiFi.config(_wifiCache.ip, _wifiCache.gw, _wifiCache.sn, _wifiCache.dns);
+  } else {
+    WiFi.config(IPAddress(0,0,0,0), IPAddress(0,0,0,0), IPAddress(0,0,0,0)); // DHCP
+  }
+}
+
+void DualNICPortal::startWiFi(bool fast){
+  const AppConfig& cfg = config();
+  // AP aktif (provisioning) tetap dipertahankan selama mencoba STA
+  WiFi.mode(_apSSID.length() > 0 ? WIFI_AP_STA : WIFI_STA);
   WiFi.setHostname(_mdnsHost.c_str());
-  WiFi.begin(_cfg.wifi_ssid.c_str(), _cfg.wifi_pass.c_str());
-  Serial.printf("[WiFi] Connecting to %s ...", _cfg.wifi_ssid.c_str());
-  uint32_t t0 = millis();
-  while (WiFi.status() != WL_CONNECTED && (millis() - t0) < timeoutMs) {
-    delay(300); Serial.print('.');
-  }
-  bool ok = WiFi.status() == WL_CONNECTED;
-  Serial.println(""); 
-  Serial.println(ok ? "[WiFi] Connected ": " [WiFi] Failed.");
-  // if (ok) {
-  //   startMDNSIfNeeded();
-  //   if (_apSSID.length() > 0) {
-  //     _apOffAt = millis() + _AP_DEFAULT_MINUTES * 60000UL;
-  //     Serial.printf("[AP] Scheduled auto-off in %u minutes", (unsigned)_AP_DEFAULT_MINUTES);
-  //     ESP.restart();
-  //   }
-  //   _wifiWatchActive = false; _wifiWatchStart = 0; _wifiScanAt = 0;
-  // } 
-  // // else {
-  // //   if (_apSSID.length() == 0) apEnableForMinutes(_AP_DEFAULT_MINUTES);
-  // // }
-  return ok;
+  fast = fast && _wifiCache.valid() && _wifiCache.ssid == cfg.wifi_ssid;
+  applyWiFiIPConfig(fast);
+  if (fast) WiFi.begin(cfg.wifi_ssid.c_str(), cfg.wifi_pass.c_str(), _wifiCache.channel, _wifiCache.bssid);
+  else      WiFi.begin(cfg.wifi_ssid.c_str(), cfg.wifi_pass.c_str());
+  _wifiAttemptAt = millis(); if (!_wifiAttemptAt) _wifiAttemptAt = 1;
+  _wifiAttemptFast = fast;
+  _wifiLastConnectTry = _wifiAttemptAt;
+  Serial.printf("[WiFi] Connecting to %s%s ...", cfg.wifi_ssid.c_str(), fast ? " (fast)" : "");
+}
+
+void DualNICPortal::wifiFastLoop(){
+  if (!_wifiAttemptAt) return;
+  const uint32_t el = millis() - _wifiAttemptAt;
+  if (WiFi.status() == WL_CONNECTED) {
+    _wifiLastConnectMs = el;
+    if (_wifiAttemptFast) _wifiFastOk++;
+    _wifiAttemptAt = 0;
+    Serial.printf("[WiFi] Connected in %lu ms%s\n", (unsigned long)el, _wifiAttemptFast ? " (fast)" : "");
+    updateWiFiCache();
+    return;
+  }
+  if (!_wifiAttemptFast) { if (el >= _WIFI_SLOW_TIMEOUT_MS) _wifiAttemptAt = 0; return; } // watchdog lanjut scan
+  if (el < _WIFI_FAST_TIMEOUT_MS) return;
+  // BSSID/channel cache basi (AP pindah channel / diganti): ulangi dengan scan penuh + DHCP
+  _wifiFastFail++;
+  Serial.println(F("[WiFi] Fast reconnect failed; fallback full scan"));
+  WiFi.disconnect(false, false);
+  startWiFi(false);
 }
 
 void DualNICPortal::disconnectWiFi(){
@@ -469,13 +832,15 @@ void DualNICPortal::apDisable(){
 }
 
 void DualNICPortal::wifiWatchdogLoop() {
-  if (_cfg.wifi_ssid.length() == 0) return;
+  const AppConfig& cfg = config();
+  if (cfg.wifi_ssid.length() == 0) return;
 
   const uint32_t now = millis();
 
   // --- Jika sudah tersambung Wi-Fi: bereskan state & housekeeping ---
   if (WiFi.status() == WL_CONNECTED) {
     if (_wifiWatchActive) Serial.println(F("[WiFi] Reconnected; stop watchdog"));
+    if (_wifiWatchActive) updateWiFiCache();
     _wifiWatchActive = false;
     _wifiWatchStart  = 0;
     _wifiScanAt      = 0;
@@ -501,11 +866,14 @@ void DualNICPortal::wifiWatchdogLoop() {
   if (!_wifiWatchActive) {
     _wifiWatchActive = true;
     _wifiWatchStart  = now;
-    _wifiScanAt      = 0;
+    _wifiScanAt      = now;  // scan pertama menunggu hasil percobaan cepat
     Serial.println(F("[WiFi] Lost; watchdog started"));
 
-    // Fallback: hidupkan Ethernet statik saat Wi-Fi drop
-    ethernetBeginStatic();
+    // Fallback: hidupkan Ethernet (static/DHCP) saat Wi-Fi drop
+    ethernetBegin();
+
+    // Langsung coba asosiasi terarah (BSSID+channel cache), tanpa menunggu scan
+    if (_wifiCache.valid()) startWiFi(true);
   }
 
   // Setelah tenggat, aktifkan AP untuk provisioning (tetap lanjut scan)
@@ -516,35 +884,37 @@ void DualNICPortal::wifiWatchdogLoop() {
     }
   }
 
+  // Percobaan connect (cepat/penuh) sedang berjalan -> tunggu hasilnya (wifiFastLoop)
+  if (_wifiAttemptAt) return;
+
   // --- Scan periodik: SELALU jalan meskipun AP/Ethernet aktif ---
   const uint32_t SCAN_INTERVAL_MS  = 5000;  // sesuai poin #2
   const uint32_t RETRY_CONNECT_GAP = 8000;  // sesuai poin #3
-  static uint32_t s_lastConnectTry = 0;
-
-  if (now - _wifiScanAt >= SCAN_INTERVAL_MS) {
-    _wifiScanAt = now;
 
-    // show_hidden=true; SSID target selalu broadcast (poin #5), aman
-    int n = WiFi.scanNetworks(false, true);
+  // Scan async: loop() tidak tertahan ~2 detik selama scan
+  if (_scanJob) return;
+  int n = WiFi.scanComplete();
+  if (n == WIFI_SCAN_RUNNING) return;
+  if (n >= 0) {
     bool found = false;
     for (int i = 0; i < n; i++) {
-      if (WiFi.SSID(i) == _cfg.wifi_ssid) { found = true; break; }
+      if (WiFi.SSID(i) == cfg.wifi_ssid) { found = true; break; }
     }
+    WiFi.scanDelete();
 
-    if (found && (now - s_lastConnectTry >= RETRY_CONNECT_GAP)) {
+    if (found && (now - _wifiLastConnectTry >= RETRY_CONNECT_GAP)) {
       Serial.println(F("[WiFi] Saved SSID detected; forcing reconnect (preempt AP/Ethernet)"));
-
-      // Preempt: kalau AP aktif, gunakan mode AP+STA; kalau tidak, STA saja
-      if (_apSSID.length() > 0) WiFi.mode(WIFI_AP_STA);
-      else                      WiFi.mode(WIFI_STA);
-
-      // Hostname mDNS (jika dipakai)
-      if (_mdnsHost.length() > 0) WiFi.setHostname(_mdnsHost.c_str());
-
-      WiFi.begin(_cfg.wifi_ssid.c_str(), _cfg.wifi_pass.c_str());
-      s_lastConnectTry = now;
+      // Preempt: kalau AP aktif, gunakan mode AP+STA; kalau tidak, STA saja (lihat startWiFi)
+      startWiFi(true);
+      return;
     }
   }
+
+  if (now - _wifiScanAt >= SCAN_INTERVAL_MS) {
+    _wifiScanAt = now;
+    // show_hidden=true; SSID target selalu broadcast (poin #5), aman
+    WiFi.scanNetworks(true, true);
+  }
 }
 
 
@@ -555,7 +925,36 @@ void DualNICPortal::ethernetResetPulse(){
   digitalWrite(_pins.w5500_rst, HIGH); delay(50);
 }
 
-bool DualNICPortal::ethernetBeginStatic(){
+bool DualNICPortal::ethernetUseDhcp() const {
+  const AppConfig& cfg = config();
+  if (cfg.eth_mode == "dhcp") return true;
+  if (cfg.eth_mode == "static") return false;
+  return cfg.eth_ip.isEmpty();
+}
+
+bool DualNICPortal::loadLease(EthernetDhcp::Lease& l){
+  File f = LittleFS.open(_leasePath, "r"); if (!f) return false;
+  JsonDocument d; DeserializationError err = deserializeJson(d, f); f.close();
+  if (err) return false;
+  l.ip.fromString(d["ip"].as<String>());      l.subnet.fromString(d["sn"].as<String>());
+  l.gateway.fromString(d["gw"].as<String>()); l.dns.fromString(d["dns"].as<String>());
+  l.server.fromString(d["server"].as<String>());
+  l.leaseS = d["lease_s"] | 0; l.t1S = d["t1_s"] | 0; l.t2S = d["t2_s"] | 0;
+  l.acquiredMs = d["at_ms"] | (uint64_t)0; // file lama tanpa at_ms: umur tidak diketahui
+  return l.valid();
+}
+
+void DualNICPortal::saveLease(const EthernetDhcp::Lease& l){
+  JsonDocument d;
+  d["ip"] = l.ip.toString(); d["sn"] = l.subnet.toString(); d["gw"] = l.gateway.toString();
+  d["dns"] = l.dns.toString(); d["server"] = l.server.toString();
+  d["lease_s"] = l.leaseS; d["t1_s"] = l.t1S; d["t2_s"] = l.t2S; d["at_ms"] = l.acquiredMs;
+  File f = LittleFS.open(_leasePath, "w"); if (!f) return;
+  FlashWear::add(FlashWear::Net, serializeJson(d, f)); f.close();
+}
+
+bool DualNICPortal::ethernetBegin(){
+  const AppConfig& cfg = config();
   SPI.begin();
   Ethernet.init(_pins.w5500_cs);
   ethernetResetPulse();
@@ -563,28 +962,34 @@ bool DualNICPortal::ethernetBeginStatic(){
   // MAC bisa reuse MAC Wi-Fi agar unik
   uint8_t mac[6]; WiFi.macAddress(mac);
 
-  // --- Ambil dari _cfg lebih dulu ---
-  IPAddress ip, gw , sn;
-  if (_cfg.eth_ip.isEmpty())      _cfg.eth_ip      = "10.26.101.197";
-  if (_cfg.eth_subnet.isEmpty())  _cfg.eth_subnet  = "10.26.101.1";
-  if (_cfg.eth_gateway.isEmpty()) _cfg.eth_gateway = "255.255.255.0";
-
-  Serial.printf("[ETH] cfg: ip='%s' gw='%s' sn='%s'\n",
-                _cfg.eth_ip.c_str(), _cfg.eth_gateway.c_str(), _cfg.eth_subnet.c_str());
-  bool ipOk = ip.fromString(_cfg.eth_ip);
-  bool snOk = sn.fromString(_cfg.eth_subnet);
-  if (!gw.fromString(_cfg.eth_gateway)) gw = IPAddress(0,0,0,0);
-  IPAddress dns = (gw == IPAddress(0,0,0,0)) ? IPAddress(8,8,8,8) : gw;
-
-  Ethernet.begin(mac, ip, dns, gw, sn);
-
-  if (!ipOk || !snOk) {
-    Serial.println(F("[ETH] Static IP/Subnet invalid; skip Ethernet."));
-    isEthernetConnected = false;
-    return false;
+  const bool dhcp = ethernetUseDhcp();
+  IPAddress ip, gw, sn, dns;
+  EthernetDhcp::Lease cached;
+  bool haveLease = false;
+
+  if (dhcp) {
+    // Lease terakhir langsung dipakai; DHCP mengonfirmasi/memperbarui di loop()
+    haveLease = loadLease(cached);
+    if (haveLease) { ip = cached.ip; gw = cached.gateway; sn = cached.subnet; dns = cached.dns; }
+    else           { ip = gw = sn = dns = IPAddress(0,0,0,0); }
+    Serial.printf("[ETH] DHCP mode, cached lease: %s\n", haveLease ? ip.toString().c_str() : "-");
+  } else {
+    _dhcp.stop();
+    Serial.printf("[ETH] cfg: ip='%s' gw='%s' sn='%s'\n",
+                  cfg.eth_ip.c_str(), cfg.eth_gateway.c_str(), cfg.eth_subnet.c_str());
+    bool ipOk = ip.fromString(cfg.eth_ip);
+    bool snOk = sn.fromString(cfg.eth_subnet);
+    if (!ipOk || !snOk) {
+      Serial.println(F("[ETH] Static IP/Subnet invalid; skip Ethernet."));
+      isEthernetConnected = false;
+      return false;
+    }
+    if (!gw.fromString(cfg.eth_gateway)) gw = IPAddress(0,0,0,0);
+    dns = (gw == IPAddress(0,0,0,0)) ? IPAddress(8,8,8,8) : gw;
   }
 
   // --- Mulai Ethernet dengan konfigurasi terbaru ---
+  Ethernet.begin(mac, ip, dns, gw, sn);
 
   // Cek hardware & link
   if (Ethernet.hardwareStatus() == EthernetNoHardware) {
@@ -598,8 +1003,13 @@ bool DualNICPortal::ethernetBeginStatic(){
     return false;
   }
 
-  Serial.print(F("[ETH] Started with static IP: "));
-  Serial.println(Ethernet.localIP());
+  if (dhcp) {
+    _dhcp.onLease([this](const EthernetDhcp::Lease& l){ saveLease(l); });
+    _dhcp.start(mac, _mdnsHost.c_str(), haveLease ? &cached : nullptr);
+  } else {
+    Serial.print(F("[ETH] Started with static IP: "));
+    Serial.println(Ethernet.localIP());
+  }
 
   _ethServer.begin();
   Serial.println(F("[ETH] EthernetServer listening on :80"));
@@ -608,116 +1018,197 @@ bool DualNICPortal::ethernetBeginStatic(){
   return true;
 }
 
-static String HTTP_200(const String& ct, const String& body) {
-  String h = "HTTP/1.1 200 OK\r\nContent-Type: "; h += ct; h += "\r\nConnection: close\r\nContent-Length: ";
-  h += String(body.length()); h += "\r\n\r\n"; return h + body;
+// header respons ditulis dari buffer stack; len < 0 = tanpa Content-Length (stream, ditutup di akhir)
+static void sendHead(Client& c, int code, const char* ct, long len) {
+  char h[192];
+  int n = snprintf(h, sizeof(h), "HTTP/1.1 %d %s\r\nContent-Type: %s\r\nConnection: close\r\n",
+                   code, code == 200 ? "OK" : code == 404 ? "Not Found" : "Error", ct);
+  if (n > 0 && len >= 0 && n < (int)sizeof(h)) n += snprintf(h + n, sizeof(h) - n, "Content-Length: %ld\r\n", len);
+  if (n > 0 && n < (int)sizeof(h)) n += snprintf(h + n, sizeof(h) - n, "\r\n");
+  if (n > (int)sizeof(h) - 1) n = sizeof(h) - 1;
+  if (n > 0) c.write((const uint8_t*)h, n);
+}
+static void sendResponse(Client& c, int code, const char* ct, const String& body) {
+  sendHead(c, code, ct, body.length());
+  c.write((const uint8_t*)body.c_str(), body.length());
 }
-static String HTTP_XXX(int code, const String& ct, const String& body) {
-  String h = "HTTP/1.1 "; h += String(code); h += (code==404?" Not Found":" Error");
-  h += "\r\nContent-Type: "; h += ct; h += "\r\nConnection: close\r\nContent-Length: ";
-  h += String(body.length()); h += "\r\n\r\n"; return h + body;
+
+// reset arena saat keluar scope (semua jalur return)
+struct ArenaScope {
+  RequestArena& a;
+  explicit ArenaScope(RequestArena& arena) : a(arena) { a.reset(); }
+  ~ArenaScope(){ a.reset(); }
+};
+
+void DualNICPortal::pumpEthernetStream(){
+  uint8_t buf[1024];
+  size_t n = _ethStreamClient.connected() ? _ethStreamFill(buf, sizeof(buf)) : 0;
+  if (n == RESPONSE_TRY_AGAIN) return; // sumber sibuk: coba lagi di loop() berikut
+  if (n) { _ethStreamClient.write(buf, n); return; }
+  _ethStreamClient.stop();
+  _ethStreamFill = nullptr;
 }
 
 void DualNICPortal::serveEthernet(){
+  if (_ethStreamFill) { pumpEthernetStream(); return; }
   EthernetClient c = _ethServer.available();
   if (!c) return;
   c.setTimeout(2000);
-
-  String reqLine = c.readStringUntil('\n');
-  if (reqLine.length() == 0) { c.stop(); return; }
-  reqLine.trim();
-  int sp1 = reqLine.indexOf(' ');
-  int sp2 = reqLine.indexOf(' ', sp1 + 1);
-  String method = reqLine.substring(0, sp1);
-  String url = reqLine.substring(sp1 + 1, sp2);
-  String path = url;
+  ArenaScope scope(_ethArena);
+
+  // request line dipotong di tempat: "METHOD\0path\0query\0"
+  char* line = _ethArena.alloc(MAX_REQLINE_BYTES);
+  if (!line) { c.stop(); return; }
+  size_t len = c.readBytesUntil('\n', line, MAX_REQLINE_BYTES - 1);
+  if (len == 0) { c.stop(); return; }
+  if (len == MAX_REQLINE_BYTES - 1) { sendResponse(c, 414, "application/json", jsonErr("URI too long")); c.stop(); return; }
+  while (len && isspace((unsigned char)line[len - 1])) len--;
+  line[len] = '\0';
+  ApiRequest rq;
+  rq.arena = &_ethArena;
+  rq.ctx   = "ethernet";
+  char* sp1 = strchr(line, ' ');
+  if (!sp1) { c.stop(); return; }
+  *sp1 = '\0';
+  rq.method = line;
+  char* url = sp1 + 1;
+  if (char* sp2 = strchr(url, ' ')) *sp2 = '\0';
+  if (char* q = strchr(url, '?')) { *q = '\0'; rq.query = q + 1; }
+  rq.path = url;
 
   int contentLength = 0;
   while (true) {
-    String h = c.readStringUntil('\n');
-    if (h == "\r" || h.length() == 0) break;
-    h.trim();
-    if (h.startsWith("Content-Length:")) contentLength = h.substring(15).toInt();
+    char h[128];
+    size_t n = c.readBytesUntil('\n', h, sizeof(h) - 1);
+    if (n == 0 || (n == 1 && h[0] == '\r')) break;
+    h[n] = '\0';
+    if (strncasecmp(h, "Content-Length:", 15) == 0) contentLength = atoi(h + 15);
   }
 
-  String body;
-  if (method == "POST" && contentLength > 0) {
-    while ((int)body.length() < contentLength) {
-      int ch = c.read(); if (ch < 0) break; body += (char)ch;
+  ExtraRoute* up = findExtraRoute(routeKey(rq.method, rq.path), rq.method, rq.path);
+  if (up && !up->uploadFn) up = nullptr;
+  if (up && contentLength > 0) {
+    // upload: potongan body langsung ke handler (loop() tertahan selama upload berlangsung)
+    uint8_t tmp[512]; int done = 0; bool ok = true;
+    while (done < contentLength) {
+      size_t n = c.readBytes(tmp, min((int)sizeof(tmp), contentLength - done));
+      if (!n) break;
+      if (ok) ok = up->uploadFn(rq, tmp, n, done, contentLength);
+      done += n;
     }
+  } else if (contentLength > (int)MAX_BODY_BYTES) {
+    sendResponse(c, 413, "application/json", jsonErr("body too large")); c.stop(); return;
+  } else if (contentLength > 0) {
+    // readBytes menunggu sesuai setTimeout, jadi body yang datang terpecah tetap utuh
+    char* body = _ethArena.alloc(contentLength + 1);
+    if (!body) { sendResponse(c, 413, "application/json", jsonErr("body too large")); c.stop(); return; }
+    rq.bodyLen = c.readBytes(body, contentLength);
+    body[rq.bodyLen] = '\0';
+    rq.body = body;
   }
 
-  if ((path == "/" || path == "/index.html") && method == "GET") {
-    size_t len = strlen_P(INDEX_HTML);               // panjang dari PROGMEM
-    String hdr = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n"
-                "Connection: close\r\nContent-Length: " + String(len) + "\r\n\r\n";
-    c.print(hdr);
+  if ((strcmp(rq.path, "/") == 0 || strcmp(rq.path, "/index.html") == 0) && strcmp(rq.method, "GET") == 0) {
+    sendHead(c, 200, "text/html", strlen_P(INDEX_HTML)); // panjang dari PROGMEM
     // Print dari PROGMEM
     c.print(FPSTR(INDEX_HTML));   // Print::print(__FlashStringHelper*) akan baca dari flash
     c.stop();
     return;
   }
 
-  String ct; int code=200; String payload = apiHandler(path, method, body, "ethernet", ct, code);
-  if (code == 200) c.print(HTTP_200(ct, payload)); else c.print(HTTP_XXX(code, ct, payload));
+  String ct; int code=200; ChunkFiller fill; String payload = dispatch(rq, ct, code, &fill);
+  if (fill) {
+    // tanpa Content-Length: body berakhir saat koneksi ditutup
+    sendHead(c, 200, ct.c_str(), -1);
+    _ethStreamClient = c; _ethStreamFill = fill;
+    return;
+  }
+  sendResponse(c, code, ct.c_str(), payload);
   c.stop();
 }
 
+// Kumpulkan body (bisa datang dalam beberapa chunk) ke req->_tempObject; dibebaskan oleh AsyncWebServerRequest.
+// Bukan di arena: body beberapa koneksi Wi-Fi bisa datang berselang-seling sebelum handler jalan.
+static void collectAsyncBody(AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total){
+  if (total > DualNICPortal::MAX_BODY_BYTES) return;
+  if (index == 0) {
+    if (req->_tempObject) free(req->_tempObject);
+    req->_tempObject = malloc(total + 1);
+  }
+  char* buf = (char*)req->_tempObject;
+  if (!buf || index + len > total) return;
+  memcpy(buf + index, data, len);
+  if (index + len == total) buf[total] = '\0';
+}
+
+void DualNICPortal::handleAsyncBody(AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total){
+  const char* method = req->methodToString();
+  ExtraRoute* r = findExtraRoute(routeKey(method, req->url().c_str()), method, req->url().c_str());
+  if (!r || !r->uploadFn) { collectAsyncBody(req, data, len, index, total); return; }
+  ApiRequest rq; rq.method = method; rq.path = req->url().c_str(); rq.ctx = "wifi";
+  r->uploadFn(rq, data, len, index, total); // handler menyimpan status gagal sendiri
+}
+
+void DualNICPortal::handleAsync(AsyncWebServerRequest* req){
+  ArenaScope scope(_asyncArena);
+  ApiRequest rq;
+  rq.arena  = &_asyncArena;
+  rq.method = req->methodToString();
+  rq.path   = req->url().c_str();
+  ExtraRoute* up = findExtraRoute(routeKey(rq.method, rq.path), rq.method, rq.path);
+  if (req->contentLength() > MAX_BODY_BYTES && !(up && up->uploadFn)) { req->send(413, "application/json", jsonErr("body too large")); return; }
+  rq.ctx    = "wifi";
+  // query digabung ulang ke arena: "a=1&b=2"
+  size_t qlen = 0;
+  for (size_t i = 0; i < req->params(); i++) {
+    auto* p = req->getParam(i);
+    if (!p->isPost() && !p->isFile()) qlen += p->name().length() + p->value().length() + 2;
+  }
+  if (char* q = qlen ? _asyncArena.alloc(qlen) : nullptr) {
+    size_t n = 0;
+    for (size_t i = 0; i < req->params(); i++) {
+      auto* p = req->getParam(i);
+      if (p->isPost() || p->isFile()) continue;
+      n += snprintf(q + n, qlen - n, "%s%s=%s", n ? "&" : "", p->name().c_str(), p->value().c_str());
+    }
+    rq.query = q;
+  }
+  if (req->_tempObject) { rq.body = (const char*)req->_tempObject; rq.bodyLen = strlen(rq.body); }
+  String ct; int code; ChunkFiller fill; String out = dispatch(rq, ct, code, &fill);
+  if (fill) {
+    req->send(req->beginChunkedResponse(ct, [fill](uint8_t* buf, size_t maxLen, size_t){ return fill(buf, maxLen); }));
+    return;
+  }
+  req->send(code, ct, out);
+}
+
 void DualNICPortal::setupAsyncRoutes(){
   _server.on("/", HTTP_GET, [this](AsyncWebServerRequest* req){
     req->send(200, "text/html", INDEX_HTML);
   });
 
-  _server.on("/api/status", HTTP_GET, [this](AsyncWebServerRequest* req){
-    String ct; int code; String out = apiHandler("/api/status","GET","", "wifi", ct, code);
-    req->send(code, ct, out);
-  });
-  _server.on("/api/scan", HTTP_GET, [this](AsyncWebServerRequest* req){
-    String ct; int code; String out = apiHandler("/api/scan","GET","", "wifi", ct, code);
-    req->send(code, ct, out);
-  });
-
-  auto handlePost = [this](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t, size_t){
-    String body((const char*)data, len);
-    String path = req->url();
-    String ct; int code; String out = apiHandler(path, "POST", body, "wifi", ct, code);
-    req->send(code, ct, out);
-  };
-
-  _server.on("/api/wifi/connect", HTTP_POST, [](AsyncWebServerRequest* req){}, NULL, handlePost);
-  _server.on("/api/wifi/disconnect", HTTP_POST, [](AsyncWebServerRequest* req){}, NULL, handlePost);
-  _server.on("/api/eth/set", HTTP_POST, [](AsyncWebServerRequest* req){}, NULL, handlePost);
-  _server.on("/api/mqtt/set", HTTP_POST, [](AsyncWebServerRequest* req){}, NULL, handlePost);
-  _server.on("/api/ap/enable", HTTP_POST, [](AsyncWebServerRequest* req){}, NULL, handlePost);
-  _server.on("/api/ap/disable", HTTP_POST, [](AsyncWebServerRequest* req){}, NULL, handlePost);
-  _server.on("/api/reset", HTTP_POST, [](AsyncWebServerRequest* req){}, NULL, handlePost);
-
-  // forward all unknown POSTs to extra handler via generic entry
-  _server.onNotFound([this](AsyncWebServerRequest* req){
-    if (req->method() == HTTP_GET || req->method() == HTTP_POST) {
-      String body;
-      if (req->method() == HTTP_POST) {
-        // empty body: extra handler will decide
-      }
-      String ct; int code; String out = apiHandler(req->url(), (req->method()==HTTP_GET?"GET":"POST"),
-                                                  body, "wifi", ct, code);
-      req->send(code, ct, out);
-    } else {
-      req->send(404, "application/json", jsonErr("not found"));
-    }
+  // Semua /api/* lewat catch-all yang sama -> dispatch() (route bawaan + route aplikasi)
+  _server.onRequestBody([this](AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total){
+    handleAsyncBody(req, data, len, index, total);
   });
+  _server.onNotFound([this](AsyncWebServerRequest* req){ handleAsync(req); });
 
   _server.begin();
   Serial.println(F("[HTTP] AsyncWebServer started on :80 (Wi-Fi)"));
 }
 
 // ===== API core =====
-String DualNICPortal::jsonStatus(const String& ctx){
+String DualNICPortal::jsonStatus(const char* ctx){
+  const AppConfig& cfg = config();
   JsonDocument doc;
   doc["wifi"]["connected"] = (WiFi.status() == WL_CONNECTED);
   doc["wifi"]["ssid"] = WiFi.SSID();
   doc["wifi"]["rssi"] = (WiFi.status() == WL_CONNECTED) ? WiFi.RSSI() : 0;
   doc["wifi"]["ip"] = (WiFi.status() == WL_CONNECTED) ? WiFi.localIP().toString() : "";
+  doc["wifi"]["ip_mode"] = cfg.wifi_ip_mode;
+  doc["wifi"]["last_connect_ms"] = _wifiLastConnectMs;
+  doc["wifi"]["fast_ok"] = _wifiFastOk;
+  doc["wifi"]["fast_fail"] = _wifiFastFail;
+  doc["wifi"]["cache_ch"] = _wifiCache.channel;
 
   doc["ap"]["active"] = _apSSID.length() > 0;
   doc["ap"]["ssid"] = _apSSID;
@@ -728,16 +1219,22 @@ String DualNICPortal::jsonStatus(const String& ctx){
   doc["eth"]["ip"] = Ethernet.localIP().toString();
   doc["eth"]["gw"] = Ethernet.gatewayIP().toString();
   doc["eth"]["sn"] = Ethernet.subnetMask().toString();
+  doc["eth"]["mode"] = ethernetUseDhcp() ? "dhcp" : "static";
+  if (ethernetUseDhcp()) {
+    doc["eth"]["dhcp"]["state"] = _dhcp.stateName();
+    doc["eth"]["dhcp"]["remaining_s"] = _dhcp.remainingS();
+  }
 
-  doc["cfg"]["eth_ip"] = _cfg.eth_ip;
-  doc["cfg"]["eth_gateway"] = _cfg.eth_gateway;
-  doc["cfg"]["eth_subnet"] = _cfg.eth_subnet;
+  doc["cfg"]["eth_mode"] = ethernetUseDhcp() ? "dhcp" : "static";
+  doc["cfg"]["eth_ip"] = cfg.eth_ip;
+  doc["cfg"]["eth_gateway"] = cfg.eth_gateway;
+  doc["cfg"]["eth_subnet"] = cfg.eth_subnet;
 
-  doc["mqtt"]["host"] = _cfg.mqtt_host;
-  doc["mqtt"]["port"] = _cfg.mqtt_port;
-  doc["mqtt"]["topic"] = _cfg.mqtt_topic;
-  doc["mqtt"]["user"]        = _cfg.mqtt_user;
-  doc["mqtt"]["pass_set"]    = _cfg.mqtt_pass.length() > 0;
+  doc["mqtt"]["host"] = cfg.mqtt_host;
+  doc["mqtt"]["port"] = cfg.mqtt_port;
+  doc["mqtt"]["topic"] = cfg.mqtt_topic;
+  doc["mqtt"]["user"]        = cfg.mqtt_user;
+  doc["mqtt"]["pass_set"]    = cfg.mqtt_pass.length() > 0;
   doc["mqtt"]["probe_running"]= s_mqttProbeRunning;
   doc["mqtt"]["last_rc"]     = s_mqttLastRC;     // PubSubClient::state()
   doc["mqtt"]["last_ok"]     = s_mqttLastOK;
@@ -746,6 +1243,17 @@ String DualNICPortal::jsonStatus(const String& ctx){
   doc["mdns"]["host"] = _mdnsHost;
   doc["ui"]["mode"] = ctx;
 
+  // watermark heap & arena request (fragmentasi: largest_block jauh di bawah free)
+  JsonObject heap = doc["heap"].to<JsonObject>();
+  heap["free"] = ESP.getFreeHeap();
+  heap["min_free"] = ESP.getMinFreeHeap();
+  heap["largest_block"] = ESP.getMaxAllocHeap();
+  heap["min_largest_block"] = _minLargestBlock == UINT32_MAX ? ESP.getMaxAllocHeap() : _minLargestBlock;
+  heap["arena_bytes"] = (uint32_t)ARENA_BYTES;
+  heap["arena_eth_high"] = (uint32_t)_ethArena.highWater();
+  heap["arena_wifi_high"] = (uint32_t)_asyncArena.highWater();
+  heap["arena_overflows"] = _ethArena.overflows() + _asyncArena.overflows();
+
   // augmentor (queue stats, dsb.)
   if (_statusAugmenter) _statusAugmenter(doc);
 
@@ -755,112 +1263,466 @@ String DualNICPortal::jsonStatus(const String& ctx){
 String DualNICPortal::jsonOk(const String& msg){ JsonDocument d; d["status"]=msg; String s; serializeJson(d,s); return s; }
 String DualNICPortal::jsonErr(const String& msg){ JsonDocument d; d["error"]=msg; String s; serializeJson(d,s); return s; }
 
-String DualNICPortal::apiHandler(const String& path, const String& method, const String& body,
-                                 const String& ctx, String& contentType, int& code){
-  contentType = "application/json"; code = 200;
+// ===== Route table =====
+// Satu daftar untuk enum, nama, dan switch dispatch; key di-hash saat compile (routeKey constexpr).
+#define PORTAL_ROUTES(X) \
+  X(STATUS,          "GET",  "/api/status",          apiStatus)         \
+  X(SCAN,            "GET",  "/api/scan",            apiScan)           \
+  X(ROUTES,          "GET",  "/api/routes",          apiRoutes)         \
+  X(JOBS,            "GET",  "/api/jobs",            apiJobs)           \
+  X(WIFI_CONNECT,    "POST", "/api/wifi/connect",    apiWifiConnect)    \
+  X(WIFI_DISCONNECT, "POST", "/api/wifi/disconnect", apiWifiDisconnect) \
+  X(ETH_SET,         "POST", "/api/eth/set",         apiEthSet)         \
+  X(MQTT_SET,        "POST", "/api/mqtt/set",        apiMqttSet)        \
+  X(RESET,           "POST", "/api/reset",           apiReset)          \
+  X(AP_ENABLE,       "POST", "/api/ap/enable",       apiApEnable)       \
+  X(AP_DISABLE,      "POST", "/api/ap/disable",      apiApDisable)
+
+enum RouteId : uint8_t {
+#define X(id, m, p, fn) R_##id,
+  PORTAL_ROUTES(X)
+#undef X
+  R_COUNT
+};
+
+struct RouteDef { const char* method; const char* path; };
+static const RouteDef s_routes[R_COUNT] = {
+#define X(id, m, p, fn) { m, p },
+  PORTAL_ROUTES(X)
+#undef X
+};
+static RouteStats s_routeStats[R_COUNT];
+
+// key -> RouteId; compiler membentuk jump/lookup table dari konstanta case
+static int findBuiltinRoute(uint32_t key){
+  switch (key) {
+#define X(id, m, p, fn) case DualNICPortal::routeKey(m, p): return R_##id;
+    PORTAL_ROUTES(X)
+#undef X
+    default: return -1;
+  }
+}
 
-  if (path == "/api/status" && method == "GET") return jsonStatus(ctx);
+static void recordRoute(RouteStats& st, uint32_t t0){
+  uint32_t dt = micros() - t0;
+  st.hits++; st.totalUs += dt;
+  if (dt > st.maxUs) st.maxUs = dt;
+}
 
-  if (path == "/api/scan" && method == "GET") {
-    int n = WiFi.scanNetworks(false, true);
-    JsonDocument doc;
-    JsonArray arr = doc["aps"].to<JsonArray>();
-    for (int i=0;i<n;i++){
-      JsonObject o = arr.add<JsonObject>();
-      o["ssid"]=WiFi.SSID(i); o["rssi"]=WiFi.RSSI(i); o["sec"]=WiFi.encryptionType(i);
-      o["bssid"]=WiFi.BSSIDstr(i); o["ch"]=WiFi.channel(i);
+void DualNICPortal::sampleHeap(){
+  if (millis() - _heapSampleAt < 1000) return;
+  _heapSampleAt = millis();
+  const uint32_t b = ESP.getMaxAllocHeap();
+  if (b < _minLargestBlock) _minLargestBlock = b;
+}
+
+bool RequestArena::init(size_t cap){
+  _buf = (char*)malloc(cap);
+  _cap = _buf ? cap : 0; _used = 0;
+  return _buf != nullptr;
+}
+
+char* RequestArena::alloc(size_t n){
+  n = (n + 3) & ~(size_t)3; // jaga alignment 4 byte
+  if (n > _cap - _used) { _overflows++; return nullptr; }
+  char* p = _buf + _used; _used += n;
+  return p;
+}
+
+const char* RequestArena::dup(const char* s, size_t n){
+  char* p = alloc(n + 1); if (!p) return "";
+  memcpy(p, s, n); p[n] = '\0';
+  return p;
+}
+
+// cari "name=" di query; value menunjuk ke query (len = panjang nilai)
+static const char* findArg(const char* q, const char* name, size_t& len){
+  const size_t nlen = strlen(name);
+  while (*q) {
+    const char* amp = strchr(q, '&'); if (!amp) amp = q + strlen(q);
+    if ((size_t)(amp - q) > nlen && q[nlen] == '=' && strncmp(q, name, nlen) == 0) {
+      len = amp - q - nlen - 1; return q + nlen + 1;
     }
-    String s; serializeJson(doc,s); return s;
+    q = *amp ? amp + 1 : amp;
   }
+  return nullptr;
+}
 
-  if (path == "/api/wifi/connect" && method == "POST") {
-    JsonDocument d; if (deserializeJson(d, body)) { code=400; return jsonErr("JSON invalid"); }
-    String ssid=d["ssid"].as<String>(), pass=d["pass"].as<String>();
-    if (ssid.isEmpty()) { code=400; return jsonErr("SSID kosong"); }
-    _cfg.wifi_ssid=ssid; _cfg.wifi_pass=pass; saveConfig();
-    bool ok = connectWiFiBlocking(30000);
-    if (!ok) { code=504; return jsonErr("Gagal konek Wi-Fi (timeout)"); }
-    return jsonOk("connected");
-    ESP.restart();
-  }
+const char* ApiRequest::arg(const char* name) const {
+  size_t len; const char* v = findArg(query, name, len);
+  if (!v || !len) return "";
+  return arena ? arena->dup(v, len) : "";
+}
 
-  if (path == "/api/wifi/disconnect" && method == "POST") { disconnectWiFi(); return jsonOk("disconnected"); }
+long ApiRequest::argInt(const char* name, long def) const {
+  size_t len; const char* v = findArg(query, name, len);
+  return (v && len) ? strtol(v, nullptr, 10) : def;
+}
 
-  if (path == "/api/eth/set" && method == "POST") {
-    JsonDocument d; if (deserializeJson(d, body)) { code=400; return jsonErr("JSON invalid"); }
+bool ApiRequest::argIs(const char* name, const char* value) const {
+  size_t len; const char* v = findArg(query, name, len);
+  return v && strlen(value) == len && strncmp(v, value, len) == 0;
+}
 
-    String ip=d["ip"].as<String>(), gw=d["gateway"].as<String>(), sn=d["subnet"].as<String>();
-    IPAddress tip, tgw, tsn; if (!tip.fromString(ip) || !tsn.fromString(sn)) { code=400; return jsonErr("IP/Subnet tidak valid"); }
-    if (!tgw.fromString(gw)) tgw = IPAddress(0,0,0,0);
-    _cfg.eth_ip=ip; _cfg.eth_gateway=gw; _cfg.eth_subnet=sn; saveConfig();
-    ethernetBeginStatic(); 
-    return jsonOk("eth_set");
+// dipanggil hanya sebelum begin(): belum ada request yang membaca tabel
+void DualNICPortal::growRoutes(size_t cap){
+  ExtraRoute* old = _extraRoutes;
+  const size_t oldCap = _routeCap;
+  _extraRoutes = new ExtraRoute[cap]; _routeCap = cap;
+  for (size_t i = 0; i < oldCap; i++) {
+    if (!old[i].key) continue;
+    size_t j = old[i].key % cap;
+    while (_extraRoutes[j].key) j = (j + 1) % cap;
+    _extraRoutes[j] = std::move(old[i]);
   }
+  delete[] old;
+}
 
-  if (path == "/api/mqtt/set" && method == "POST") {
-    JsonDocument d;
-    if (deserializeJson(d, body)) { code=400; return jsonErr("JSON invalid"); }
-
-    _cfg.mqtt_host  = d["host"].as<String>();
-    _cfg.mqtt_port  = d["port"] | _cfg.mqtt_port;
-    _cfg.mqtt_user  = d["user"].as<String>();
-    // hanya overwrite jika field 'pass' dikirim
-    if (!d["pass"].isNull()) {
-      String p = d["pass"].as<String>();
-      if (p.length()) _cfg.mqtt_pass = p; // atau langsung = p; jika ingin bisa clear
+DualNICPortal::ExtraRoute* DualNICPortal::reserveRoute(const char* method, const char* path){
+  const uint32_t key = routeKey(method, path);
+  ExtraRoute* r = findExtraRoute(key, method, path); // didaftarkan ulang: ganti handler
+  if (!r) {
+    if (!_routesFrozen && (_routeCount + 1) * 2 > _routeCap) growRoutes(_routeCap ? _routeCap * 2 : MIN_EXTRA_ROUTES);
+    for (size_t n = 0; n < _routeCap && !r; n++) {
+      ExtraRoute& e = _extraRoutes[(key + n) % _routeCap];
+      if (e.key == 0) r = &e;
     }
-    _cfg.mqtt_topic = d["topic"].as<String>();
-    saveConfig();
+    if (!r) {
+      Serial.printf("[HTTP] Route table full (%u), drop %s %s\n", (unsigned)_routeCap, method, path);
+      return nullptr;
+    }
+    _routeCount++;
+  }
+  r->key = key; r->method = method; r->path = path; r->fn = nullptr; r->streamFn = nullptr; r->uploadFn = nullptr;
+  return r;
+}
+
+bool DualNICPortal::addRoute(const char* method, const char* path, RouteHandler fn){
+  ExtraRoute* r = reserveRoute(method, path); if (!r) return false;
+  r->fn = fn; return true;
+}
+
+bool DualNICPortal::addStreamRoute(const char* method, const char* path, StreamRouteHandler fn){
+  ExtraRoute* r = reserveRoute(method, path); if (!r) return false;
+  r->streamFn = fn; return true;
+}
 
-    // Jangan tes koneksi di thread async_tcp (hindari WDT). Jadwalkan saja.
-    s_mqttProbeRequested = true;
+bool DualNICPortal::addUploadRoute(const char* method, const char* path, UploadHandler onChunk, RouteHandler onDone){
+  ExtraRoute* r = reserveRoute(method, path); if (!r) return false;
+  r->uploadFn = onChunk; r->fn = onDone; return true;
+}
 
-    JsonDocument resp;
-    resp["status"]  = "mqtt_saved";
-    resp["testing"] = true;
-    String s; serializeJson(resp, s);
-    _pendingRestart = true;
-    return s;
+DualNICPortal::ExtraRoute* DualNICPortal::findExtraRoute(uint32_t key, const char* method, const char* path){
+  for (size_t n = 0; n < _routeCap; n++) {
+    ExtraRoute& r = _extraRoutes[(key + n) % _routeCap];
+    if (r.key == 0) return nullptr;
+    if (r.key == key && strcmp(path, r.path) == 0 && strcmp(method, r.method) == 0) return &r;
   }
+  return nullptr;
+}
+
+String DualNICPortal::dispatch(const ApiRequest& rq, String& contentType, int& code, ChunkFiller* stream){
+  contentType = "application/json"; code = 200;
+  const uint32_t key = routeKey(rq.method, rq.path);
+  const uint32_t t0 = micros();
 
-  if (path == "/api/reset" && method == "POST") {
-    LittleFS.remove(_configPath.c_str()); ESP.restart(); return jsonOk("restarting");
+  int id = findBuiltinRoute(key);
+  if (id >= 0 && (strcmp(rq.path, s_routes[id].path) != 0 || strcmp(rq.method, s_routes[id].method) != 0)) id = -1;
+  if (id < 0 && strcmp(rq.method, "GET") == 0 && strncmp(rq.path, "/api/jobs/", 10) == 0) id = R_JOBS; // /api/jobs/<id>
+  if (id >= 0) {
+    String out;
+    switch (id) {
+#define X(rid, m, p, fn) case R_##rid: out = fn(rq, contentType, code); break;
+      PORTAL_ROUTES(X)
+#undef X
+    }
+    recordRoute(s_routeStats[id], t0);
+    return out;
   }
 
-  if (path == "/api/ap/enable" && method == "POST") {
-    JsonDocument d; if (deserializeJson(d, body)) { code=400; return jsonErr("JSON invalid"); }
-    uint32_t m = d["minutes"] | _AP_DEFAULT_MINUTES; apEnableForMinutes(m); return jsonOk("ap_enabled");
+  if (ExtraRoute* r = findExtraRoute(key, rq.method, rq.path)) {
+    String out;
+    if (r->streamFn) {
+      ChunkFiller fill = r->streamFn(rq, contentType, code);
+      if (fill && stream) *stream = fill;
+      else { if (code == 200) code = 503; contentType = "application/json"; out = jsonErr("stream unavailable"); }
+    } else {
+      out = r->fn(rq, contentType, code);
+    }
+    recordRoute(r->stats, t0);
+    return out;
   }
-  if (path == "/api/ap/disable" && method == "POST") { apDisable(); return jsonOk("ap_disabled"); }
 
-  // → extra handler (user app)
+  // → extra handler (user app, API lama; String hanya dibuat di jalur ini)
   if (_extraHandler) {
     String out;
-    bool handled = _extraHandler(path, method, body, ctx, contentType, code, out);
+    bool handled = _extraHandler(String(rq.path), String(rq.method), String(rq.body), String(rq.ctx), contentType, code, out);
     if (handled) return out;
   }
 
   code = 404; return jsonErr("not found");
 }
 
+String DualNICPortal::jsonRoutes(){
+  JsonDocument doc;
+  JsonArray arr = doc["routes"].to<JsonArray>();
+  auto add = [&](const char* m, const char* p, const RouteStats& st){
+    JsonObject o = arr.add<JsonObject>();
+    o["method"] = m; o["path"] = p; o["hits"] = st.hits;
+    o["avg_us"] = st.hits ? st.totalUs / st.hits : 0; o["max_us"] = st.maxUs;
+  };
+  for (int i = 0; i < R_COUNT; i++) add(s_routes[i].method, s_routes[i].path, s_routeStats[i]);
+  for (size_t i = 0; i < _routeCap; i++) if (_extraRoutes[i].key) add(_extraRoutes[i].method, _extraRoutes[i].path, _extraRoutes[i].stats);
+  String out; serializeJson(doc, out); return out;
+}
+
+// ===== Job queue =====
+uint32_t DualNICPortal::postJob(const char* resource, const char* payload, JobStep step, bool* coalesced){
+  if (coalesced) *coalesced = false;
+  if (!_jobMtx) return 0;
+  xSemaphoreTake(_jobMtx, portMAX_DELAY);
+  Job* queued = nullptr;
+  for (auto& j : _jobs) if (j.state == JOB_QUEUED && strcmp(j.resource, resource) == 0) { queued = &j; break; }
+  uint32_t id = 0;
+  if (queued && payload && !queued->anyPayload && queued->payload == payload) {
+    // belum jalan & parameter sama: peminta lama & baru poll id yang sama
+    id = queued->id;
+    if (coalesced) *coalesced = true;
+  } else {
+    // slot kosong, atau hasil selesai yang paling lama (record job yang digantikan disisakan bila bisa)
+    Job* slot = nullptr;
+    for (auto& j : _jobs) {
+      if (j.state == JOB_FREE) { slot = &j; break; }
+      if (j.state >= JOB_DONE && (!slot || j.id < slot->id)) slot = &j;
+    }
+    if (!slot) slot = queued;
+    if (slot) {
+      id = ++_jobSeq;
+      if (queued) {
+        // parameter beda: job lama tidak dijalankan, pemintanya melihat siapa penggantinya
+        queued->state = JOB_SUPERSEDED; queued->supersededBy = id; queued->step = nullptr;
+        queued->code = 409; queued->doneAt = millis();
+        Serial.printf("[JOB] #%u %s superseded by #%u\n", (unsigned)queued->id, resource, (unsigned)id);
+      }
+      slot->id = id; slot->state = JOB_QUEUED; slot->resource = resource; slot->step = step;
+      slot->payload = payload ? payload : ""; slot->anyPayload = !payload; slot->supersededBy = 0;
+      slot->result = ""; slot->code = 200; slot->queuedAt = millis(); slot->startedAt = slot->doneAt = 0;
+    }
+  }
+  xSemaphoreGive(_jobMtx);
+  if (!id) Serial.printf("[JOB] Queue full, drop %s\n", resource);
+  return id;
+}
+
+String DualNICPortal::jobAccepted(uint32_t id, bool coalesced, int& code){
+  if (!id) { code = 503; return jsonErr("antrian job penuh"); }
+  code = 202;
+  JsonDocument d;
+  d["job"] = id; d["state"] = "queued"; d["coalesced"] = coalesced;
+  d["poll"] = String("/api/jobs/") + id;
+  String s; serializeJson(d, s); return s;
+}
+
+// satu job berjalan pada satu waktu (FIFO by id) -> resource yang sama tidak pernah paralel
+void DualNICPortal::runJobs(){
+  if (!_jobRunning) {
+    xSemaphoreTake(_jobMtx, portMAX_DELAY);
+    for (auto& j : _jobs) if (j.state == JOB_QUEUED && (!_jobRunning || j.id < _jobRunning->id)) _jobRunning = &j;
+    if (_jobRunning) { _jobRunning->state = JOB_RUNNING; _jobRunning->startedAt = millis(); }
+    xSemaphoreGive(_jobMtx);
+    if (!_jobRunning) return;
+  }
+  String result; int code = 200;
+  if (!_jobRunning->step(result, code)) return;
+
+  xSemaphoreTake(_jobMtx, portMAX_DELAY);
+  Job& j = *_jobRunning;
+  j.result = result; j.code = code; j.doneAt = millis(); j.state = JOB_DONE; j.step = nullptr; j.payload = "";
+  xSemaphoreGive(_jobMtx);
+  Serial.printf("[JOB] #%u %s -> %d (%u ms)\n", (unsigned)j.id, j.resource, code, (unsigned)(j.doneAt - j.startedAt));
+  _jobRunning = nullptr;
+}
+
+void DualNICPortal::jobToJson(const Job& j, JsonObject o){
+  static const char* const names[] = { "free", "queued", "running", "done", "superseded" };
+  o["id"] = j.id; o["resource"] = j.resource; o["state"] = names[j.state];
+  o["age_ms"] = millis() - j.queuedAt;
+  if (j.state == JOB_SUPERSEDED) { o["code"] = j.code; o["superseded_by"] = j.supersededBy; }
+  if (j.state == JOB_DONE) {
+    o["code"] = j.code; o["run_ms"] = j.doneAt - j.startedAt;
+    if (j.result.length()) o["result"] = serialized(j.result);
+  }
+}
+
+// ===== Route handlers =====
+String DualNICPortal::apiStatus(const ApiRequest& rq, String& contentType, int& code){ return jsonStatus(rq.ctx); }
+
+String DualNICPortal::apiRoutes(const ApiRequest& rq, String& contentType, int& code){ return jsonRoutes(); }
+
+// GET /api/jobs -> semua job; GET /api/jobs/<id> -> satu job (404 jika sudah tergeser)
+String DualNICPortal::apiJobs(const ApiRequest& rq, String& contentType, int& code){
+  const bool one = strlen(rq.path) > 9;
+  const uint32_t id = one ? strtoul(rq.path + 10, nullptr, 10) : 0;
+  JsonDocument d; bool found = false;
+  xSemaphoreTake(_jobMtx, portMAX_DELAY);
+  if (one) {
+    for (auto& j : _jobs) if (id && j.id == id && j.state != JOB_FREE) { jobToJson(j, d.to<JsonObject>()); found = true; break; }
+  } else {
+    JsonArray arr = d["jobs"].to<JsonArray>();
+    for (auto& j : _jobs) if (j.state != JOB_FREE) jobToJson(j, arr.add<JsonObject>());
+    found = true;
+  }
+  xSemaphoreGive(_jobMtx);
+  if (!found) { code = 404; return jsonErr("job tidak ditemukan"); }
+  String s; serializeJson(d, s); return s;
+}
+
+// scan 13 channel makan beberapa detik: async di job, hasil lewat /api/jobs/<id> -> {aps:[...]}
+String DualNICPortal::apiScan(const ApiRequest& rq, String& contentType, int& code){
+  bool co = false;
+  uint32_t id = postJob("scan", "", [this, t0 = uint32_t(0)](String& out, int& rc) mutable {
+    int n = WiFi.scanComplete();
+    if (!t0) {
+      _scanJob = true;
+      if (n != WIFI_SCAN_RUNNING) WiFi.scanNetworks(true, true); // scan watchdog yang sedang jalan dipakai
+      t0 = millis(); if (!t0) t0 = 1;
+      return false;
+    }
+    if (n == WIFI_SCAN_RUNNING && millis() - t0 < 15000) return false;
+    _scanJob = false;
+    if (n < 0) { WiFi.scanDelete(); rc = 504; out = jsonErr("Scan Wi-Fi gagal"); return true; }
+    JsonDocument doc;
+    JsonArray arr = doc["aps"].to<JsonArray>();
+    for (int i=0;i<n;i++){
+      JsonObject o = arr.add<JsonObject>();
+      o["ssid"]=WiFi.SSID(i); o["rssi"]=WiFi.RSSI(i); o["sec"]=WiFi.encryptionType(i);
+      o["bssid"]=WiFi.BSSIDstr(i); o["ch"]=WiFi.channel(i);
+    }
+    WiFi.scanDelete();
+    serializeJson(doc, out);
+    return true;
+  }, &co);
+  return jobAccepted(id, co, code);
+}
+
+String DualNICPortal::apiWifiConnect(const ApiRequest& rq, String& contentType, int& code){
+  JsonDocument d; if (deserializeJson(d, rq.body)) { code=400; return jsonErr("JSON invalid"); }
+  String ssid=d["ssid"].as<String>(), pass=d["pass"].as<String>();
+  if (ssid.isEmpty()) { code=400; return jsonErr("SSID kosong"); }
+  String ipMode = d["ip_mode"].isNull() ? String() : d["ip_mode"].as<String>();
+  String ip=d["ip"].as<String>(), gw=d["gateway"].as<String>(), sn=d["subnet"].as<String>();
+
+  // simpan + startWiFi() di loop(); selesai saat tersambung atau 30 s
+  bool co = false;
+  uint32_t id = postJob("wifi", rq.body, [this, ssid, pass, ipMode, ip, gw, sn, t0 = uint32_t(0)](String& out, int& rc) mutable {
+    if (!t0) {
+      bool busy = false;
+      updateConfig([&](AppConfig& c){
+        c.wifi_ssid=ssid; c.wifi_pass=pass;
+        if (ipMode.length()) { c.wifi_ip_mode = ipMode; c.wifi_ip = ip; c.wifi_gateway = gw; c.wifi_subnet = sn; }
+      }, &busy);
+      if (busy) return false; // slot config penuh: ulangi di loop() berikutnya
+      startWiFi();
+      t0 = millis(); if (!t0) t0 = 1;
+      return false;
+    }
+    if (WiFi.status() == WL_CONNECTED) { Serial.println(F("[WiFi] Connected")); out = jsonOk("connected"); return true; }
+    if (millis() - t0 >= 30000) { Serial.println(F("[WiFi] Failed.")); rc = 504; out = jsonErr("Gagal konek Wi-Fi (timeout)"); return true; }
+    return false;
+  }, &co);
+  return jobAccepted(id, co, code);
+}
+
+String DualNICPortal::apiWifiDisconnect(const ApiRequest& rq, String& contentType, int& code){
+  disconnectWiFi(); return jsonOk("disconnected");
+}
+
+String DualNICPortal::apiEthSet(const ApiRequest& rq, String& contentType, int& code){
+  JsonDocument d; if (deserializeJson(d, rq.body)) { code=400; return jsonErr("JSON invalid"); }
+
+  String mode = d["mode"] | "static";
+  String ip=d["ip"].as<String>(), gw=d["gateway"].as<String>(), sn=d["subnet"].as<String>();
+  if (mode != "dhcp") {
+    IPAddress tip, tsn; if (!tip.fromString(ip) || !tsn.fromString(sn)) { code=400; return jsonErr("IP/Subnet tidak valid"); }
+  }
+
+  // re-init W5500 di loop(); request beruntun sebelum dijalankan cukup diterapkan sekali
+  bool co = false;
+  uint32_t id = postJob("eth", rq.body, [this, mode, ip, gw, sn](String& out, int& rc){
+    bool busy = false;
+    if (mode == "dhcp") updateConfig([](AppConfig& c){ c.eth_mode = "dhcp"; }, &busy);
+    else updateConfig([&](AppConfig& c){ c.eth_mode="static"; c.eth_ip=ip; c.eth_gateway=gw; c.eth_subnet=sn; }, &busy);
+    if (busy) return false; // slot config penuh: ulangi di loop() berikutnya
+    ethernetBegin();
+    out = jsonOk("eth_set");
+    return true;
+  }, &co);
+  return jobAccepted(id, co, code);
+}
+
+String DualNICPortal::apiMqttSet(const ApiRequest& rq, String& contentType, int& code){
+  JsonDocument d;
+  if (deserializeJson(d, rq.body)) { code=400; return jsonErr("JSON invalid"); }
+
+  bool busy = false;
+  updateConfig([&](AppConfig& c){
+    c.mqtt_host  = d["host"].as<String>();
+    c.mqtt_port  = d["port"] | c.mqtt_port;
+    c.mqtt_user  = d["user"].as<String>();
+    // hanya overwrite jika field 'pass' dikirim
+    if (!d["pass"].isNull()) {
+      String p = d["pass"].as<String>();
+      if (p.length()) c.mqtt_pass = p; // atau langsung = p; jika ingin bisa clear
+    }
+    c.mqtt_topic = d["topic"].as<String>();
+  }, &busy);
+  if (busy) { code = 503; return jsonErr("konfigurasi sibuk, coba lagi"); }
+
+  // Jangan tes koneksi di thread async_tcp (hindari WDT). Jadwalkan saja.
+  s_mqttProbeRequested = true;
+
+  JsonDocument resp;
+  resp["status"]  = "mqtt_saved";
+  resp["testing"] = true;
+  String s; serializeJson(resp, s);
+  _pendingRestart = true;
+  return s;
+}
+
+String DualNICPortal::apiReset(const ApiRequest& rq, String& contentType, int& code){
+  // .bak/.tmp dulu: loadConfig() jatuh ke .bak bila config utama hilang
+  LittleFS.remove(_configPath + ".bak"); LittleFS.remove(_configPath + ".tmp");
+  LittleFS.remove(_configPath.c_str()); ESP.restart(); return jsonOk("restarting");
+}
+
+String DualNICPortal::apiApEnable(const ApiRequest& rq, String& contentType, int& code){
+  JsonDocument d; if (deserializeJson(d, rq.body)) { code=400; return jsonErr("JSON invalid"); }
+  uint32_t m = d["minutes"] | _AP_DEFAULT_MINUTES; apEnableForMinutes(m); return jsonOk("ap_enabled");
+}
+
+String DualNICPortal::apiApDisable(const ApiRequest& rq, String& contentType, int& code){
+  apDisable(); return jsonOk("ap_disabled");
+}
+
 bool DualNICPortal::mqttTestConnectivity(uint32_t timeoutMs){
-  if (_cfg.mqtt_host.isEmpty()) return false;
+  const AppConfig cfg = config(); // salinan: PubSubClient menyimpan pointer host, probe bisa lama
+  if (cfg.mqtt_host.isEmpty()) return false;
 
   if (WiFi.status() == WL_CONNECTED) _mqttTest.setClient(_wifiClient);
   else if (ethernetLinkUp())         _mqttTest.setClient(_ethClient);
   else return false;
 
-  _mqttTest.setServer( _cfg.mqtt_host.c_str(), _cfg.mqtt_port);
+  _mqttTest.setServer( cfg.mqtt_host.c_str(), cfg.mqtt_port);
   Serial.print("Menghubungkan ke MQTT ");
-  Serial.print(_cfg.mqtt_host);
+  Serial.print(cfg.mqtt_host);
   Serial.print(":");
-  Serial.println(_cfg.mqtt_port);
+  Serial.println(cfg.mqtt_port);
   
   uint32_t t0 = millis();
   bool ok = false;
 
   while (!ok && (millis() - t0) < timeoutMs) {
-    if (_cfg.mqtt_user.length() > 0) ok = _mqttTest.connect("Barcode_Device", _cfg.mqtt_user.c_str(), _cfg.mqtt_pass.c_str());
+    if (cfg.mqtt_user.length() > 0) ok = _mqttTest.connect("Barcode_Device", cfg.mqtt_user.c_str(), cfg.mqtt_pass.c_str());
     else ok = _mqttTest.connect("Barcode_Device");
   }
 
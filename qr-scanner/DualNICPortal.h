@@ -9,10 +9,17 @@
 #include <PubSubClient.h>
 #include <ArduinoJson.h>
 #include <LittleFS.h>
+#include <atomic>
+#include "EthernetDhcp.h"
 
 struct AppConfig {
   String wifi_ssid;
   String wifi_pass;
+  String wifi_ip_mode;  // "dhcp" (default) | "cached" (pakai IP lease terakhir) | "static"
+  String wifi_ip;       // hanya untuk mode static
+  String wifi_gateway;
+  String wifi_subnet;
+  String eth_mode;   // "dhcp" | "static" (kosong: dhcp jika eth_ip belum diisi)
   String eth_ip;
   String eth_gateway;
   String eth_subnet;
@@ -23,6 +30,41 @@ struct AppConfig {
   String mqtt_topic;
 };
 
+// Bump allocator per request: blok tetap dialokasikan sekali di begin(), alloc() O(1),
+// reset() setelah respons terkirim membebaskan semuanya sekaligus -> heap tidak terfragmentasi
+class RequestArena {
+public:
+  bool init(size_t cap);
+  char* alloc(size_t n);                   // nullptr jika tidak muat (overflows++)
+  const char* dup(const char* s, size_t n); // salinan + NUL; "" jika tidak muat
+  void reset() { if (_used > _high) _high = _used; _used = 0; }
+  size_t capacity() const { return _cap; }
+  size_t highWater() const { return _used > _high ? _used : _high; }
+  uint32_t overflows() const { return _overflows; }
+private:
+  char* _buf = nullptr;
+  size_t _cap = 0, _used = 0, _high = 0;
+  uint32_t _overflows = 0;
+};
+
+// Satu request API yang sudah diparse, sama untuk jalur Wi-Fi (Async) & Ethernet.
+// Semua string menunjuk ke arena request (atau buffer server), valid selama handler berjalan.
+struct ApiRequest {
+  const char* method = "";
+  const char* path = "";   // tanpa query string
+  const char* query = "";  // "a=1&b=2" (tanpa '?')
+  const char* body = "";   // selalu diakhiri NUL
+  size_t bodyLen = 0;
+  const char* ctx = "";    // "wifi" | "ethernet"
+  RequestArena* arena = nullptr;
+  const char* arg(const char* name) const;            // nilai parameter query, "" jika tidak ada
+  long argInt(const char* name, long def = 0) const;  // def jika tidak ada / kosong
+  bool argIs(const char* name, const char* value) const;
+};
+
+// Statistik per route (hit & latency handler, mikrodetik)
+struct RouteStats { uint32_t hits = 0; uint32_t totalUs = 0; uint32_t maxUs = 0; };
+
 class DualNICPortal {
 public:
   struct Pins { int w5500_cs; int w5500_rst; };
@@ -33,6 +75,36 @@ public:
     const String& path, const String& method, const String& body,
     const String& ctx, String& contentType, int& code, String& out)>;
 
+  // Handler route terdaftar: return payload; set contentType & code bila perlu
+  using RouteHandler = std::function<String(const ApiRequest& rq, String& contentType, int& code)>;
+  // Respons streaming: isi buf maks maxLen byte, return 0 = selesai, RESPONSE_TRY_AGAIN = sibuk (panggil lagi)
+  using ChunkFiller = std::function<size_t(uint8_t* buf, size_t maxLen)>;
+  // return filler kosong + code/contentType untuk menolak request (payload error JSON)
+  using StreamRouteHandler = std::function<ChunkFiller(const ApiRequest& rq, String& contentType, int& code)>;
+  // Upload streaming: tiap potongan body (offset index dari total) diteruskan tanpa ditampung;
+  // return false = abaikan sisa body. Setelah body habis, handler route biasa dipanggil.
+  using UploadHandler = std::function<bool(const ApiRequest& rq, const uint8_t* data, size_t len, size_t index, size_t total)>;
+
+  // FNV-1a atas "METHOD path"; constexpr agar tabel route di-hash saat compile
+  static constexpr uint32_t fnv1a(const char* s, uint32_t h = 2166136261u){
+    return *s ? fnv1a(s + 1, (h ^ (uint8_t)*s) * 16777619u) : h;
+  }
+  static constexpr uint32_t routeKey(const char* method, const char* path){
+    return fnv1a(path, (fnv1a(method) ^ (uint8_t)' ') * 16777619u);
+  }
+  // tabel route aplikasi mulai MIN_EXTRA_ROUTES slot, digandakan selama pendaftaran (sebelum begin())
+  // sehingga terisi <= separuh; sesudah begin() ukurannya tetap (dispatch jalan di task lain)
+  static const size_t MIN_EXTRA_ROUTES = 16;
+  static const size_t MAX_BODY_BYTES   = 4096;
+  static const size_t MAX_REQLINE_BYTES = 512;  // "METHOD /path?query HTTP/1.1" (Ethernet)
+  // arena per server: request line/query + body + salinan arg()
+  static const size_t ARENA_BYTES = MAX_BODY_BYTES + MAX_REQLINE_BYTES + 512;
+
+  // Job: pekerjaan berat dari handler HTTP, dijalankan di loop() (bukan di task async_tcp).
+  // step dipanggil sekali per loop() sampai return true; isi result (JSON) & code saat selesai.
+  using JobStep = std::function<bool(String& result, int& code)>;
+  static const size_t MAX_JOBS = 8;
+
   // Let caller augment /api/status JSON (e.g., add queue stats)
   using StatusAugmenter = std::function<void(JsonDocument& root)>;
 
@@ -40,8 +112,10 @@ public:
                 const char* mdnsHost = "barcode",
                 const char* configPath = "/config.json");
 
-  // boot the portal: load config, AP/STA, Ethernet, HTTP routes
+  // boot the portal: load config, AP/STA, HTTP routes. Tidak blocking:
+  // koneksi Wi-Fi (dan fallback Ethernet/AP) diselesaikan bertahap di loop()
   void begin();
+  bool booting() const { return _bootWifiPending; }
 
   // call in loop(): ethernet HTTP, AP timer, Wi-Fi watchdog
   void loop();
@@ -54,14 +128,37 @@ public:
   // info helpers
   NetInfo current() const;
   String activeIP() const;
+  String statusJson(const char* ctx) { return jsonStatus(ctx); } // isi /api/status (bench, dsb.)
   bool ethernetLinkUp() const;
 
-  // config access
-  AppConfig& config();
+  // config access: snapshot immutable, dibaca tanpa lock (RCU). Referensi hanya boleh
+  // dipegang sepanjang satu pemanggilan (bukan disimpan), lihat _CFG_GRACE_MS.
+  const AppConfig& config() const { return *_cfg.load(std::memory_order_acquire); }
+  // copy-on-write: salin snapshot, ubah lewat fn, publish (pointer swap) lalu simpan atomik.
+  // false + *busy = true jika semua slot snapshot lama masih dalam grace period (update beruntun):
+  // tidak ada yang diubah, caller menjawab 503 / mencoba lagi
+  bool updateConfig(std::function<void(AppConfig&)> fn, bool* busy = nullptr);
 
   // hooks
-  void setExtraApiHandler(ExtraApiHandler fn);
+  void setExtraApiHandler(ExtraApiHandler fn); // fallback lama (dipanggil jika route tidak ada)
   void setStatusAugmenter(StatusAugmenter fn);
+  // jam epoch ms (RTC) untuk umur lease DHCP yang tersimpan; tanpa jam lease cache hanya dipakai
+  // bila server menjawab INIT-REBOOT
+  void setClock(EthernetDhcp::EpochFn fn){ _dhcp.setClock(fn); }
+  // daftarkan endpoint aplikasi; body & query diteruskan dari kedua server.
+  // false = tabel penuh (hanya mungkin sesudah begin()), route tidak aktif
+  bool addRoute(const char* method, const char* path, RouteHandler fn);
+  // endpoint dengan body besar (export dsb.) yang dikirim bertahap tanpa ditampung di RAM
+  bool addStreamRoute(const char* method, const char* path, StreamRouteHandler fn);
+  // endpoint upload besar (di atas MAX_BODY_BYTES): onChunk per potongan, onDone saat selesai
+  bool addUploadRoute(const char* method, const char* path, UploadHandler onChunk, RouteHandler onDone);
+  // antre job untuk resource ("wifi", "eth", "queue", ...). payload = parameter request (mis. body):
+  // job resource yang sama yang belum jalan dengan payload identik dipakai bersama (coalesce, id
+  // tetap); payload lain -> job lama ditandai "superseded" (by = id baru), request baru dapat id
+  // sendiri. payload nullptr = tidak pernah identik. return id > 0, atau 0 jika antrian penuh
+  uint32_t postJob(const char* resource, const char* payload, JobStep step, bool* coalesced = nullptr);
+  // respons handler untuk id dari postJob: 202 {job, state, poll}, atau 503 jika id == 0
+  String jobAccepted(uint32_t id, bool coalesced, int& code);
 
 private:
   // pins & cfg
@@ -75,9 +172,14 @@ private:
   WiFiClient _wifiClient;
   EthernetClient _ethClient;
   PubSubClient _mqttTest; // internal for /api/mqtt/test
+  EthernetDhcp _dhcp;
+  const char* _leasePath = "/eth_lease.json";
 
   // state
-  AppConfig _cfg;
+  std::atomic<const AppConfig*> _cfg;
+  SemaphoreHandle_t _cfgWriteMtx = nullptr; // hanya antar penulis; pembaca tidak pernah lock
+  struct RetiredCfg { const AppConfig* p = nullptr; uint32_t at = 0; } _retiredCfg[4];
+  const uint32_t _CFG_GRACE_MS = 5000;
   bool _mdnsStarted = false;
   String _apSSID;
   uint32_t _apOffAt = 0;
@@ -87,17 +189,67 @@ private:
   bool _wifiWatchActive = false;
   uint32_t _wifiWatchStart = 0;
   uint32_t _wifiScanAt = 0;
+  bool _scanJob = false; // job /api/scan memegang hasil scan: watchdog tidak mengambil/menghapusnya
   const uint32_t _WIFI_LOST_AP_DELAY_MS = 30000;
 
+  // fast reconnect: BSSID/channel/IP koneksi sukses terakhir (/wifi_cache.json)
+  struct WiFiCache {
+    String ssid; uint8_t bssid[6] = {0}; int32_t channel = 0;
+    IPAddress ip, gw, sn, dns;
+    bool valid() const { return channel > 0; }
+  } _wifiCache;
+  const char* _wifiCachePath = "/wifi_cache.json";
+  uint32_t _wifiAttemptAt = 0;      // millis() awal percobaan yang sedang berjalan (0 = tidak ada)
+  bool _wifiAttemptFast = false;
+  uint32_t _wifiLastConnectMs = 0;  // durasi (re)connect terakhir
+  uint32_t _wifiFastOk = 0, _wifiFastFail = 0;
+  uint32_t _wifiLastConnectTry = 0;
+  const uint32_t _WIFI_FAST_TIMEOUT_MS = 3000;
+  const uint32_t _WIFI_SLOW_TIMEOUT_MS = 10000;
+
+  // boot non-blocking: tunggu Wi-Fi s/d _BOOT_WIFI_TIMEOUT_MS lalu fallback Ethernet/AP
+  bool _bootWifiPending = false;
+  uint32_t _bootWifiStart = 0;
+  const uint32_t _BOOT_WIFI_TIMEOUT_MS = 30000;
+
   // hooks
   ExtraApiHandler _extraHandler = nullptr;
   StatusAugmenter _statusAugmenter = nullptr;
 
+  // route aplikasi: open addressing by key (slot kosong: key == 0)
+  struct ExtraRoute { uint32_t key = 0; const char* method = nullptr; const char* path = nullptr;
+                      RouteHandler fn; StreamRouteHandler streamFn; UploadHandler uploadFn; RouteStats stats; };
+  ExtraRoute* _extraRoutes = nullptr;
+  size_t _routeCap = 0, _routeCount = 0;
+  bool _routesFrozen = false;
+  void growRoutes(size_t cap);
+  ExtraRoute* reserveRoute(const char* method, const char* path);
+  ExtraRoute* findExtraRoute(uint32_t key, const char* method, const char* path);
+
+  // job queue: slot tetap; QUEUED/DONE diubah di bawah _jobMtx, step RUNNING hanya disentuh loop()
+  enum JobState : uint8_t { JOB_FREE, JOB_QUEUED, JOB_RUNNING, JOB_DONE, JOB_SUPERSEDED };
+  struct Job { uint32_t id = 0; JobState state = JOB_FREE; const char* resource = ""; JobStep step;
+               String payload; bool anyPayload = false; uint32_t supersededBy = 0;
+               String result; int code = 200; uint32_t queuedAt = 0, startedAt = 0, doneAt = 0; };
+  Job _jobs[MAX_JOBS];
+  uint32_t _jobSeq = 0;
+  Job* _jobRunning = nullptr;
+  SemaphoreHandle_t _jobMtx = nullptr;
+  void runJobs();
+  void jobToJson(const Job& j, JsonObject o);
+
   // ==== internals ====
   void loadConfig();
-  bool saveConfig();
+  bool saveConfig(const AppConfig& c);
+  RetiredCfg* retiredSlot();
+  bool publishConfig(const AppConfig* next);
   void setupAPIfNoCred();
-  bool connectWiFiBlocking(uint32_t timeoutMs = 30000);
+  void startWiFi(bool fast = true); // fast: asosiasi terarah ke BSSID/channel cache, tanpa scan
+  void wifiFastLoop();              // fallback ke scan penuh bila asosiasi terarah gagal
+  void applyWiFiIPConfig(bool fast);
+  void loadWiFiCache();
+  void updateWiFiCache();           // simpan BSSID/channel/IP terakhir (hanya jika berubah)
+  void bootLoop();
   void disconnectWiFi();
   void startMDNSIfNeeded();
   void apEnableForMinutes(uint32_t minutes);
@@ -105,14 +257,41 @@ private:
   void wifiWatchdogLoop();
 
   void ethernetResetPulse();
-  bool ethernetBeginStatic();
+  bool ethernetBegin();          // static atau DHCP sesuai eth_mode
+  bool ethernetUseDhcp() const;
+  bool loadLease(EthernetDhcp::Lease& l);
+  void saveLease(const EthernetDhcp::Lease& l);
   void setupAsyncRoutes();
   void serveEthernet();
+  // arena request: Ethernet dipakai loop(), Async dipakai task async_tcp (satu request sekaligus)
+  RequestArena _ethArena, _asyncArena;
+  // watermark heap: min free dari IDF, blok terbesar minimum disampel tiap detik di loop()
+  uint32_t _minLargestBlock = UINT32_MAX, _heapSampleAt = 0;
+  void sampleHeap();
+  // satu stream Ethernet aktif, dipompa per loop() supaya capture tidak tertahan
+  EthernetClient _ethStreamClient;
+  ChunkFiller _ethStreamFill = nullptr;
+  void pumpEthernetStream();
 
   // api plumbing
-  String apiHandler(const String& path, const String& method, const String& body,
-                    const String& ctx, String& contentType, int& code);
-  String jsonStatus(const String& ctx);
+  void handleAsync(AsyncWebServerRequest* req);
+  void handleAsyncBody(AsyncWebServerRequest* req, uint8_t* data, size_t len, size_t index, size_t total);
+  String dispatch(const ApiRequest& rq, String& contentType, int& code, ChunkFiller* stream = nullptr);
+  String jsonStatus(const char* ctx);
+  String jsonRoutes();
+
+  // handler route bawaan (lihat PORTAL_ROUTES di .cpp)
+  String apiStatus(const ApiRequest& rq, String& contentType, int& code);
+  String apiScan(const ApiRequest& rq, String& contentType, int& code);
+  String apiRoutes(const ApiRequest& rq, String& contentType, int& code);
+  String apiJobs(const ApiRequest& rq, String& contentType, int& code);
+  String apiWifiConnect(const ApiRequest& rq, String& contentType, int& code);
+  String apiWifiDisconnect(const ApiRequest& rq, String& contentType, int& code);
+  String apiEthSet(const ApiRequest& rq, String& contentType, int& code);
+  String apiMqttSet(const ApiRequest& rq, String& contentType, int& code);
+  String apiReset(const ApiRequest& rq, String& contentType, int& code);
+  String apiApEnable(const ApiRequest& rq, String& contentType, int& code);
+  String apiApDisable(const ApiRequest& rq, String& contentType, int& code);
   String jsonOk(const String& msg = "ok");
   String jsonErr(const String& msg);
 
@@ -0,0 +1,56 @@
+#pragma once
+#include <Arduino.h>
+#include <Ethernet.h>
+#include <functional>
+
+// DHCP client non-blocking untuk W5500 (RFC 2131), dipoll dari loop().
+// Lease terakhir bisa diberikan lewat start(): alamat langsung dipakai,
+// lalu dikonfirmasi dengan REQUEST INIT-REBOOT di background (tanpa DISCOVER/OFFER).
+// Umur lease cache dihitung dari acquiredMs (epoch RTC saat ACK, lewat setClock()): lease yang
+// sudah habis langsung ke INIT; tanpa balasan INIT-REBOOT, BOUND hanya dengan sisa masa lease.
+class EthernetDhcp {
+public:
+  struct Lease {
+    IPAddress ip, subnet, gateway, dns, server;
+    uint32_t leaseS = 0, t1S = 0, t2S = 0; // detik
+    uint64_t acquiredMs = 0;                // epoch ms saat ACK (0 = tidak diketahui)
+    bool valid() const { return ip != IPAddress(0,0,0,0) && leaseS > 0; }
+  };
+  enum State : uint8_t { IDLE, INIT, SELECTING, REQUESTING, REBOOTING, BOUND, RENEWING, REBINDING };
+
+  using LeaseCallback = std::function<void(const Lease&)>;
+  using EpochFn = std::function<uint64_t()>; // epoch ms, 0 = jam belum valid
+
+  void start(const uint8_t mac[6], const char* hostname, const Lease* cached = nullptr);
+  void stop();
+  void loop();                       // panggil di loop(); tidak pernah blocking
+  void onLease(LeaseCallback cb){ _onLease = cb; } // tiap ACK (lease baru / diperpanjang)
+  void setClock(EpochFn fn){ _epochMs = fn; }
+
+  State state() const { return _state; }
+  const char* stateName() const;
+  const Lease& lease() const { return _lease; }
+  uint32_t remainingS() const;       // sisa masa lease (0 jika belum BOUND)
+
+private:
+  EthernetUDP _udp;
+  bool _udpOpen = false;
+  State _state = IDLE;
+  uint8_t _mac[6] = {0};
+  char _host[32] = {0};
+  uint32_t _xid = 0;
+  Lease _lease, _offer;
+  uint32_t _boundAt = 0;     // millis() saat ACK terakhir (lease cache: dimundurkan sebesar umurnya)
+  bool _ageKnown = false;    // umur lease cache diketahui (acquiredMs & jam valid)
+  uint32_t _sentAt = 0, _retryMs = 0;
+  uint8_t _tries = 0;
+  LeaseCallback _onLease = nullptr;
+  EpochFn _epochMs = nullptr;
+
+  void enter(State s);
+  void send(uint8_t msgType, bool broadcast);
+  bool receive(uint8_t& msgType, Lease& out);
+  void applyLease(const Lease& l);
+  void openUdp();
+  void closeUdp();
+};
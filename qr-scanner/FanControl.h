@@ -0,0 +1,45 @@
+#pragma once
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <functional>
+
+// Kontrol kipas periodik, dipanggil dari loop() tanpa delay:
+//   - suhu disampel tiap sampleMs lewat sampler (NAN = gagal baca), dihaluskan EWMA
+//   - histeresis: kipas nyala saat suhu >= onC, mati saat <= offC
+//   - selama nyala duty proporsional offC..fullC (minDuty .. 255)
+//   - duty PWM berubah bertahap maks rampPerS per detik (mulai dari 0 langsung ke minDuty)
+//   - sensor gagal 3x berturut-turut -> kipas penuh (fail-safe)
+class FanControl {
+public:
+  struct Settings {
+    float onC = 50, offC = 30, fullC = 50;
+    uint8_t minDuty = 80;       // di bawah ini kipas umumnya tidak mau berputar
+    uint16_t sampleMs = 1000;
+    uint16_t rampPerS = 128;    // unit duty per detik
+  };
+  using Sampler = std::function<float()>;
+
+  void begin(int pin, Sampler sampler);
+  void loop();
+  void setSettings(const Settings& s) { _set = s; }
+  const Settings& settings() const { return _set; }
+  static bool valid(const Settings& s) {
+    return s.offC < s.onC && s.onC <= s.fullC && s.sampleMs >= 100 && s.sampleMs <= 60000 && s.rampPerS > 0;
+  }
+  float tempC() const { return _temp; }
+  uint8_t duty() const { return _duty; }
+  void toJson(JsonObject o) const;
+
+private:
+  static const uint8_t FAULT_LIMIT = 3;
+  static const uint16_t RAMP_MS = 50;
+  int _pin = -1;
+  Sampler _sampler;
+  Settings _set;
+  float _temp = NAN, _raw = NAN;
+  bool _on = false;
+  uint8_t _target = 0, _duty = 0, _faultRun = 0;
+  uint32_t _faults = 0, _samples = 0, _lastSample = 0, _lastRamp = 0, _sampleUs = 0;
+
+  void sample();
+};
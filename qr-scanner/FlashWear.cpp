@@ -0,0 +1,61 @@
+#include "FlashWear.h"
+#include <LittleFS.h>
+#include <esp_timer.h>
+
+FlashWear::Counter FlashWear::_c[FlashWear::SUB_COUNT];
+uint32_t FlashWear::_items = 0, FlashWear::_cycles = 100000;
+portMUX_TYPE FlashWear::_mux = portMUX_INITIALIZER_UNLOCKED;
+
+void FlashWear::add(Sub s, size_t bytes, uint8_t metaOps){
+  if (s >= SUB_COUNT) return;
+  const uint64_t phys = (uint64_t)(bytes + PAGE - 1) / PAGE * PAGE + (uint64_t)PAGE * (1 + metaOps);
+  portENTER_CRITICAL(&_mux);
+  _c[s].bytes += bytes; _c[s].phys += phys; _c[s].commits++;
+  portEXIT_CRITICAL(&_mux);
+}
+
+void FlashWear::addItems(uint32_t n){
+  portENTER_CRITICAL(&_mux);
+  _items += n;
+  portEXIT_CRITICAL(&_mux);
+}
+
+uint64_t FlashWear::physBytes(){
+  uint64_t p = 0;
+  portENTER_CRITICAL(&_mux);
+  for (uint8_t i = 0; i < SUB_COUNT; i++) p += _c[i].phys;
+  portEXIT_CRITICAL(&_mux);
+  return p;
+}
+
+const char* FlashWear::name(Sub s){
+  static const char* const N[SUB_COUNT] = { "queue_append", "queue_head", "queue_compact", "queue_prune",
+                                            "config", "tally", "products", "net" };
+  return s < SUB_COUNT ? N[s] : "?";
+}
+
+void FlashWear::toJson(JsonObject o){
+  Counter c[SUB_COUNT]; uint32_t items;
+  portENTER_CRITICAL(&_mux);
+  memcpy(c, _c, sizeof(c)); items = _items;
+  portEXIT_CRITICAL(&_mux);
+
+  uint64_t bytes = 0, phys = 0;
+  JsonObject by = o["by"].to<JsonObject>();
+  for (uint8_t i = 0; i < SUB_COUNT; i++) {
+    bytes += c[i].bytes; phys += c[i].phys;
+    if (!c[i].commits) continue;
+    JsonObject s = by[name((Sub)i)].to<JsonObject>();
+    s["bytes"] = c[i].bytes; s["phys"] = c[i].phys; s["commits"] = c[i].commits;
+  }
+  const uint32_t upS = (uint32_t)(esp_timer_get_time() / 1000000);
+  const size_t fs = LittleFS.totalBytes();
+  o["rated_cycles"] = _cycles; o["fs_bytes"] = fs; o["fs_used"] = LittleFS.usedBytes();
+  o["uptime_s"] = upS; o["bytes"] = bytes; o["phys_bytes"] = phys; o["items"] = items;
+  o["bytes_per_item"] = items ? roundf((float)phys / items * 10) / 10 : 0;
+  const float perDay = upS ? (float)phys * 86400.0f / upS : 0;
+  o["phys_per_day"] = (uint32_t)perDay;
+  // belum ada tulisan (atau baru boot): proyeksi tidak bermakna -> null
+  if (perDay > 0 && upS >= 60) o["lifetime_years"] = roundf((float)fs * _cycles / perDay / 365.0f * 10) / 10;
+  else o["lifetime_years"] = nullptr;
+}
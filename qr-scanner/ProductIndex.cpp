@@ -0,0 +1,171 @@
+#include "ProductIndex.h"
+#include "BarcodeParse.h"
+#include "FlashWear.h"
+#include <algorithm>
+
+namespace {
+struct IndexLock {
+  SemaphoreHandle_t m;
+  explicit IndexLock(SemaphoreHandle_t mtx) : m(mtx) { if (m) xSemaphoreTake(m, portMAX_DELAY); }
+  ~IndexLock(){ if (m) xSemaphoreGive(m); }
+};
+}
+
+static uint64_t fnv1a64(const char* p, size_t n){
+  uint64_t h = 1469598103934665603ULL;
+  while (n--) { h ^= (uint8_t)*p++; h *= 1099511628211ULL; }
+  return h;
+}
+
+uint64_t ProductIndex::keyOf(const char* code, size_t len){
+  BarcodeParse::Result r;
+  BarcodeParse::parse(code, len, r);
+  const char* p = r.data; size_t n = r.len;
+  if (const BarcodeParse::Field* g = r.find("gtin")) { p = g->value; n = g->len; }
+  if (r.sym != BarcodeParse::Symbology::Other && r.sym != BarcodeParse::Symbology::GS1) {
+    char gtin[14]; memset(gtin, '0', sizeof(gtin));          // EAN/UPC -> GTIN-14 (nol di kiri)
+    memcpy(gtin + sizeof(gtin) - n, p, n);
+    return fnv1a64(gtin, sizeof(gtin));
+  }
+  return fnv1a64(p, n);
+}
+
+bool ProductIndex::begin(const char* path){
+  _path = path;
+  if (!_mtx) _mtx = xSemaphoreCreateMutex();
+  LittleFS.remove(_path + ".tmp"); // sisa upload yang terputus
+  IndexLock lk(_mtx);
+  return openIndex();
+}
+
+// buka file & bangun fence; dipanggil di bawah lock
+bool ProductIndex::openIndex(){
+  if (_f) _f.close();
+  _count = 0; _fence.clear();
+  if (!LittleFS.exists(_path)) return false;
+  _f = LittleFS.open(_path, "r");
+  if (!_f) return false;
+  uint8_t h[HEADER_BYTES];
+  uint32_t count = 0, stride = 0;
+  if (_f.read(h, sizeof(h)) != sizeof(h) || memcmp(h, "PIX1", 4) != 0) { _f.close(); return false; }
+  memcpy(&count, h + 4, 4); memcpy(&stride, h + 8, 4);
+  if (stride != sizeof(Rec) || _f.size() != HEADER_BYTES + (size_t)count * sizeof(Rec)) {
+    Serial.println(F("[PIDX] Index file invalid, ignored")); _f.close(); return false;
+  }
+  _count = count;
+  _fence.reserve((_count + FENCE_STRIDE - 1) / FENCE_STRIDE);
+  Rec r;
+  for (size_t i = 0; i < _count; i += FENCE_STRIDE) { if (!readRec(i, r)) break; _fence.push_back(r.key); }
+  Serial.printf("[PIDX] %u products\n", (unsigned)_count);
+  return true;
+}
+
+bool ProductIndex::readRec(size_t i, Rec& r){
+  return _f.seek(HEADER_BYTES + i * sizeof(Rec)) && _f.read((uint8_t*)&r, sizeof(r)) == sizeof(r);
+}
+
+bool ProductIndex::lookup(const char* code, size_t len, uint32_t& sku){
+  const uint64_t key = keyOf(code, len);
+  const uint32_t t0 = micros();
+  bool found = false;
+  {
+    IndexLock lk(_mtx);
+    if (_count) {
+      // blok terakhir dengan fence <= key
+      size_t blk = std::upper_bound(_fence.begin(), _fence.end(), key) - _fence.begin();
+      if (blk) {
+        size_t lo = (blk - 1) * FENCE_STRIDE, hi = min(lo + FENCE_STRIDE, _count);
+        Rec r;
+        while (lo < hi) {
+          const size_t mid = (lo + hi) / 2;
+          if (!readRec(mid, r)) break;
+          if (r.key == key) { sku = r.sku; found = true; break; }
+          if (r.key < key) lo = mid + 1; else hi = mid;
+        }
+      }
+    }
+  }
+  const uint32_t dt = micros() - t0;
+  _stats.lookups++; _stats.totalUs += dt;
+  if (dt > _stats.maxUs) _stats.maxUs = dt;
+  if (found) _stats.hits++;
+  return found;
+}
+
+// ---- upload ----
+void ProductIndex::uploadReset(){
+  if (_up) free(_up);
+  _up = nullptr; _upCap = _upLen = _upBad = 0;
+  _lineLen = 0; _lineOver = false; _upFailed = false; _upErr = nullptr;
+}
+
+bool ProductIndex::uploadChunk(const uint8_t* data, size_t len, size_t index, size_t total){
+  if (index == 0) {
+    uploadReset();
+    // baris terpendek "a,1\n" = 4 byte -> batas atas jumlah entri
+    _upCap = min(MAX_ENTRIES, total / 4 + 1);
+    const size_t bytes = _upCap * sizeof(Rec);
+    _up = (Rec*)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+    if (!_up) { _upFailed = true; _upErr = "memori tidak cukup"; }
+  }
+  if (_upFailed) return false;
+  for (size_t i = 0; i < len; i++) {
+    const char c = (char)data[i];
+    if (c == '\n' || c == '\r') { uploadLine(); continue; }
+    if (_lineLen < sizeof(_line) - 1) _line[_lineLen++] = c; else _lineOver = true;
+  }
+  if (index + len >= total) uploadLine(); // baris terakhir tanpa newline
+  return !_upFailed;
+}
+
+void ProductIndex::uploadLine(){
+  if (!_lineLen) { _lineOver = false; return; }
+  _line[_lineLen] = '\0';
+  const bool over = _lineOver;
+  _lineLen = 0; _lineOver = false;
+  char* sep = strpbrk(_line, ",;\t");
+  if (over || !sep || sep == _line) { _upBad++; return; }
+  char* end = nullptr;
+  const unsigned long sku = strtoul(sep + 1, &end, 10);
+  if (end == sep + 1) { if (_upLen || _upBad) _upBad++; return; } // baris header "kode,sku" dilewati
+  size_t kl = sep - _line;
+  while (kl && _line[kl - 1] == ' ') kl--;
+  if (!kl) { _upBad++; return; }
+  if (_upLen >= _upCap) { _upFailed = true; _upErr = "entri terlalu banyak"; return; }
+  _up[_upLen++] = { keyOf(_line, kl), (uint32_t)sku };
+}
+
+bool ProductIndex::uploadFinish(String& err, size_t& entries, size_t& badLines, size_t& duplicates){
+  entries = badLines = duplicates = 0;
+  if (!_up || _upFailed || !_upLen) { err = _upErr ? _upErr : "tidak ada entri"; uploadReset(); return false; }
+  std::sort(_up, _up + _upLen, [](const Rec& a, const Rec& b){ return a.key < b.key; });
+  size_t w = 0; // buang key kembar (entri pertama setelah sort dipertahankan)
+  for (size_t i = 0; i < _upLen; i++) {
+    if (w && _up[w - 1].key == _up[i].key) { duplicates++; continue; }
+    _up[w++] = _up[i];
+  }
+  const String tmp = _path + ".tmp";
+  File f = LittleFS.open(tmp, "w");
+  bool ok = (bool)f;
+  if (ok) {
+    uint8_t h[HEADER_BYTES] = { 'P', 'I', 'X', '1' };
+    const uint32_t count = w, stride = sizeof(Rec);
+    memcpy(h + 4, &count, 4); memcpy(h + 8, &stride, 4);
+    ok = f.write(h, sizeof(h)) == sizeof(h) && f.write((const uint8_t*)_up, w * sizeof(Rec)) == w * sizeof(Rec);
+    f.close();
+    FlashWear::add(FlashWear::Products, sizeof(h) + w * sizeof(Rec), 1);
+  }
+  if (!ok) { LittleFS.remove(tmp); err = "gagal menulis (flash penuh?)"; uploadReset(); return false; }
+
+  {
+    // rename LittleFS atomik: pembaca melihat index lama atau baru, tidak pernah setengah
+    IndexLock lk(_mtx);
+    if (_f) _f.close();
+    ok = LittleFS.rename(tmp, _path);
+    openIndex();
+  }
+  entries = w; badLines = _upBad;
+  uploadReset();
+  if (!ok) err = "rename gagal";
+  return ok;
+}
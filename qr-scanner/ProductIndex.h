@@ -0,0 +1,52 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <vector>
+
+// Tabel produk (kode -> SKU id) di LittleFS, dicari tanpa memuat file ke RAM:
+//   header 16 byte : "PIX1" | count u32 | stride u32 (= 12) | reserved u32
+//   record 12 byte : key u64 | sku u32, urut naik by key
+// key = FNV-1a 64 dari kode ternormalisasi (EAN-8/UPC-A/EAN-13 & GS1 AI 01 -> GTIN-14),
+// jadi EAN-13 dan GTIN-14 barang yang sama menemukan SKU yang sama.
+// Key tiap FENCE_STRIDE record ditahan di RAM; lookup = binary search fence + ~7 read di file.
+class ProductIndex {
+public:
+  static const size_t FENCE_STRIDE = 128;
+  static const size_t MAX_ENTRIES  = 65536;
+
+  struct Stats { uint32_t lookups = 0, hits = 0, totalUs = 0, maxUs = 0; };
+
+  bool begin(const char* path = "/products.idx");
+  bool lookup(const char* code, size_t len, uint32_t& sku);
+  size_t count() const { return _count; }
+  const Stats& stats() const { return _stats; }
+
+  // Upload CSV "kode,sku" per baris (urutan bebas, header opsional), potongan demi potongan.
+  // Entri dikumpulkan di RAM (PSRAM bila ada) 12 byte/entri, tanpa menampung teks CSV.
+  bool uploadChunk(const uint8_t* data, size_t len, size_t index, size_t total);
+  // urutkan, tulis <path>.tmp lalu rename atomik menggantikan index lama; false -> lihat err
+  bool uploadFinish(String& err, size_t& entries, size_t& badLines, size_t& duplicates);
+
+  static uint64_t keyOf(const char* code, size_t len);
+
+private:
+  struct __attribute__((packed)) Rec { uint64_t key; uint32_t sku; };
+  static const size_t HEADER_BYTES = 16;
+
+  String _path;
+  SemaphoreHandle_t _mtx = nullptr; // lookup (loop) vs swap file (job upload)
+  File _f;
+  size_t _count = 0;
+  std::vector<uint64_t> _fence;
+  Stats _stats;
+
+  // sesi upload (task async_tcp / loop Ethernet; diselesaikan lewat job di loop)
+  Rec* _up = nullptr; size_t _upCap = 0, _upLen = 0, _upBad = 0;
+  char _line[96]; uint8_t _lineLen = 0; bool _lineOver = false;
+  bool _upFailed = false; const char* _upErr = nullptr;
+
+  bool openIndex();
+  bool readRec(size_t i, Rec& r);
+  void uploadLine();
+  void uploadReset();
+};
@@ -2,13 +2,100 @@
 #include <Arduino.h>
 #include <Wire.h>
 #include <RTClib.h>
+#include <functional>
+
+// Disiplin jam: esp_timer (us) dikunci ke detik RTC. Murni aritmetika (tanpa I/O).
+//   edge(us, sec): tepi detik RTC terjadi pada timer us -> fase di-snap ke sec, dan laju
+//   esp_timer relatif RTC (ppb, EWMA 1/8) diperbarui dari jarak antar tepi.
+//   at(us): epoch us = fase terakhir + selisih timer dikoreksi laju.
+class ClockDiscipline {
+public:
+  void anchor(int64_t us, uint64_t epochUs);   // set fase langsung (RTC dibaca tanpa SQW / NTP)
+  void edge(int64_t us, uint64_t epochSec);
+  uint64_t at(int64_t us) const;
+  bool valid() const { return _valid; }
+  int32_t ppb() const { return _ppb; }         // + = esp_timer lebih cepat dari RTC
+  int64_t lastErrUs() const { return _lastErrUs; } // prediksi - RTC pada tepi terakhir
+  uint64_t edgeSec() const { return _edgeSec; }    // detik RTC tepi terakhir (0 = belum ada)
+private:
+  bool _valid = false;
+  int64_t _baseUs = 0, _edgeUs = 0;
+  uint64_t _baseEpochUs = 0, _edgeSec = 0;
+  int32_t _ppb = 0;
+  int64_t _lastErrUs = 0;
+};
 
 class RTCClockDS3231 {
 public:
-  bool begin(int sda=5, int scl=6);
+  static const int32_t DEFAULT_TZ_S = 7 * 3600; // RTC berisi waktu lokal, default WIB (UTC+7)
+  static const int32_t MAX_PPB = 100000;         // batas koreksi laju (100 ppm)
+  static const int32_t SLEW_PPM = 500;           // koreksi offset kecil dilewatkan 0.5 ms per detik
+
+  struct ClockStats { uint32_t edges = 0, rtcReads = 0, steps = 0, rtcWrites = 0; int32_t ppb = 0; int32_t lastErrUs = 0, maxErrUs = 0; bool sqw = false; };
+
+  bool begin(int sda=5, int scl=6, int sqwPin=-1); // sqwPin: input SQW DS3231 (open drain, pull-up internal)
   bool isValid(); // false jika lost power atau tanggal out of range
-  void nowLocal(String& tanggal, String& waktu); // WIB (UTC+7)
-  bool syncFromNTPAndSetRTC(uint32_t timeoutMs=7000); // opsional (butuh internet)
+  // epoch ms (UTC), resolusi ms, monoton naik; tanpa I2C. 0 jika RTC belum pernah terbaca valid.
+  uint64_t nowMs();
+  void loopClock();          // tepi SQW / resync berkala, panggil tiap loop()
+  const ClockStats& clockStats() const { return _cs; }
+  void nowLocal(String& tanggal, String& waktu); // waktu lokal (tzOffsetS), dari nowMs()
+  // format saat serialisasi: tanggal "YYYY-MM-DD" (11 byte), waktu "HH:mm:ss" (9 byte) waktu lokal
+  static void formatLocal(uint64_t epochMs, char* tanggal, char* waktu);
+  static uint64_t parseLocal(const char* tanggal, const char* waktu); // 0 jika format salah
+
+  // zona waktu lokal (detik dari UTC), dipakai RTC & format tanggal/waktu
+  static int32_t tzOffsetS() { return _tzS; }
+  static void initTz(int32_t s) { _tzS = s; } // sebelum begin(): RTC sudah berisi waktu lokal zona ini
+  void setTzOffsetS(int32_t s);                // runtime: RTC ditulis ulang dalam zona baru
+
+  // Koreksi perangkat lunak atas RTC (disetel TimeSync dari SNTP):
+  //   error RTC(raw) = errUs + (raw - refRawUs) * ppb / 1e9  (+ = RTC lebih cepat)
+  //   nowMs() = raw - error; slew = true melewatkan perubahan bertahap (SLEW_PPM), tanpa lompat
+  void setCorrection(int64_t errUs, uint64_t refRawUs, int32_t ppb, bool slew);
+  uint64_t rawUs();                           // epoch us versi RTC tanpa koreksi (0 = belum valid)
+  int64_t correctionUs();                     // error RTC + sisa slew saat ini
+  int32_t correctionPpb() const { return _corrPpb; }
+  int64_t correctionErrUs() const { return _corrErrUs; }
+  uint64_t correctionRefUs() const { return _corrRefUs; }
+  // tulis RTC = epochMs (UTC) tepat setelah batas detik, dikerjakan loopClock() (maks ~5 s)
+  void writeRtc(uint64_t epochMs);
+  bool rtcWritePending() const { return _wrPending; }
+  // raw bisa dipakai sebagai referensi: fase terkunci ke tepi SQW (sebelumnya +-0.5 s dari baca I2C),
+  // tidak ada tulis RTC tertunda. SQW yang tidak pernah berdenyut tidak menahan lebih dari 5 s.
+  bool phaseLocked() const { return !_wrPending && (!_clk.valid() || !_cs.sqw || _clk.edgeSec() || millis() - _lastRead > 5000); }
+  // dipanggil (dari loopClock) bila raw melompat: RTC ditulis, atau fase dikoreksi > 1 s;
+  // jumpUs = raw lama - raw baru. Koreksi sudah ikut digeser, waktu terkoreksi tetap kontinu.
+  void onRawStep(std::function<void(int64_t jumpUs)> cb) { _stepCb = cb; }
 private:
+  static int32_t _tzS;
   RTC_DS3231 _rtc;
-};
\ No newline at end of file
+
+  ClockDiscipline _clk;
+  portMUX_TYPE _mux = portMUX_INITIALIZER_UNLOCKED;
+  int _sqwPin = -1;
+  volatile int64_t _sqwUs = 0;      // ditulis ISR
+  volatile uint32_t _sqwEdges = 0;
+  uint32_t _seenEdges = 0, _lastRead = 0;
+  bool _needRead = true;            // baca detik RTC di tepi berikutnya
+  uint64_t _lastMs = 0;
+  ClockStats _cs;
+
+  int64_t _corrErrUs = 0, _slewUs = 0;      // dilindungi _mux
+  uint64_t _corrRefUs = 0, _slewAtUs = 0;
+  int32_t _corrPpb = 0;
+  bool _wrPending = false;
+  int64_t _wrBaseUs = 0;                    // esp_timer saat writeRtc()
+  uint64_t _wrEpochUs = 0;
+  std::function<void(int64_t)> _stepCb;
+
+  static void sqwIsr(void* arg);
+  void startClock(int sqwPin);
+  bool readRtcSec(uint64_t& epochSec);
+  // di dalam _mux
+  int64_t modelAt(uint64_t raw) const;
+  int64_t slewLeft(uint64_t raw) const;
+  int64_t correctionAt(uint64_t raw) const { return modelAt(raw) + slewLeft(raw); }
+  int64_t rawStep(int64_t us, uint64_t newRaw); // anchor ulang + geser koreksi; return lompatan
+  bool loopWrite();
+};
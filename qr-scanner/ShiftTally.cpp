@@ -0,0 +1,265 @@
+#include "ShiftTally.h"
+#include "RTCClockDS3231.h"
+#include "FlashWear.h"
+#include <algorithm>
+
+namespace {
+struct TallyLock {
+  SemaphoreHandle_t m;
+  explicit TallyLock(SemaphoreHandle_t mtx) : m(mtx) { if (m) xSemaphoreTake(m, portMAX_DELAY); }
+  ~TallyLock(){ if (m) xSemaphoreGive(m); }
+};
+
+// header snapshot 32 byte: "TLY1" | used u16 | shift u8 | pad | total u32 | overflow u32 | date[12] | sum u32
+struct __attribute__((packed)) SnapHeader {
+  char magic[4]; uint16_t used; uint8_t index, pad; uint32_t total, overflow; char date[12]; uint32_t sum;
+};
+}
+
+static uint64_t fnv1a64(const char* p, size_t n){
+  uint64_t h = 1469598103934665603ULL;
+  while (n--) { h ^= (uint8_t)*p++; h *= 1099511628211ULL; }
+  return h;
+}
+
+static uint32_t fnv1a32(const uint8_t* p, size_t n, uint32_t h = 2166136261UL){
+  while (n--) { h ^= *p++; h *= 16777619UL; }
+  return h;
+}
+
+// jumlah hari sejak 1970-01-01 -> tanggal (kalender Gregorian proleptik)
+static void civilFromDays(int32_t z, int& y, unsigned& m, unsigned& d){
+  z += 719468;
+  const int era = (z >= 0 ? z : z - 146096) / 146097;
+  const unsigned doe = (unsigned)(z - era * 146097);
+  const unsigned yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+  const unsigned doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+  const unsigned mp = (5 * doy + 2) / 153;
+  d = doy - (153 * mp + 2) / 5 + 1;
+  m = mp < 10 ? mp + 3 : mp - 9;
+  y = (int)yoe + era * 400 + (m <= 2);
+}
+
+bool ShiftTally::begin(const char* path){
+  _path = path;
+  if (!_mtx) _mtx = xSemaphoreCreateMutex();
+  if (!_tab) {
+    const size_t bytes = sizeof(Entry) * CAPACITY;
+    _tab = (Entry*)(psramFound() ? ps_malloc(bytes) : malloc(bytes));
+    if (!_tab) return false;
+  }
+  if (!_nStarts) setSchedule("06:00,14:00,22:00");
+  TallyLock lk(_mtx);
+  clear();
+  _closedPending = LittleFS.exists(_path + ".closed.json");
+  return load();
+}
+
+bool ShiftTally::parseSchedule(const String& csv, uint16_t* starts, uint8_t& n){
+  n = 0;
+  int from = 0;
+  while (from < (int)csv.length()) {
+    int comma = csv.indexOf(',', from); if (comma < 0) comma = csv.length();
+    String t = csv.substring(from, comma); t.trim();
+    from = comma + 1;
+    if (t.isEmpty()) continue;
+    const int colon = t.indexOf(':');
+    if (colon < 1 || n >= MAX_SHIFTS) return false;
+    const long h = t.substring(0, colon).toInt(), m = t.substring(colon + 1).toInt();
+    if (h < 0 || h > 23 || m < 0 || m > 59) return false;
+    starts[n++] = (uint16_t)(h * 60 + m);
+  }
+  if (!n) return false;
+  // insertion sort (n <= MAX_SHIFTS); jam ganda ditolak
+  for (uint8_t i = 1; i < n; i++) {
+    const uint16_t v = starts[i]; uint8_t j = i;
+    for (; j && starts[j - 1] > v; j--) starts[j] = starts[j - 1];
+    starts[j] = v;
+  }
+  for (uint8_t i = 1; i < n; i++) if (starts[i] == starts[i - 1]) return false;
+  return true;
+}
+
+bool ShiftTally::validSchedule(const String& csv){
+  uint16_t starts[MAX_SHIFTS]; uint8_t n;
+  return parseSchedule(csv, starts, n);
+}
+
+bool ShiftTally::setSchedule(const String& csv){
+  uint16_t starts[MAX_SHIFTS]; uint8_t n;
+  if (!parseSchedule(csv, starts, n)) return false;
+  TallyLock lk(_mtx);
+  memcpy(_starts, starts, sizeof(starts[0]) * n); _nStarts = n;
+  return true;
+}
+
+String ShiftTally::schedule() const {
+  String s;
+  for (uint8_t i = 0; i < _nStarts; i++) {
+    char b[7]; snprintf(b, sizeof(b), "%s%02u:%02u", i ? "," : "", _starts[i] / 60, _starts[i] % 60);
+    s += b;
+  }
+  return s;
+}
+
+bool ShiftTally::shiftOf(uint64_t epochMs, Shift& s) const {
+  if (epochMs < 1577836800000ULL || !_nStarts) return false; // < 2020: RTC belum valid -> jangan ganti shift
+  const int64_t local = (int64_t)(epochMs / 1000) + RTCClockDS3231::tzOffsetS();
+  int32_t days = (int32_t)(local / 86400);
+  const uint16_t now = (uint16_t)(local % 86400 / 60);
+  int i = _nStarts - 1;
+  while (i >= 0 && _starts[i] > now) i--;
+  if (i < 0) { days--; i = _nStarts - 1; } // sebelum shift pertama -> shift terakhir kemarin
+  int y; unsigned mo, d;
+  civilFromDays(days, y, mo, d);
+  snprintf(s.date, sizeof(s.date), "%04d-%02u-%02u", y, mo, d);
+  s.index = (uint8_t)i;
+  return true;
+}
+
+void ShiftTally::clear(){
+  memset(_tab, 0, sizeof(Entry) * CAPACITY);
+  _used = 0; _total = 0; _overflow = 0;
+}
+
+void ShiftTally::add(const char* code, size_t len, uint64_t epochMs){
+  Shift s;
+  const bool known = shiftOf(epochMs, s);
+  TallyLock lk(_mtx);
+  if (!_tab) return;
+  if (known) rollover(s);
+  _total++; _dirty = true;
+  const uint64_t key = fnv1a64(code, len) | 1; // 0 = slot kosong
+  // linear probing; batasi isi 7/8 kapasitas supaya probe tetap pendek
+  for (uint16_t i = key & (CAPACITY - 1), n = 0; n < CAPACITY; i = (i + 1) & (CAPACITY - 1), n++) {
+    Entry& e = _tab[i];
+    if (e.key == key) { e.count++; return; }
+    if (e.key) continue;
+    if (_used >= CAPACITY - CAPACITY / 8) break;
+    e.key = key; e.count = 1; e.len = (uint8_t)min(len, (size_t)CODE_LEN);
+    memcpy(e.code, code, e.len);
+    _used++;
+    return;
+  }
+  _overflow++;
+}
+
+bool ShiftTally::tick(uint64_t epochMs){
+  Shift s;
+  if (!shiftOf(epochMs, s)) return false;
+  TallyLock lk(_mtx);
+  return rollover(s);
+}
+
+// tutup shift berjalan bila waktu sudah masuk shift lain; ringkasannya disimpan sebelum tabel dikosongkan
+bool ShiftTally::rollover(const Shift& next){
+  if (!_cur.date[0]) { _cur = next; _dirty = true; return false; }  // boot pertama tanpa snapshot
+  if (next.index == _cur.index && strcmp(next.date, _cur.date) == 0) return false;
+  bool closed = false;
+  if (_total) {
+    JsonDocument d;
+    summaryLocked(d.to<JsonObject>(), 0);
+    d["closed"] = true;
+    File f = LittleFS.open(_path + ".closed.json", "w");
+    if (f) { FlashWear::add(FlashWear::Tally, serializeJson(d, f)); f.close(); _closedPending = closed = true; }
+    Serial.printf("[TALLY] Shift %s #%u ditutup: %lu scan, %u kode\n", _cur.date, _cur.index + 1,
+                  (unsigned long)_total, _used);
+  }
+  clear();
+  _cur = next; _dirty = true;
+  writeSnapshot(); // tabel kosong shift baru langsung persisten (snapshot lama = shift yang sudah ditutup)
+  return closed;
+}
+
+bool ShiftTally::snapshot(){
+  TallyLock lk(_mtx);
+  if (!_dirty || !_cur.date[0]) return false;
+  return writeSnapshot();
+}
+
+bool ShiftTally::writeSnapshot(){
+  const String tmp = _path + ".tmp";
+  File f = LittleFS.open(tmp, "w");
+  if (!f) return false;
+  SnapHeader h = {};
+  memcpy(h.magic, "TLY1", 4);
+  h.used = _used; h.index = _cur.index; h.total = _total; h.overflow = _overflow;
+  memcpy(h.date, _cur.date, sizeof(_cur.date));
+  uint32_t sum = 2166136261UL;
+  for (uint16_t i = 0; i < CAPACITY; i++) if (_tab[i].key) sum = fnv1a32((const uint8_t*)&_tab[i], sizeof(Entry), sum);
+  h.sum = sum;
+  bool ok = f.write((const uint8_t*)&h, sizeof(h)) == sizeof(h);
+  for (uint16_t i = 0; ok && i < CAPACITY; i++)
+    if (_tab[i].key) ok = f.write((const uint8_t*)&_tab[i], sizeof(Entry)) == sizeof(Entry);
+  f.close();
+  FlashWear::add(FlashWear::Tally, sizeof(h) + (size_t)_used * sizeof(Entry), 1);
+  if (ok) ok = LittleFS.rename(tmp, _path);
+  if (!ok) { LittleFS.remove(tmp); return false; }
+  _dirty = false; _snapshots++;
+  return true;
+}
+
+bool ShiftTally::load(){
+  File f = LittleFS.open(_path, "r");
+  if (!f) return false;
+  SnapHeader h;
+  bool ok = f.read((uint8_t*)&h, sizeof(h)) == sizeof(h) && memcmp(h.magic, "TLY1", 4) == 0 &&
+            h.used <= CAPACITY && f.size() == sizeof(h) + (size_t)h.used * sizeof(Entry);
+  uint32_t sum = 2166136261UL;
+  for (uint16_t n = 0; ok && n < h.used; n++) {
+    Entry e;
+    if (f.read((uint8_t*)&e, sizeof(e)) != sizeof(e) || !e.key || e.len > CODE_LEN) { ok = false; break; }
+    sum = fnv1a32((const uint8_t*)&e, sizeof(e), sum);
+    uint16_t i = e.key & (CAPACITY - 1);
+    while (_tab[i].key) i = (i + 1) & (CAPACITY - 1);
+    _tab[i] = e;
+  }
+  f.close();
+  if (!ok || sum != h.sum) { Serial.println(F("[TALLY] Snapshot invalid, ignored")); clear(); return false; }
+  _used = h.used; _total = h.total; _overflow = h.overflow;
+  memcpy(_cur.date, h.date, sizeof(_cur.date)); _cur.date[sizeof(_cur.date) - 1] = '\0';
+  _cur.index = h.index;
+  Serial.printf("[TALLY] Restored shift %s #%u: %lu scan\n", _cur.date, _cur.index + 1, (unsigned long)_total);
+  return true;
+}
+
+void ShiftTally::summary(JsonObject o, size_t limit){
+  TallyLock lk(_mtx);
+  summaryLocked(o, limit);
+}
+
+void ShiftTally::summaryLocked(JsonObject o, size_t limit){
+  o["date"] = _cur.date; o["shift"] = _cur.index + 1;
+  if (_cur.index < _nStarts) {
+    char b[6]; snprintf(b, sizeof(b), "%02u:%02u", _starts[_cur.index] / 60, _starts[_cur.index] % 60);
+    o["start"] = b;
+  }
+  o["total"] = _total; o["unique"] = _used; o["overflow"] = _overflow;
+  if (!_tab) return;
+  uint16_t idx[CAPACITY], n = 0;
+  for (uint16_t i = 0; i < CAPACITY; i++) if (_tab[i].key) idx[n++] = i;
+  std::sort(idx, idx + n, [this](uint16_t a, uint16_t b){ return _tab[a].count > _tab[b].count; });
+  if (limit && limit < n) n = limit;
+  JsonArray items = o["items"].to<JsonArray>();
+  for (uint16_t k = 0; k < n; k++) {
+    const Entry& e = _tab[idx[k]];
+    char code[CODE_LEN + 1]; memcpy(code, e.code, e.len); code[e.len] = '\0';
+    JsonObject it = items.add<JsonObject>();
+    it["kode"] = code; it["count"] = e.count;
+    if (_hook) _hook(code, e.len, it);
+  }
+}
+
+String ShiftTally::lastClosed() const {
+  String out;
+  File f = LittleFS.open(_path + (_closedPending ? ".closed.json" : ".last.json"), "r");
+  if (f) { out = f.readString(); f.close(); }
+  return out;
+}
+
+void ShiftTally::markClosedPublished(){
+  TallyLock lk(_mtx);
+  if (!_closedPending) return;
+  LittleFS.rename(_path + ".closed.json", _path + ".last.json");
+  _closedPending = false;
+}
@@ -0,0 +1,71 @@
+#pragma once
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <ArduinoJson.h>
+#include <functional>
+
+// Hitungan per kode_barang untuk shift yang sedang berjalan.
+// Tabel hash open addressing (CAPACITY slot tetap, tanpa alokasi per scan), key = FNV-1a 64
+// dari kode mentah. Jadwal shift = daftar jam mulai lokal ("06:00,14:00,22:00"); scan sebelum
+// jam mulai pertama masuk shift terakhir hari sebelumnya.
+// Snapshot biner ke LittleFS (tmp + rename) supaya hitungan selamat dari reboot. Saat shift
+// berganti, ringkasan shift yang ditutup disimpan ke <path>.closed.json sampai berhasil dipublish.
+class ShiftTally {
+public:
+  static const uint16_t CAPACITY   = 256; // kode unik per shift (power of 2)
+  static const uint8_t  CODE_LEN   = 40;  // kode lebih panjang dipotong untuk tampilan (key tetap penuh)
+  static const uint8_t  MAX_SHIFTS = 6;
+
+  struct Shift { char date[11] = ""; uint8_t index = 0; };   // date = tanggal jam mulai shift
+  // dipanggil untuk tiap item ringkasan (mis. menambah sku dari tabel produk)
+  using ItemHook = std::function<void(const char* code, size_t len, JsonObject item)>;
+
+  bool begin(const char* path = "/tally.bin");
+  // "HH:MM,HH:MM,..." (urutan bebas); false jika kosong / format salah
+  bool setSchedule(const String& csv);
+  static bool validSchedule(const String& csv); // cek saja, jadwal aktif tidak berubah
+  String schedule() const;
+  void setItemHook(ItemHook h) { _hook = h; }
+
+  // tambah satu scan pada epochMs (UTC; shift dihitung di waktu lokal); ganti shift bila perlu
+  void add(const char* code, size_t len, uint64_t epochMs);
+  // cek pergantian shift tanpa scan; true jika ada shift yang baru ditutup
+  bool tick(uint64_t epochMs);
+  // tulis snapshot bila ada perubahan (dipanggil periodik dari loop)
+  bool snapshot();
+
+  // ringkasan shift berjalan: {date, shift, start, total, unique, overflow, items[{kode,count}]}
+  // item urut count turun, maksimal limit (0 = semua)
+  void summary(JsonObject o, size_t limit = 0);
+  // ringkasan shift terakhir yang ditutup (pending publish atau sudah terkirim); "" jika belum ada
+  String lastClosed() const;
+  bool closedPending() const { return _closedPending; }
+  void markClosedPublished(); // ringkasan tertutup sudah terkirim -> pindah ke <path>.last.json
+
+  const Shift& current() const { return _cur; }
+  uint32_t total() const { return _total; }
+  uint16_t unique() const { return _used; }
+  uint32_t overflow() const { return _overflow; }
+  uint32_t snapshots() const { return _snapshots; }
+
+private:
+  struct Entry { uint64_t key; uint32_t count; uint8_t len; char code[CODE_LEN]; };
+
+  String _path;
+  SemaphoreHandle_t _mtx = nullptr; // add/tick/snapshot (loop) vs /api/tally (async_tcp)
+  Entry* _tab = nullptr;
+  uint16_t _used = 0;
+  uint32_t _total = 0, _overflow = 0, _snapshots = 0;
+  bool _dirty = false, _closedPending = false;
+  Shift _cur;
+  uint16_t _starts[MAX_SHIFTS] = {}; uint8_t _nStarts = 0; // menit sejak 00:00, urut naik
+  static bool parseSchedule(const String& csv, uint16_t* starts, uint8_t& n);
+  ItemHook _hook;
+
+  bool shiftOf(uint64_t epochMs, Shift& s) const;
+  bool rollover(const Shift& next);  // di bawah lock
+  void summaryLocked(JsonObject o, size_t limit);
+  void clear();
+  bool load();
+  bool writeSnapshot();
+};
@@ -3,16 +3,49 @@
   Fitur:
     - Wi-Fi prioritas, fallback Ethernet (W5500).
     - Konfigurasi lewat DualNICPortal (Wi-Fi/Ethernet + mDNS).
-    - MQTT publish payload JSON: {ip_address, kode_barang, tanggal, waktu}.
-    - Antrian offline (LittleFS NDJSON); auto-flush saat online.
-    - DS3231 untuk tanggal/waktu (WIB). Fallback NTP jika tersedia.
+    - MQTT publish payload JSON: {ip_address, kode_barang, tanggal, waktu, ts, symbology[, sku, gtin, lot, expiry, serial, gs1{}]}
+      (AI GS1 bernama sebagai field sendiri, AI lain di gs1{<AI>: nilai}; dikirim streaming, tanpa batas
+      buffer PubSubClient).
+    - Tabel produk (kode -> SKU) di LittleFS (ProductIndex), diisi lewat upload CSV dari portal.
+    - Tally per kode per shift (ShiftTally), snapshot ke LittleFS; ringkasan dipublish ke <topic>/tally
+      tiap publish_s detik dan sekali saat shift ditutup. summary_only = hanya ringkasan yang dikirim.
+    - Kode EAN/UPC/GS1 divalidasi di perangkat (BarcodeParse); kode rusak ditolak sebelum publish.
+    - Antrian offline dua tingkat: ring di PSRAM dulu, ditulis ke LittleFS (NDJSON) hanya bila
+      outage > spill_after_s atau ring berisi max_undurable event; auto-flush (RAM dulu) saat online.
+      File hanya di-append; yang terkirim ditandai head (.h0/.h1) lalu di-compact, sehingga padam
+      di titik mana pun tidak menghilangkan antrian (duplikat maks 16 event), pemulihan boot O(1).
+    - Tulis flash LittleFS dihitung per subsistem (FlashWear) -> status.flash: byte, perkiraan byte
+      fisik, byte per item & proyeksi umur flash dari FLASH_RATED_CYCLES.
+    - DS3231 untuk tanggal/waktu (zona waktu diatur, default WIB). TimeSync: SNTP berkala lewat
+      Wi-Fi/Ethernet, estimasi drift RTC, koreksi disimpan di /time.json; RTC ditulis hanya bila
+      error > threshold_ms.
+    - Event dicap epoch ms (ts) dari esp_timer yang dikunci ke RTC (tepi SQW 1 Hz bila RTC_SQW_PIN
+      terpasang), tanpa baca I2C per scan; tanggal/waktu diformat saat publish/export.
+    - Kipas (FanControl) di slot loop(): suhu disampel tiap sample_ms, histeresis on_c/off_c,
+      duty PWM proporsional s/d full_c dengan ramp; suhu & duty di status.fan.
     - Endpoint extra:
-        POST /api/queue/flush  -> {flushed: <n>}
+        POST /api/queue/flush  -> 202 {job}; hasil di GET /api/jobs/<id> -> {flushed: <n>}
+        GET  /api/queue/events?from=&limit= -> {total, from, limit, items[]}
+        GET  /api/queue/export?format=csv   -> seluruh antrian (NDJSON default), streaming
+        POST /api/queue/settings {spill_after_s, max_undurable} -> disimpan
+        POST /api/scanner/settings {window_ms, size, validate} -> dedup & validasi kode (disimpan)
+        POST /api/scanner/config {mode, read_ms, interval_ms, baud} -> job setelan modul GM66 (field yang
+             tidak dikirim tidak diubah; read_ms 0 | 100..25500, interval_ms 0..25500, selain itu 400)
+        POST /api/products (CSV "kode,sku")  -> 202 {job}; ganti tabel produk secara atomik
+        GET  /api/products/lookup?code=     -> {found, sku, us}
+        GET  /api/tally?limit=50 | ?shift=last -> ringkasan shift berjalan / terakhir ditutup
+        POST /api/tally/settings {shifts:"06:00,14:00,22:00", publish_s, snapshot_s, summary_only}
+        POST /api/time {server, interval_min, threshold_ms, max_delay_ms, tz_min, sync} -> disimpan
+        POST /api/fan {on_c, off_c, full_c, min_duty, sample_ms, ramp_per_s} -> disimpan
     - Status UI menampilkan jumlah item & size antrian.
   Catatan:
     - Ubah pin sesuai wiring Anda di bagian "=== KONFIGURASI PIN ===".
     - Pastikan board: Seeed XIAO ESP32S3, core ESP32 >= 2.0.14.
     - Library: ESPAsyncWebServer, Ethernet, PubSubClient, ArduinoJson, RTClib.
+    - Test & benchmark di host (shim Arduino, LittleFS = direktori): test/ (CMake), mis.
+      cmake -S test -B build && cmake --build build && ctest --test-dir build; ./build/bench_queue_qr
+    - Simulator lini (setup()/loop() sketch ini, millis() virtual, aliran byte GM66, link Wi-Fi/Ethernet
+      putus-sambung, broker mati): ./build/sim_line_qr [skenario] -> item hilang/duplikat/terlambat & antrian.
 */
 
 #include <Arduino.h>
@@ -23,19 +56,29 @@
 #include <ArduinoJson.h>
 #include <LittleFS.h>
 #include <time.h>
+#include <memory>
 #include <SmoothThermistor.h>
 
 #include "DualNICPortal.h"
 #include "BarcodeScannerGM66.h"
+#include "BarcodeParse.h"
 #include "OfflineQueue.h"
+#include "ProductIndex.h"
+#include "ShiftTally.h"
 #include "RTCClockDS3231.h"
+#include "TimeSync.h"
+#include "FanControl.h"
+#include "FlashWear.h"
 
 // ====================== KONFIGURASI PIN ======================
 // SESUAIKAN dengan wiring Anda! Nilai di bawah hanyalah contoh.
 static constexpr int PIN_GM66_RX   = 44;   // RX dari ESP32S3 (terhubung ke TX GM66)
 static constexpr int PIN_GM66_TX   = 43;   // TX dari ESP32S3 (terhubung ke RX GM66)
+static constexpr uint32_t GM66_BAUD = 115200;
 static constexpr int PIN_GM66_TRIG = -1;  // set ke pin digital jika modul GM66 memakai pin trigger (aktif LOW)
 static const size_t QUEUE_MAX_BYTES = 512 * 1024;
+static const size_t QUEUE_RAM_EVENTS = 2048;  // kapasitas ring antrian di PSRAM
+static const uint32_t FLASH_RATED_CYCLES = 100000; // siklus erase rated flash modul (proyeksi umur)
 
 // SPI untuk W5500 — sesuaikan dengan papan Anda
 #define W5500_CS     4
@@ -46,6 +89,7 @@ static const size_t QUEUE_MAX_BYTES = 512 * 1024;
 
 #define I2C_SDA 5
 #define I2C_SCL 6
+#define RTC_SQW_PIN -1   // pin SQW DS3231 (1 Hz) jika disambung; -1 = tanpa SQW (resync kasar tiap menit)
 
 #define TEMP_PIN 1
 #define FAN_PIN 2
@@ -58,7 +102,6 @@ static const char* MDNS_HOST = "barcode";
 static const char* QUEUE_FILE = "/scan_queue.ndjson";
 
 uint32_t lastLEDBlink = 0;
-float temp;
 bool ledBlinkState = false;
 
 SmoothThermistor smoothThermistor(TEMP_PIN,              // the analog pin to read from
@@ -67,7 +110,7 @@ SmoothThermistor smoothThermistor(TEMP_PIN,              // the analog pin to re
                                   10000,           // the series resistance
                                   3950,            // the beta coefficient of the thermistor
                                   25,              // the temperature for nominal resistance
-                                  10);             // the number of samples to take for each measurement
+                                  1);              // satu analogRead per sampel; penghalusan di FanControl
 
 
 // ====================== OBJEK GLOBAL =========================
@@ -76,23 +119,44 @@ WiFiClient     wifiClient;
 EthernetClient ethClient;
 PubSubClient   mqtt;
 BarcodeScannerGM66 scanner;
+bool validateCodes = true;   // tolak EAN/UPC/GS1 yang cek digit / struktur AI-nya salah
+uint32_t scanRejected = 0;
+uint32_t publishDeadLetters = 0; // event yang payload-nya tidak akan pernah muat -> dibuang dari antrian
 OfflineQueue   queue;
+ProductIndex   products;
+ShiftTally     tally;
+uint32_t tallyPublishS = 300, tallySnapshotS = 60; // 0 = ringkasan periodik mati
+bool tallySummaryOnly = false;                      // true: scan tidak dipublish satu per satu
 RTCClockDS3231 rtc;
-
-String activeIP(){
-  if (WiFi.status() == WL_CONNECTED) return WiFi.localIP().toString();
-  else if (Ethernet.linkStatus() == LinkON) return Ethernet.localIP().toString();
-  else return String("0.0.0.0");
+TimeSync       timeSync;
+FanControl     fan;
+
+// ---- Boot paralel: jaringan, NTP & MQTT berjalan di background, capture langsung hidup ----
+// Semua dalam ms sejak reset (0 = belum terjadi); diekspos di /api/status -> boot
+struct BootTimes { uint32_t captureReady=0, firstCapture=0, wifi=0, eth=0, ntp=0, mqtt=0; } bootT;
+// PubSubClient dipakai loop() (publish/flush) dan mqttTask (connect) -> wajib lewat mutex ini
+SemaphoreHandle_t mqttMutex = nullptr;
+
+// dipanggil per event -> format ke buffer tetap (tanpa String/heap)
+FixedString<15> activeIP(){
+  IPAddress ip(0, 0, 0, 0);
+  if (WiFi.status() == WL_CONNECTED) ip = WiFi.localIP();
+  else if (Ethernet.linkStatus() == LinkON) ip = Ethernet.localIP();
+  FixedString<15> s; s.appendf("%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
+  return s;
 }
 
 static bool ensureMqttConnected() {
   // Pilih transport (Wi-Fi lebih dulu, jika tidak ada pakai Ethernet)
   if (!portal.selectClient(mqtt, wifiClient, ethClient)) return false;
 
-  // Set server dari konfigurasi
-  const AppConfig& cfg = portal.config();
+  // Set server dari konfigurasi (salinan snapshot: connect bisa lama, dan
+  // PubSubClient menyimpan pointer host, jadi string-nya harus tetap hidup)
+  const AppConfig cfg = portal.config();
   if (cfg.mqtt_host.isEmpty() || cfg.mqtt_port == 0) return false;
-  mqtt.setServer(cfg.mqtt_host.c_str(), cfg.mqtt_port);
+  static String mqttHost;
+  mqttHost = cfg.mqtt_host;
+  mqtt.setServer(mqttHost.c_str(), cfg.mqtt_port);
 
   Serial.print("Menghubungkan ke MQTT ");
   Serial.print(cfg.mqtt_host);
@@ -114,16 +178,80 @@ static bool ensureMqttConnected() {
 }
 
 
+// field hasil parse menunjuk ke dalam kode; salin ke buffer (char* -> disalin ArduinoJson)
+static void putField(JsonObject o, const char* key, const BarcodeParse::Field& f){
+  char v[BarcodeParse::MAX_FIELD_LEN + 1];
+  memcpy(v, f.value, f.len); v[f.len] = '\0';
+  o[key] = v;
+}
+
+// kode 200 char yang seluruhnya escape \u00XX (6x) + field tetap; GS1 valid tanpa karakter kontrol
+static const size_t EVENT_JSON_MAX = 1536;
+
+// true = event selesai (terkirim, atau dibuang karena tidak akan pernah muat); false = broker belum siap
 bool publishEvent(const ScanEvent& e){
   const AppConfig& cfg = portal.config();
   JsonDocument d;
-  d["ip_address"]  = e.ip_address;
-  d["kode_barang"] = e.kode_barang;
-  d["tanggal"]     = e.tanggal;
-  d["waktu"]       = e.waktu;
-  String buf; 
-  serializeJson(d, buf);
-  return mqtt.publish(cfg.mqtt_topic.c_str(), buf.c_str(), true);
+  d["ip_address"]  = e.ip_address.c_str();
+  d["kode_barang"] = e.kode_barang.c_str();
+  char tgl[11], jam[9]; RTCClockDS3231::formatLocal(e.ts, tgl, jam);
+  d["tanggal"]     = tgl;
+  d["waktu"]       = jam;
+  d["ts"]          = e.ts;
+  // struktur GS1 diurai ulang dari kode mentah (antrian offline cukup menyimpan kode)
+  BarcodeParse::Result pr;
+  BarcodeParse::parse(e.kode_barang.c_str(), e.kode_barang.length(), pr);
+  d["symbology"] = BarcodeParse::symbologyName(pr.sym);
+  uint32_t sku;
+  if (products.lookup(e.kode_barang.c_str(), e.kode_barang.length(), sku)) d["sku"] = sku;
+  if (pr.sym == BarcodeParse::Symbology::GS1 && pr.valid()) {
+    // tiap AI sekali: bernama di root, sisanya di gs1{}
+    JsonObject root = d.as<JsonObject>(), g;
+    for (uint8_t i = 0; i < pr.nFields; i++) {
+      const BarcodeParse::Field& f = pr.fields[i];
+      if (f.def->name) { putField(root, f.def->name, f); continue; }
+      if (g.isNull()) g = d["gs1"].to<JsonObject>();
+      char ai[5]; memcpy(ai, f.ai, f.aiLen); ai[f.aiLen] = '\0';
+      putField(g, ai, f);
+    }
+  }
+  static char buf[EVENT_JSON_MAX]; // hanya dari loop() dengan mqttMutex dipegang
+  const size_t n = serializeJson(d, buf, sizeof(buf));
+  if (n >= sizeof(buf) - 1) {
+    // diulang pun tetap tidak muat: jangan tahan head antrian selamanya
+    publishDeadLetters++;
+    Serial.printf("[MQTT] Payload %s melebihi %u byte, event dibuang\n", e.kode_barang.c_str(), (unsigned)sizeof(buf));
+    return true;
+  }
+  // streaming: payload GS1 + topic bisa > buffer PubSubClient (256 B)
+  if (!mqtt.beginPublish(cfg.mqtt_topic.c_str(), n, true)) return false;
+  mqtt.write((const uint8_t*)buf, n);
+  return mqtt.endPublish();
+}
+
+// ringkasan tally bisa > buffer PubSubClient (256 B) -> kirim streaming
+static bool publishLarge(const String& topic, const String& payload, bool retained){
+  if (!mqtt.beginPublish(topic.c_str(), payload.length(), retained)) return false;
+  mqtt.write((const uint8_t*)payload.c_str(), payload.length());
+  return mqtt.endPublish();
+}
+
+// dipanggil di loop() saat mutex MQTT dipegang & terhubung
+static void publishTally(){
+  static uint32_t lastPublish = 0;
+  const String topic = portal.config().mqtt_topic + "/tally";
+  if (tally.closedPending()) {
+    const String closed = tally.lastClosed();
+    if (closed.isEmpty() || publishLarge(topic, closed, false)) tally.markClosedPublished();
+  }
+  if (!tallyPublishS || millis() - lastPublish < tallyPublishS * 1000UL) return;
+  lastPublish = millis();
+  JsonDocument d;
+  d["ip_address"] = activeIP().c_str();
+  tally.summary(d["tally"].to<JsonObject>());
+  d["closed"] = false;
+  String out; serializeJson(d, out);
+  publishLarge(topic, out, true);
 }
 
 static size_t flushQueueLimited(size_t maxItems = 200) {
@@ -132,6 +260,137 @@ static size_t flushQueueLimited(size_t maxItems = 200) {
   }, maxItems);
 }
 
+// Publish langsung bila MQTT siap & tidak sedang dipakai mqttTask; selain itu masuk antrian
+static bool publishOrEnqueue(const ScanEvent& ev){
+  FlashWear::addItems(1);
+  bool sent = false;
+  if (xSemaphoreTake(mqttMutex, 0) == pdTRUE) {
+    if (mqtt.connected()) sent = publishEvent(ev);
+    xSemaphoreGive(mqttMutex);
+  }
+  if (!sent && !queue.enqueue(ev)) Serial.println("[QUEUE] event dibuang: baris > LINE_MAX / flash penuh");
+  return sent;
+}
+
+// Connect MQTT di task terpisah: PubSubClient::connect bisa blocking beberapa detik
+static void mqttTask(void*){
+  for (;;) {
+    if (!portal.booting() && xSemaphoreTake(mqttMutex, portMAX_DELAY) == pdTRUE) {
+      if (!mqtt.connected() && ensureMqttConnected() && !bootT.mqtt) bootT.mqtt = millis();
+      xSemaphoreGive(mqttMutex);
+    }
+    vTaskDelay(pdMS_TO_TICKS(3000));
+  }
+}
+
+// Setelan dedup scanner (/scanner.json); default 600 ms untuk 8 kode terakhir
+static const char* SCANNER_CFG = "/scanner.json";
+static void loadScannerCfg(){
+  uint32_t win = 600; uint8_t size = 8;
+  File f = LittleFS.open(SCANNER_CFG, "r");
+  if (f) {
+    JsonDocument d;
+    if (!deserializeJson(d, f)) { win = d["window_ms"] | win; size = d["size"] | size; validateCodes = d["validate"] | true; }
+    f.close();
+  }
+  scanner.setDedup(win, size);
+}
+
+static void saveScannerCfg(){
+  JsonDocument d; d["window_ms"] = scanner.dedupWindowMs(); d["size"] = scanner.dedupSize(); d["validate"] = validateCodes;
+  File f = LittleFS.open(SCANNER_CFG, "w");
+  if (!f) return;
+  FlashWear::add(FlashWear::Config, serializeJson(d, f)); f.close();
+}
+
+// Setelan tally (/tally.json)
+static const char* TALLY_CFG = "/tally.json";
+static void loadTallyCfg(){
+  File f = LittleFS.open(TALLY_CFG, "r");
+  if (!f) return;
+  JsonDocument d;
+  if (!deserializeJson(d, f)) {
+    if (d["shifts"].is<const char*>()) tally.setSchedule(d["shifts"].as<String>());
+    tallyPublishS = d["publish_s"] | tallyPublishS; tallySnapshotS = d["snapshot_s"] | tallySnapshotS;
+    tallySummaryOnly = d["summary_only"] | false;
+  }
+  f.close();
+}
+
+static void saveTallyCfg(){
+  JsonDocument d;
+  d["shifts"] = tally.schedule(); d["publish_s"] = tallyPublishS; d["snapshot_s"] = tallySnapshotS;
+  d["summary_only"] = tallySummaryOnly;
+  File f = LittleFS.open(TALLY_CFG, "w");
+  if (!f) return;
+  FlashWear::add(FlashWear::Config, serializeJson(d, f)); f.close();
+}
+
+// Setelan tier RAM antrian (/queue.json)
+static const char* QUEUE_CFG = "/queue.json";
+static bool queueCfgFromJson(JsonVariantConst d, OfflineQueue::FrontSettings& s){
+  const uint32_t spillS = d["spill_after_s"] | s.spillAfterMs / 1000;
+  const uint32_t maxU = d["max_undurable"] | (uint32_t)s.maxUndurable;
+  if (spillS > 3600 || maxU < 1 || maxU > 65535) return false;
+  s.spillAfterMs = spillS * 1000; s.maxUndurable = maxU;
+  return true;
+}
+static void loadQueueCfg(){
+  File f = LittleFS.open(QUEUE_CFG, "r");
+  if (!f) return;
+  JsonDocument d;
+  OfflineQueue::FrontSettings s = queue.frontSettings();
+  if (!deserializeJson(d, f) && queueCfgFromJson(d, s)) queue.setFrontSettings(s);
+  f.close();
+}
+
+// Setelan kipas (/fan.json)
+static const char* FAN_CFG = "/fan.json";
+static bool fanCfgFromJson(JsonVariantConst d, FanControl::Settings& s){
+  s.onC = d["on_c"] | s.onC; s.offC = d["off_c"] | s.offC; s.fullC = d["full_c"] | s.fullC;
+  s.minDuty = d["min_duty"] | s.minDuty; s.sampleMs = d["sample_ms"] | s.sampleMs; s.rampPerS = d["ramp_per_s"] | s.rampPerS;
+  return FanControl::valid(s);
+}
+static void loadFanCfg(){
+  File f = LittleFS.open(FAN_CFG, "r");
+  if (!f) return;
+  JsonDocument d;
+  FanControl::Settings s = fan.settings();
+  if (!deserializeJson(d, f) && fanCfgFromJson(d, s)) fan.setSettings(s);
+  f.close();
+}
+
+// Langkah boot jaringan yang tersisa, dipanggil tiap loop() (non-blocking)
+static void bootNetworkLoop(){
+  const bool wifiUp = WiFi.status() == WL_CONNECTED;
+  const bool ethUp = !portal.booting() && portal.ethernetLinkUp() && Ethernet.localIP() != IPAddress(0,0,0,0);
+  if (!bootT.wifi && wifiUp) bootT.wifi = millis();
+  if (!bootT.eth && ethUp) bootT.eth = millis();
+  timeSync.loop(wifiUp, ethUp);
+  if (!bootT.ntp && timeSync.stats().syncs) bootT.ntp = millis();
+}
+
+
+// Satu kode dari GM66 -> validasi, tally, publish/antrian
+static void handleScan(const char* kode, size_t len){
+  BarcodeParse::Result pr;
+  if (!BarcodeParse::parse(kode, len, pr) && validateCodes) {
+    scanRejected++;
+    Serial.printf("[SCAN] Reject %s (%s, %s)\n", kode, BarcodeParse::symbologyName(pr.sym), BarcodeParse::errorName(pr.err));
+    return;
+  }
+  if (!bootT.firstCapture) bootT.firstCapture = millis();
+  const uint64_t ts = rtc.nowMs();
+  tally.add(kode, len, ts);
+  if (tallySummaryOnly) return; // uplink hanya ringkasan tally
+  ScanEvent ev{ activeIP(), kode, ts };
+  bool sent = publishOrEnqueue(ev);
+  if (!sent) {
+    Serial.printf("[QUEUE] Enqueued: %s\n", kode);
+  } else {
+    Serial.printf("[MQTT] Sent: %s\n", kode);
+  }
+}
 
 // =================== SETUP / LOOP ============================
 void setup() {
@@ -140,81 +399,308 @@ void setup() {
   pinMode(FAN_PIN, INPUT);
   digitalWrite(LED_PIN, LOW);
   smoothThermistor.useAREF(true);
-  delay(500);
   Serial.println("\n[BOOT] Barcode & Counter — QR Scanner");
+  mqttMutex = xSemaphoreCreateMutex();
 
   queue.begin(QUEUE_FILE, QUEUE_MAX_BYTES);
+  if (!queue.beginFront(QUEUE_RAM_EVENTS)) Serial.println("[QUEUE] PSRAM tidak ada, antrian langsung ke flash");
+  loadQueueCfg();
+  FlashWear::setRatedCycles(FLASH_RATED_CYCLES);
 
   // Portal jaringan (Wi-Fi/Ethernet + UI)
   portal.setStatusAugmenter([](JsonDocument& root){
     // Tambahkan statistik antrian di /api/status -> ui
     root["queue"]["count"] = queue.count();
+    FlashWear::toJson(root["flash"].to<JsonObject>());
     root["queue"]["bytes"] = queue.sizeBytes();
+    const OfflineQueue::FrontStats& qf = queue.frontStats();
+    JsonObject ram = root["queue"]["ram"].to<JsonObject>();
+    ram["count"] = queue.frontCount(); ram["capacity"] = queue.frontCapacity();
+    ram["spill_after_s"] = queue.frontSettings().spillAfterMs / 1000; ram["max_undurable"] = queue.frontSettings().maxUndurable;
+    ram["spills"] = qf.spills; ram["spilled"] = qf.spilled; ram["drained"] = qf.drained; ram["direct"] = qf.direct; root["queue"]["rejected"] = qf.rejected;
+    root["queue"]["head"] = queue.headOffset(); root["queue"]["dead_letters"] = publishDeadLetters;
+    const OfflineQueue::RecoveryStats& rs = queue.recoveryStats();
+    JsonObject rec = root["queue"]["recovery"].to<JsonObject>();
+    rec["us"] = rs.us; rec["tmp_restored"] = rs.tmpRestored; rec["tmp_discarded"] = rs.tmpDiscarded;
+    rec["head_reset"] = rs.headReset; rec["torn_tail"] = rs.tornTail;
+    JsonObject b = root["boot"].to<JsonObject>();
+    b["capture_ready_ms"] = bootT.captureReady; b["first_capture_ms"] = bootT.firstCapture;
+    b["wifi_ms"] = bootT.wifi; b["eth_ms"] = bootT.eth; b["ntp_ms"] = bootT.ntp; b["mqtt_ms"] = bootT.mqtt;
+    const BarcodeScannerGM66::Stats& st = scanner.stats();
+    JsonObject sc = root["scanner"].to<JsonObject>();
+    sc["bytes"] = st.bytes.load(); sc["codes"] = st.codes; sc["duplicates"] = st.duplicates;
+    sc["dropped"] = st.dropped.load(); sc["truncated"] = st.truncated.load(); sc["uart_errors"] = st.uartErrors.load();
+    sc["interleaved"] = st.interleaved.load();
+    sc["ring_peak"] = st.ringPeak;
+    sc["dedup_window_ms"] = scanner.dedupWindowMs(); sc["dedup_size"] = scanner.dedupSize();
+    sc["baud"] = scanner.baud(); sc["mode"] = scanner.mode();
+    sc["cmd_ok"] = st.cmdOk; sc["cmd_fail"] = st.cmdFail;
+    sc["validate"] = validateCodes; sc["rejected"] = scanRejected;
+    const ProductIndex::Stats& ps = products.stats();
+    JsonObject p = root["products"].to<JsonObject>();
+    p["count"] = products.count(); p["lookups"] = ps.lookups; p["hits"] = ps.hits;
+    p["avg_us"] = ps.lookups ? ps.totalUs / ps.lookups : 0; p["max_us"] = ps.maxUs;
+    const RTCClockDS3231::ClockStats& ck = rtc.clockStats();
+    JsonObject cl = root["clock"].to<JsonObject>();
+    cl["now_ms"] = rtc.nowMs(); cl["sqw"] = ck.sqw; cl["edges"] = ck.edges; cl["rtc_reads"] = ck.rtcReads;
+    cl["steps"] = ck.steps; cl["ppb"] = ck.ppb; cl["last_err_us"] = ck.lastErrUs; cl["max_err_us"] = ck.maxErrUs;
+    timeSync.toJson(root["time"].to<JsonObject>());
+    fan.toJson(root["fan"].to<JsonObject>());
+    JsonObject t = root["tally"].to<JsonObject>();
+    t["date"] = tally.current().date; t["shift"] = tally.current().index + 1;
+    t["total"] = tally.total(); t["unique"] = tally.unique(); t["overflow"] = tally.overflow();
+    t["snapshots"] = tally.snapshots(); t["closed_pending"] = tally.closedPending();
+    t["shifts"] = tally.schedule(); t["publish_s"] = tallyPublishS; t["snapshot_s"] = tallySnapshotS;
+    t["summary_only"] = tallySummaryOnly;
+  });
+  bool routesOk = true; // route yang gagal masuk tabel tidak bisa dipanggil: harus terlihat di log boot
+  routesOk &= portal.addRoute("POST", "/api/queue/flush", [](const ApiRequest& rq, String& contentType, int& code){
+    // flush jalan di loop() (satu penulis file antrian), 100 item per putaran s/d 500
+    bool co = false;
+    uint32_t id = portal.postJob("queue", "", [total = size_t(0)](String& out, int& rc) mutable {
+      if (xSemaphoreTake(mqttMutex, 0) != pdTRUE) return false; // mqttTask sedang connect, coba lagi
+      size_t n = mqtt.connected() ? flushQueueLimited(100) : 0;
+      xSemaphoreGive(mqttMutex);
+      total += n;
+      if (n == 100 && total < 500) return false;
+      JsonDocument d; d["flushed"] = total; serializeJson(d, out);
+      return true;
+    }, &co);
+    return portal.jobAccepted(id, co, code);
   });
-  portal.setExtraApiHandler([](const String& path, const String& method, const String& body,
-                               const String& ctx, String& contentType, int& code, String& out)->bool {
-    if (path == "/api/queue/flush" && method == "POST") {
-      size_t n = flushQueueLimited(500);
-      JsonDocument d; d["flushed"] = n; serializeJson(d, out);
-      contentType = "application/json"; code = 200; return true;
+  routesOk &= portal.addRoute("POST", "/api/scanner/settings", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    long win = d["window_ms"] | (long)scanner.dedupWindowMs(), size = d["size"] | (long)scanner.dedupSize();
+    if (win < 0 || win > 600000 || size < 1 || size > (long)BarcodeScannerGM66::DEDUP_MAX) {
+      code = 400; return String("{\"error\":\"window_ms 0..600000, size 1..32\"}");
+    }
+    scanner.setDedup(win, size);
+    validateCodes = d["validate"] | validateCodes;
+    saveScannerCfg();
+    JsonDocument r; r["window_ms"] = win; r["size"] = size; r["validate"] = validateCodes;
+    String out; serializeJson(r, out); return out;
+  });
+  routesOk &= portal.addRoute("POST", "/api/scanner/config", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    static const char* const MODES[] = { "manual", "command", "continuous", "sensor" };
+    int mode = -1;
+    if (!d["mode"].isNull()) {
+      const String m = d["mode"].as<String>();
+      for (int i = 0; i < 4; i++) if (m == MODES[i]) mode = i;
+      if (mode < 0) { code = 400; return String("{\"error\":\"mode: manual|command|continuous|sensor\"}"); }
+    }
+    // field yang tidak dikirim = -1: nilai di modul dipertahankan
+    const long readMs = d["read_ms"] | -1L, intervalMs = d["interval_ms"] | -1L;
+    if (!BarcodeScannerGM66::validReadTiming(readMs, intervalMs)) {
+      code = 400; return String("{\"error\":\"read_ms 0 (tanpa batas) | 100..25500, interval_ms 0..25500\"}");
     }
-    return false;
+    const uint32_t baud = d["baud"] | 0UL;
+    // transaksi UART (ratusan ms) dijalankan di loop(), bukan di task async_tcp
+    bool co = false;
+    uint32_t id = portal.postJob("scanner", rq.body, [mode, readMs, intervalMs, baud](String& out, int& rc){
+      bool ok = true;
+      if (mode >= 0) ok &= scanner.setMode((BarcodeScannerGM66::Mode)mode);
+      if (readMs >= 0 || intervalMs >= 0) ok &= scanner.setReadTiming(readMs, intervalMs);
+      if (baud) ok &= scanner.setBaud(baud);
+      JsonDocument r; r["ok"] = ok; r["baud"] = scanner.baud(); r["mode"] = scanner.mode();
+      if (!ok) rc = 502;
+      serializeJson(r, out);
+      return true;
+    }, &co);
+    return portal.jobAccepted(id, co, code);
+  });
+  routesOk &= portal.addRoute("POST", "/api/queue/settings", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    OfflineQueue::FrontSettings s = queue.frontSettings();
+    if (!queueCfgFromJson(d, s)) { code = 400; return String("{\"error\":\"spill_after_s 0..3600, max_undurable >= 1\"}"); }
+    queue.setFrontSettings(s); // spill karena batas baru dikerjakan loop()
+    JsonDocument r;
+    r["spill_after_s"] = queue.frontSettings().spillAfterMs / 1000; r["max_undurable"] = queue.frontSettings().maxUndurable;
+    File f = LittleFS.open(QUEUE_CFG, "w");
+    if (f) { FlashWear::add(FlashWear::Config, serializeJson(r, f)); f.close(); }
+    String out; serializeJson(r, out); return out;
+  });
+  routesOk &= portal.addRoute("GET", "/api/queue/events", [](const ApiRequest& rq, String& contentType, int& code){
+    long from = rq.argInt("from"), limit = rq.argInt("limit");
+    if (from < 0) from = 0;
+    if (limit <= 0) limit = 50;
+    if (limit > 200) limit = 200;
+    JsonDocument d;
+    JsonArray items = d["items"].to<JsonArray>();
+    size_t total = queue.readRange(from, limit, [&](size_t idx, const ScanEvent& e){
+      JsonObject o = items.add<JsonObject>();
+      o["idx"] = idx; o["ip_address"] = e.ip_address.c_str(); o["kode_barang"] = e.kode_barang.c_str();
+      char tgl[11], jam[9]; RTCClockDS3231::formatLocal(e.ts, tgl, jam);
+      o["tanggal"] = tgl; o["waktu"] = jam; o["ts"] = e.ts;
+    });
+    if (total == SIZE_MAX) { code = 503; return String("{\"error\":\"antrian sibuk, coba lagi\"}"); }
+    d["total"] = total; d["from"] = from; d["limit"] = limit;
+    String out; serializeJson(d, out); return out;
+  });
+  routesOk &= portal.addStreamRoute("GET", "/api/queue/export", [](const ApiRequest& rq, String& contentType, int& code){
+    auto cur = std::make_shared<OfflineQueue::ExportCursor>();
+    cur->csv = rq.argIs("format", "csv");
+    contentType = cur->csv ? "text/csv" : "application/x-ndjson";
+    return DualNICPortal::ChunkFiller([cur](uint8_t* buf, size_t maxLen){ return queue.exportChunk(*cur, buf, maxLen); });
+  });
+
+  routesOk &= portal.addUploadRoute("POST", "/api/products",
+    [](const ApiRequest& rq, const uint8_t* data, size_t len, size_t index, size_t total){
+      return products.uploadChunk(data, len, index, total);
+    },
+    [](const ApiRequest& rq, String& contentType, int& code){
+      // sort + tulis file (bisa > 1 s untuk puluhan ribu entri) -> job di loop()
+      bool co = false;
+      // staging upload sudah diganti upload ini: job yang masih antre untuk upload lama digantikan
+      uint32_t id = portal.postJob("products", nullptr, [](String& out, int& rc){
+        String err; size_t n, bad, dup;
+        JsonDocument r;
+        if (products.uploadFinish(err, n, bad, dup)) { r["count"] = n; r["bad_lines"] = bad; r["duplicates"] = dup; }
+        else { rc = 400; r["error"] = err; }
+        serializeJson(r, out);
+        return true;
+      }, &co);
+      return portal.jobAccepted(id, co, code);
+    });
+  routesOk &= portal.addRoute("GET", "/api/products/lookup", [](const ApiRequest& rq, String& contentType, int& code){
+    const char* kode = rq.arg("code");
+    uint32_t sku = 0; const uint32_t t0 = micros();
+    const bool found = products.lookup(kode, strlen(kode), sku);
+    JsonDocument d; d["code"] = kode; d["found"] = found; d["us"] = micros() - t0;
+    if (found) d["sku"] = sku;
+    String out; serializeJson(d, out); return out;
   });
 
-  portal.begin();
+  routesOk &= portal.addRoute("GET", "/api/tally", [](const ApiRequest& rq, String& contentType, int& code){
+    if (rq.argIs("shift", "last")) {
+      String last = tally.lastClosed();
+      if (last.isEmpty()) { code = 404; return String("{\"error\":\"belum ada shift ditutup\"}"); }
+      return last;
+    }
+    const long limit = rq.argInt("limit", 50);
+    JsonDocument d;
+    tally.summary(d.to<JsonObject>(), limit > 0 ? limit : 0);
+    String out; serializeJson(d, out); return out;
+  });
+  routesOk &= portal.addRoute("POST", "/api/tally/settings", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    // semua field dicek dulu: request yang ditolak tidak boleh mengubah apa pun
+    const bool shifts = !d["shifts"].isNull();
+    if (shifts && !ShiftTally::validSchedule(d["shifts"].as<String>())) {
+      code = 400; return String("{\"error\":\"shifts: HH:MM dipisah koma, maks 6\"}");
+    }
+    long pub = d["publish_s"] | (long)tallyPublishS, snap = d["snapshot_s"] | (long)tallySnapshotS;
+    if (pub < 0 || pub > 86400 || snap < 10 || snap > 3600) {
+      code = 400; return String("{\"error\":\"publish_s 0..86400, snapshot_s 10..3600\"}");
+    }
+    if (shifts) tally.setSchedule(d["shifts"].as<String>());
+    tallyPublishS = pub; tallySnapshotS = snap;
+    tallySummaryOnly = d["summary_only"] | tallySummaryOnly;
+    saveTallyCfg();
+    JsonDocument r;
+    r["shifts"] = tally.schedule(); r["publish_s"] = tallyPublishS; r["snapshot_s"] = tallySnapshotS;
+    r["summary_only"] = tallySummaryOnly;
+    String out; serializeJson(r, out); return out;
+  });
 
-  // RTC
-  if (!rtc.begin(I2C_SDA, I2C_SCL)) Serial.println("RTC init failed");
-  if (!rtc.isValid()) Serial.println("RTC not valid – set via NTP when Wi‑Fi up");
+  routesOk &= portal.addRoute("POST", "/api/time", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    TimeSync::Settings s = timeSync.settings();
+    if (d["server"].is<const char*>()) strlcpy(s.server, d["server"], sizeof(s.server));
+    s.intervalMin = d["interval_min"] | s.intervalMin; s.thresholdMs = d["threshold_ms"] | s.thresholdMs;
+    s.maxDelayMs = d["max_delay_ms"] | s.maxDelayMs; s.tzMin = d["tz_min"] | s.tzMin;
+    if (!timeSync.requestSettings(s)) {
+      code = 400; return String("{\"error\":\"interval_min 1..1440, threshold_ms 10..60000, max_delay_ms 10..2000, tz_min -720..840\"}");
+    }
+    if (d["sync"] | false) timeSync.requestSync();
+    return String("{\"ok\":true}"); // diterapkan di loop()
+  });
 
-  // Scanner GM66 di Serial1 (ubah pin sesuai atas)
-  scanner.begin(Serial1, PIN_GM66_RX, PIN_GM66_TX, 9600, PIN_GM66_TRIG);
-  scanner.setDebounceMs(600);
-  scanner.onScan([&](const String& kode){
-    String tgl, jam; rtc.nowLocal(tgl, jam);
-    ScanEvent ev{ activeIP(), kode, tgl, jam };
-    bool sent = false;  
-    if (ensureMqttConnected()) sent = publishEvent(ev);
-    if (!sent) {
-      queue.enqueue(ev);
-      Serial.printf("[QUEUE] Enqueued: %s\n", kode.c_str());
-    } else {
-      Serial.printf("[MQTT] Sent: %s\n", kode.c_str());
+  routesOk &= portal.addRoute("POST", "/api/fan", [](const ApiRequest& rq, String& contentType, int& code){
+    JsonDocument d;
+    if (deserializeJson(d, rq.body)) { code = 400; return String("{\"error\":\"JSON invalid\"}"); }
+    FanControl::Settings s = fan.settings();
+    if (!fanCfgFromJson(d, s)) {
+      code = 400; return String("{\"error\":\"off_c < on_c <= full_c, sample_ms 100..60000, ramp_per_s > 0\"}");
     }
+    fan.setSettings(s);
+    JsonDocument r; JsonObject o = r.to<JsonObject>();
+    o["on_c"] = s.onC; o["off_c"] = s.offC; o["full_c"] = s.fullC;
+    o["min_duty"] = s.minDuty; o["sample_ms"] = s.sampleMs; o["ramp_per_s"] = s.rampPerS;
+    File f = LittleFS.open(FAN_CFG, "w");
+    if (f) { FlashWear::add(FlashWear::Config, serializeJson(r, f)); f.close(); }
+    String out; serializeJson(r, out); return out;
   });
 
-  // MQTT client basic callbacks (opsional)
-  ensureMqttConnected();
+  if (!routesOk) Serial.println("[BOOT] ERROR: route API gagal didaftarkan (lihat [HTTP] di atas)");
+
+  portal.setClock([](){ return rtc.nowMs(); }); // umur lease DHCP tersimpan
+  portal.begin();     // non-blocking; Wi-Fi/Ethernet selesai di portal.loop()
+  products.begin();   // LittleFS sudah di-mount oleh portal
+  loadTallyCfg();
+  tally.setItemHook([](const char* kode, size_t len, JsonObject item){
+    uint32_t sku;
+    if (products.lookup(kode, len, sku)) item["sku"] = sku;
+  });
+  tally.begin();
+
+  // RTC; zona waktu & koreksi tersimpan dimuat dulu (RTC berisi waktu lokal zona itu).
+  // SNTP berjalan di bootNetworkLoop() begitu ada NIC yang up.
+  timeSync.begin(rtc);
+  if (!rtc.begin(I2C_SDA, I2C_SCL, RTC_SQW_PIN)) Serial.println("RTC init failed");
+  if (!rtc.isValid()) Serial.println("RTC not valid – set via SNTP when network up");
+  loadFanCfg();
+  fan.begin(FAN_PIN, [](){ return smoothThermistor.temperature(); });
+
+  // Scanner GM66 di Serial1 (ubah pin sesuai atas)
+  // baud 0 = deteksi otomatis; modul pabrik (9600) dipindah sekali ke 115200 (disimpan di flash modul)
+  scanner.begin(Serial1, PIN_GM66_RX, PIN_GM66_TX, 0, PIN_GM66_TRIG);
+  if (scanner.baud() != GM66_BAUD && !scanner.setBaud(GM66_BAUD)) Serial.println("[GM66] Switch baud failed");
+  loadScannerCfg();
+  scanner.onScan(handleScan);
+
+  // MQTT client basic callbacks (opsional); connect dilakukan mqttTask
   mqtt.setCallback([](char*, uint8_t*, unsigned int){});
+  xTaskCreatePinnedToCore(mqttTask, "mqtt_conn", 4096, nullptr, 1, nullptr, 0);
 
+  bootT.captureReady = millis();
   Serial.printf("[INFO] Web UI: http://%s.local/\n", MDNS_HOST);
-  Serial.println("[READY] Scan kode untuk menguji...");
+  Serial.printf("[READY] Capture aktif %lu ms setelah reset\n", (unsigned long)bootT.captureReady);
 }
 
 uint32_t lastMqttAttempt = 0;
 uint32_t lastFlushCheck  = 0;
+uint32_t lastTallyTick = 0, lastTallySnapshot = 0;
 
 void loop() {
-  temp = smoothThermistor.temperature();
-  // Serial.print("Suhu: ");
-  // Serial.println(temp);
-  delay(100);
-  if (temp >= 50 ){
-    analogWrite(FAN_PIN, 255);
-    // Serial.println("FAN ON");
-    delay(1000);
-  }else if(temp <= 30){
-    analogWrite(FAN_PIN, 0);
-    // Serial.println("FAN OFF");
-    delay(1000);
-  }
   portal.loop();     // wajib dipanggil
 
   // Jalankan loop scanner
   scanner.loop();
-  activeIP();
+  bootNetworkLoop();
+  rtc.loopClock();
+  fan.loop();        // sampel suhu tiap sample_ms, histeresis & ramp PWM kipas; tanpa delay
+  queue.loop();      // ring PSRAM -> flash bila outage melewati spill_after_s / max_undurable
+
+  // Pergantian shift tanpa scan & snapshot tally berkala
+  if (millis() - lastTallyTick >= 5000) {
+    lastTallyTick = millis();
+    tally.tick(rtc.nowMs());
+  }
+  if (millis() - lastTallySnapshot >= tallySnapshotS * 1000UL) {
+    lastTallySnapshot = millis();
+    tally.snapshot();
+  }
 
-  if (!mqtt.loop()) {
+  // MQTT sedang dipegang mqttTask (connect) -> lewati putaran ini, capture tetap jalan
+  bool mqttAlive = false, mqttLocked = (xSemaphoreTake(mqttMutex, 0) == pdTRUE);
+  if (mqttLocked) mqttAlive = mqtt.loop();
+  if (!mqttAlive) {
     if (millis() - lastLEDBlink >= 1000) {
       lastLEDBlink = millis();
       ledBlinkState = !ledBlinkState;
@@ -225,11 +711,13 @@ void loop() {
     // mqtt.loop(); // tetap jalankan loop MQTT saat connected
   }
   // Coba flush antrian tiap 2 detik saat online
-  if (mqtt.connected() && (millis() - lastFlushCheck > 2000)) {
+  if (mqttLocked && mqtt.connected() && (millis() - lastFlushCheck > 2000)) {
     lastFlushCheck = millis();
     size_t n = flushQueueLimited(100);
     if (n) Serial.printf("[QUEUE] Flushed %u items\n", (unsigned)n);
   }
+  if (mqttLocked && mqtt.connected()) publishTally();
+  if (mqttLocked) xSemaphoreGive(mqttMutex);
 
   delay(2);
 }
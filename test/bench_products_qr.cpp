@@ -0,0 +1,70 @@
+// Benchmark host ProductIndex: upload CSV 50k entri (streaming, rename atomik) lalu lookup
+// EAN-13, bentuk GS1 (01) GTIN-14 dari barang yang sama, & kode yang tidak ada.
+// Keluar 1 bila index tidak lengkap / ada lookup yang salah (smoke test ctest).
+#include "harness.h"
+#include "ProductIndex.h"
+
+static const uint32_t N = 50000;
+static ProductIndex px;
+
+// EAN-13 ke-i (prefix 20 = internal), cek digit GS1
+static std::string ean13(uint32_t i){
+  char d[14]; snprintf(d, sizeof(d), "20%010lu", (unsigned long)(i * 7919UL % 10000000000UL));
+  unsigned sum = 0;
+  for (int k = 0; k < 12; k++) sum += (d[11 - k] - '0') * ((k & 1) ? 1 : 3);
+  d[12] = '0' + (10 - sum % 10) % 10; d[13] = 0;
+  return d;
+}
+static uint32_t pick(uint32_t i){ return (uint32_t)((i * 2654435761ULL) % N); } // urutan acak, deterministik
+
+static bool upload(){
+  std::string csv = "kode,sku\n";
+  for (uint32_t i = 0; i < N; i++) csv += ean13(i) + "," + std::to_string(100000 + i) + "\n";
+  const size_t CHUNK = 1436; // satu segmen TCP
+  for (size_t off = 0; off < csv.size(); off += CHUNK) {
+    const size_t n = std::min(CHUNK, csv.size() - off);
+    if (!px.uploadChunk((const uint8_t*)csv.data() + off, n, off, csv.size())) return false;
+  }
+  String err; size_t entries, bad, dup;
+  if (!px.uploadFinish(err, entries, bad, dup)) { printf("upload gagal: %s\n", err.c_str()); return false; }
+  return entries == N && bad == 0 && dup == 0;
+}
+
+int main(int argc, char** argv){
+  harness::fresh();
+  px.begin("/bench_products.idx");
+  const auto t0 = std::chrono::steady_clock::now();
+  const uint64_t w0 = host::fsBytesWritten();
+  if (!upload()) { printf("index tidak lengkap\n"); return 1; }
+  printf("upload %u entri: %.0f ms host, %llu byte ke flash, fence RAM %u byte\n", N,
+         std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count(),
+         (unsigned long long)(host::fsBytesWritten() - w0), (unsigned)((N + ProductIndex::FENCE_STRIDE - 1) / ProductIndex::FENCE_STRIDE * 8));
+
+  // ketepatan: sampel acak EAN-13 & GTIN-14 menemukan SKU yang benar, kode asing tidak
+  for (uint32_t i = 0; i < 2000; i++) {
+    const uint32_t k = pick(i);
+    const std::string e = ean13(k), g = "(01)0" + e;
+    uint32_t a = 0, b = 0, c = 0;
+    if (!px.lookup(e.c_str(), e.size(), a) || a != 100000 + k || !px.lookup(g.c_str(), g.size(), b) || b != a) {
+      printf("lookup salah: %s -> %u / %u\n", e.c_str(), a, b); return 1;
+    }
+    const std::string miss = "X" + e;
+    if (px.lookup(miss.c_str(), miss.size(), c)) { printf("lookup palsu: %s\n", miss.c_str()); return 1; }
+  }
+
+  static std::vector<std::string> eans, gtins, misses;
+  for (uint32_t i = 0; i < 4096; i++) {
+    eans.push_back(ean13(pick(i)));
+    gtins.push_back("]C101" + std::string("0") + eans.back());
+    misses.push_back(ean13(N + i));
+  }
+  std::vector<harness::Case> cases = {
+    { "lookup_ean13", 200000, [](uint32_t i){ uint32_t s; const std::string& c = eans[i & 4095]; px.lookup(c.c_str(), c.size(), s); } },
+    { "lookup_gtin14", 200000, [](uint32_t i){ uint32_t s; const std::string& c = gtins[i & 4095]; px.lookup(c.c_str(), c.size(), s); } },
+    { "lookup_miss", 200000, [](uint32_t i){ uint32_t s; const std::string& c = misses[i & 4095]; px.lookup(c.c_str(), c.size(), s); } },
+  };
+  const int rc = harness::bench("product index (50k)", cases, argc, argv);
+  const ProductIndex::Stats& st = px.stats();
+  printf("stats: %u lookup, %u hit, max %u us (virtual)\n", st.lookups, st.hits, st.maxUs);
+  return rc;
+}
@@ -0,0 +1,47 @@
+// Benchmark host counting-barang: antrian offline (enqueue/count/read/flush/prune) & serialisasi
+// /api/status (augmenter sketch asli). Antrian bench = instance & file sendiri.
+#include "harness.h"
+#include "../counting-barang/counting-barang.ino"
+
+static OfflineQueue bq, bqr; // bqr: dengan tier depan PSRAM
+static const char* BQ = "/bench_q.ndjson";
+static const char* BQR = "/bench_qr.ndjson";
+
+static ScanEvent benchEvent(uint32_t i){
+  return ScanEvent{ "192.168.1.100", i, 1700000000000ULL + i, (uint8_t)(1 + i % 4) };
+}
+static void freshQ(size_t maxBytes){ LittleFS.remove(BQ); bq.begin(BQ, maxBytes); }
+static void dropQ(){ LittleFS.remove(BQ); LittleFS.remove(String(BQ) + ".h0"); LittleFS.remove(String(BQ) + ".h1"); }
+static void flushAll(OfflineQueue& q){ q.flush([](const ScanEvent&){ return true; }, 100000); }
+
+// write amplification per mode antrian: byte flash (data + head + compact) / byte baris event.
+// Siklus = outage 100 event lalu broker kembali (flush semua).
+static void waCases(std::vector<harness::Case>& cases){
+  const uint32_t unit = OfflineQueue::lineBytes(benchEvent(0));
+  // tanpa PSRAM: setiap event langsung ke flash
+  cases.push_back({ "wa_direct", 5000, [](uint32_t i){ bq.enqueue(benchEvent(i)); if (i % 100 == 99) flushAll(bq); },
+                    [](){ freshQ(1024 * 1024); }, dropQ, unit });
+  // ring PSRAM, outage > maxUndurable: sebagian event di-spill lalu dibaca lagi dari flash
+  cases.push_back({ "wa_spill", 5000, [](uint32_t i){ bqr.enqueue(benchEvent(i)); if (i % 100 == 99) flushAll(bqr); },
+                    [](){ OfflineQueue::FrontSettings s; s.maxUndurable = 64; bqr.setFrontSettings(s); }, nullptr, unit });
+  // broker tersambung: event langsung terkuras dari ring, flash tidak disentuh
+  cases.push_back({ "wa_online", 5000, [](uint32_t i){ bqr.enqueue(benchEvent(i)); flushAll(bqr); }, nullptr, nullptr, unit });
+}
+
+int main(int argc, char** argv){
+  harness::fresh();
+  setup();
+  host::advance(2000000); // jaringan & task boot
+  LittleFS.remove(BQR); bqr.begin(BQR, 1024 * 1024); bqr.beginFront(256);
+  std::vector<harness::Case> cases = {
+    { "queue_enqueue", 2000, [](uint32_t i){ bq.enqueue(benchEvent(i)); }, [](){ freshQ(1024 * 1024); } },
+    { "queue_count", 2000, [](uint32_t){ bq.count(); } },
+    { "queue_read", 200, [](uint32_t i){ bq.readRange(i * 10, 10, [](size_t, const ScanEvent&){}); } },
+    { "queue_flush", 1, [](uint32_t){ bq.flush([](const ScanEvent&){ return true; }, 100000); }, nullptr, dropQ },
+    // file kecil: prune (tulis ulang 80% isi) terjadi berkali-kali
+    { "queue_prune", 2000, [](uint32_t i){ bq.enqueue(benchEvent(i)); }, [](){ freshQ(4096); }, dropQ },
+    { "status_json", 200, [](uint32_t){ portal.statusJson("bench"); } },
+  };
+  waCases(cases);
+  return harness::bench("counting-barang", cases, argc, argv);
+}
@@ -0,0 +1,54 @@
+// Benchmark host qr-scanner: antrian offline (enqueue/count/read/flush/prune), serialisasi
+// /api/status (augmenter sketch asli) & parsing scan. Antrian bench = instance & file sendiri.
+#include "harness.h"
+#include "../qr-scanner/qr-scanner.ino"
+
+static OfflineQueue bq, bqr; // bqr: dengan tier depan PSRAM
+static const char* BQ = "/bench_q.ndjson";
+static const char* BQR = "/bench_qr.ndjson";
+
+static ScanEvent benchEvent(uint32_t i){
+  char kode[24]; snprintf(kode, sizeof(kode), "BENCH-%08lu", (unsigned long)i);
+  return ScanEvent{ "192.168.1.100", kode, 1700000000000ULL + i };
+}
+static void freshQ(size_t maxBytes){ LittleFS.remove(BQ); bq.begin(BQ, maxBytes); }
+static void dropQ(){ LittleFS.remove(BQ); LittleFS.remove(String(BQ) + ".h0"); LittleFS.remove(String(BQ) + ".h1"); }
+static void flushAll(OfflineQueue& q){ q.flush([](const ScanEvent&){ return true; }, 100000); }
+
+// write amplification per mode antrian: byte flash (data + head + compact) / byte baris event.
+// Siklus = outage 100 event lalu broker kembali (flush semua).
+static void waCases(std::vector<harness::Case>& cases){
+  const uint32_t unit = OfflineQueue::lineBytes(benchEvent(0));
+  // tanpa PSRAM: setiap event langsung ke flash
+  cases.push_back({ "wa_direct", 5000, [](uint32_t i){ bq.enqueue(benchEvent(i)); if (i % 100 == 99) flushAll(bq); },
+                    [](){ freshQ(1024 * 1024); }, dropQ, unit });
+  // ring PSRAM, outage > maxUndurable: sebagian event di-spill lalu dibaca lagi dari flash
+  cases.push_back({ "wa_spill", 5000, [](uint32_t i){ bqr.enqueue(benchEvent(i)); if (i % 100 == 99) flushAll(bqr); },
+                    [](){ OfflineQueue::FrontSettings s; s.maxUndurable = 64; bqr.setFrontSettings(s); }, nullptr, unit });
+  // broker tersambung: event langsung terkuras dari ring, flash tidak disentuh
+  cases.push_back({ "wa_online", 5000, [](uint32_t i){ bqr.enqueue(benchEvent(i)); flushAll(bqr); }, nullptr, nullptr, unit });
+}
+
+int main(int argc, char** argv){
+  harness::fresh();
+  setup();
+  host::advance(2000000); // jaringan & task boot
+  LittleFS.remove(BQR); bqr.begin(BQR, 1024 * 1024); bqr.beginFront(256);
+  std::vector<harness::Case> cases = {
+    { "queue_enqueue", 2000, [](uint32_t i){ bq.enqueue(benchEvent(i)); }, [](){ freshQ(1024 * 1024); } },
+    { "queue_count", 2000, [](uint32_t){ bq.count(); } },
+    { "queue_read", 200, [](uint32_t i){ bq.readRange(i * 10, 10, [](size_t, const ScanEvent&){}); } },
+    { "queue_flush", 1, [](uint32_t){ bq.flush([](const ScanEvent&){ return true; }, 100000); }, nullptr, dropQ },
+    // file kecil: prune (tulis ulang 80% isi) terjadi berkali-kali
+    { "queue_prune", 2000, [](uint32_t i){ bq.enqueue(benchEvent(i)); }, [](){ freshQ(4096); }, dropQ },
+    { "status_json", 200, [](uint32_t){ portal.statusJson("bench"); } },
+    // parsing scan: EAN-13, GS1 bentuk manusia & kode bebas
+    { "scan_parse", 100000, [](uint32_t i){
+        static const char* const CODES[] = { "4006381333931", "(01)09501101530003(17)251231(10)LOT42", "INT-00042" };
+        const char* c = CODES[i % 3];
+        BarcodeParse::Result pr; BarcodeParse::parse(c, strlen(c), pr);
+      } },
+  };
+  waCases(cases);
+  return harness::bench("qr-scanner", cases, argc, argv);
+}
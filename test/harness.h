@@ -0,0 +1,110 @@
+#pragma once
+// Harness test & benchmark host (tanpa dependensi): CHECK/TEST, boot lingkungan host, runner bench.
+#include <Arduino.h>
+#include <LittleFS.h>
+#include <Preferences.h>
+#include "shim/host.h"
+#include "shim/host_fs.h"
+#include "shim/host_net.h"
+#include "shim/host_rtc.h"
+#include <chrono>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace harness {
+
+struct Test { const char* name; void (*fn)(); };
+inline std::vector<Test>& tests(){ static std::vector<Test> t; return t; }
+inline int& failures(){ static int n = 0; return n; }
+struct Register { Register(const char* n, void (*fn)()){ tests().push_back({ n, fn }); } };
+
+// lingkungan bersih: waktu 0, FS kosong, NVS kosong, jaringan & RTC default
+inline void fresh(){
+  host::reset();
+  host::netReset();
+  host::fsFormat();
+  host::nvsReset();
+  LittleFS.begin(true);
+}
+
+inline int run(int argc, char** argv){
+  const char* only = argc > 1 ? argv[1] : nullptr;
+  int ran = 0;
+  for (auto& t : tests()) {
+    if (only && !strstr(t.name, only)) continue;
+    const int before = failures();
+    fresh();
+    try { t.fn(); }
+    catch (host::Restart&) { printf("  restart tak tertangkap\n"); failures()++; }
+    catch (host::PowerCut&) { printf("  power cut tak tertangkap\n"); failures()++; }
+    printf("%s %s\n", failures() == before ? "[ OK ]" : "[FAIL]", t.name);
+    ran++;
+  }
+  printf("%d test, %d gagal\n", ran, failures());
+  return failures() ? 1 : 0;
+}
+
+// ---- benchmark ----
+// Waktu = jam dinding host (bukan millis() virtual), jadi ops/s membandingkan versi kode di mesin
+// yang sama, bukan angka ESP32. Byte & blok = LittleFS host; alokasi = operator new/malloc.
+struct Case {
+  const char* name; uint32_t iters;
+  std::function<void(uint32_t)> op;
+  std::function<void()> setup, teardown;
+  uint32_t unit = 0;  // byte logis per op -> wa = byte tertulis / (iters x unit)
+};
+
+inline int bench(const char* title, std::vector<Case>& cases, int argc, char** argv){
+  uint32_t scale = 1; const char* only = nullptr; FILE* json = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (!strcmp(argv[i], "--quick")) scale = 10;
+    else if (!strcmp(argv[i], "--json") && i + 1 < argc) json = fopen(argv[++i], "w");
+    else only = argv[i];
+  }
+  printf("%s\n%-16s %8s %12s %12s %10s %9s %8s %10s %6s\n", title, "case", "iters", "ns/op", "ops/s",
+         "bytes", "bytes/op", "blocks", "allocs/op", "wa");
+  if (json) fprintf(json, "{\"bench\":\"%s\",\"cases\":[", title);
+  bool first = true;
+  for (auto& c : cases) {
+    if (only && !strstr(c.name, only)) continue;
+    const uint32_t iters = c.iters / scale ? c.iters / scale : 1;
+    if (c.setup) c.setup();
+    const uint64_t b0 = host::fsBytesWritten(), k0 = host::fsBlocksProgrammed(), a0 = host::allocCount();
+    const auto t0 = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < iters; i++) c.op(i);
+    const double ns = (double)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - t0).count();
+    const uint64_t bytes = host::fsBytesWritten() - b0, blocks = host::fsBlocksProgrammed() - k0, allocs = host::allocCount() - a0;
+    if (c.teardown) c.teardown();
+    const double nsOp = ns / iters, opsS = ns > 0 ? iters * 1e9 / ns : 0;
+    const double wa = c.unit ? (double)bytes / ((double)iters * c.unit) : 0;
+    printf("%-16s %8u %12.0f %12.0f %10llu %9.1f %8llu %10.2f", c.name, iters, nsOp, opsS,
+           (unsigned long long)bytes, (double)bytes / iters, (unsigned long long)blocks, (double)allocs / iters);
+    if (c.unit) printf(" %6.2f", wa);
+    printf("\n");
+    if (json) {
+      fprintf(json, "%s{\"name\":\"%s\",\"iters\":%u,\"ns_per_op\":%.0f,\"ops_s\":%.0f,\"bytes\":%llu,\"blocks\":%llu,\"allocs_per_op\":%.2f",
+              first ? "" : ",", c.name, iters, nsOp, opsS, (unsigned long long)bytes, (unsigned long long)blocks, (double)allocs / iters);
+      if (c.unit) fprintf(json, ",\"wa\":%.2f", wa);
+      fprintf(json, "}");
+      first = false;
+    }
+  }
+  if (json) { fprintf(json, "]}\n"); fclose(json); }
+  return 0;
+}
+
+}
+
+#define TEST(name) \
+  static void name(); \
+  static harness::Register name##_reg(#name, name); \
+  static void name()
+
+#define CHECK(c) do { if (!(c)) { printf("  %s:%d: CHECK(%s)\n", __FILE__, __LINE__, #c); harness::failures()++; } } while (0)
+#define CHECK_EQ(a, b) do { const auto _a = (a); const auto _b = (b); if (!(_a == _b)) { \
+  printf("  %s:%d: CHECK_EQ(%s, %s): %lld != %lld\n", __FILE__, __LINE__, #a, #b, (long long)_a, (long long)_b); harness::failures()++; } } while (0)
+#define REQUIRE(c) do { if (!(c)) { printf("  %s:%d: REQUIRE(%s)\n", __FILE__, __LINE__, #c); harness::failures()++; return; } } while (0)
+
+#define TEST_MAIN() int main(int argc, char** argv){ return harness::run(argc, argv); }
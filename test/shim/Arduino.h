@@ -0,0 +1,295 @@
+#pragma once
+// Shim Arduino-ESP32 untuk build host (test/). Cukup untuk modul sketch & .ino:
+// String, Print/Stream, HardwareSerial (RX diumpan test, TX ke model perangkat), GPIO + ISR,
+// millis()/micros() waktu virtual (lihat host.h), FreeRTOS kooperatif (freertos_shim.h).
+#include <cstdint>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <cstdarg>
+#include <cctype>
+#include <cmath>
+#include <string>
+#include <deque>
+#include <functional>
+#include <algorithm>
+#include <type_traits>
+
+typedef uint8_t byte;
+typedef bool boolean;
+using std::min; using std::max;
+using std::isnan; using std::isinf;
+
+#define F(x) (x)
+#define PSTR(x) (x)
+#define FPSTR(x) (x)
+#define PROGMEM
+#define IRAM_ATTR
+#define HIGH 1
+#define LOW 0
+#define INPUT 0x01
+#define OUTPUT 0x03
+#define INPUT_PULLUP 0x05
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+#define HEX 16
+#define DEC 10
+#define SERIAL_8N1 0x800001c
+
+inline size_t strlen_P(const char* s){ return strlen(s); }
+inline size_t strlcpy(char* d, const char* s, size_t n){
+  const size_t l = strlen(s);
+  if (n) { const size_t c = l < n - 1 ? l : n - 1; memcpy(d, s, c); d[c] = 0; }
+  return l;
+}
+inline size_t strlcat(char* d, const char* s, size_t n){
+  const size_t dl = strnlen(d, n);
+  return dl == n ? n + strlen(s) : dl + strlcpy(d + dl, s, n - dl);
+}
+template<class T> T constrain(T x, T a, T b){ return x < a ? a : (x > b ? b : x); }
+
+class String {
+public:
+  String() {}
+  String(const char* c){ if (c) _s = c; }
+  String(const char* c, size_t n) : _s(c, n) {}
+  String(const std::string& s) : _s(s) {}
+  String(char c) : _s(1, c) {}
+  String(unsigned char v, unsigned char base = 10){ num((unsigned long long)v, base); }
+  String(int v, unsigned char base = 10){ snum(v, base); }
+  String(unsigned int v, unsigned char base = 10){ num(v, base); }
+  String(long v, unsigned char base = 10){ snum(v, base); }
+  String(unsigned long v, unsigned char base = 10){ num(v, base); }
+  String(long long v, unsigned char base = 10){ snum(v, base); }
+  String(unsigned long long v, unsigned char base = 10){ num(v, base); }
+  String(float v, unsigned int decimals = 2){ fnum(v, decimals); }
+  String(double v, unsigned int decimals = 2){ fnum(v, decimals); }
+
+  unsigned int length() const { return _s.size(); }
+  const char* c_str() const { return _s.c_str(); }
+  char* begin(){ return &_s[0]; }
+  char* end(){ return &_s[0] + _s.size(); }
+  bool isEmpty() const { return _s.empty(); }
+  bool reserve(unsigned int n){ _s.reserve(n); return true; }
+  void clear(){ _s.clear(); }
+
+  bool concat(const String& o){ _s += o._s; return true; }
+  bool concat(const char* c){ if (c) _s += c; return true; }
+  bool concat(const char* c, unsigned int n){ _s.append(c, n); return true; }
+  bool concat(char c){ _s += c; return true; }
+  template<class T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+  bool concat(T v){ _s += String(v)._s; return true; }
+  String& operator+=(const String& o){ concat(o); return *this; }
+  String& operator+=(const char* o){ concat(o); return *this; }
+  String& operator+=(char o){ concat(o); return *this; }
+  template<class T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+  String& operator+=(T v){ concat(v); return *this; }
+
+  bool operator==(const String& o) const { return _s == o._s; }
+  bool operator==(const char* o) const { return _s == (o ? o : ""); }
+  bool operator!=(const String& o) const { return _s != o._s; }
+  bool operator!=(const char* o) const { return !(*this == o); }
+  bool operator<(const String& o) const { return _s < o._s; }
+  char operator[](unsigned int i) const { return i < _s.size() ? _s[i] : 0; }
+  char& operator[](unsigned int i){ return _s[i]; }
+  char charAt(unsigned int i) const { return (*this)[i]; }
+  void setCharAt(unsigned int i, char c){ if (i < _s.size()) _s[i] = c; }
+  bool equals(const String& o) const { return _s == o._s; }
+  bool equalsIgnoreCase(const String& o) const {
+    if (_s.size() != o._s.size()) return false;
+    for (size_t i = 0; i < _s.size(); i++) if (tolower((unsigned char)_s[i]) != tolower((unsigned char)o._s[i])) return false;
+    return true;
+  }
+  bool startsWith(const String& p) const { return _s.compare(0, p._s.size(), p._s) == 0; }
+  bool endsWith(const String& p) const { return _s.size() >= p._s.size() && _s.compare(_s.size() - p._s.size(), p._s.size(), p._s) == 0; }
+  int indexOf(char c, unsigned int from = 0) const { return pos(_s.find(c, from)); }
+  int indexOf(const String& c, unsigned int from = 0) const { return pos(_s.find(c._s, from)); }
+  int lastIndexOf(char c) const { return pos(_s.rfind(c)); }
+  int lastIndexOf(const String& c) const { return pos(_s.rfind(c._s)); }
+  String substring(unsigned int a) const { return a >= _s.size() ? String() : String(_s.substr(a)); }
+  String substring(unsigned int a, unsigned int b) const {
+    if (a > b) std::swap(a, b);
+    return a >= _s.size() ? String() : String(_s.substr(a, b - a));
+  }
+  void trim(){
+    size_t b = 0, e = _s.size();
+    while (b < e && isspace((unsigned char)_s[b])) b++;
+    while (e > b && isspace((unsigned char)_s[e - 1])) e--;
+    _s = _s.substr(b, e - b);
+  }
+  void toLowerCase(){ for (auto& c : _s) c = tolower((unsigned char)c); }
+  void toUpperCase(){ for (auto& c : _s) c = toupper((unsigned char)c); }
+  void remove(unsigned int i){ if (i < _s.size()) _s.erase(i); }
+  void remove(unsigned int i, unsigned int n){ if (i < _s.size()) _s.erase(i, n); }
+  void replace(const String& a, const String& b){
+    if (a._s.empty()) return;
+    for (size_t p = 0; (p = _s.find(a._s, p)) != std::string::npos; p += b._s.size()) _s.replace(p, a._s.size(), b._s);
+  }
+  void replace(char a, char b){ for (auto& c : _s) if (c == a) c = b; }
+  long toInt() const { return atol(_s.c_str()); }
+  float toFloat() const { return atof(_s.c_str()); }
+  double toDouble() const { return atof(_s.c_str()); }
+  void getBytes(uint8_t* b, unsigned int n) const { if (!n) return; size_t k = std::min<size_t>(n - 1, _s.size()); memcpy(b, _s.data(), k); b[k] = 0; }
+  void toCharArray(char* b, unsigned int n) const { getBytes((uint8_t*)b, n); }
+  explicit operator bool() const { return true; }
+  const std::string& str() const { return _s; }
+
+private:
+  std::string _s;
+  static int pos(size_t p){ return p == std::string::npos ? -1 : (int)p; }
+  void num(unsigned long long v, unsigned char base){
+    char b[70]; char* p = b + sizeof(b); *--p = 0;
+    if (base < 2) base = 10;
+    do { const int d = v % base; *--p = d < 10 ? '0' + d : 'a' + d - 10; v /= base; } while (v);
+    _s = p;
+  }
+  void snum(long long v, unsigned char base){
+    if (base == 10 && v < 0) { num((unsigned long long)(-(v + 1)) + 1, 10); _s.insert(0, "-"); }
+    else num(base == 10 ? (unsigned long long)v : (unsigned long long)(unsigned int)v, base);
+  }
+  void fnum(double v, unsigned int decimals){ char b[64]; snprintf(b, sizeof(b), "%.*f", (int)decimals, v); _s = b; }
+};
+
+inline String operator+(const String& a, const String& b){ String r(a); r += b; return r; }
+inline String operator+(const String& a, const char* b){ String r(a); r += b; return r; }
+inline String operator+(const char* a, const String& b){ String r(a); r += b; return r; }
+inline String operator+(const String& a, char b){ String r(a); r += b; return r; }
+template<class T, typename std::enable_if<std::is_arithmetic<T>::value, int>::type = 0>
+inline String operator+(const String& a, T b){ String r(a); r += b; return r; }
+inline bool operator==(const char* a, const String& b){ return b == a; }
+
+class Print {
+public:
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) = 0;
+  virtual size_t write(const uint8_t* b, size_t n){ size_t k = 0; while (n--) { if (!write(*b++)) break; k++; } return k; }
+  size_t write(const char* s){ return s ? write((const uint8_t*)s, strlen(s)) : 0; }
+  size_t write(const char* s, size_t n){ return write((const uint8_t*)s, n); }
+  virtual void flush() {}
+  size_t print(const String& s){ return write((const uint8_t*)s.c_str(), s.length()); }
+  size_t print(const char* s){ return write(s); }
+  size_t print(char c){ return write((uint8_t)c); }
+  template<class T> size_t print(T v){ return print(String(v)); }
+  template<class T> size_t print(T v, int fmt){ return print(String(v, fmt)); }
+  size_t println(){ return write("\r\n"); }
+  template<class T> size_t println(T v){ const size_t n = print(v); return n + println(); }
+  template<class T> size_t println(T v, int fmt){ const size_t n = print(v, fmt); return n + println(); }
+  size_t printf(const char* fmt, ...) __attribute__((format(printf, 2, 3))) {
+    char small[256];
+    va_list ap; va_start(ap, fmt);
+    const int n = vsnprintf(small, sizeof(small), fmt, ap);
+    va_end(ap);
+    if (n < 0) return 0;
+    if ((size_t)n < sizeof(small)) return write((const uint8_t*)small, n);
+    std::string big(n + 1, '\0');
+    va_start(ap, fmt); vsnprintf(&big[0], big.size(), fmt, ap); va_end(ap);
+    return write((const uint8_t*)big.data(), n);
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual int available() = 0;
+  virtual int read() = 0;
+  virtual int peek() = 0;
+  void setTimeout(unsigned long ms){ _timeout = ms; }
+  size_t readBytes(char* b, size_t n){ size_t k = 0; int c; while (k < n && (c = read()) >= 0) b[k++] = (char)c; return k; }
+  size_t readBytes(uint8_t* b, size_t n){ return readBytes((char*)b, n); }
+  size_t readBytesUntil(char t, char* b, size_t n){
+    size_t k = 0; int c;
+    while (k < n && (c = read()) >= 0) { if (c == t) break; b[k++] = (char)c; }
+    return k;
+  }
+  size_t readBytesUntil(char t, uint8_t* b, size_t n){ return readBytesUntil(t, (char*)b, n); }
+  String readStringUntil(char t){ std::string s; int c; while ((c = read()) >= 0 && c != t) s += (char)c; return String(s); }
+  String readString(){ std::string s; int c; while ((c = read()) >= 0) s += (char)c; return String(s); }
+protected:
+  unsigned long _timeout = 1000;
+};
+
+// ---- waktu virtual & GPIO (implementasi di host.cpp) ----
+unsigned long millis();
+unsigned long micros();
+void delay(uint32_t ms);
+void delayMicroseconds(uint32_t us);
+void yield();
+void pinMode(uint8_t pin, uint8_t mode);
+void digitalWrite(uint8_t pin, uint8_t val);
+int digitalRead(uint8_t pin);
+int analogRead(uint8_t pin);
+void analogWrite(uint8_t pin, int val);
+void analogReadResolution(uint8_t bits);
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode);
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode);
+void detachInterrupt(uint8_t pin);
+inline int digitalPinToInterrupt(int pin){ return pin; }
+long random(long howbig);
+long random(long howsmall, long howbig);
+void randomSeed(unsigned long seed);
+
+enum hardwareSerial_error_t { UART_NO_ERROR, UART_BREAK_ERROR, UART_BUFFER_FULL_ERROR, UART_FIFO_OVF_ERROR, UART_FRAME_ERROR, UART_PARITY_ERROR };
+
+// UART: RX diisi test lewat hostRx() (memanggil callback onReceive seperti task event UART),
+// byte TX diteruskan ke model perangkat (onHostTx), mis. simulator GM66
+class HardwareSerial : public Stream {
+public:
+  explicit HardwareSerial(int num) : _num(num) {}
+  void begin(unsigned long baud, uint32_t config = SERIAL_8N1, int8_t rx = -1, int8_t tx = -1){ _baud = baud; _begun = true; (void)config; (void)rx; (void)tx; }
+  void end(){ _begun = false; }
+  void updateBaudRate(unsigned long baud){ _baud = baud; }
+  uint32_t baudRate() const { return _baud; }
+  size_t setRxBufferSize(size_t n){ _rxCap = n; return n; }
+  void onReceive(std::function<void(void)> cb, bool onlyOnTimeout = false){ _onRx = cb; (void)onlyOnTimeout; }
+  void onReceiveError(std::function<void(hardwareSerial_error_t)> cb){ _onErr = cb; }
+  bool setRxFIFOFull(uint8_t){ return true; }
+  bool setRxTimeout(uint8_t){ return true; }
+  int available() override { return (int)_rx.size(); }
+  int availableForWrite(){ return 128; }
+  int read() override { if (_rx.empty()) return -1; const int c = _rx.front(); _rx.pop_front(); return c; }
+  size_t read(uint8_t* b, size_t n){ size_t k = 0; while (k < n && !_rx.empty()) { b[k++] = _rx.front(); _rx.pop_front(); } return k; }
+  int peek() override { return _rx.empty() ? -1 : _rx.front(); }
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* b, size_t n) override;
+  using Print::write;
+  operator bool() const { return true; }
+
+  // ---- sisi host ----
+  // byte masuk FIFO RX; yang melebihi buffer dibuang + error (seperti driver UART)
+  void hostRx(const uint8_t* b, size_t n, bool notify = true);
+  void onHostTx(std::function<void(const uint8_t*, size_t)> fn){ _onTx = fn; }
+  void hostEcho(bool on){ _echo = on; }
+  void hostReset(){ _rx.clear(); _onRx = nullptr; _onErr = nullptr; _onTx = nullptr; _baud = 0; }
+private:
+  int _num;
+  bool _begun = false, _echo = false;
+  uint32_t _baud = 0;
+  size_t _rxCap = 256;
+  std::deque<uint8_t> _rx;
+  std::function<void(void)> _onRx;
+  std::function<void(hardwareSerial_error_t)> _onErr;
+  std::function<void(const uint8_t*, size_t)> _onTx;
+};
+extern HardwareSerial Serial;
+extern HardwareSerial Serial1;
+extern HardwareSerial Serial2;
+
+class EspClass {
+public:
+  void restart();
+  uint64_t getEfuseMac(){ return 0x0000A1B2C3D4E5F6ULL; }
+  uint32_t getFreeHeap();
+  uint32_t getMinFreeHeap();
+  uint32_t getMaxAllocHeap();
+  uint32_t getHeapSize(){ return 320 * 1024; }
+  uint32_t getPsramSize(){ return 8 * 1024 * 1024; }
+  uint32_t getFreePsram(){ return 8 * 1024 * 1024; }
+  uint32_t getCpuFreqMHz(){ return 240; }
+};
+extern EspClass ESP;
+
+bool psramFound();
+void* ps_malloc(size_t n);
+
+#include "freertos_shim.h"
+#include "IPAddress.h"
@@ -0,0 +1,322 @@
+#pragma once
+// Subset ArduinoJson v7 untuk host: pohon node (urutan member dipertahankan), proxy lazy untuk
+// d["a"]["b"] = x, konversi as/is/|, serialize/deserialize & DeserializationError. Semantik
+// mengikuti v7 untuk hal yang dipakai firmware (as<String>() non-string = JSON-nya, serialize ke
+// String menimpa isi, nesting limit 10). Bukan pengganti lengkap.
+#include "Arduino.h"
+#include <memory>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <cmath>
+#include <limits>
+
+namespace ajson {
+struct Node {
+  enum Type : uint8_t { Null, Bool, Int, UInt, Float, Str, Raw, Arr, Obj } t = Null;
+  bool b = false; bool single = false;
+  int64_t i = 0; uint64_t u = 0; double f = 0;
+  std::string s;
+  std::vector<std::pair<std::string, std::unique_ptr<Node>>> members;
+  std::vector<std::unique_ptr<Node>> items;
+  void reset(Type nt){ t = nt; s.clear(); members.clear(); items.clear(); }
+  Node* member(const char* k) const { for (auto& m : members) if (m.first == k) return m.second.get(); return nullptr; }
+  void copyFrom(const Node& o);
+};
+}
+
+struct SerializedValue { std::string s; };
+inline SerializedValue serialized(const String& s){ return { s.c_str() }; }
+inline SerializedValue serialized(const char* s){ return { s ? s : "" }; }
+inline SerializedValue serialized(const char* s, size_t n){ return { std::string(s, n) }; }
+inline SerializedValue serialized(const std::string& s){ return { s }; }
+
+class JsonVariant;
+class JsonProxy;
+class JsonObject;
+class JsonArray;
+class JsonDocument;
+
+template<class T> struct IsJsonRef : std::is_base_of<JsonVariant, T> {};
+
+class JsonIterator {
+public:
+  JsonIterator(const std::vector<std::unique_ptr<ajson::Node>>* v, size_t i) : _v(v), _i(i) {}
+  JsonVariant operator*() const;
+  JsonIterator& operator++(){ _i++; return *this; }
+  bool operator!=(const JsonIterator& o) const { return _i != o._i; }
+private:
+  const std::vector<std::unique_ptr<ajson::Node>>* _v; size_t _i;
+};
+
+class JsonVariant {
+public:
+  JsonVariant() {}
+  explicit JsonVariant(ajson::Node* n) : _node(n) {}
+  JsonVariant(const JsonVariant&) = default;
+  JsonVariant& operator=(const JsonVariant&) = default; // variabel: ikat ulang (seperti v7)
+  template<class T, class = typename std::enable_if<!IsJsonRef<T>::value>::type>
+  JsonVariant& operator=(const T& v){ set(v); return *this; }
+
+  JsonProxy operator[](const char* key) const;
+  JsonProxy operator[](const String& key) const;
+  JsonProxy operator[](const std::string& key) const;
+  template<class I, class = typename std::enable_if<std::is_integral<I>::value>::type>
+  JsonProxy operator[](I index) const;
+
+  bool isNull() const { const ajson::Node* n = node(); return !n || n->t == ajson::Node::Null; }
+  size_t size() const;
+  bool containsKey(const char* k) const { const ajson::Node* n = node(); return n && n->t == ajson::Node::Obj && n->member(k); }
+  void remove(const char* key) const;
+  void remove(const String& key) const { remove(key.c_str()); }
+  template<class I, class = typename std::enable_if<std::is_integral<I>::value>::type>
+  void remove(I index) const { removeAt((size_t)index); }
+  void clear() const { ajson::Node* n = node(); if (n) n->reset(n->t == ajson::Node::Arr || n->t == ajson::Node::Obj ? n->t : ajson::Node::Null); }
+
+  template<class T> T as() const;
+  template<class T> bool is() const;
+  template<class T> T to() const;
+  template<class T> typename std::enable_if<IsJsonRef<T>::value, T>::type add() const;
+  template<class T> bool add(const T& v) const { ajson::Node* n = appendNode(); if (!n) return false; JsonVariant(n).set(v); return true; }
+
+  template<class T, class = typename std::enable_if<!IsJsonRef<T>::value && !std::is_array<T>::value>::type>
+  operator T() const { return as<T>(); }
+
+  template<class T> T operator|(const T& def) const { return is<T>() ? as<T>() : def; }
+  const char* operator|(const char* def) const { return is<const char*>() ? as<const char*>() : def; }
+  String operator|(const String& def) const { return is<const char*>() ? as<String>() : def; }
+
+  bool operator==(const char* s) const { const char* v = as<const char*>(); return v && s && strcmp(v, s) == 0; }
+  bool operator!=(const char* s) const { return !(*this == s); }
+  template<class T, class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  bool operator==(T v) const { return is<T>() && as<T>() == v; }
+  template<class T, class = typename std::enable_if<std::is_arithmetic<T>::value>::type>
+  bool operator!=(T v) const { return !(*this == v); }
+
+  JsonIterator begin() const;
+  JsonIterator end() const;
+
+  // nilai
+  bool set(const JsonVariant& v) const;
+  bool set(bool v) const { return setScalar(ajson::Node::Bool, [&](ajson::Node& n){ n.b = v; }); }
+  bool set(const char* v) const;
+  bool set(char* v) const { return set((const char*)v); }
+  bool set(const String& v) const { return setStr(v.c_str(), v.length()); }
+  bool set(const std::string& v) const { return setStr(v.data(), v.size()); }
+  bool set(const SerializedValue& v) const;
+  bool set(std::nullptr_t) const { ajson::Node* n = resolve(true); if (n) n->reset(ajson::Node::Null); return n; }
+  template<size_t N> bool set(const char (&v)[N]) const { return set((const char*)v); }
+  template<class T> typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value && !std::is_same<T, bool>::value && !std::is_same<T, char>::value, bool>::type
+  set(T v) const { return setScalar(ajson::Node::Int, [&](ajson::Node& n){ n.i = v; }); }
+  template<class T> typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value && !std::is_same<T, bool>::value, bool>::type
+  set(T v) const { return setScalar(ajson::Node::UInt, [&](ajson::Node& n){ n.u = v; }); }
+  bool set(char v) const { return set((int)v); }
+  bool set(float v) const { return setScalar(ajson::Node::Float, [&](ajson::Node& n){ n.f = v; n.single = true; }); }
+  bool set(double v) const { return setScalar(ajson::Node::Float, [&](ajson::Node& n){ n.f = v; n.single = false; }); }
+
+  ajson::Node* node() const { return resolve(false); }
+  ajson::Node* resolve(bool create) const;
+
+protected:
+  ajson::Node* _node = nullptr;
+  std::shared_ptr<JsonVariant> _up;   // proxy: induk + key / index
+  std::string _key; long _index = -1;
+  friend class JsonProxy;
+
+  ajson::Node* appendNode() const;
+  void removeAt(size_t i) const;
+  bool setStr(const char* s, size_t n) const { return setScalar(ajson::Node::Str, [&](ajson::Node& x){ x.s.assign(s, n); }); }
+  template<class F> bool setScalar(ajson::Node::Type t, F f) const {
+    ajson::Node* n = resolve(true); if (!n) return false;
+    n->reset(t); f(*n); return true;
+  }
+};
+
+// hasil operator[]: assignment menyalin nilai ke member/elemen (bukan mengikat ulang)
+class JsonProxy : public JsonVariant {
+public:
+  JsonProxy(const JsonVariant& parent, const char* key) { _up = std::make_shared<JsonVariant>(parent); _key = key ? key : ""; }
+  JsonProxy(const JsonVariant& parent, size_t index) { _up = std::make_shared<JsonVariant>(parent); _index = (long)index; }
+  JsonProxy(const JsonProxy&) = default;
+  JsonProxy& operator=(const JsonProxy& o){ set((const JsonVariant&)o); return *this; }
+  template<class T> JsonProxy& operator=(const T& v){ set(v); return *this; }
+};
+
+class JsonObject : public JsonVariant {
+public:
+  JsonObject() {}
+  JsonObject(const JsonVariant& v) : JsonVariant(v) {}
+};
+class JsonArray : public JsonVariant {
+public:
+  JsonArray() {}
+  JsonArray(const JsonVariant& v) : JsonVariant(v) {}
+};
+typedef JsonVariant JsonVariantConst;
+typedef JsonObject JsonObjectConst;
+typedef JsonArray JsonArrayConst;
+
+class JsonDocument : public JsonVariant {
+public:
+  JsonDocument() : _root(new ajson::Node()) { _node = _root.get(); }
+  explicit JsonDocument(size_t) : JsonDocument() {}
+  JsonDocument(const JsonDocument& o) : JsonDocument() { _root->copyFrom(*o._root); }
+  JsonDocument(const JsonVariant& v) : JsonDocument() { if (v.node()) _root->copyFrom(*v.node()); }
+  JsonDocument& operator=(const JsonDocument& o){ if (this != &o) { ajson::Node tmp; tmp.copyFrom(*o._root); _root->copyFrom(tmp); } return *this; }
+  template<class T> JsonDocument& operator=(const T& v){ set(v); return *this; }
+  void clear(){ _root->reset(ajson::Node::Null); }
+  bool overflowed() const { return false; }
+  void shrinkToFit() {}
+  template<class T> T to(){ clear(); return JsonVariant::to<T>(); }
+private:
+  std::unique_ptr<ajson::Node> _root;
+};
+
+class DeserializationError {
+public:
+  enum Code { Ok, EmptyInput, IncompleteInput, InvalidInput, NoMemory, TooDeep };
+  DeserializationError(Code c = Ok) : _c(c) {}
+  explicit operator bool() const { return _c != Ok; }
+  bool operator==(Code c) const { return _c == c; }
+  bool operator!=(Code c) const { return _c != c; }
+  bool operator==(const DeserializationError& o) const { return _c == o._c; }
+  bool operator!=(const DeserializationError& o) const { return _c != o._c; }
+  Code code() const { return _c; }
+  const char* c_str() const {
+    static const char* const N[] = { "Ok", "EmptyInput", "IncompleteInput", "InvalidInput", "NoMemory", "TooDeep" };
+    return N[_c];
+  }
+private:
+  Code _c;
+};
+
+DeserializationError deserializeJson(JsonDocument& d, const char* s);
+DeserializationError deserializeJson(JsonDocument& d, const char* s, size_t n);
+DeserializationError deserializeJson(JsonDocument& d, Stream& s);
+inline DeserializationError deserializeJson(JsonDocument& d, const uint8_t* s, size_t n){ return deserializeJson(d, (const char*)s, n); }
+inline DeserializationError deserializeJson(JsonDocument& d, const String& s){ return deserializeJson(d, s.c_str(), s.length()); }
+inline DeserializationError deserializeJson(JsonDocument& d, const std::string& s){ return deserializeJson(d, s.data(), s.size()); }
+
+size_t serializeJson(const JsonVariant& v, std::string& out);
+size_t serializeJson(const JsonVariant& v, String& out);
+size_t serializeJson(const JsonVariant& v, Print& out);
+size_t serializeJson(const JsonVariant& v, char* buf, size_t cap);
+template<size_t N> size_t serializeJson(const JsonVariant& v, char (&buf)[N]){ return serializeJson(v, (char*)buf, N); }
+size_t measureJson(const JsonVariant& v);
+
+// ---- implementasi inline ----
+inline JsonVariant JsonIterator::operator*() const { return JsonVariant((*_v)[_i].get()); }
+
+inline JsonProxy JsonVariant::operator[](const char* key) const { return JsonProxy(*this, key); }
+inline JsonProxy JsonVariant::operator[](const String& key) const { return JsonProxy(*this, key.c_str()); }
+inline JsonProxy JsonVariant::operator[](const std::string& key) const { return JsonProxy(*this, key.c_str()); }
+template<class I, class> inline JsonProxy JsonVariant::operator[](I index) const { return JsonProxy(*this, (size_t)index); }
+
+inline size_t JsonVariant::size() const {
+  const ajson::Node* n = node(); if (!n) return 0;
+  return n->t == ajson::Node::Arr ? n->items.size() : n->t == ajson::Node::Obj ? n->members.size() : 0;
+}
+
+inline JsonIterator JsonVariant::begin() const {
+  static const std::vector<std::unique_ptr<ajson::Node>> none;
+  const ajson::Node* n = node();
+  return n && n->t == ajson::Node::Arr ? JsonIterator(&n->items, 0) : JsonIterator(&none, 0);
+}
+inline JsonIterator JsonVariant::end() const {
+  static const std::vector<std::unique_ptr<ajson::Node>> none;
+  const ajson::Node* n = node();
+  return n && n->t == ajson::Node::Arr ? JsonIterator(&n->items, n->items.size()) : JsonIterator(&none, 0);
+}
+
+template<class T> inline typename std::enable_if<IsJsonRef<T>::value, T>::type JsonVariant::add() const {
+  ajson::Node* n = appendNode(); if (!n) return T();
+  if (std::is_same<T, JsonObject>::value) n->reset(ajson::Node::Obj);
+  else if (std::is_same<T, JsonArray>::value) n->reset(ajson::Node::Arr);
+  return T(JsonVariant(n));
+}
+
+template<class T> inline T JsonVariant::to() const {
+  ajson::Node* n = resolve(true); if (!n) return T();
+  if (std::is_same<T, JsonObject>::value) n->reset(ajson::Node::Obj);
+  else if (std::is_same<T, JsonArray>::value) n->reset(ajson::Node::Arr);
+  else n->reset(ajson::Node::Null);
+  return T(JsonVariant(n));
+}
+
+namespace ajson {
+template<class T> struct Conv;
+template<class T> struct ConvInt {
+  static bool is(const Node* n){
+    if (!n) return false;
+    if (n->t == Node::Int) return n->i >= (int64_t)std::numeric_limits<T>::min() && (std::is_unsigned<T>::value ? n->i >= 0 : true) &&
+                                   (uint64_t)(n->i < 0 ? 0 : n->i) <= (uint64_t)std::numeric_limits<T>::max();
+    if (n->t == Node::UInt) return n->u <= (uint64_t)std::numeric_limits<T>::max();
+    return false;
+  }
+  static T as(const Node* n){
+    if (!n) return 0;
+    switch (n->t) {
+      case Node::Int: return is(n) ? (T)n->i : 0;
+      case Node::UInt: return is(n) ? (T)n->u : 0;
+      case Node::Float: return (n->f >= (double)std::numeric_limits<T>::min() && n->f <= (double)std::numeric_limits<T>::max()) ? (T)n->f : 0;
+      case Node::Bool: return n->b;
+      default: return 0;
+    }
+  }
+};
+template<class T> struct ConvFloat {
+  static bool is(const Node* n){ return n && (n->t == Node::Float || n->t == Node::Int || n->t == Node::UInt); }
+  static T as(const Node* n){
+    if (!n) return 0;
+    switch (n->t) { case Node::Float: return (T)n->f; case Node::Int: return (T)n->i; case Node::UInt: return (T)n->u; case Node::Bool: return n->b; default: return 0; }
+  }
+};
+template<class T> struct Conv : std::conditional<std::is_floating_point<T>::value, ConvFloat<T>, ConvInt<T>>::type {
+  static_assert(std::is_arithmetic<T>::value, "tipe tidak didukung shim ArduinoJson");
+};
+template<> struct Conv<bool> {
+  static bool is(const Node* n){ return n && n->t == Node::Bool; }
+  static bool as(const Node* n){
+    if (!n) return false;
+    switch (n->t) { case Node::Bool: return n->b; case Node::Int: return n->i != 0; case Node::UInt: return n->u != 0; case Node::Float: return n->f != 0; default: return false; }
+  }
+};
+template<> struct Conv<const char*> {
+  static bool is(const Node* n){ return n && n->t == Node::Str; }
+  static const char* as(const Node* n){ return is(n) ? n->s.c_str() : nullptr; }
+};
+template<> struct Conv<char*> {
+  static bool is(const Node* n){ return n && n->t == Node::Str; }
+  static char* as(const Node* n){ return is(n) ? (char*)n->s.c_str() : nullptr; }
+};
+std::string toJson(const Node* n);
+template<> struct Conv<String> {
+  static bool is(const Node* n){ return n && n->t == Node::Str; }
+  static String as(const Node* n){ return is(n) ? String(n->s.c_str()) : String(toJson(n).c_str()); }
+};
+template<> struct Conv<std::string> {
+  static bool is(const Node* n){ return n && n->t == Node::Str; }
+  static std::string as(const Node* n){ return is(n) ? n->s : toJson(n); }
+};
+}
+
+template<class T> inline T JsonVariant::as() const {
+  if constexpr (IsJsonRef<T>::value) {
+    const ajson::Node* n = node();
+    if (std::is_same<T, JsonObject>::value) return n && n->t == ajson::Node::Obj ? T(*this) : T();
+    if (std::is_same<T, JsonArray>::value) return n && n->t == ajson::Node::Arr ? T(*this) : T();
+    return T(*this);
+  } else {
+    return ajson::Conv<T>::as(node());
+  }
+}
+template<class T> inline bool JsonVariant::is() const {
+  const ajson::Node* n = node();
+  if constexpr (IsJsonRef<T>::value) {
+    if (std::is_same<T, JsonObject>::value) return n && n->t == ajson::Node::Obj;
+    if (std::is_same<T, JsonArray>::value) return n && n->t == ajson::Node::Arr;
+    return true;
+  } else {
+    return ajson::Conv<T>::is(n);
+  }
+}
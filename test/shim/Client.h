@@ -0,0 +1,24 @@
+#pragma once
+#include "Arduino.h"
+#include "IPAddress.h"
+
+// TCP client tanpa soket: "terhubung" bila link interface-nya up (lihat host_net.h).
+// Data aplikasi lewat PubSubClient palsu, jadi read/write di sini tidak membawa apa-apa.
+class Client : public Stream {
+public:
+  virtual int connect(IPAddress, uint16_t){ _conn = linkUp(); return _conn; }
+  virtual int connect(const char*, uint16_t){ _conn = linkUp(); return _conn; }
+  size_t write(uint8_t) override { return _conn ? 1 : 0; }
+  size_t write(const uint8_t*, size_t n) override { return _conn ? n : 0; }
+  using Print::write;
+  int available() override { return 0; }
+  int read() override { return -1; }
+  virtual int read(uint8_t*, size_t){ return 0; }
+  int peek() override { return -1; }
+  virtual void stop(){ _conn = false; }
+  virtual uint8_t connected(){ return _conn && linkUp(); }
+  virtual operator bool(){ return connected(); }
+  virtual bool linkUp() const = 0;
+protected:
+  bool _conn = false;
+};
@@ -0,0 +1,88 @@
+#pragma once
+// AsyncWebServer host: request dibuat test lewat host::http() (host_http.h), diproses sinkron
+// (body -> onRequestBody, lalu handler/onNotFound); respons chunked dipompa sampai selesai.
+#include "Arduino.h"
+#include <functional>
+#include <vector>
+#include <string>
+
+#define RESPONSE_TRY_AGAIN 0xFFFFFFFF
+
+typedef enum { HTTP_GET = 0b00000001, HTTP_POST = 0b00000010, HTTP_DELETE = 0b00000100, HTTP_PUT = 0b00001000,
+               HTTP_PATCH = 0b00010000, HTTP_HEAD = 0b00100000, HTTP_OPTIONS = 0b01000000, HTTP_ANY = 0b01111111 } WebRequestMethod;
+typedef uint8_t WebRequestMethodComposite;
+
+class AsyncWebParameter {
+public:
+  AsyncWebParameter(const String& n, const String& v, bool post = false, bool file = false) : _name(n), _value(v), _post(post), _file(file) {}
+  const String& name() const { return _name; }
+  const String& value() const { return _value; }
+  bool isPost() const { return _post; }
+  bool isFile() const { return _file; }
+private:
+  String _name, _value; bool _post, _file;
+};
+
+typedef std::function<size_t(uint8_t*, size_t, size_t)> AwsResponseFiller;
+
+class AsyncWebServerResponse {
+public:
+  int code = 200; String contentType; std::string body; AwsResponseFiller filler; bool chunked = false;
+  void addHeader(const String&, const String&) {}
+  void setCode(int c){ code = c; }
+};
+
+class AsyncWebServerRequest {
+public:
+  void* _tempObject = nullptr;
+  AsyncWebServerRequest(const char* method, const String& url, const String& query, size_t contentLength);
+  ~AsyncWebServerRequest(){ if (_tempObject) free(_tempObject); for (auto* p : _params) delete p; delete _resp; }
+  const String& url() const { return _url; }
+  WebRequestMethodComposite method() const { return _method; }
+  const char* methodToString() const { return _methodStr.c_str(); }
+  size_t contentLength() const { return _len; }
+  size_t params() const { return _params.size(); }
+  const AsyncWebParameter* getParam(size_t i) const { return i < _params.size() ? _params[i] : nullptr; }
+  const AsyncWebParameter* getParam(const String& name, bool post = false, bool file = false) const;
+  bool hasParam(const String& name, bool post = false, bool file = false) const { return getParam(name, post, file) != nullptr; }
+  void send(int code, const String& contentType = String(), const String& content = String());
+  void send(int code, const char* contentType, const char* content){ send(code, String(contentType), String(content)); }
+  void send(AsyncWebServerResponse* r){ delete _resp; _resp = r; }
+  AsyncWebServerResponse* beginResponse(int code, const String& contentType = String(), const String& content = String());
+  AsyncWebServerResponse* beginChunkedResponse(const String& contentType, AwsResponseFiller filler);
+  void onDisconnect(std::function<void()>) {}
+  AsyncWebServerResponse* hostResponse(){ return _resp; }
+private:
+  String _url, _methodStr; WebRequestMethodComposite _method; size_t _len;
+  std::vector<AsyncWebParameter*> _params;
+  AsyncWebServerResponse* _resp = nullptr;
+};
+
+typedef std::function<void(AsyncWebServerRequest*)> ArRequestHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, const String&, size_t, uint8_t*, size_t, bool)> ArUploadHandlerFunction;
+typedef std::function<void(AsyncWebServerRequest*, uint8_t*, size_t, size_t, size_t)> ArBodyHandlerFunction;
+
+class AsyncCallbackWebHandler {
+public:
+  String uri; WebRequestMethodComposite method; ArRequestHandlerFunction fn; ArUploadHandlerFunction upload; ArBodyHandlerFunction body;
+};
+
+class AsyncWebServer {
+public:
+  explicit AsyncWebServer(uint16_t port);
+  ~AsyncWebServer();
+  AsyncCallbackWebHandler& on(const char* uri, WebRequestMethodComposite m, ArRequestHandlerFunction fn,
+                              ArUploadHandlerFunction upload = nullptr, ArBodyHandlerFunction body = nullptr);
+  void onNotFound(ArRequestHandlerFunction fn){ _notFound = fn; }
+  void onRequestBody(ArBodyHandlerFunction fn){ _body = fn; }
+  void onFileUpload(ArUploadHandlerFunction fn){ _upload = fn; }
+  void begin(){ _begun = true; }
+  void end(){ _begun = false; }
+  // sisi host
+  void hostHandle(AsyncWebServerRequest* rq, const std::string& body, size_t chunk);
+  bool hostBegun() const { return _begun; }
+private:
+  std::vector<AsyncCallbackWebHandler*> _handlers;
+  ArRequestHandlerFunction _notFound; ArBodyHandlerFunction _body; ArUploadHandlerFunction _upload;
+  bool _begun = false;
+};
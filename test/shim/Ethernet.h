@@ -0,0 +1,53 @@
+#pragma once
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "Client.h"
+#include "Udp.h"
+#define ETHERNET_H
+
+enum EthernetLinkStatus { Unknown, LinkON, LinkOFF };
+enum EthernetHardwareStatus { EthernetNoHardware, EthernetW5100, EthernetW5200, EthernetW5500 };
+
+// W5500: link dari host::setEthLink; alamat diset static/DHCP (EthernetDhcp lewat UDP host)
+class EthernetClass {
+public:
+  void init(uint8_t cs){ (void)cs; }
+  int begin(uint8_t* mac, unsigned long timeout = 60000, unsigned long responseTimeout = 4000){ return 0; } // DHCP bawaan tidak dipakai
+  void begin(uint8_t* mac, IPAddress ip, IPAddress dns, IPAddress gw, IPAddress sn){ _ip = ip; _dns = dns; _gw = gw; _sn = sn; }
+  void begin(uint8_t* mac, IPAddress ip){ _ip = ip; }
+  int maintain(){ return 0; }
+  EthernetLinkStatus linkStatus();
+  EthernetHardwareStatus hardwareStatus();
+  IPAddress localIP(){ return _ip; }
+  IPAddress gatewayIP(){ return _gw; }
+  IPAddress subnetMask(){ return _sn; }
+  IPAddress dnsServerIP(){ return _dns; }
+  void setLocalIP(IPAddress ip){ _ip = ip; }
+  void setGatewayIP(IPAddress ip){ _gw = ip; }
+  void setSubnetMask(IPAddress ip){ _sn = ip; }
+  void setDnsServerIP(IPAddress ip){ _dns = ip; }
+  void MACAddress(uint8_t* m){ memset(m, 0, 6); }
+  void setRetransmissionTimeout(uint16_t){}
+  void setRetransmissionCount(uint8_t){}
+  void hostReset(){ _ip = _gw = _sn = _dns = IPAddress(); }
+private:
+  IPAddress _ip, _gw, _sn, _dns;
+};
+extern EthernetClass Ethernet;
+
+class EthernetClient : public Client {
+public:
+  bool linkUp() const override { return Ethernet.linkStatus() == LinkON && Ethernet.localIP() != IPAddress(); }
+  // server HTTP Ethernet tidak disimulasikan: klien dari available() tidak pernah terhubung
+  uint8_t connected() override { return _conn && linkUp(); }
+};
+class EthernetServer {
+public:
+  explicit EthernetServer(uint16_t port) : _port(port) {}
+  void begin(){}
+  EthernetClient available(){ return EthernetClient(); }
+  EthernetClient accept(){ return EthernetClient(); }
+private:
+  uint16_t _port;
+};
+class EthernetUDP : public UDP { public: EthernetUDP() : UDP(IF_ETH) {} };
@@ -0,0 +1,24 @@
+#pragma once
+#include "Arduino.h"
+
+class IPAddress {
+public:
+  IPAddress() {}
+  IPAddress(uint8_t a, uint8_t b, uint8_t c, uint8_t d){ _b[0] = a; _b[1] = b; _b[2] = c; _b[3] = d; }
+  IPAddress(uint32_t v){ memcpy(_b, &v, 4); } // urutan byte jaringan, seperti core ESP32
+  operator uint32_t() const { uint32_t v; memcpy(&v, _b, 4); return v; }
+  bool fromString(const char* s){
+    unsigned a, b, c, d; char tail;
+    if (!s || sscanf(s, "%u.%u.%u.%u%c", &a, &b, &c, &d, &tail) != 4 || a > 255 || b > 255 || c > 255 || d > 255) return false;
+    *this = IPAddress(a, b, c, d);
+    return true;
+  }
+  bool fromString(const String& s){ return fromString(s.c_str()); }
+  String toString() const { char b[16]; snprintf(b, sizeof(b), "%u.%u.%u.%u", _b[0], _b[1], _b[2], _b[3]); return String(b); }
+  uint8_t operator[](int i) const { return _b[i]; }
+  uint8_t& operator[](int i){ return _b[i]; }
+  bool operator==(const IPAddress& o) const { return memcmp(_b, o._b, 4) == 0; }
+  bool operator!=(const IPAddress& o) const { return !(*this == o); }
+private:
+  uint8_t _b[4] = {0, 0, 0, 0};
+};
@@ -0,0 +1,65 @@
+#pragma once
+// LittleFS host: direktori di disk (host::fsRoot). Meniru sifat atomik littlefs yang dipakai
+// firmware: isi file "w" baru terlihat saat close (sebelumnya isi lama utuh), data "a" yang
+// belum di-close hilang saat listrik putus. Setiap operasi mutasi dihitung; host::fsCutAfter(n)
+// memutus "listrik" tepat setelah operasi ke-n (lihat host_fs.h).
+#include "Arduino.h"
+#include <memory>
+
+#define FILE_READ "r"
+#define FILE_WRITE "w"
+#define FILE_APPEND "a"
+enum SeekMode { SeekSet = 0, SeekCur = 1, SeekEnd = 2 };
+
+namespace fs {
+struct FileImpl;
+
+class File : public Stream {
+public:
+  File() {}
+  explicit File(std::shared_ptr<FileImpl> p) : _p(p) {}
+  size_t write(uint8_t c) override { return write(&c, 1); }
+  size_t write(const uint8_t* b, size_t n) override;
+  using Print::write;
+  int available() override;
+  int read() override;
+  int peek() override;
+  size_t read(uint8_t* b, size_t n);
+  void flush() override;
+  bool seek(uint32_t pos, SeekMode mode = SeekSet);
+  size_t position() const;
+  size_t size() const;
+  void close();
+  operator bool() const;
+  const char* name() const;
+  const char* path() const;
+  bool isDirectory() const;
+  File openNextFile(const char* mode = "r");
+  void rewindDirectory();
+private:
+  std::shared_ptr<FileImpl> _p;
+};
+
+class FS {
+public:
+  bool begin(bool formatOnFail = false, const char* basePath = "/littlefs", uint8_t maxOpen = 10, const char* label = nullptr);
+  void end() {}
+  bool format();
+  File open(const char* path, const char* mode = "r", bool create = false);
+  File open(const String& path, const char* mode = "r", bool create = false){ return open(path.c_str(), mode, create); }
+  bool exists(const char* path);
+  bool exists(const String& path){ return exists(path.c_str()); }
+  bool remove(const char* path);
+  bool remove(const String& path){ return remove(path.c_str()); }
+  bool rename(const char* from, const char* to);
+  bool rename(const String& from, const String& to){ return rename(from.c_str(), to.c_str()); }
+  bool mkdir(const char* path);
+  bool mkdir(const String& path){ return mkdir(path.c_str()); }
+  bool rmdir(const char* path);
+  size_t totalBytes();
+  size_t usedBytes();
+};
+}
+using fs::File;
+using fs::FS;
+extern fs::FS LittleFS;
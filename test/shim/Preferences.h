@@ -0,0 +1,26 @@
+#pragma once
+// NVS host: map di memori, bertahan selama proses (melewati "reboot" di test).
+#include <Arduino.h>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace host { void nvsReset(); std::map<std::string, std::map<std::string, std::vector<uint8_t>>>& nvs(); uint64_t nvsWrites(); }
+
+class Preferences {
+public:
+  bool begin(const char* ns, bool readOnly = false){ _ns = ns ? ns : ""; _ro = readOnly; _open = true; return true; }
+  void end(){ _open = false; }
+  size_t putBytes(const char* key, const void* v, size_t n);
+  size_t getBytes(const char* key, void* buf, size_t max);
+  size_t getBytesLength(const char* key);
+  size_t putULong64(const char* key, uint64_t v){ return putBytes(key, &v, sizeof(v)); }
+  uint64_t getULong64(const char* key, uint64_t d = 0){ uint64_t v; return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : d; }
+  size_t putUInt(const char* key, uint32_t v){ return putBytes(key, &v, sizeof(v)); }
+  uint32_t getUInt(const char* key, uint32_t d = 0){ uint32_t v; return getBytesLength(key) == sizeof(v) && getBytes(key, &v, sizeof(v)) ? v : d; }
+  bool isKey(const char* key);
+  bool remove(const char* key);
+  bool clear();
+private:
+  std::string _ns; bool _ro = false, _open = false;
+};
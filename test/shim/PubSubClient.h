@@ -0,0 +1,55 @@
+#pragma once
+#include "Arduino.h"
+#include "Client.h"
+#include <functional>
+
+#define MQTT_MAX_PACKET_SIZE 256
+#define MQTT_MAX_HEADER_SIZE 5
+#define MQTT_CONNECTED 0
+#define MQTT_CONNECTION_TIMEOUT (-4)
+#define MQTT_CONNECTION_LOST (-3)
+#define MQTT_CONNECT_FAILED (-2)
+#define MQTT_DISCONNECTED (-1)
+
+// PubSubClient dengan broker palsu (host_net.h): connect/publish sukses hanya bila broker up
+// dan link interface client terpilih up. Batas buffer sama dengan library (default 256 byte).
+class PubSubClient {
+public:
+  using Callback = std::function<void(char*, uint8_t*, unsigned int)>;
+  PubSubClient() {}
+  explicit PubSubClient(Client& c) : _client(&c) {}
+  PubSubClient& setClient(Client& c){ _client = &c; return *this; }
+  PubSubClient& setServer(const char* host, uint16_t port){ _host = host ? host : ""; _port = port; return *this; }
+  PubSubClient& setServer(IPAddress ip, uint16_t port){ _host = ip.toString().c_str(); _port = port; return *this; }
+  PubSubClient& setCallback(Callback cb){ _cb = cb; return *this; }
+  PubSubClient& setSocketTimeout(uint16_t s){ _timeoutS = s; return *this; }
+  PubSubClient& setKeepAlive(uint16_t){ return *this; }
+  bool setBufferSize(uint16_t n){ _bufSize = n; return true; }
+  uint16_t getBufferSize(){ return _bufSize; }
+
+  bool connect(const char* id){ return connect(id, nullptr, nullptr); }
+  bool connect(const char* id, const char* user, const char* pass);
+  bool connect(const char* id, const char* user, const char* pass, const char*, uint8_t, bool, const char*){ return connect(id, user, pass); }
+  void disconnect(){ _connected = false; _state = MQTT_DISCONNECTED; }
+  bool connected();
+  bool loop(){ return connected(); }
+  int state(){ connected(); return _state; }
+
+  bool publish(const char* topic, const char* payload, bool retained = false){ return publish(topic, (const uint8_t*)payload, payload ? strlen(payload) : 0, retained); }
+  bool publish(const char* topic, const char* payload, unsigned int len, bool retained){ return publish(topic, (const uint8_t*)payload, len, retained); }
+  bool publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained = false);
+  bool beginPublish(const char* topic, unsigned int len, bool retained);
+  size_t write(uint8_t c){ return write(&c, 1); }
+  size_t write(const uint8_t* b, size_t n);
+  int endPublish();
+private:
+  Client* _client = nullptr;
+  std::string _host; uint16_t _port = 0;
+  Callback _cb;
+  uint16_t _bufSize = MQTT_MAX_PACKET_SIZE, _timeoutS = 15;
+  bool _connected = false;
+  int _state = MQTT_DISCONNECTED;
+  uint32_t _session = 0;
+  // beginPublish..endPublish
+  std::string _pubTopic, _pubData; unsigned int _pubLen = 0; bool _pubRetained = false, _pubOpen = false;
+};
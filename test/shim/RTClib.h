@@ -0,0 +1,37 @@
+#pragma once
+// RTClib host: DateTime lengkap + model DS3231 (host_rtc.h) dengan drift ppm, flag OSF dan
+// keluaran SQW 1 Hz yang turun tepat di batas detik RTC.
+#include "Arduino.h"
+
+class DateTime {
+public:
+  DateTime(uint32_t t = 946684800UL);
+  DateTime(uint16_t y, uint8_t m, uint8_t d, uint8_t hh = 0, uint8_t mm = 0, uint8_t ss = 0);
+  uint16_t year() const { return _y; }
+  uint8_t month() const { return _m; }
+  uint8_t day() const { return _d; }
+  uint8_t hour() const { return _hh; }
+  uint8_t minute() const { return _mm; }
+  uint8_t second() const { return _ss; }
+  uint8_t dayOfTheWeek() const { return (uint8_t)((unixtime() / 86400UL + 4) % 7); }
+  uint32_t unixtime() const;
+  uint32_t secondstime() const { return unixtime() - 946684800UL; }
+  bool isValid() const { return _y >= 2000 && _m >= 1 && _m <= 12 && _d >= 1 && _d <= 31 && _hh < 24 && _mm < 60 && _ss < 60; }
+private:
+  uint16_t _y; uint8_t _m, _d, _hh, _mm, _ss;
+};
+
+enum Ds3231SqwPinMode { DS3231_OFF = 0x1C, DS3231_SquareWave1Hz = 0x00, DS3231_SquareWave1kHz = 0x08,
+                        DS3231_SquareWave4kHz = 0x10, DS3231_SquareWave8kHz = 0x18 };
+
+class TwoWire;
+class RTC_DS3231 {
+public:
+  bool begin(TwoWire* w = nullptr);
+  bool lostPower();
+  DateTime now();
+  void adjust(const DateTime& dt);
+  float getTemperature();
+  void writeSqwPinMode(Ds3231SqwPinMode m);
+  Ds3231SqwPinMode readSqwPinMode();
+};
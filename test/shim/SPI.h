@@ -0,0 +1,4 @@
+#pragma once
+#include "Arduino.h"
+struct SPIClass { void begin(int8_t = -1, int8_t = -1, int8_t = -1, int8_t = -1) {} void end() {} };
+extern SPIClass SPI;
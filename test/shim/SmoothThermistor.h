@@ -0,0 +1,27 @@
+#pragma once
+// SmoothThermistor host: rumus beta dari analogRead() (nilai diatur test lewat host::setAnalog).
+#include <Arduino.h>
+#include <math.h>
+
+#define ADC_SIZE_8_BIT 8
+#define ADC_SIZE_10_BIT 10
+#define ADC_SIZE_12_BIT 12
+
+class SmoothThermistor {
+public:
+  SmoothThermistor(uint8_t pin, uint8_t adcSize = ADC_SIZE_10_BIT, uint32_t nominalR = 10000, uint32_t seriesR = 10000,
+                   uint16_t beta = 3950, uint8_t nominalT = 25, uint8_t samples = 10)
+    : _pin(pin), _max((1UL << adcSize) - 1), _nomR(nominalR), _serR(seriesR), _beta(beta), _nomT(nominalT), _n(samples ? samples : 1) {}
+  void useAREF(bool v){ _aref = v; }
+  float temperature(){
+    float avg = 0;
+    for (uint8_t i = 0; i < _n; i++) avg += analogRead(_pin);
+    avg /= _n;
+    if (avg <= 0 || avg >= _max) return NAN;
+    const float r = _serR / ((float)_max / avg - 1.0f);
+    float s = logf(r / _nomR) / _beta + 1.0f / (_nomT + 273.15f);
+    return 1.0f / s - 273.15f;
+  }
+private:
+  uint8_t _pin; uint32_t _max, _nomR, _serR; uint16_t _beta; uint8_t _nomT, _n; bool _aref = false;
+};
@@ -0,0 +1,45 @@
+#pragma once
+#include "Arduino.h"
+#include "IPAddress.h"
+#include <vector>
+
+// UDP lewat jaringan host (host_net.h): paket keluar ke server palsu per port tujuan,
+// balasan masuk ke soket yang terikat di port lokal, pada interface yang sama
+class UDP : public Stream {
+public:
+  enum Iface : uint8_t { IF_WIFI, IF_ETH };
+  explicit UDP(Iface i) : _if(i) {}
+  virtual ~UDP();
+  virtual uint8_t begin(uint16_t port);
+  virtual void stop();
+  virtual int beginPacket(IPAddress ip, uint16_t port);
+  virtual int beginPacket(const char* host, uint16_t port);
+  virtual int endPacket();
+  size_t write(uint8_t c) override { _out.push_back(c); return 1; }
+  size_t write(const uint8_t* b, size_t n) override { _out.insert(_out.end(), b, b + n); return n; }
+  using Print::write;
+  virtual int parsePacket();
+  int available() override { return (int)(_cur.size() - _pos); }
+  int read() override { return _pos < _cur.size() ? _cur[_pos++] : -1; }
+  virtual int read(unsigned char* b, size_t n){ size_t k = 0; while (k < n && _pos < _cur.size()) b[k++] = _cur[_pos++]; return (int)k; }
+  virtual int read(char* b, size_t n){ return read((unsigned char*)b, n); }
+  int peek() override { return _pos < _cur.size() ? _cur[_pos] : -1; }
+  void flush() override {}
+  virtual IPAddress remoteIP(){ return _curFrom; }
+  virtual uint16_t remotePort(){ return _curPort; }
+
+  // sisi host
+  struct Packet { std::vector<uint8_t> data; IPAddress from; uint16_t fromPort; };
+  Iface iface() const { return _if; }
+  uint16_t localPort() const { return _port; }
+  void hostDeliver(const Packet& p){ _inbox.push_back(p); }
+private:
+  Iface _if;
+  uint16_t _port = 0;
+  bool _open = false;
+  std::vector<uint8_t> _out;
+  String _dstHost; IPAddress _dst; uint16_t _dstPort = 0;
+  std::vector<Packet> _inbox;
+  std::vector<uint8_t> _cur; size_t _pos = 0;
+  IPAddress _curFrom; uint16_t _curPort = 0;
+};
@@ -0,0 +1,74 @@
+#pragma once
+#include "Arduino.h"
+#include "IPAddress.h"
+#include "Client.h"
+#include "Udp.h"
+#include <time.h>
+
+typedef enum { WL_IDLE_STATUS = 0, WL_NO_SSID_AVAIL = 1, WL_SCAN_COMPLETED = 2, WL_CONNECTED = 3,
+               WL_CONNECT_FAILED = 4, WL_CONNECTION_LOST = 5, WL_DISCONNECTED = 6 } wl_status_t;
+typedef enum { WIFI_OFF = 0, WIFI_STA = 1, WIFI_AP = 2, WIFI_AP_STA = 3 } wifi_mode_t;
+#define WIFI_SCAN_RUNNING (-1)
+#define WIFI_SCAN_FAILED (-2)
+
+// Wi-Fi STA: terhubung connectMs setelah begin() selama AP (host::setWifi) ada; AP hilang =
+// putus, AP kembali = sambung ulang otomatis (setAutoReconnect, default on di core ESP32)
+class WiFiClass {
+public:
+  wl_status_t status();
+  IPAddress localIP();
+  IPAddress gatewayIP(){ return status() == WL_CONNECTED ? IPAddress(192, 168, 1, 1) : IPAddress(); }
+  IPAddress subnetMask(){ return status() == WL_CONNECTED ? IPAddress(255, 255, 255, 0) : IPAddress(); }
+  IPAddress dnsIP(uint8_t = 0){ return gatewayIP(); }
+  IPAddress softAPIP(){ return _ap ? IPAddress(192, 168, 4, 1) : IPAddress(); }
+  String SSID(){ return status() == WL_CONNECTED ? _ssid : String(); }
+  String SSID(uint8_t i);
+  int32_t RSSI(){ return status() == WL_CONNECTED ? -55 : 0; }
+  int32_t RSSI(uint8_t){ return -55; }
+  uint8_t encryptionType(uint8_t){ return 3; }
+  uint8_t* BSSID(){ return _bssid; }
+  uint8_t* BSSID(uint8_t){ return _bssid; }
+  String BSSIDstr(){ return String("02:00:00:00:00:01"); }
+  String BSSIDstr(uint8_t){ return BSSIDstr(); }
+  int32_t channel(){ return 6; }
+  int32_t channel(uint8_t){ return 6; }
+  int16_t scanNetworks(bool async = false, bool showHidden = false, bool passive = false, uint32_t maxMs = 300, uint8_t channel = 0);
+  int16_t scanComplete();
+  void scanDelete(){ _scan = -2; }
+  bool mode(wifi_mode_t m){ _mode = m; return true; }
+  wifi_mode_t getMode(){ return _mode; }
+  bool setHostname(const char*){ return true; }
+  wl_status_t begin(const char* ssid, const char* pass = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr, bool connect = true);
+  bool config(IPAddress ip, IPAddress gw, IPAddress sn, IPAddress dns1 = IPAddress(), IPAddress dns2 = IPAddress()){ _staticIp = ip; return true; }
+  bool softAP(const char*, const char* = nullptr, int = 1, int = 0, int = 4){ _ap = true; return true; }
+  bool softAPdisconnect(bool = false){ _ap = false; return true; }
+  bool disconnect(bool wifioff = false, bool eraseap = false){ _begun = false; return true; }
+  bool reconnect(){ if (_ssid.length()) begin(_ssid.c_str()); return true; }
+  bool setAutoReconnect(bool on){ _auto = on; return true; }
+  bool getAutoReconnect(){ return _auto; }
+  void persistent(bool){}
+  bool setSleep(bool){ return true; }
+  void macAddress(uint8_t* m){ const uint8_t mac[6] = { 0x02, 0xA1, 0xB2, 0xC3, 0xD4, 0xE5 }; memcpy(m, mac, 6); }
+  String macAddress(){ return String("02:A1:B2:C3:D4:E5"); }
+  int hostByName(const char*, IPAddress& ip){ ip = IPAddress(10, 0, 0, 2); return status() == WL_CONNECTED; }
+  // sisi host
+  void hostReset();
+private:
+  String _ssid;
+  bool _begun = false, _auto = true, _ap = false;
+  uint64_t _beginUs = 0;
+  wifi_mode_t _mode = WIFI_STA;
+  IPAddress _staticIp;
+  uint8_t _bssid[6] = { 2, 0, 0, 0, 0, 1 };
+  int16_t _scan = -2; uint64_t _scanDoneUs = 0;
+};
+extern WiFiClass WiFi;
+
+class WiFiClient : public Client {
+public:
+  bool linkUp() const override { return WiFi.status() == WL_CONNECTED; }
+};
+class WiFiUDP : public UDP { public: WiFiUDP() : UDP(IF_WIFI) {} };
+
+void configTime(long gmtOffset, int dstOffset, const char* s1, const char* s2 = nullptr, const char* s3 = nullptr);
+bool getLocalTime(struct tm* info, uint32_t ms = 5000);
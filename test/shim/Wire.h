@@ -0,0 +1,4 @@
+#pragma once
+#include "Arduino.h"
+struct TwoWire { bool begin(int = -1, int = -1, uint32_t = 0){ return true; } void setClock(uint32_t) {} };
+extern TwoWire Wire;
@@ -0,0 +1,5 @@
+#pragma once
+// RTC memory di host = memori biasa; "power-on" disimulasikan test dengan mengosongkannya sendiri
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+#define IRAM_ATTR
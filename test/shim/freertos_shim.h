@@ -0,0 +1,48 @@
+#pragma once
+// FreeRTOS kooperatif untuk host: task = coroutine (ucontext) yang hanya berpindah di
+// vTaskDelay()/delay(); semaphore tanpa preemption. Take yang harus menunggu memajukan waktu
+// virtual sampai pemegang (task lain) melepas, atau timeout.
+#include <cstdint>
+
+typedef void* SemaphoreHandle_t;
+typedef void* TaskHandle_t;
+typedef uint32_t TickType_t;
+typedef int BaseType_t;
+typedef unsigned UBaseType_t;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xffffffffUL
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(x) ((TickType_t)(x))
+#define tskNO_AFFINITY 0x7fffffff
+#define configTICK_RATE_HZ 1000
+
+SemaphoreHandle_t xSemaphoreCreateMutex();
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex();
+SemaphoreHandle_t xSemaphoreCreateBinary();
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait);
+BaseType_t xSemaphoreGive(SemaphoreHandle_t s);
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t wait);
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t s);
+void vSemaphoreDelete(SemaphoreHandle_t s);
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t stack, void* arg,
+                                   UBaseType_t prio, TaskHandle_t* out, BaseType_t core);
+inline BaseType_t xTaskCreate(void (*fn)(void*), const char* name, uint32_t stack, void* arg, UBaseType_t prio, TaskHandle_t* out){
+  return xTaskCreatePinnedToCore(fn, name, stack, arg, prio, out, tskNO_AFFINITY);
+}
+void vTaskDelay(TickType_t ticks);
+void vTaskDelete(TaskHandle_t t);
+TickType_t xTaskGetTickCount();
+
+// tanpa preemption & ISR nyata: critical section cukup no-op
+typedef struct { int owner; } portMUX_TYPE;
+#define portMUX_INITIALIZER_UNLOCKED { 0 }
+inline void portENTER_CRITICAL(portMUX_TYPE*) {}
+inline void portEXIT_CRITICAL(portMUX_TYPE*) {}
+inline void portENTER_CRITICAL_ISR(portMUX_TYPE*) {}
+inline void portEXIT_CRITICAL_ISR(portMUX_TYPE*) {}
+inline void portYIELD_FROM_ISR(BaseType_t = 0) {}
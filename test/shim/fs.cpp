@@ -0,0 +1,241 @@
+#include "host_fs.h"
+#include <LittleFS.h>
+#include <filesystem>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
+
+namespace stdfs = std::filesystem;
+
+fs::FS LittleFS;
+
+namespace {
+const size_t BLOCK = 4096;
+std::string g_root;
+size_t g_total = 0x160000;
+uint64_t g_ops = 0, g_bytes = 0, g_blocks = 0, g_cutAt = 0;
+uint32_t g_shadowSeq = 0;
+std::vector<std::weak_ptr<fs::FileImpl>> g_open;
+
+const std::string& root(){
+  if (g_root.empty()) {
+    const char* e = getenv("HOST_FS");
+    g_root = e && *e ? e : "/tmp/hostfs-" + std::to_string(getpid());
+  }
+  return g_root;
+}
+std::string real(const char* p){ std::string s = p ? p : ""; if (s.empty() || s[0] != '/') s = "/" + s; return root() + s; }
+size_t blocksOf(uint64_t n){ return (size_t)((n + BLOCK - 1) / BLOCK); }
+}
+
+namespace fs {
+struct FileImpl {
+  std::string path, realPath, shadow;
+  char mode = 'r';                 // r, w, a, d (direktori)
+  FILE* fp = nullptr;
+  uint64_t openSize = 0;
+  bool dead = false;
+  std::vector<std::string> entries; size_t next = 0;
+  std::string nameBuf;
+  ~FileImpl(){ if (!dead) commit(); } // File lepas tanpa close(): core ESP32 juga menutupnya
+  void commit();
+  void rollback();
+};
+
+void FileImpl::commit(){
+  if (!fp) return;
+  fclose(fp); fp = nullptr;
+  std::error_code ec;
+  if (mode == 'w') {
+    const uint64_t sz = stdfs::file_size(shadow, ec);
+    stdfs::rename(shadow, realPath, ec);
+    g_blocks += blocksOf(sz) + 1;
+  } else if (mode == 'a') {
+    const uint64_t sz = stdfs::file_size(realPath, ec);
+    if (sz > openSize) g_blocks += blocksOf(sz) - openSize / BLOCK + 1;
+  }
+}
+
+void FileImpl::rollback(){
+  if (fp) { fclose(fp); fp = nullptr; }
+  std::error_code ec;
+  if (mode == 'w') stdfs::remove(shadow, ec);
+  else if (mode == 'a') stdfs::resize_file(realPath, openSize, ec);
+  dead = true;
+}
+}
+
+static void powerCut(){
+  for (auto& w : g_open) if (auto p = w.lock()) if (!p->dead) p->rollback();
+  g_open.clear();
+  throw host::PowerCut();
+}
+
+// satu operasi mutasi selesai; putus listrik bila jatuh tempo
+static void op(){
+  g_ops++;
+  if (g_cutAt && g_ops >= g_cutAt) { g_cutAt = 0; powerCut(); }
+}
+
+namespace host {
+void fsRoot(const std::string& dir){ g_root = dir; }
+const std::string& fsRoot(){ return root(); }
+void fsFormat(){
+  for (auto& w : g_open) if (auto p = w.lock()) { if (p->fp) fclose(p->fp); p->fp = nullptr; p->dead = true; }
+  g_open.clear();
+  std::error_code ec;
+  stdfs::remove_all(root(), ec);
+  stdfs::create_directories(root() + "/.shadow", ec);
+}
+void fsSetTotal(size_t bytes){ g_total = bytes; }
+uint64_t fsOps(){ return g_ops; }
+uint64_t fsBytesWritten(){ return g_bytes; }
+uint64_t fsBlocksProgrammed(){ return g_blocks; }
+void fsCutAfter(uint64_t n){ g_cutAt = n ? g_ops + n : 0; }
+bool fsCutArmed(){ return g_cutAt != 0; }
+}
+
+namespace fs {
+bool FS::begin(bool, const char*, uint8_t, const char*){
+  std::error_code ec;
+  stdfs::create_directories(root() + "/.shadow", ec);
+  return !ec;
+}
+bool FS::format(){ host::fsFormat(); return true; }
+
+File FS::open(const char* path, const char* mode, bool){
+  std::error_code ec;
+  auto p = std::make_shared<FileImpl>();
+  p->path = path ? path : ""; p->realPath = real(path);
+  p->mode = mode && *mode ? mode[0] : 'r';
+  if (stdfs::is_directory(p->realPath, ec)) {
+    if (p->mode != 'r') return File();
+    p->mode = 'd';
+    for (auto& e : stdfs::directory_iterator(p->realPath, ec)) {
+      const std::string n = e.path().filename().string();
+      if (n != ".shadow") p->entries.push_back(n);
+    }
+    std::sort(p->entries.begin(), p->entries.end());
+    return File(p);
+  }
+  if (p->mode == 'r') {
+    p->fp = fopen(p->realPath.c_str(), "rb");
+    if (!p->fp) return File();
+    return File(p);
+  }
+  if (!stdfs::is_directory(stdfs::path(p->realPath).parent_path(), ec)) return File();
+  if (p->mode == 'w') {
+    // littlefs: entri dibuat saat open, isi baru ter-commit saat close
+    if (!stdfs::exists(p->realPath, ec)) { FILE* t = fopen(p->realPath.c_str(), "wb"); if (t) fclose(t); }
+    p->shadow = root() + "/.shadow/" + std::to_string(++g_shadowSeq);
+    p->fp = fopen(p->shadow.c_str(), "wb");
+  } else {
+    p->openSize = stdfs::exists(p->realPath, ec) ? stdfs::file_size(p->realPath, ec) : 0;
+    p->fp = fopen(p->realPath.c_str(), "ab");
+  }
+  if (!p->fp) return File();
+  g_open.erase(std::remove_if(g_open.begin(), g_open.end(), [](const std::weak_ptr<FileImpl>& w){ return w.expired(); }), g_open.end());
+  g_open.push_back(p);
+  op();
+  return File(p);
+}
+
+bool FS::exists(const char* path){ std::error_code ec; return stdfs::exists(real(path), ec); }
+
+bool FS::remove(const char* path){
+  std::error_code ec;
+  const std::string r = real(path);
+  if (!stdfs::exists(r, ec) || stdfs::is_directory(r, ec)) return false;
+  stdfs::remove(r, ec);
+  g_blocks++;
+  op();
+  return !ec;
+}
+
+bool FS::rename(const char* from, const char* to){
+  std::error_code ec;
+  if (!stdfs::exists(real(from), ec)) return false;
+  stdfs::rename(real(from), real(to), ec);
+  g_blocks++;
+  op();
+  return !ec;
+}
+
+bool FS::mkdir(const char* path){
+  std::error_code ec;
+  const bool ok = stdfs::create_directory(real(path), ec) || stdfs::is_directory(real(path), ec);
+  g_blocks++;
+  op();
+  return ok;
+}
+
+bool FS::rmdir(const char* path){ std::error_code ec; return stdfs::remove(real(path), ec); }
+
+size_t FS::totalBytes(){ return g_total; }
+
+size_t FS::usedBytes(){
+  std::error_code ec; size_t used = 2 * BLOCK; // superblock
+  for (auto& e : stdfs::recursive_directory_iterator(root(), ec)) {
+    if (e.is_directory(ec)) continue;
+    used += blocksOf(e.file_size(ec)) * BLOCK;
+  }
+  return used;
+}
+
+// ---- File ----
+size_t File::write(const uint8_t* b, size_t n){
+  if (!_p || _p->dead || !_p->fp || (_p->mode != 'w' && _p->mode != 'a') || !n) return 0;
+  // partisi penuh: tulis sebagian seperti littlefs (LFS_ERR_NOSPC)
+  const size_t used = LittleFS.usedBytes(), cur = size();
+  const size_t room = used >= g_total ? 0 : g_total - used + (BLOCK - cur % BLOCK) % BLOCK;
+  if (n > room) n = room;
+  const size_t k = n ? fwrite(b, 1, n, _p->fp) : 0;
+  g_bytes += k;
+  op();
+  return k;
+}
+int File::available(){ return _p && _p->fp && _p->mode == 'r' ? (int)(size() - position()) : 0; }
+int File::read(){ if (!_p || !_p->fp || _p->mode != 'r') return -1; const int c = fgetc(_p->fp); return c == EOF ? -1 : c; }
+int File::peek(){ const int c = read(); if (c >= 0) ungetc(c, _p->fp); return c; }
+size_t File::read(uint8_t* b, size_t n){ return _p && _p->fp && _p->mode == 'r' ? fread(b, 1, n, _p->fp) : 0; }
+void File::flush(){
+  if (!_p || _p->dead || !_p->fp || _p->mode == 'r') return;
+  fflush(_p->fp);
+  op();
+}
+bool File::seek(uint32_t pos, SeekMode mode){
+  if (!_p || !_p->fp) return false;
+  return fseek(_p->fp, (long)pos, mode == SeekSet ? SEEK_SET : mode == SeekCur ? SEEK_CUR : SEEK_END) == 0;
+}
+size_t File::position() const { return _p && _p->fp ? (size_t)ftell(_p->fp) : 0; }
+size_t File::size() const {
+  if (!_p || !_p->fp) return 0;
+  fflush(_p->fp);
+  std::error_code ec;
+  return (size_t)stdfs::file_size(_p->mode == 'w' ? _p->shadow : _p->realPath, ec);
+}
+void File::close(){
+  if (!_p) return;
+  auto p = _p; _p.reset();
+  if (p->dead) return;
+  const bool mut = p->fp && (p->mode == 'w' || p->mode == 'a');
+  p->commit();
+  p->dead = true; // commit sekali saja
+  if (mut) op();
+}
+File::operator bool() const { return _p && !_p->dead && (_p->fp || _p->mode == 'd'); }
+const char* File::name() const {
+  if (!_p) return "";
+  const size_t s = _p->path.find_last_of('/');
+  _p->nameBuf = s == std::string::npos ? _p->path : _p->path.substr(s + 1);
+  return _p->nameBuf.c_str();
+}
+const char* File::path() const { return _p ? _p->path.c_str() : ""; }
+bool File::isDirectory() const { return _p && _p->mode == 'd'; }
+File File::openNextFile(const char* mode){
+  if (!_p || _p->mode != 'd' || _p->next >= _p->entries.size()) return File();
+  std::string base = _p->path; if (base.empty() || base.back() != '/') base += '/';
+  return LittleFS.open((base + _p->entries[_p->next++]).c_str(), mode);
+}
+void File::rewindDirectory(){ if (_p) _p->next = 0; }
+}
@@ -0,0 +1,281 @@
+#include "host.h"
+#include "host_rtc.h"
+#include <esp_timer.h>
+#include <malloc.h>
+#include <ucontext.h>
+#include <map>
+#include <memory>
+#include <new>
+#include <vector>
+
+HardwareSerial Serial(0);
+HardwareSerial Serial1(1);
+HardwareSerial Serial2(2);
+EspClass ESP;
+
+namespace {
+
+uint64_t g_now = 0;
+uint64_t g_timerSeq = 0;
+std::multimap<std::pair<uint64_t, uint64_t>, std::function<void()>> g_timers; // (waktu, urutan)
+
+struct Task {
+  void (*fn)(void*); void* arg; std::string name;
+  ucontext_t ctx; std::unique_ptr<char[]> stack;
+  uint64_t wakeUs = 0; bool done = false;
+};
+std::vector<std::unique_ptr<Task>> g_tasks;
+Task* g_current = nullptr;   // task yang sedang jalan (nullptr = konteks utama: setup/loop/test)
+ucontext_t g_mainCtx;
+
+struct Sem { bool mutex; bool recursive; int count; void* owner; int depth; };
+std::vector<std::unique_ptr<Sem>> g_sems;
+
+struct Pin { int level = HIGH; int mode = INPUT; int analog = 0, analogIn = 0;
+             void (*isr)(void*) = nullptr; void (*isr0)() = nullptr; void* arg = nullptr; int isrMode = 0; };
+Pin g_pins[64];
+
+bool g_psram = true; long g_psFailAfter = -1, g_psCalls = 0;
+uint64_t g_allocs = 0, g_allocBytes = 0, g_live = 0;
+bool g_verbose = getenv("HOST_VERBOSE") != nullptr;
+std::string g_serialLog;
+uint64_t g_rand = 88172645463325252ULL;
+
+void taskEntry(){
+  Task* t = g_current;
+  t->fn(t->arg);
+  t->done = true;
+  swapcontext(&t->ctx, &g_mainCtx);
+}
+
+void switchTo(Task* t){
+  g_current = t;
+  swapcontext(&g_mainCtx, &t->ctx);
+  g_current = nullptr;
+}
+
+// dipanggil dari dalam task: tidur sampai wake, kembali ke scheduler
+void taskSleep(uint64_t wake){
+  Task* t = g_current;
+  t->wakeUs = wake;
+  swapcontext(&t->ctx, &g_mainCtx);
+}
+
+uint64_t nextEvent(){
+  uint64_t n = UINT64_MAX;
+  if (!g_timers.empty()) n = g_timers.begin()->first.first;
+  for (auto& t : g_tasks) if (!t->done && t->wakeUs < n) n = t->wakeUs;
+  return n;
+}
+
+void fireDue(){
+  for (;;) {
+    bool any = false;
+    while (!g_timers.empty() && g_timers.begin()->first.first <= g_now) {
+      auto fn = std::move(g_timers.begin()->second);
+      g_timers.erase(g_timers.begin());
+      fn(); any = true;
+    }
+    if (!g_current) {
+      for (size_t i = 0; i < g_tasks.size(); i++) {
+        Task* t = g_tasks[i].get();
+        if (!t->done && t->wakeUs <= g_now) { switchTo(t); any = true; }
+      }
+    }
+    if (!any) break;
+  }
+}
+
+Sem* sem(SemaphoreHandle_t s){ return (Sem*)s; }
+void* self(){ return g_current ? (void*)g_current : (void*)&g_mainCtx; }
+
+bool tryTake(Sem* s){
+  if (s->mutex) {
+    if (s->recursive && s->owner == self()) { s->depth++; return true; }
+    if (s->owner) return false;
+    s->owner = self(); s->depth = 1; return true;
+  }
+  if (!s->count) return false;
+  s->count--; return true;
+}
+
+} // namespace
+
+// ---- waktu ----
+namespace host {
+uint64_t nowUs(){ return g_now; }
+
+void advanceTo(uint64_t us){
+  if (g_current) { taskSleep(us); return; }
+  fireDue();
+  while (g_now < us) {
+    const uint64_t n = nextEvent();
+    g_now = n < us ? n : us;
+    fireDue();
+  }
+}
+
+void at(uint64_t us, std::function<void()> fn){ g_timers.emplace(std::make_pair(us, g_timerSeq++), std::move(fn)); }
+void runTasks(){ if (!g_current) fireDue(); }
+
+void reset(){
+  g_now = 0; g_timers.clear(); g_tasks.clear(); g_current = nullptr;
+  for (auto& p : g_pins) p = Pin();
+  g_psram = true; g_psFailAfter = -1; g_psCalls = 0;
+  Serial.hostReset(); Serial1.hostReset(); Serial2.hostReset();
+  g_rand = 88172645463325252ULL;
+  rtcReset();
+}
+
+void setPin(uint8_t pin, int level){
+  Pin& p = g_pins[pin];
+  const int old = p.level;
+  p.level = level ? HIGH : LOW;
+  if (old == p.level || !p.isrMode) return;
+  const bool fire = p.isrMode == CHANGE || (p.isrMode == RISING && p.level) || (p.isrMode == FALLING && !p.level);
+  if (!fire) return;
+  if (p.isr) p.isr(p.arg);
+  else if (p.isr0) p.isr0();
+}
+int pinLevel(uint8_t pin){ return g_pins[pin].level; }
+int pinAnalog(uint8_t pin){ return g_pins[pin].analog; }
+void setAnalog(uint8_t pin, int v){ g_pins[pin].analogIn = v; }
+
+void setPsram(bool present, long failAfter){ g_psram = present; g_psFailAfter = failAfter; g_psCalls = 0; }
+uint64_t allocCount(){ return g_allocs; }
+uint64_t allocBytes(){ return g_allocBytes; }
+uint64_t heapLive(){ return g_live; }
+
+void setVerbose(bool on){ g_verbose = on; }
+const std::string& serialLog(){ return g_serialLog; }
+void clearSerialLog(){ g_serialLog.clear(); }
+}
+
+unsigned long millis(){ return (uint32_t)(g_now / 1000); }
+unsigned long micros(){ return (uint32_t)g_now; }
+int64_t esp_timer_get_time(){ return (int64_t)g_now; }
+void delay(uint32_t ms){ host::advance((uint64_t)ms * 1000); }
+void delayMicroseconds(uint32_t us){ g_now += us; } // busy-wait: waktu jalan, tanpa berpindah task
+void yield(){ host::runTasks(); }
+
+// ---- FreeRTOS ----
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void*), const char* name, uint32_t, void* arg, UBaseType_t, TaskHandle_t* out, BaseType_t){
+  std::unique_ptr<Task> t(new Task());
+  t->fn = fn; t->arg = arg; t->name = name ? name : ""; t->wakeUs = g_now;
+  const size_t STACK = 256 * 1024;
+  t->stack.reset(new char[STACK]);
+  getcontext(&t->ctx);
+  t->ctx.uc_stack.ss_sp = t->stack.get(); t->ctx.uc_stack.ss_size = STACK; t->ctx.uc_link = nullptr;
+  makecontext(&t->ctx, taskEntry, 0);
+  if (out) *out = t.get();
+  g_tasks.push_back(std::move(t));
+  return pdPASS;
+}
+void vTaskDelay(TickType_t ticks){ host::advance((uint64_t)ticks * 1000); }
+void vTaskDelete(TaskHandle_t t){
+  Task* k = t ? (Task*)t : g_current;
+  if (!k) return;
+  k->done = true;
+  if (k == g_current) swapcontext(&k->ctx, &g_mainCtx);
+}
+TickType_t xTaskGetTickCount(){ return (TickType_t)(g_now / 1000); }
+
+static SemaphoreHandle_t newSem(bool mutex, bool recursive, int count){
+  g_sems.emplace_back(new Sem{ mutex, recursive, count, nullptr, 0 });
+  return g_sems.back().get();
+}
+SemaphoreHandle_t xSemaphoreCreateMutex(){ return newSem(true, false, 1); }
+SemaphoreHandle_t xSemaphoreCreateRecursiveMutex(){ return newSem(true, true, 1); }
+SemaphoreHandle_t xSemaphoreCreateBinary(){ return newSem(false, false, 0); }
+void vSemaphoreDelete(SemaphoreHandle_t){}
+
+static BaseType_t take(SemaphoreHandle_t h, TickType_t wait){
+  Sem* s = sem(h);
+  if (tryTake(s)) return pdTRUE;
+  // pemegang hanya bisa task lain yang sedang tidur: majukan waktu sampai lepas / timeout
+  const uint64_t limit = wait == portMAX_DELAY ? g_now + 600ULL * 1000000 : g_now + (uint64_t)wait * 1000;
+  while (g_now < limit) {
+    host::advance(1000);
+    if (tryTake(s)) return pdTRUE;
+  }
+  if (wait == portMAX_DELAY) { fprintf(stderr, "host: deadlock pada semaphore (600 s virtual)\n"); abort(); }
+  return pdFALSE;
+}
+BaseType_t xSemaphoreTake(SemaphoreHandle_t s, TickType_t wait){ return take(s, wait); }
+BaseType_t xSemaphoreTakeRecursive(SemaphoreHandle_t s, TickType_t wait){ return take(s, wait); }
+BaseType_t xSemaphoreGive(SemaphoreHandle_t h){
+  Sem* s = sem(h);
+  if (s->mutex) { if (!s->owner) return pdFALSE; s->owner = nullptr; s->depth = 0; return pdTRUE; }
+  s->count = 1; return pdTRUE;
+}
+BaseType_t xSemaphoreGiveRecursive(SemaphoreHandle_t h){
+  Sem* s = sem(h);
+  if (s->owner != self()) return pdFALSE;
+  if (--s->depth == 0) s->owner = nullptr;
+  return pdTRUE;
+}
+
+// ---- GPIO ----
+void pinMode(uint8_t pin, uint8_t mode){ g_pins[pin].mode = mode; }
+void digitalWrite(uint8_t pin, uint8_t val){ g_pins[pin].level = val ? HIGH : LOW; }
+int digitalRead(uint8_t pin){ return g_pins[pin].level; }
+int analogRead(uint8_t pin){ return g_pins[pin].analogIn; }
+void analogWrite(uint8_t pin, int val){ g_pins[pin].analog = val; }
+void analogReadResolution(uint8_t){}
+void attachInterrupt(uint8_t pin, void (*fn)(void), int mode){ Pin& p = g_pins[pin]; p.isr0 = fn; p.isr = nullptr; p.isrMode = mode; }
+void attachInterruptArg(uint8_t pin, void (*fn)(void*), void* arg, int mode){ Pin& p = g_pins[pin]; p.isr = fn; p.arg = arg; p.isr0 = nullptr; p.isrMode = mode; }
+void detachInterrupt(uint8_t pin){ Pin& p = g_pins[pin]; p.isr = nullptr; p.isr0 = nullptr; p.isrMode = 0; }
+
+static uint64_t xorshift(){ g_rand ^= g_rand << 13; g_rand ^= g_rand >> 7; g_rand ^= g_rand << 17; return g_rand; }
+long random(long howbig){ return howbig > 0 ? (long)(xorshift() % (uint64_t)howbig) : 0; }
+long random(long lo, long hi){ return hi > lo ? lo + random(hi - lo) : lo; }
+void randomSeed(unsigned long seed){ g_rand = seed ? seed : 1; }
+
+// ---- UART ----
+size_t HardwareSerial::write(const uint8_t* b, size_t n){
+  if (this == &Serial) {
+    g_serialLog.append((const char*)b, n);
+    if (g_serialLog.size() > (1u << 20)) g_serialLog.erase(0, g_serialLog.size() / 2);
+    if (g_verbose) fwrite(b, 1, n, stdout);
+  }
+  if (_onTx) _onTx(b, n);
+  return n;
+}
+
+void HardwareSerial::hostRx(const uint8_t* b, size_t n, bool notify){
+  bool over = false;
+  for (size_t i = 0; i < n; i++) {
+    if (_rx.size() >= _rxCap) { over = true; continue; }
+    _rx.push_back(b[i]);
+  }
+  if (over && _onErr) _onErr(UART_BUFFER_FULL_ERROR);
+  if (notify && _onRx) _onRx();
+}
+
+// ---- ESP ----
+void EspClass::restart(){ throw host::Restart(); }
+uint32_t EspClass::getFreeHeap(){ return 200 * 1024; }
+uint32_t EspClass::getMinFreeHeap(){ return 180 * 1024; }
+uint32_t EspClass::getMaxAllocHeap(){ return 110 * 1024; }
+
+bool psramFound(){ return g_psram; }
+void* ps_malloc(size_t n){
+  if (!g_psram) return nullptr;
+  if (g_psFailAfter >= 0 && g_psCalls++ >= g_psFailAfter) return nullptr;
+  return malloc(n);
+}
+
+// ---- penghitung alokasi (bench) & heap hidup (soak) ----
+void* operator new(size_t n){
+  g_allocs++; g_allocBytes += n;
+  if (void* p = malloc(n ? n : 1)) {
+    g_live += malloc_usable_size(p);
+    return p;
+  }
+  throw std::bad_alloc();
+}
+void* operator new[](size_t n){ return operator new(n); }
+void operator delete(void* p) noexcept { if (p) g_live -= malloc_usable_size(p); free(p); }
+void operator delete[](void* p) noexcept { operator delete(p); }
+void operator delete(void* p, size_t) noexcept { operator delete(p); }
+void operator delete[](void* p, size_t) noexcept { operator delete(p); }
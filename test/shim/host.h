@@ -0,0 +1,44 @@
+#pragma once
+// Kendali lingkungan host untuk test, bench & simulator: waktu virtual, event terjadwal (ISR,
+// byte UART, link), GPIO, PSRAM, heap & penghitung alokasi. Tidak di-include oleh kode firmware.
+#include <Arduino.h>
+#include <functional>
+#include <string>
+
+namespace host {
+
+// ESP.restart(): dilempar supaya test/simulator bisa "boot ulang" objek firmware
+struct Restart {};
+
+// ---- waktu virtual (us sejak reset) ----
+uint64_t nowUs();
+// maju sampai t: event terjadwal & task yang jatuh tempo dijalankan pada waktunya
+void advanceTo(uint64_t us);
+inline void advance(uint64_t us){ advanceTo(nowUs() + us); }
+// jadwalkan fn pada waktu virtual absolut (dipanggil dari advanceTo, konteks "ISR")
+void at(uint64_t us, std::function<void()> fn);
+// jalankan task yang jatuh tempo tanpa memajukan waktu
+void runTasks();
+// bersihkan waktu, jadwal, task, GPIO, semaphore & UART (antar test)
+void reset();
+
+// ---- GPIO ----
+// ubah level input dari luar; ISR yang terpasang dipanggil sesuai mode (RISING/FALLING/CHANGE)
+void setPin(uint8_t pin, int level);
+int pinLevel(uint8_t pin);         // level output terakhir (digitalWrite) atau input
+int pinAnalog(uint8_t pin);        // nilai analogWrite terakhir
+void setAnalog(uint8_t pin, int v); // hasil analogRead
+
+// ---- memori ----
+void setPsram(bool present, long failAfter = -1); // failAfter: ps_malloc ke-n (0 = pertama) gagal
+uint64_t allocCount();             // operator new/malloc sejak start
+uint64_t allocBytes();
+// heap hidup lewat operator new/delete (String, JSON, std::): byte blok malloc, bukan permintaan
+uint64_t heapLive();
+
+// ---- log Serial ----
+void setVerbose(bool on);          // Serial (USB) ke stdout
+const std::string& serialLog();
+void clearSerialLog();
+
+}
@@ -0,0 +1,21 @@
+#pragma once
+// Kendali LittleFS host: lokasi direktori, kapasitas, statistik tulis & pemutusan listrik.
+#include <cstdint>
+#include <string>
+
+namespace host {
+// dilempar operasi FS saat listrik "putus"; handle terbuka dibatalkan seperti littlefs
+struct PowerCut {};
+
+void fsRoot(const std::string& dir);  // default: $HOST_FS atau /tmp/hostfs-<pid>
+const std::string& fsRoot();
+void fsFormat();                      // hapus semua isi (juga handle terbuka)
+void fsSetTotal(size_t bytes);        // kapasitas partisi (default 1.5 MB)
+// operasi mutasi: open(w/a), write, flush, close(w/a), remove, rename, mkdir
+uint64_t fsOps();
+uint64_t fsBytesWritten();            // byte yang diberikan ke write()
+uint64_t fsBlocksProgrammed();        // perkiraan blok 4 KB yang ditulis (commit w/a per blok tersentuh)
+// putus listrik tepat setelah operasi mutasi ke-n berikutnya (1 = operasi berikutnya); 0 = nonaktif
+void fsCutAfter(uint64_t n);
+bool fsCutArmed();
+}
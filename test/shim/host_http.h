@@ -0,0 +1,11 @@
+#pragma once
+// Request HTTP ke AsyncWebServer terakhir yang begin() (jalur Wi-Fi portal), di konteks pemanggil.
+#include <Arduino.h>
+#include <string>
+
+namespace host {
+struct HttpResponse { int code = 0; std::string contentType, body; bool chunked = false; };
+// url boleh berisi query ("/api/x?a=1"); body dikirim per chunk byte (0 = sekaligus).
+// Respons chunked dipompa; RESPONSE_TRY_AGAIN memajukan waktu 1 ms lalu mencoba lagi.
+HttpResponse http(const char* method, const char* url, const std::string& body = std::string(), size_t chunk = 0);
+}
@@ -0,0 +1,40 @@
+#pragma once
+// Jaringan host: AP Wi-Fi, link Ethernet, broker MQTT palsu & server UDP palsu (DHCP, SNTP).
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <Udp.h>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace host {
+
+void setWifi(bool apPresent, uint32_t connectMs = 300); // AP dengan SSID apa pun terjangkau
+void setEthLink(bool up);
+void setEthHardware(bool present);
+bool wifiUp();
+bool ethUp();                 // link ON & alamat terpasang
+
+struct Message { std::string topic, payload; bool retained; uint64_t atUs; uint8_t iface; };
+struct Broker {
+  bool up = true;
+  uint32_t connects = 0, refused = 0, oversize = 0;
+  std::vector<Message> messages;            // semua publish yang diterima broker
+  std::function<void(const Message&)> onMessage;
+  uint32_t session = 1;                     // naik saat broker down -> sesi client lama putus
+};
+Broker& broker();
+void setBroker(bool up);
+
+// server UDP palsu per port tujuan (67 DHCP, 123 SNTP). reply() mengirim balasan ke soket
+// asal setelah delayUs (0 = langsung tersedia untuk parsePacket berikutnya)
+struct UdpRequest {
+  const uint8_t* data; size_t len;
+  IPAddress dst; std::string dstHost; uint16_t dstPort, srcPort; UDP::Iface iface;
+};
+using UdpReply = std::function<void(const uint8_t* data, size_t len, IPAddress from, uint16_t fromPort, uint64_t delayUs)>;
+void udpServer(uint16_t port, std::function<void(const UdpRequest&, UdpReply)> fn);
+
+void netReset();
+
+}
@@ -0,0 +1,19 @@
+#pragma once
+// Model DS3231 di bus I2C host. Waktu RTC = base + (t_host - baseUs) * (1 + ppm*1e-6).
+#include <cstdint>
+
+namespace host {
+struct Ds3231 {
+  bool present = true;
+  bool lostPower = false;   // OSF; dibersihkan adjust()
+  double ppm = 0;           // positif = RTC lebih cepat dari waktu host
+  float tempC = 25;
+  int sqwPin = -1;          // GPIO yang menerima SQW (open-drain, pull-up di board)
+};
+Ds3231& rtc();
+// set waktu RTC (detik epoch lokal) seperti adjust(), tanpa melalui firmware
+void rtcSet(uint32_t epoch);
+// waktu RTC saat ini dalam mikrodetik (termasuk pecahan detik)
+uint64_t rtcNowUs();
+void rtcReset();
+}
@@ -0,0 +1,109 @@
+#include "host.h"
+#include "host_http.h"
+#include <ESPAsyncWebServer.h>
+
+namespace { AsyncWebServer* g_server = nullptr; }
+
+static WebRequestMethodComposite methodOf(const char* m){
+  static const struct { const char* s; WebRequestMethod m; } T[] = {
+    { "GET", HTTP_GET }, { "POST", HTTP_POST }, { "DELETE", HTTP_DELETE }, { "PUT", HTTP_PUT },
+    { "PATCH", HTTP_PATCH }, { "HEAD", HTTP_HEAD }, { "OPTIONS", HTTP_OPTIONS } };
+  for (auto& t : T) if (!strcmp(t.s, m)) return t.m;
+  return HTTP_ANY;
+}
+
+static String urlDecode(const std::string& s){
+  std::string o;
+  for (size_t i = 0; i < s.size(); i++) {
+    if (s[i] == '+') o += ' ';
+    else if (s[i] == '%' && i + 2 < s.size()) { o += (char)strtol(s.substr(i + 1, 2).c_str(), nullptr, 16); i += 2; }
+    else o += s[i];
+  }
+  return String(o);
+}
+
+AsyncWebServerRequest::AsyncWebServerRequest(const char* method, const String& url, const String& query, size_t len)
+  : _url(url), _methodStr(method), _method(methodOf(method)), _len(len) {
+  std::string q = query.c_str();
+  size_t p = 0;
+  while (p < q.size()) {
+    size_t amp = q.find('&', p); if (amp == std::string::npos) amp = q.size();
+    const std::string kv = q.substr(p, amp - p);
+    const size_t eq = kv.find('=');
+    if (!kv.empty()) _params.push_back(new AsyncWebParameter(urlDecode(kv.substr(0, eq)), eq == std::string::npos ? String() : urlDecode(kv.substr(eq + 1))));
+    p = amp + 1;
+  }
+}
+
+const AsyncWebParameter* AsyncWebServerRequest::getParam(const String& name, bool post, bool file) const {
+  for (auto* p : _params) if (p->name() == name && p->isPost() == post && p->isFile() == file) return p;
+  return nullptr;
+}
+
+void AsyncWebServerRequest::send(int code, const String& ct, const String& content){
+  AsyncWebServerResponse* r = beginResponse(code, ct, content);
+  send(r);
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginResponse(int code, const String& ct, const String& content){
+  auto* r = new AsyncWebServerResponse();
+  r->code = code; r->contentType = ct; r->body = content.c_str();
+  return r;
+}
+
+AsyncWebServerResponse* AsyncWebServerRequest::beginChunkedResponse(const String& ct, AwsResponseFiller filler){
+  auto* r = new AsyncWebServerResponse();
+  r->contentType = ct; r->filler = filler; r->chunked = true;
+  return r;
+}
+
+AsyncWebServer::AsyncWebServer(uint16_t){ }
+AsyncWebServer::~AsyncWebServer(){ for (auto* h : _handlers) delete h; if (g_server == this) g_server = nullptr; }
+
+AsyncCallbackWebHandler& AsyncWebServer::on(const char* uri, WebRequestMethodComposite m, ArRequestHandlerFunction fn,
+                                            ArUploadHandlerFunction upload, ArBodyHandlerFunction body){
+  auto* h = new AsyncCallbackWebHandler{ uri, m, fn, upload, body };
+  _handlers.push_back(h);
+  g_server = this;
+  return *h;
+}
+
+void AsyncWebServer::hostHandle(AsyncWebServerRequest* rq, const std::string& body, size_t chunk){
+  AsyncCallbackWebHandler* h = nullptr;
+  for (auto* x : _handlers) if (x->uri == rq->url() && (x->method & rq->method())) { h = x; break; }
+  ArBodyHandlerFunction bodyFn = h ? h->body : _body;
+  if (!body.empty() && bodyFn) {
+    const size_t step = chunk ? chunk : body.size();
+    for (size_t i = 0; i < body.size(); i += step) {
+      const size_t n = std::min(step, body.size() - i);
+      bodyFn(rq, (uint8_t*)body.data() + i, n, i, body.size());
+    }
+  }
+  if (h) h->fn(rq);
+  else if (_notFound) _notFound(rq);
+  else rq->send(404);
+}
+
+namespace host {
+HttpResponse http(const char* method, const char* url, const std::string& body, size_t chunk){
+  HttpResponse out;
+  if (!g_server || !g_server->hostBegun()) { out.code = -1; return out; }
+  std::string u = url, q;
+  const size_t qm = u.find('?');
+  if (qm != std::string::npos) { q = u.substr(qm + 1); u = u.substr(0, qm); }
+  AsyncWebServerRequest rq(method, String(u), String(q), body.size());
+  g_server->hostHandle(&rq, body, chunk);
+  AsyncWebServerResponse* r = rq.hostResponse();
+  if (!r) { out.code = 0; return out; }
+  out.code = r->chunked ? 200 : r->code; out.contentType = r->contentType.c_str(); out.chunked = r->chunked;
+  if (!r->chunked) { out.body = r->body; return out; }
+  uint8_t buf[1460];
+  for (size_t index = 0, tries = 0; tries < 100000; tries++) {
+    const size_t n = r->filler(buf, sizeof(buf), index);
+    if (n == RESPONSE_TRY_AGAIN) { advance(1000); continue; }
+    if (!n) break;
+    out.body.append((const char*)buf, n); index += n;
+  }
+  return out;
+}
+}
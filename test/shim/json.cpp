@@ -0,0 +1,318 @@
+#include <ArduinoJson.h>
+#include <cerrno>
+
+using ajson::Node;
+
+void Node::copyFrom(const Node& o){
+  reset(o.t);
+  b = o.b; single = o.single; i = o.i; u = o.u; f = o.f; s = o.s;
+  for (auto& m : o.members) { members.emplace_back(m.first, std::unique_ptr<Node>(new Node())); members.back().second->copyFrom(*m.second); }
+  for (auto& e : o.items) { items.emplace_back(new Node()); items.back()->copyFrom(*e); }
+}
+
+Node* JsonVariant::resolve(bool create) const {
+  if (!_up) return _node;
+  Node* p = _up->resolve(create);
+  if (!p) return nullptr;
+  if (_index < 0) {
+    if (p->t == Node::Obj) { if (Node* m = p->member(_key.c_str())) return m; }
+    else if (!(create && p->t == Node::Null)) return nullptr;
+    if (!create) return nullptr;
+    if (p->t == Node::Null) p->reset(Node::Obj);
+    p->members.emplace_back(_key, std::unique_ptr<Node>(new Node()));
+    return p->members.back().second.get();
+  }
+  const size_t idx = (size_t)_index;
+  if (p->t == Node::Arr) { if (idx < p->items.size()) return p->items[idx].get(); }
+  else if (!(create && p->t == Node::Null)) return nullptr;
+  if (!create) return nullptr;
+  if (p->t == Node::Null) p->reset(Node::Arr);
+  while (p->items.size() <= idx) p->items.emplace_back(new Node());
+  return p->items[idx].get();
+}
+
+Node* JsonVariant::appendNode() const {
+  Node* n = resolve(true);
+  if (!n) return nullptr;
+  if (n->t == Node::Null) n->reset(Node::Arr);
+  if (n->t != Node::Arr) return nullptr;
+  n->items.emplace_back(new Node());
+  return n->items.back().get();
+}
+
+void JsonVariant::remove(const char* key) const {
+  Node* n = node();
+  if (!n || n->t != Node::Obj || !key) return;
+  for (auto it = n->members.begin(); it != n->members.end(); ++it)
+    if (it->first == key) { n->members.erase(it); return; }
+}
+
+void JsonVariant::removeAt(size_t i) const {
+  Node* n = node();
+  if (n && n->t == Node::Arr && i < n->items.size()) n->items.erase(n->items.begin() + i);
+}
+
+bool JsonVariant::set(const JsonVariant& v) const {
+  Node tmp; const Node* src = v.node();
+  if (src) tmp.copyFrom(*src);
+  Node* dst = resolve(true);
+  if (!dst) return false;
+  dst->copyFrom(tmp);
+  return true;
+}
+
+bool JsonVariant::set(const char* v) const {
+  if (!v) return set(nullptr);
+  return setStr(v, strlen(v));
+}
+
+bool JsonVariant::set(const SerializedValue& v) const {
+  return setScalar(Node::Raw, [&](Node& n){ n.s = v.s; });
+}
+
+// ---- serialize ----
+static void escape(std::string& o, const std::string& s){
+  o += '"';
+  for (unsigned char c : s) {
+    switch (c) {
+      case '"': o += "\\\""; break;
+      case '\\': o += "\\\\"; break;
+      case '\b': o += "\\b"; break;
+      case '\f': o += "\\f"; break;
+      case '\n': o += "\\n"; break;
+      case '\r': o += "\\r"; break;
+      case '\t': o += "\\t"; break;
+      default:
+        if (c < 0x20) { char b[8]; snprintf(b, sizeof(b), "\\u%04x", c); o += b; }
+        else o += (char)c;
+    }
+  }
+  o += '"';
+}
+
+static void write(std::string& o, const Node* n){
+  if (!n) { o += "null"; return; }
+  char b[40];
+  switch (n->t) {
+    case Node::Null: o += "null"; break;
+    case Node::Bool: o += n->b ? "true" : "false"; break;
+    case Node::Int: snprintf(b, sizeof(b), "%lld", (long long)n->i); o += b; break;
+    case Node::UInt: snprintf(b, sizeof(b), "%llu", (unsigned long long)n->u); o += b; break;
+    case Node::Float:
+      if (!std::isfinite(n->f)) { o += "null"; break; }
+      snprintf(b, sizeof(b), n->single ? "%.7g" : "%.9g", n->f); o += b; break;
+    case Node::Str: escape(o, n->s); break;
+    case Node::Raw: o += n->s; break;
+    case Node::Arr:
+      o += '[';
+      for (size_t i = 0; i < n->items.size(); i++) { if (i) o += ','; write(o, n->items[i].get()); }
+      o += ']';
+      break;
+    case Node::Obj:
+      o += '{';
+      for (size_t i = 0; i < n->members.size(); i++) {
+        if (i) o += ',';
+        escape(o, n->members[i].first); o += ':'; write(o, n->members[i].second.get());
+      }
+      o += '}';
+      break;
+  }
+}
+
+std::string ajson::toJson(const Node* n){ std::string o; write(o, n); return o; }
+
+size_t serializeJson(const JsonVariant& v, std::string& out){ out.clear(); write(out, v.node()); return out.size(); }
+size_t serializeJson(const JsonVariant& v, String& out){ std::string s; write(s, v.node()); out = s.c_str(); return s.size(); }
+size_t serializeJson(const JsonVariant& v, Print& out){ std::string s; write(s, v.node()); return out.write((const uint8_t*)s.data(), s.size()); }
+size_t serializeJson(const JsonVariant& v, char* buf, size_t cap){
+  std::string s; write(s, v.node());
+  if (!cap) return 0;
+  const size_t n = s.size() < cap - 1 ? s.size() : cap - 1;
+  memcpy(buf, s.data(), n); buf[n] = 0;
+  return n;
+}
+size_t measureJson(const JsonVariant& v){ std::string s; write(s, v.node()); return s.size(); }
+
+// ---- deserialize ----
+namespace {
+struct Reader {
+  virtual ~Reader() {}
+  virtual int peek() = 0;
+  virtual int next() = 0;
+};
+struct BufReader : Reader {
+  const char* p; const char* end; // end == nullptr: berhenti di NUL
+  BufReader(const char* s, const char* e) : p(s), end(e) {}
+  int peek() override { if (end ? p >= end : !*p) return -1; return (unsigned char)*p; }
+  int next() override { const int c = peek(); if (c >= 0) p++; return c; }
+};
+struct StreamReader : Reader {
+  Stream& s; int la = -2;
+  explicit StreamReader(Stream& st) : s(st) {}
+  int peek() override { if (la == -2) la = s.read(); return la; }
+  int next() override { const int c = peek(); la = -2; return c; }
+};
+
+typedef DeserializationError DE;
+const int NESTING_LIMIT = 10;
+
+void skipWs(Reader& r){ for (int c = r.peek(); c == ' ' || c == '\t' || c == '\r' || c == '\n'; c = r.peek()) r.next(); }
+
+void utf8(std::string& o, uint32_t cp){
+  if (cp < 0x80) o += (char)cp;
+  else if (cp < 0x800) { o += (char)(0xC0 | (cp >> 6)); o += (char)(0x80 | (cp & 0x3F)); }
+  else if (cp < 0x10000) { o += (char)(0xE0 | (cp >> 12)); o += (char)(0x80 | ((cp >> 6) & 0x3F)); o += (char)(0x80 | (cp & 0x3F)); }
+  else { o += (char)(0xF0 | (cp >> 18)); o += (char)(0x80 | ((cp >> 12) & 0x3F)); o += (char)(0x80 | ((cp >> 6) & 0x3F)); o += (char)(0x80 | (cp & 0x3F)); }
+}
+
+DE::Code hex4(Reader& r, uint32_t& v){
+  v = 0;
+  for (int k = 0; k < 4; k++) {
+    const int c = r.next();
+    if (c < 0) return DE::IncompleteInput;
+    if (!isxdigit(c)) return DE::InvalidInput;
+    v = v * 16 + (isdigit(c) ? c - '0' : (tolower(c) - 'a' + 10));
+  }
+  return DE::Ok;
+}
+
+DE::Code parseString(Reader& r, std::string& out){
+  const int q = r.next();
+  out.clear();
+  for (;;) {
+    int c = r.next();
+    if (c < 0) return DE::IncompleteInput;
+    if (c == q) return DE::Ok;
+    if (c != '\\') { out += (char)c; continue; }
+    c = r.next();
+    switch (c) {
+      case -1: return DE::IncompleteInput;
+      case 'b': out += '\b'; break;
+      case 'f': out += '\f'; break;
+      case 'n': out += '\n'; break;
+      case 'r': out += '\r'; break;
+      case 't': out += '\t'; break;
+      case 'u': {
+        uint32_t cp; DE::Code e = hex4(r, cp); if (e) return e;
+        if (cp >= 0xD800 && cp < 0xDC00) {
+          if (r.next() != '\\' || r.next() != 'u') return DE::InvalidInput;
+          uint32_t lo; e = hex4(r, lo); if (e) return e;
+          cp = 0x10000 + ((cp - 0xD800) << 10) + (lo - 0xDC00);
+        }
+        utf8(out, cp);
+        break;
+      }
+      default: out += (char)c;
+    }
+  }
+}
+
+DE::Code parseKey(Reader& r, std::string& out){
+  const int c = r.peek();
+  if (c == '"' || c == '\'') return parseString(r, out);
+  // kunci tanpa kutip (diterima ArduinoJson)
+  out.clear();
+  while (isalnum(r.peek()) || r.peek() == '_' || r.peek() == '$') out += (char)r.next();
+  if (out.empty()) return r.peek() < 0 ? DE::IncompleteInput : DE::InvalidInput;
+  return DE::Ok;
+}
+
+DE::Code parseValue(Reader& r, Node& n, int depth);
+
+DE::Code parseLiteral(Reader& r, Node& n, const char* word, Node::Type t, bool b){
+  for (const char* w = word; *w; w++) {
+    const int c = r.next();
+    if (c < 0) return DE::IncompleteInput;
+    if (c != *w) return DE::InvalidInput;
+  }
+  n.reset(t); n.b = b;
+  return DE::Ok;
+}
+
+DE::Code parseNumber(Reader& r, Node& n){
+  std::string s;
+  for (int c = r.peek(); c >= 0 && (isdigit(c) || c == '-' || c == '+' || c == '.' || c == 'e' || c == 'E'); c = r.peek()) s += (char)r.next();
+  if (s.empty()) return DE::InvalidInput;
+  char* end = nullptr; errno = 0;
+  if (s.find_first_of(".eE") == std::string::npos) {
+    if (s[0] == '-') {
+      const long long v = strtoll(s.c_str(), &end, 10);
+      if (*end) return DE::InvalidInput;
+      if (errno != ERANGE) { n.reset(Node::Int); n.i = v; return DE::Ok; }
+    } else {
+      const unsigned long long v = strtoull(s.c_str(), &end, 10);
+      if (*end) return DE::InvalidInput;
+      if (errno != ERANGE) { n.reset(Node::UInt); n.u = v; return DE::Ok; }
+    }
+  }
+  errno = 0;
+  const double d = strtod(s.c_str(), &end);
+  if (*end) return DE::InvalidInput;
+  n.reset(Node::Float); n.f = d;
+  return DE::Ok;
+}
+
+DE::Code parseValue(Reader& r, Node& n, int depth){
+  skipWs(r);
+  const int c = r.peek();
+  if (c < 0) return DE::IncompleteInput;
+  if (c == '{' || c == '[') {
+    if (depth >= NESTING_LIMIT) return DE::TooDeep;
+    const bool obj = c == '{';
+    const int close = obj ? '}' : ']';
+    r.next();
+    n.reset(obj ? Node::Obj : Node::Arr);
+    skipWs(r);
+    if (r.peek() == close) { r.next(); return DE::Ok; }
+    for (;;) {
+      skipWs(r);
+      std::unique_ptr<Node> child(new Node());
+      std::string key;
+      if (obj) {
+        DE::Code e = parseKey(r, key); if (e) return e;
+        skipWs(r);
+        const int colon = r.next();
+        if (colon < 0) return DE::IncompleteInput;
+        if (colon != ':') return DE::InvalidInput;
+      }
+      DE::Code e = parseValue(r, *child, depth + 1); if (e) return e;
+      if (obj) {
+        Node* ex = n.member(key.c_str());
+        if (ex) ex->copyFrom(*child); else n.members.emplace_back(key, std::move(child));
+      } else n.items.push_back(std::move(child));
+      skipWs(r);
+      const int sep = r.next();
+      if (sep < 0) return DE::IncompleteInput;
+      if (sep == close) return DE::Ok;
+      if (sep != ',') return DE::InvalidInput;
+    }
+  }
+  if (c == '"' || c == '\'') { std::string s; DE::Code e = parseString(r, s); if (e) return e; n.reset(Node::Str); n.s = s; return DE::Ok; }
+  if (c == 't') return parseLiteral(r, n, "true", Node::Bool, true);
+  if (c == 'f') return parseLiteral(r, n, "false", Node::Bool, false);
+  if (c == 'n') return parseLiteral(r, n, "null", Node::Null, false);
+  if (isdigit(c) || c == '-' || c == '+' || c == '.') return parseNumber(r, n);
+  return DE::InvalidInput;
+}
+
+DeserializationError run(JsonDocument& d, Reader& r){
+  d.clear();
+  skipWs(r);
+  if (r.peek() < 0) return DE::EmptyInput;
+  Node tmp;
+  const DE::Code e = parseValue(r, tmp, 0);
+  if (e) return e;
+  *d.node() = std::move(tmp);
+  return DE::Ok;
+}
+}
+
+DeserializationError deserializeJson(JsonDocument& d, const char* s){
+  if (!s) { d.clear(); return DE::EmptyInput; }
+  BufReader r(s, nullptr); return run(d, r);
+}
+DeserializationError deserializeJson(JsonDocument& d, const char* s, size_t n){
+  if (!s) { d.clear(); return DE::EmptyInput; }
+  BufReader r(s, s + n); return run(d, r);
+}
+DeserializationError deserializeJson(JsonDocument& d, Stream& s){ StreamReader r(s); return run(d, r); }
@@ -0,0 +1,183 @@
+#include "host.h"
+#include "host_net.h"
+#include <WiFi.h>
+#include <Ethernet.h>
+#include <PubSubClient.h>
+#include <ESPmDNS.h>
+#include <SPI.h>
+#include <Wire.h>
+#include <esp_system.h>
+#include <algorithm>
+#include <map>
+
+WiFiClass WiFi;
+EthernetClass Ethernet;
+MDNSResponder MDNS;
+SPIClass SPI;
+TwoWire Wire;
+
+namespace {
+bool g_apPresent = true, g_ethLink = true, g_ethHw = true;
+uint32_t g_wifiConnectMs = 300;
+uint64_t g_apSinceUs = 0;
+host::Broker g_broker;
+std::vector<UDP*> g_sockets;
+std::map<uint16_t, std::function<void(const host::UdpRequest&, host::UdpReply)>> g_udpServers;
+esp_reset_reason_t g_resetReason = ESP_RST_POWERON;
+}
+
+namespace host {
+void setWifi(bool ap, uint32_t connectMs){
+  if (ap && !g_apPresent) g_apSinceUs = nowUs();
+  g_apPresent = ap; g_wifiConnectMs = connectMs;
+}
+void setEthLink(bool up){ g_ethLink = up; }
+void setEthHardware(bool present){ g_ethHw = present; }
+bool wifiUp(){ return WiFi.status() == WL_CONNECTED; }
+bool ethUp(){ return Ethernet.linkStatus() == LinkON && Ethernet.localIP() != IPAddress(); }
+Broker& broker(){ return g_broker; }
+void setBroker(bool up){ if (!up && g_broker.up) g_broker.session++; g_broker.up = up; }
+void udpServer(uint16_t port, std::function<void(const UdpRequest&, UdpReply)> fn){
+  if (fn) g_udpServers[port] = fn; else g_udpServers.erase(port);
+}
+void netReset(){
+  g_apPresent = true; g_ethLink = true; g_ethHw = true; g_wifiConnectMs = 300; g_apSinceUs = 0;
+  g_broker = Broker();
+  g_udpServers.clear();
+  WiFi.hostReset(); Ethernet.hostReset();
+}
+void setResetReason(esp_reset_reason_t r){ g_resetReason = r; }
+}
+
+esp_reset_reason_t esp_reset_reason(){ return g_resetReason; }
+
+// ---- Wi-Fi ----
+wl_status_t WiFiClass::status(){
+  if (!_begun) return WL_DISCONNECTED;
+  if (!g_apPresent) return WL_DISCONNECTED;
+  const uint64_t from = std::max(_beginUs, g_apSinceUs);
+  if (!_auto && g_apSinceUs > _beginUs) return WL_DISCONNECTED;
+  return host::nowUs() >= from + (uint64_t)g_wifiConnectMs * 1000 ? WL_CONNECTED : WL_DISCONNECTED;
+}
+IPAddress WiFiClass::localIP(){
+  if (status() != WL_CONNECTED) return IPAddress();
+  return _staticIp != IPAddress() ? _staticIp : IPAddress(192, 168, 1, 50);
+}
+wl_status_t WiFiClass::begin(const char* ssid, const char*, int32_t, const uint8_t*, bool connect){
+  _ssid = ssid ? ssid : "";
+  _begun = connect && _ssid.length();
+  _beginUs = host::nowUs();
+  return status();
+}
+int16_t WiFiClass::scanNetworks(bool async, bool, bool, uint32_t maxMs, uint8_t){
+  _scanDoneUs = host::nowUs() + (uint64_t)maxMs * 1000 * 13; // 13 channel
+  if (async) { _scan = WIFI_SCAN_RUNNING; return WIFI_SCAN_RUNNING; }
+  host::advanceTo(_scanDoneUs);
+  return _scan = g_apPresent ? 1 : 0;
+}
+int16_t WiFiClass::scanComplete(){
+  if (_scan == WIFI_SCAN_RUNNING && host::nowUs() >= _scanDoneUs) _scan = g_apPresent ? 1 : 0;
+  return _scan;
+}
+String WiFiClass::SSID(uint8_t){ return _ssid.length() ? _ssid : String("host-ap"); }
+void WiFiClass::hostReset(){ *this = WiFiClass(); }
+
+void configTime(long, int, const char*, const char*, const char*){}
+bool getLocalTime(struct tm*, uint32_t){ return false; }
+
+// ---- Ethernet ----
+EthernetLinkStatus EthernetClass::linkStatus(){ return !g_ethHw ? Unknown : g_ethLink ? LinkON : LinkOFF; }
+EthernetHardwareStatus EthernetClass::hardwareStatus(){ return g_ethHw ? EthernetW5500 : EthernetNoHardware; }
+
+// ---- UDP ----
+static bool ifaceUp(UDP::Iface i){ return i == UDP::IF_WIFI ? host::wifiUp() : host::ethUp(); }
+// broadcast boleh keluar tanpa alamat (DHCPDISCOVER / INIT-REBOOT dari 0.0.0.0), cukup link ON
+static bool canSend(UDP::Iface i, IPAddress dst){
+  if (ifaceUp(i)) return true;
+  return i == UDP::IF_ETH && dst == IPAddress(255, 255, 255, 255) && Ethernet.linkStatus() == LinkON;
+}
+
+UDP::~UDP(){ stop(); }
+uint8_t UDP::begin(uint16_t port){
+  stop();
+  _port = port; _open = true;
+  g_sockets.push_back(this);
+  return 1;
+}
+void UDP::stop(){
+  if (!_open) return;
+  _open = false; _inbox.clear();
+  g_sockets.erase(std::remove(g_sockets.begin(), g_sockets.end(), this), g_sockets.end());
+}
+int UDP::beginPacket(IPAddress ip, uint16_t port){ _dst = ip; _dstHost = ""; _dstPort = port; _out.clear(); return 1; }
+int UDP::beginPacket(const char* h, uint16_t port){ _dst = IPAddress(); _dstHost = h ? h : ""; _dstPort = port; _out.clear(); return h && *h; }
+int UDP::endPacket(){
+  if (!_open || !canSend(_if, _dst)) return 0;
+  auto it = g_udpServers.find(_dstPort);
+  if (it == g_udpServers.end()) return 1; // terkirim, tidak ada yang menjawab
+  host::UdpRequest rq{ _out.data(), _out.size(), _dst, _dstHost.c_str(), _dstPort, _port, _if };
+  const uint16_t port = _port; const Iface iface = _if;
+  it->second(rq, [port, iface](const uint8_t* d, size_t n, IPAddress from, uint16_t fromPort, uint64_t delayUs){
+    Packet p{ std::vector<uint8_t>(d, d + n), from, fromPort };
+    auto deliver = [p, port, iface](){
+      for (UDP* s : g_sockets) if (s->_port == port && s->_if == iface) s->hostDeliver(p);
+    };
+    if (delayUs) host::at(host::nowUs() + delayUs, deliver); else deliver();
+  });
+  _out.clear();
+  return 1;
+}
+int UDP::parsePacket(){
+  if (_inbox.empty()) return 0;
+  Packet p = _inbox.front(); _inbox.erase(_inbox.begin());
+  _cur = p.data; _pos = 0; _curFrom = p.from; _curPort = p.fromPort;
+  return (int)_cur.size();
+}
+
+// ---- MQTT ----
+bool PubSubClient::connect(const char*, const char*, const char*){
+  if (!_client || _host.empty() || !_client->linkUp()) { _connected = false; _state = MQTT_CONNECT_FAILED; return false; }
+  if (!g_broker.up) {
+    g_broker.refused++;
+    // koneksi TCP ke broker mati menunggu timeout socket
+    host::advance((uint64_t)_timeoutS * 1000000);
+    _connected = false; _state = MQTT_CONNECTION_TIMEOUT; return false;
+  }
+  g_broker.connects++;
+  _connected = true; _state = MQTT_CONNECTED; _session = g_broker.session;
+  return true;
+}
+bool PubSubClient::connected(){
+  if (_connected && (!g_broker.up || _session != g_broker.session || !_client || !_client->linkUp())) {
+    _connected = false; _state = MQTT_CONNECTION_LOST;
+  }
+  return _connected;
+}
+bool PubSubClient::publish(const char* topic, const uint8_t* payload, unsigned int len, bool retained){
+  if (!connected()) return false;
+  if (MQTT_MAX_HEADER_SIZE + 2 + strlen(topic) + len > _bufSize) { g_broker.oversize++; return false; }
+  host::Message m{ topic, std::string((const char*)payload, len), retained, host::nowUs(),
+                   (uint8_t)(dynamic_cast<WiFiClient*>(_client) ? 0 : 1) };
+  g_broker.messages.push_back(m);
+  if (g_broker.onMessage) g_broker.onMessage(g_broker.messages.back());
+  return true;
+}
+bool PubSubClient::beginPublish(const char* topic, unsigned int len, bool retained){
+  if (!connected()) return false;
+  _pubTopic = topic; _pubData.clear(); _pubLen = len; _pubRetained = retained; _pubOpen = true;
+  return true;
+}
+size_t PubSubClient::write(const uint8_t* b, size_t n){
+  if (!_pubOpen || !connected()) return 0;
+  _pubData.append((const char*)b, n);
+  return n;
+}
+int PubSubClient::endPublish(){
+  if (!_pubOpen) return 0;
+  _pubOpen = false;
+  if (!connected() || _pubData.size() != _pubLen) return 0;
+  host::Message m{ _pubTopic, _pubData, _pubRetained, host::nowUs(), (uint8_t)(dynamic_cast<WiFiClient*>(_client) ? 0 : 1) };
+  g_broker.messages.push_back(m);
+  if (g_broker.onMessage) g_broker.onMessage(g_broker.messages.back());
+  return 1;
+}
@@ -0,0 +1,33 @@
+#include <Preferences.h>
+
+namespace {
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>> g_nvs;
+uint64_t g_writes = 0;
+}
+
+namespace host {
+void nvsReset(){ g_nvs.clear(); g_writes = 0; }
+std::map<std::string, std::map<std::string, std::vector<uint8_t>>>& nvs(){ return g_nvs; }
+uint64_t nvsWrites(){ return g_writes; }
+}
+
+size_t Preferences::putBytes(const char* key, const void* v, size_t n){
+  if (!_open || _ro || !key) return 0;
+  g_nvs[_ns][key].assign((const uint8_t*)v, (const uint8_t*)v + n);
+  g_writes++;
+  return n;
+}
+size_t Preferences::getBytes(const char* key, void* buf, size_t max){
+  if (!_open || !key) return 0;
+  auto ns = g_nvs.find(_ns); if (ns == g_nvs.end()) return 0;
+  auto it = ns->second.find(key); if (it == ns->second.end() || it->second.size() > max) return 0;
+  memcpy(buf, it->second.data(), it->second.size());
+  return it->second.size();
+}
+size_t Preferences::getBytesLength(const char* key){
+  auto ns = g_nvs.find(_ns); if (!_open || !key || ns == g_nvs.end()) return 0;
+  auto it = ns->second.find(key); return it == ns->second.end() ? 0 : it->second.size();
+}
+bool Preferences::isKey(const char* key){ auto ns = g_nvs.find(_ns); return _open && key && ns != g_nvs.end() && ns->second.count(key); }
+bool Preferences::remove(const char* key){ if (!_open || _ro || !key) return false; auto ns = g_nvs.find(_ns); if (ns == g_nvs.end()) return false; g_writes++; return ns->second.erase(key) > 0; }
+bool Preferences::clear(){ if (!_open || _ro) return false; g_nvs[_ns].clear(); g_writes++; return true; }
@@ -0,0 +1,85 @@
+#include "host.h"
+#include "host_rtc.h"
+#include <RTClib.h>
+
+// ---- DateTime ----
+static const uint8_t DAYS[] = { 31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31 };
+static bool leap(uint16_t y){ return (y % 4 == 0 && y % 100 != 0) || y % 400 == 0; }
+
+DateTime::DateTime(uint32_t t){
+  _ss = t % 60; t /= 60; _mm = t % 60; t /= 60; _hh = t % 24;
+  uint32_t days = t / 24;
+  _y = 1970;
+  for (;;) { const uint32_t n = leap(_y) ? 366 : 365; if (days < n) break; days -= n; _y++; }
+  _m = 1;
+  for (;;) { const uint32_t n = DAYS[_m - 1] + (_m == 2 && leap(_y)); if (days < n) break; days -= n; _m++; }
+  _d = (uint8_t)(days + 1);
+}
+
+DateTime::DateTime(uint16_t y, uint8_t m, uint8_t d, uint8_t hh, uint8_t mm, uint8_t ss)
+  : _y(y >= 2000 ? y : y + 2000), _m(m), _d(d), _hh(hh), _mm(mm), _ss(ss) {}
+
+uint32_t DateTime::unixtime() const {
+  uint32_t days = 0;
+  for (uint16_t y = 1970; y < _y; y++) days += leap(y) ? 366 : 365;
+  for (uint8_t m = 1; m < _m; m++) days += DAYS[m - 1] + (m == 2 && leap(_y));
+  days += _d - 1;
+  return ((days * 24 + _hh) * 60 + _mm) * 60 + _ss;
+}
+
+// ---- model DS3231 ----
+namespace {
+host::Ds3231 g_rtc;
+uint64_t g_baseUs = 0;        // waktu host saat base diset
+uint64_t g_baseRtcUs = 946684800ULL * 1000000ULL;
+bool g_sqw = false;
+uint32_t g_gen = 0;           // rantai SQW lama batal saat adjust/mode berubah
+
+uint64_t rtcUs(){
+  const double el = (double)(host::nowUs() - g_baseUs) * (1.0 + g_rtc.ppm * 1e-6);
+  return g_baseRtcUs + (uint64_t)el;
+}
+// waktu host saat waktu RTC mencapai rtcTarget
+uint64_t hostAt(uint64_t rtcTarget){
+  return g_baseUs + (uint64_t)((double)(rtcTarget - g_baseRtcUs) / (1.0 + g_rtc.ppm * 1e-6) + 0.5);
+}
+
+void scheduleSqw(){
+  if (!g_sqw || g_rtc.sqwPin < 0) return;
+  const uint32_t gen = g_gen;
+  const uint64_t nextSec = (rtcUs() / 1000000ULL + 1) * 1000000ULL;
+  uint64_t t = hostAt(nextSec);
+  if (t <= host::nowUs()) t = host::nowUs() + 1;
+  host::at(t, [gen](){
+    if (gen != g_gen) return;
+    host::setPin((uint8_t)g_rtc.sqwPin, LOW);  // tepi turun = detik baru
+    const uint64_t half = host::nowUs() + 500000;
+    host::at(half, [gen](){ if (gen == g_gen) host::setPin((uint8_t)g_rtc.sqwPin, HIGH); });
+    scheduleSqw();
+  });
+}
+}
+
+namespace host {
+Ds3231& rtc(){ return g_rtc; }
+void rtcSet(uint32_t epoch){
+  g_baseUs = nowUs(); g_baseRtcUs = (uint64_t)epoch * 1000000ULL; g_rtc.lostPower = false;
+  g_gen++;
+  scheduleSqw();
+}
+uint64_t rtcNowUs(){ return rtcUs(); }
+void rtcReset(){ g_rtc = Ds3231(); g_baseUs = nowUs(); g_baseRtcUs = 946684800ULL * 1000000ULL; g_sqw = false; g_gen++; }
+}
+
+bool RTC_DS3231::begin(TwoWire*){ return g_rtc.present; }
+bool RTC_DS3231::lostPower(){ return g_rtc.lostPower; }
+DateTime RTC_DS3231::now(){ return DateTime((uint32_t)(rtcUs() / 1000000ULL)); }
+void RTC_DS3231::adjust(const DateTime& dt){ host::rtcSet(dt.unixtime()); } // pembagi detik ikut direset
+float RTC_DS3231::getTemperature(){ return g_rtc.tempC; }
+void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode m){
+  const bool on = m == DS3231_SquareWave1Hz;
+  if (on == g_sqw) return;
+  g_sqw = on; g_gen++;
+  if (on) scheduleSqw();
+}
+Ds3231SqwPinMode RTC_DS3231::readSqwPinMode(){ return g_sqw ? DS3231_SquareWave1Hz : DS3231_OFF; }
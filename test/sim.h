@@ -0,0 +1,176 @@
+#pragma once
+// Simulator lini di host: setup()/loop() sketch asli di bawah millis() virtual. Input terjadwal
+// lewat shim (pulsa sensor, aliran byte GM66, link Wi-Fi/Ethernet putus-sambung, broker mati);
+// broker palsu mencatat setiap publish -> item hilang / duplikat / terlambat & pertumbuhan antrian.
+// Satu skenario = satu proses anak (fork): objek global sketch selalu mulai dari boot bersih.
+#include "harness.h"
+#include <algorithm>
+#include <map>
+#include <sys/wait.h>
+#include <unistd.h>
+
+namespace sim {
+
+struct Window { uint32_t atS, forS; }; // jendela mati [atS, atS+forS)
+
+struct Scenario {
+  const char* name;
+  uint32_t durationS;       // lama produksi; setelahnya semua link & broker hidup, antrian dikuras
+  float ratePerMin;         // item per menit (per jalur untuk counting-barang)
+  uint8_t jitterPct = 0;    // jarak antar item +/- persen (xorshift, seed tetap)
+  std::vector<Window> broker, wifi, eth;
+  uint8_t lanes = 1;        // counting-barang: jalur berselang-seling
+  uint32_t maxLost = 0, maxDup = 0; // batas lulus (smoke test)
+};
+
+struct Report {
+  uint32_t injected = 0, published = 0, lost = 0, dup = 0;
+  double delayAvgMs = 0; uint32_t delayP99Ms = 0, delayMaxMs = 0;
+  size_t queuePeak = 0, queueBytesPeak = 0;
+  uint64_t flashBytes = 0;
+  uint32_t drainS = 0;      // lama antrian kosong setelah produksi selesai
+};
+
+class Line {
+public:
+  void injected(const std::string& key){ Item& it = _items[key]; it.inUs = host::nowUs(); it.known = true; }
+  void published(const std::string& key, uint64_t atUs){
+    Item& it = _items[key];
+    if (!it.pubs++) it.pubUs = atUs;
+  }
+  void sampleQueue(size_t n, size_t bytes){ _r.queuePeak = std::max(_r.queuePeak, n); _r.queueBytesPeak = std::max(_r.queueBytesPeak, bytes); }
+  Report& report(){
+    std::vector<uint32_t> d;
+    double sum = 0;
+    _r.injected = _r.published = _r.lost = _r.dup = 0;
+    for (auto& kv : _items) {
+      const Item& it = kv.second;
+      if (!it.known) { _r.dup += it.pubs; continue; } // publish item yang tidak pernah dibuat
+      _r.injected++;
+      if (!it.pubs) { _r.lost++; continue; }
+      _r.published++; _r.dup += it.pubs - 1;
+      const uint32_t ms = it.pubUs > it.inUs ? (uint32_t)((it.pubUs - it.inUs) / 1000) : 0;
+      d.push_back(ms); sum += ms;
+    }
+    std::sort(d.begin(), d.end());
+    _r.delayAvgMs = d.empty() ? 0 : sum / d.size();
+    _r.delayP99Ms = d.empty() ? 0 : d[(d.size() - 1) * 99 / 100];
+    _r.delayMaxMs = d.empty() ? 0 : d.back();
+    return _r;
+  }
+  Report& raw(){ return _r; }
+private:
+  struct Item { uint64_t inUs = 0, pubUs = 0; uint32_t pubs = 0; bool known = false; };
+  std::map<std::string, Item> _items;
+  Report _r;
+};
+
+inline uint64_t S(uint64_t s){ return s * 1000000ULL; }
+
+// jadwal item: waktu (us) tiap item selama durationS, jarak rata-rata 60/rate dengan jitter
+inline std::vector<uint64_t> schedule(const Scenario& sc, uint64_t startUs, uint32_t seed){
+  std::vector<uint64_t> t;
+  if (sc.ratePerMin <= 0) return t;
+  const double period = 60e6 / sc.ratePerMin;
+  uint32_t x = seed ? seed : 1;
+  for (double at = 0; at < S(sc.durationS); ) {
+    t.push_back(startUs + (uint64_t)at);
+    x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+    const double j = sc.jitterPct ? ((int32_t)(x % 2001) - 1000) / 1000.0 * sc.jitterPct / 100.0 : 0;
+    at += period * (1 + j);
+  }
+  return t;
+}
+
+// jendela mati -> event host::at pada awal & akhir jendela
+inline void windows(const std::vector<Window>& w, uint64_t startUs, std::function<void(bool up)> set){
+  for (const Window& x : w) {
+    host::at(startUs + S(x.atS), [set](){ set(false); });
+    host::at(startUs + S(x.atS + x.forS), [set](){ set(true); });
+  }
+}
+
+// Hooks per firmware: boot (config skenario + setup()), jadwalkan item, kunci item dari payload broker,
+// isi antrian saat ini.
+struct Firmware {
+  std::function<void(const Scenario&)> boot;
+  std::function<void()> loop;
+  std::function<void(const Scenario&, uint64_t startUs, Line&)> inject;
+  std::function<bool(const std::string& payload, std::string& key)> keyOf;
+  std::function<void(size_t& n, size_t& bytes)> queue;
+};
+
+inline Report runOne(Firmware& fw, const Scenario& sc){
+  Line line;
+  harness::fresh();
+  host::broker().onMessage = [&](const host::Message& m){
+    std::string key;
+    if (fw.keyOf(m.payload, key)) line.published(key, m.atUs);
+  };
+  fw.boot(sc);
+  // boot & koneksi awal (Wi-Fi, MQTT) sebelum produksi
+  const uint64_t start = host::nowUs() + S(10);
+  while (host::nowUs() < start) { fw.loop(); host::advance(1000); }
+  windows(sc.broker, start, [](bool up){ host::setBroker(up); });
+  windows(sc.wifi, start, [](bool up){ host::setWifi(up); });
+  windows(sc.eth, start, [](bool up){ host::setEthLink(up); });
+  fw.inject(sc, start, line);
+  const uint64_t prodEnd = start + S(sc.durationS);
+  uint64_t nextSample = 0, drainedAt = 0;
+  const uint64_t flash0 = host::fsBytesWritten();
+  for (;;) {
+    fw.loop();
+    host::advance(1000);
+    const uint64_t now = host::nowUs();
+    if (now >= nextSample) {
+      size_t n = 0, bytes = 0; fw.queue(n, bytes);
+      line.sampleQueue(n, bytes);
+      nextSample = now + S(1);
+      if (now >= prodEnd + S(5) && !n) { drainedAt = now; break; }
+      if (now >= prodEnd + S(900)) break; // tidak terkuras dalam 15 menit
+    }
+  }
+  Report& r = line.report();
+  r.flashBytes = host::fsBytesWritten() - flash0;
+  r.drainS = drainedAt ? (uint32_t)((drainedAt - prodEnd) / 1000000) : UINT32_MAX;
+  return r;
+}
+
+inline void print(const char* name, const Report& r, FILE* out){
+  fprintf(out, "%-16s %7u %9u %5u %5u %10.0f %9u %9u %8zu %9zu %10llu %7d\n", name, r.injected, r.published, r.lost, r.dup,
+          r.delayAvgMs, r.delayP99Ms, r.delayMaxMs, r.queuePeak, r.queueBytesPeak, (unsigned long long)r.flashBytes,
+          r.drainS == UINT32_MAX ? -1 : (int)r.drainS);
+}
+
+// argv: [nama skenario] [--quick] (durasi & jendela / 5)
+inline int main(const char* title, Firmware& fw, std::vector<Scenario> scs, int argc, char** argv){
+  bool quick = false; const char* only = nullptr;
+  for (int i = 1; i < argc; i++) { if (!strcmp(argv[i], "--quick")) quick = true; else only = argv[i]; }
+  printf("%s\n%-16s %7s %9s %5s %5s %10s %9s %9s %8s %9s %10s %7s\n", title, "scenario", "items", "published", "lost", "dup",
+         "delay_avg", "delay_p99", "delay_max", "q_peak", "q_bytes", "flash_b", "drain_s");
+  fflush(stdout);
+  int failed = 0;
+  for (Scenario sc : scs) {
+    if (only && !strstr(sc.name, only)) continue;
+    if (quick) {
+      sc.durationS /= 5;
+      for (auto* w : { &sc.broker, &sc.wifi, &sc.eth }) for (Window& x : *w) { x.atS /= 5; x.forS /= 5; }
+    }
+    const pid_t pid = fork();
+    if (pid == 0) {
+      host::setVerbose(false);
+      Report r = runOne(fw, sc);
+      print(sc.name, r, stdout);
+      const bool ok = r.lost <= sc.maxLost && r.dup <= sc.maxDup && r.drainS != UINT32_MAX;
+      if (!ok) printf("  [FAIL] %s: lost %u (maks %u), dup %u (maks %u)%s\n", sc.name, r.lost, sc.maxLost, r.dup, sc.maxDup,
+                      r.drainS == UINT32_MAX ? ", antrian tidak terkuras" : "");
+      fflush(stdout);
+      _exit(ok ? 0 : 1);
+    }
+    int st = 0; waitpid(pid, &st, 0);
+    if (!WIFEXITED(st) || WEXITSTATUS(st)) failed++;
+  }
+  return failed ? 1 : 0;
+}
+
+}
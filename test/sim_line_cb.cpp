@@ -0,0 +1,55 @@
+// Simulator lini counting-barang: pulsa beam (LOW 40 ms) di pin sensor tiap jalur, jalur
+// berselang-seling; item = (lane, count) di payload broker (count kumulatif per jalur, NVS bersih).
+#include "sim.h"
+#include "../counting-barang/counting-barang.ino"
+
+static const char* CONFIG =
+  "{\"wifi_ssid\":\"lini\",\"wifi_pass\":\"x\",\"eth_mode\":\"static\",\"eth_ip\":\"192.168.10.61\","
+  "\"eth_gateway\":\"192.168.10.1\",\"eth_subnet\":\"255.255.255.0\",\"mqtt_host\":\"broker.lan\","
+  "\"mqtt_port\":1883,\"mqtt_topic\":\"lini/count\"}";
+static const uint8_t PINS[] = { 2, 5, 6, 7 };
+static const uint32_t PULSE_US = 40000;
+
+int main(int argc, char** argv){
+  sim::Firmware fw;
+  fw.boot = [](const sim::Scenario& sc){
+    File f = LittleFS.open("/config.json", "w"); f.print(CONFIG); f.close();
+    String lj = "{\"lanes\":[";
+    for (uint8_t i = 0; i < sc.lanes; i++) {
+      lj += String(i ? "," : "") + "{\"id\":" + String(i + 1) + ",\"pin\":" + String(PINS[i]) + ",\"debounce_ms\":20}";
+      host::setPin(PINS[i], HIGH); // beam utuh
+    }
+    f = LittleFS.open("/lanes.json", "w"); f.print(lj + "]}"); f.close();
+    setup();
+  };
+  fw.loop = [](){ loop(); };
+  fw.inject = [](const sim::Scenario& sc, uint64_t start, sim::Line& line){
+    for (uint8_t l = 0; l < sc.lanes; l++) {
+      // jalur digeser sebagian periode supaya pulsa berselang-seling
+      const uint64_t shift = (uint64_t)(60e6 / sc.ratePerMin) * l / sc.lanes;
+      uint32_t n = 0;
+      for (uint64_t t : sim::schedule(sc, start + shift, 0x9E3779B9 + l)) {
+        const std::string k = std::to_string(l + 1) + ":" + std::to_string(++n);
+        const uint8_t pin = PINS[l];
+        host::at(t, [pin](){ host::setPin(pin, LOW); });
+        host::at(t + PULSE_US, [pin, k, &line](){ line.injected(k); host::setPin(pin, HIGH); }); // terhitung di tepi naik
+      }
+    }
+  };
+  fw.keyOf = [](const std::string& payload, std::string& key){
+    JsonDocument d;
+    if (deserializeJson(d, payload) || !d["count"].is<uint32_t>() || !d["lane"].is<uint32_t>()) return false;
+    key = std::to_string(d["lane"].as<uint32_t>()) + ":" + std::to_string(d["count"].as<uint32_t>());
+    return true;
+  };
+  fw.queue = [](size_t& n, size_t& bytes){ n = queue.count(); bytes = queue.sizeBytes(); };
+
+  std::vector<sim::Scenario> scs = {
+    { "steady", 300, 120 },
+    { "four_lanes", 300, 300, 30, {}, {}, {}, 4 },
+    { "broker_outage", 600, 120, 20, { { 60, 240 } }, {}, {}, 2 },
+    { "link_flap", 600, 120, 20, {}, { { 60, 15 }, { 180, 15 }, { 300, 90 } }, { { 330, 30 } }, 2 },
+    { "long_outage", 3600, 60, 10, { { 60, 3000 } } },
+  };
+  return sim::main("counting-barang line sim", fw, scs, argc, argv);
+}
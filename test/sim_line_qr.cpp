@@ -0,0 +1,46 @@
+// Simulator lini qr-scanner: kode unik "L<nnnnnn>\r" masuk lewat UART GM66 (Serial1) pada
+// jadwal skenario; item = kode_barang di payload broker.
+#include "sim.h"
+#include "../qr-scanner/qr-scanner.ino"
+
+static const char* CONFIG =
+  "{\"wifi_ssid\":\"lini\",\"wifi_pass\":\"x\",\"eth_mode\":\"static\",\"eth_ip\":\"192.168.10.60\","
+  "\"eth_gateway\":\"192.168.10.1\",\"eth_subnet\":\"255.255.255.0\",\"mqtt_host\":\"broker.lan\","
+  "\"mqtt_port\":1883,\"mqtt_topic\":\"lini/scan\"}";
+
+int main(int argc, char** argv){
+  sim::Firmware fw;
+  fw.boot = [](const sim::Scenario&){
+    File f = LittleFS.open("/config.json", "w"); f.print(CONFIG); f.close();
+    setup();
+  };
+  fw.loop = [](){ loop(); };
+  fw.inject = [](const sim::Scenario& sc, uint64_t start, sim::Line& line){
+    uint32_t n = 0;
+    for (uint64_t t : sim::schedule(sc, start, 0x9E3779B9)) {
+      char kode[16]; snprintf(kode, sizeof(kode), "L%06lu", (unsigned long)n++);
+      const std::string k = kode;
+      host::at(t, [k, &line](){
+        line.injected(k);
+        const std::string b = k + "\r";
+        Serial1.hostRx((const uint8_t*)b.data(), b.size());
+      });
+    }
+  };
+  fw.keyOf = [](const std::string& payload, std::string& key){
+    JsonDocument d;
+    if (deserializeJson(d, payload) || !d["kode_barang"].is<const char*>()) return false;
+    key = d["kode_barang"].as<const char*>();
+    return true;
+  };
+  fw.queue = [](size_t& n, size_t& bytes){ n = queue.count(); bytes = queue.sizeBytes(); };
+
+  std::vector<sim::Scenario> scs = {
+    { "steady", 300, 120 },
+    { "jitter_burst", 120, 1200, 50 },
+    { "broker_outage", 600, 120, 20, { { 60, 240 } } },
+    { "link_flap", 600, 120, 20, {}, { { 60, 15 }, { 180, 15 }, { 300, 90 } }, { { 330, 30 } } },
+    { "long_outage", 3600, 60, 10, { { 60, 3000 } } },
+  };
+  return sim::main("qr-scanner line sim", fw, scs, argc, argv);
+}
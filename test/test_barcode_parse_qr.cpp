@@ -0,0 +1,121 @@
+#include "harness.h"
+#include "BarcodeParse.h"
+#include <string>
+#include <vector>
+
+// Korpus BarcodeParse: EAN/UPC (cek digit), GS1 bentuk manusia & element string mentah (AIM / FNC1),
+// kode internal, dan setiap jenis error. Field dicek nilai & urutannya.
+
+using namespace BarcodeParse;
+
+struct Sample {
+  std::string code;
+  Symbology sym;
+  Error err;
+  std::vector<std::pair<const char*, const char*>> fields; // (nama AI ringkas | digit AI, nilai)
+};
+
+static const std::string GS(1, 0x1D);
+
+static const std::vector<Sample> CORPUS = {
+  { "4006381333931", Symbology::EAN13, Error::None, {} },
+  { "4006381333932", Symbology::EAN13, Error::CheckDigit, {} },
+  { "96385074", Symbology::EAN8, Error::None, {} },
+  { "96385075", Symbology::EAN8, Error::CheckDigit, {} },
+  { "036000291452", Symbology::UPCA, Error::None, {} },
+  { "036000291453", Symbology::UPCA, Error::CheckDigit, {} },
+  { "]E04006381333931", Symbology::EAN13, Error::None, {} },           // AIM EAN, bukan GS1
+  { "INT-00042", Symbology::Other, Error::None, {} },
+  { "1234567890", Symbology::Other, Error::None, {} },                  // numerik, panjang bukan EAN/UPC
+  { "(01)09501101530003(17)251231(10)LOT42", Symbology::GS1, Error::None,
+    { { "gtin", "09501101530003" }, { "expiry", "251231" }, { "lot", "LOT42" } } },
+  { "]C101095011015300031725123110LOT42" + GS + "21SER1", Symbology::GS1, Error::None,
+    { { "gtin", "09501101530003" }, { "expiry", "251231" }, { "lot", "LOT42" }, { "serial", "SER1" } } },
+  { GS + "0109501101530003", Symbology::GS1, Error::None, { { "gtin", "09501101530003" } } },
+  { "]d200106141412345678908", Symbology::GS1, Error::None, { { "sscc", "106141412345678908" } } },
+  { "]Q3(01)09501101530003(21)A1", Symbology::GS1, Error::None, { { "gtin", "09501101530003" }, { "serial", "A1" } } },
+  { "(3103)001250(15)260100", Symbology::GS1, Error::None, { { "3103", "001250" }, { "best_before", "260100" } } },
+  { "(91)ABC-9" , Symbology::GS1, Error::None, { { "91", "ABC-9" } } },
+  { "]C1" + GS + "10LOT" + GS + "3712", Symbology::GS1, Error::None, { { "lot", "LOT" }, { "count", "12" } } },
+  { "(01)09501101530004", Symbology::GS1, Error::CheckDigit, {} },
+  { "(00)106141412345678909", Symbology::GS1, Error::CheckDigit, {} },
+  { "(17)251331", Symbology::GS1, Error::BadDate, {} },
+  { "(11)250000", Symbology::GS1, Error::BadDate, {} },
+  { "(42)123", Symbology::GS1, Error::UnknownAI, {} },
+  { "(01", Symbology::GS1, Error::UnknownAI, {} },
+  { "(30)12A", Symbology::GS1, Error::BadChar, {} },
+  { "(01)0950110153000", Symbology::GS1, Error::BadLength, {} },
+  { "(10)ABCDEFGHIJKLMNOPQRSTU", Symbology::GS1, Error::BadLength, {} }, // lot > 20
+  { "]C1", Symbology::GS1, Error::BadLength, {} },                       // GS1 tanpa field
+  { "]C10109501101530003", Symbology::GS1, Error::None, { { "gtin", "09501101530003" } } },
+  { "]C1010950110153", Symbology::GS1, Error::BadLength, {} },           // terpotong
+  { "(21)1(21)2(21)3(21)4(21)5(21)6(21)7(21)8(21)9", Symbology::GS1, Error::TooManyFields, {} },
+};
+
+static std::string fieldKey(const Field& f){ return f.def->name ? f.def->name : std::string(f.ai, f.aiLen); }
+
+TEST(corpus){
+  for (const Sample& s : CORPUS) {
+    Result r;
+    const bool ok = parse(s.code.data(), s.code.size(), r);
+    if (r.sym != s.sym || r.err != s.err) {
+      printf("  %s: sym %s err %s (harap %s %s)\n", s.code.c_str(), symbologyName(r.sym), errorName(r.err),
+             symbologyName(s.sym), errorName(s.err));
+    }
+    CHECK(r.sym == s.sym);
+    CHECK(r.err == s.err);
+    CHECK_EQ(ok, s.err == Error::None);
+    if (s.err != Error::None) continue;
+    CHECK_EQ((size_t)r.nFields, s.fields.size());
+    for (size_t i = 0; i < s.fields.size() && i < r.nFields; i++) {
+      CHECK(fieldKey(r.fields[i]) == s.fields[i].first);
+      CHECK(std::string(r.fields[i].value, r.fields[i].len) == s.fields[i].second);
+    }
+  }
+}
+
+TEST(fields_point_into_input){
+  const std::string c = "]C101095011015300031725123110LOT42";
+  Result r;
+  REQUIRE(parse(c.data(), c.size(), r));
+  CHECK(r.data == c.data() + 3); // prefix AIM dilewati
+  for (uint8_t i = 0; i < r.nFields; i++) {
+    CHECK(r.fields[i].value >= c.data());
+    CHECK(r.fields[i].value + r.fields[i].len <= c.data() + c.size());
+  }
+  const Field* lot = r.find("lot");
+  REQUIRE(lot);
+  CHECK(std::string(lot->value, lot->len) == "LOT42");
+  CHECK(!r.find("serial"));
+}
+
+TEST(check_digit_catches_every_single_digit_error){
+  const std::string good = "09501101530003";
+  for (size_t pos = 0; pos < good.size(); pos++) {
+    for (char d = '0'; d <= '9'; d++) {
+      if (d == good[pos]) continue;
+      std::string bad = good; bad[pos] = d;
+      CHECK(!gs1CheckDigit(bad.data(), bad.size()));
+    }
+  }
+  CHECK(gs1CheckDigit(good.data(), good.size()));
+}
+
+// throughput: korpus diputar berulang, tanpa alokasi heap
+TEST(throughput_without_allocation){
+  const int ROUNDS = 20000;
+  const uint64_t a0 = host::allocCount();
+  const auto t0 = std::chrono::steady_clock::now();
+  uint32_t valid = 0;
+  for (int k = 0; k < ROUNDS; k++) {
+    for (const Sample& s : CORPUS) { Result r; valid += parse(s.code.data(), s.code.size(), r); }
+  }
+  const double s = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+  CHECK_EQ(host::allocCount(), a0);
+  const double perSec = ROUNDS * CORPUS.size() / s;
+  printf("  %zu kode, %.0f kode/s (host), %.0f ns/kode\n", ROUNDS * CORPUS.size(), perSec, 1e9 / perSec);
+  CHECK(valid > 0);
+  CHECK(perSec > 100000); // batas longgar: di host jauh di atas laju scan mana pun
+}
+
+TEST_MAIN()
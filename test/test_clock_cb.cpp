@@ -0,0 +1,116 @@
+#include "harness.h"
+#include "RTCClockDS3231.h"
+#include <esp_timer.h>
+
+// Timebase ms RTCClockDS3231 terhadap model DS3231 dengan drift (host_rtc.h): esp_timer = waktu host,
+// RTC berjalan ppm lebih cepat/lambat. Jam terkoreksi harus mengikuti detik RTC, monoton, dan
+// membaca I2C hanya sesekali.
+
+static const uint32_t EPOCH_UTC = 1760000000UL; // 2025-10-09
+static const uint8_t SQW = 4;
+
+static int64_t errUs(RTCClockDS3231& c){ // nowMs - waktu RTC (UTC)
+  return (int64_t)c.nowMs() * 1000 - (int64_t)(host::rtcNowUs() - (uint64_t)RTCClockDS3231::tzOffsetS() * 1000000ULL);
+}
+
+struct Track { int64_t maxErr = 0; uint64_t lastMs = 0; bool monotonic = true; };
+
+// loop() tiap stepUs selama durS; stallUs tambahan tiap stallEvery loop (tepi SQW terlewat)
+static Track run(RTCClockDS3231& c, uint32_t durS, uint32_t stepUs, uint32_t stallUs = 0, uint32_t stallEvery = 0, uint32_t settleS = 3){
+  Track t;
+  const uint64_t end = host::nowUs() + (uint64_t)durS * 1000000, settle = host::nowUs() + (uint64_t)settleS * 1000000;
+  for (uint32_t n = 1; host::nowUs() < end; n++) {
+    c.loopClock();
+    const uint64_t ms = c.nowMs();
+    if (ms < t.lastMs) t.monotonic = false;
+    t.lastMs = ms;
+    if (host::nowUs() >= settle) t.maxErr = std::max(t.maxErr, std::abs(errUs(c)));
+    host::advance(stepUs + (stallEvery && n % stallEvery == 0 ? stallUs : 0));
+  }
+  return t;
+}
+
+static void boot(RTCClockDS3231& c, double ppm, int sqwPin){
+  RTCClockDS3231::initTz(RTCClockDS3231::DEFAULT_TZ_S);
+  host::rtc().ppm = ppm; host::rtc().sqwPin = sqwPin;
+  host::rtcSet(EPOCH_UTC + RTCClockDS3231::DEFAULT_TZ_S); // RTC berisi waktu lokal
+  host::advance(370000);                                  // boot di tengah detik RTC
+  REQUIRE(c.begin(sqwPin));
+}
+
+TEST(sqw_tracks_drifting_rtc_to_the_millisecond){
+  for (double ppm : { 0.0, 20.0, -35.0, 90.0 }) {
+    harness::fresh();
+    RTCClockDS3231 c;
+    boot(c, ppm, SQW);
+    const Track t = run(c, 3600, 7000);
+    const RTCClockDS3231::ClockStats& st = c.clockStats();
+    printf("  %+5.0f ppm: ppb %ld, err maks %lld us, %u tepi, %u baca I2C\n", ppm, (long)st.ppb,
+           (long long)t.maxErr, st.edges, st.rtcReads);
+    CHECK(t.monotonic);
+    CHECK(t.maxErr < 1000 + 200);                // truncation ms + sisa drift antar tepi
+    CHECK(std::abs(st.ppb + (int32_t)(ppm * 1000)) <= 1500); // + = esp_timer lebih cepat dari RTC
+    CHECK(st.edges >= 3598);
+    CHECK(st.rtcReads <= 2 + 3600 / 600);        // sekali di boot, tepi pertama, lalu tiap 10 menit
+    CHECK_EQ(st.steps, (uint32_t)0);
+  }
+}
+
+TEST(loop_stalls_skip_edges_without_losing_phase){
+  RTCClockDS3231 c;
+  boot(c, 45, SQW);
+  // loop() tertahan 2.7 s tiap ~100 s: beberapa tepi tergabung jadi satu, baca I2C terlambat dilewati
+  const Track t = run(c, 3600, 10000, 2700000, 10000);
+  CHECK(t.monotonic);
+  CHECK(t.maxErr < 1000 + 300);
+  CHECK(std::abs(c.clockStats().ppb + 45000) <= 2000);
+}
+
+TEST(events_in_the_same_second_are_distinct){
+  RTCClockDS3231 c;
+  boot(c, 10, SQW);
+  run(c, 5, 5000);
+  const uint32_t reads = c.clockStats().rtcReads;
+  uint64_t prev = 0;
+  for (int i = 0; i < 50; i++) { // 50 barang dalam 150 ms
+    const uint64_t ms = c.nowMs();
+    CHECK(ms > prev);
+    prev = ms;
+    host::advance(3000);
+  }
+  CHECK_EQ(c.clockStats().rtcReads, reads); // cap waktu tanpa transaksi I2C
+  char tgl[11], jam[9];
+  RTCClockDS3231::formatLocal(prev, tgl, jam);
+  CHECK(std::string(tgl) == "2025-10-09");
+  CHECK_EQ(RTCClockDS3231::parseLocal(tgl, jam) / 1000, prev / 1000);
+}
+
+TEST(without_sqw_error_is_bounded_by_coarse_resync){
+  RTCClockDS3231 c;
+  boot(c, 100, -1);
+  // tanpa SQW fase awal +-0.5 s, cek tiap menit, lompat bila beda > 1 s
+  const Track t = run(c, 8 * 3600, 50000, 0, 0, 0);
+  printf("  tanpa SQW: err maks %lld us, %u lompat, %u baca I2C\n", (long long)t.maxErr, c.clockStats().steps, c.clockStats().rtcReads);
+  CHECK(t.monotonic);
+  CHECK(t.maxErr < 2100000); // detik bulat beda 2 = drift: fase di-snap, jam kembali ke RTC
+  CHECK(c.clockStats().steps >= 1);
+  CHECK(c.clockStats().rtcReads <= 1 + 8 * 60 + 1);
+}
+
+TEST(rtc_adjusted_externally_keeps_corrected_time_continuous){
+  RTCClockDS3231 c;
+  boot(c, 0, SQW);
+  int64_t jumps = 0;
+  c.onRawStep([&](int64_t j){ jumps += j; });
+  run(c, 30, 10000);
+  const uint64_t ms0 = c.nowMs(), t0 = host::nowUs();
+  host::rtcSet((uint32_t)(host::rtcNowUs() / 1000000) + 120); // RTC dimajukan 2 menit dari luar
+  // tepi berikut hanya menggeser fase (pembagi detik direset); detik baru terbaca di baca I2C 10 menit
+  run(c, 620, 10000, 0, 0, 10000);
+  CHECK(jumps < -119000000 && jumps > -121000000);
+  CHECK(c.clockStats().steps >= 1);
+  CHECK(std::abs((int64_t)(c.nowMs() - ms0) * 1000 - (int64_t)(host::nowUs() - t0)) < 2000); // tanpa lompatan
+  CHECK(std::abs((int64_t)c.rawUs() - (int64_t)(host::rtcNowUs() - (uint64_t)RTCClockDS3231::tzOffsetS() * 1000000ULL)) < 1200);
+}
+
+TEST_MAIN()
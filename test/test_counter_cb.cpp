@@ -0,0 +1,106 @@
+#include "harness.h"
+#include "PersistentCounter.h"
+#include <esp_system.h>
+#include <map>
+
+// PersistentCounter: write amplification journal+checkpoint dibanding tulis-per-hitungan, dan
+// restore setelah power-on (flash saja, batas hilang) / soft reset (RTC memory, tepat).
+
+static uint32_t lcg(uint32_t& s){ s = s * 1664525u + 1013904223u; return s >> 8; }
+
+// n hitungan acak ke ids jalur, loop() tiap 50 hitungan; real = total sebenarnya per id
+static void run(PersistentCounter& pc, uint32_t n, uint8_t ids, uint32_t gapMs, std::map<uint8_t, uint32_t>& real, uint32_t seed){
+  for (uint32_t i = 0; i < n; i++) {
+    const uint8_t id = 1 + lcg(seed) % ids;
+    CHECK_EQ(pc.add(id), real[id] + 1);
+    real[id]++;
+    host::advance((uint64_t)gapMs * 1000);
+    if (i % 50 == 0) pc.loop();
+  }
+}
+
+TEST(write_amplification_fast_line){
+  host::setResetReason(ESP_RST_POWERON);
+  PersistentCounter pc;
+  REQUIRE(pc.begin("wa"));
+  std::map<uint8_t, uint32_t> real;
+  run(pc, 20000, 4, 150, real, 7); // 4 jalur, ~400 barang/menit total
+  const PersistentCounter::Stats& st = pc.stats();
+  CHECK_EQ(st.counts, (uint32_t)20000);
+  CHECK_EQ((uint64_t)st.journalWrites + st.checkpoints, host::nvsWrites()); // flashBytes menghitung semua tulisan
+  // record 32 B per COMMIT_EVERY hitungan + checkpoint tiap JOURNAL_SLOTS record
+  const float wa = pc.writeAmplification();
+  printf("  %u hitungan: %u record, %u checkpoint, %u byte, %.2f byte/hitungan (naif %u)\n", st.counts,
+         st.journalWrites, st.checkpoints, st.flashBytes, wa, (unsigned)PersistentCounter::NVS_ENTRY_BYTES);
+  CHECK(wa >= (float)PersistentCounter::NVS_ENTRY_BYTES / PersistentCounter::COMMIT_EVERY);
+  CHECK(wa <= 3.0f);
+  CHECK(st.journalWrites <= 20000 / PersistentCounter::COMMIT_EVERY + 4 * PersistentCounter::MAX_IDS);
+}
+
+TEST(write_amplification_slow_line_commits_on_idle){
+  host::setResetReason(ESP_RST_POWERON);
+  PersistentCounter pc;
+  REQUIRE(pc.begin("wa"));
+  std::map<uint8_t, uint32_t> real;
+  // satu barang tiap 3 s: commit waktu (COMMIT_MS setelah hitungan terakhir) tidak pernah jatuh tempo
+  for (int i = 0; i < 200; i++) { pc.add(1); real[1]++; host::advance(3000000); pc.loop(); }
+  CHECK(pc.stats().journalWrites <= 200 / PersistentCounter::COMMIT_EVERY + 1);
+  // jalur berhenti: sisa pending di-commit setelah COMMIT_MS
+  host::advance((uint64_t)PersistentCounter::COMMIT_MS * 1000); pc.loop();
+  PersistentCounter again;
+  again.begin("wa");
+  CHECK_EQ(again.get(1), real[1]);
+}
+
+TEST(power_on_restore_loses_at_most_bound){
+  host::setResetReason(ESP_RST_POWERON);
+  std::map<uint8_t, uint32_t> real;
+  uint32_t seed = 99;
+  for (int boot = 0; boot < 12; boot++) {
+    PersistentCounter pc;
+    REQUIRE(pc.begin("pwr"));
+    for (auto& r : real) {
+      const uint32_t got = pc.get(r.first);
+      CHECK(got <= r.second);
+      CHECK(r.second - got <= pc.lossBound());
+      r.second = got; // hitungan yang hilang memang hilang; berikutnya lanjut dari nilai restore
+    }
+    if (boot) CHECK(pc.stats().restored == PersistentCounter::Source::Flash);
+    run(pc, 300 + lcg(seed) % 700, 5, 100, real, seed); // listrik putus di titik acak, tanpa commit()
+  }
+}
+
+TEST(soft_reset_restores_exact_from_rtc_memory){
+  host::setResetReason(ESP_RST_POWERON);
+  std::map<uint8_t, uint32_t> real;
+  {
+    PersistentCounter pc; pc.begin("soft");
+    run(pc, 1000 + 7, 3, 100, real, 3); // pending < COMMIT_EVERY di tiap id
+  }
+  host::setResetReason(ESP_RST_TASK_WDT);
+  {
+    PersistentCounter pc; pc.begin("soft");
+    CHECK(pc.stats().restored == PersistentCounter::Source::RtcMemory);
+    for (auto& r : real) CHECK_EQ(pc.get(r.first), r.second);
+    // selisih RTC vs flash ikut di-commit pada record berikutnya
+    REQUIRE(pc.commit());
+  }
+  host::setResetReason(ESP_RST_POWERON);
+  PersistentCounter pc; pc.begin("soft");
+  CHECK(pc.stats().restored == PersistentCounter::Source::Flash);
+  for (auto& r : real) CHECK_EQ(pc.get(r.first), r.second);
+}
+
+TEST(brownout_ignores_rtc_shadow){
+  host::setResetReason(ESP_RST_POWERON);
+  {
+    PersistentCounter pc; pc.begin("bo");
+    for (int i = 0; i < 40; i++) pc.add(2); // 2 x COMMIT_EVERY ter-commit, 8 pending
+  }
+  host::setResetReason(ESP_RST_BROWNOUT); // isi RTC memory tidak bisa dipercaya
+  PersistentCounter pc; pc.begin("bo");
+  CHECK(pc.stats().restored == PersistentCounter::Source::Flash);
+  CHECK_EQ(pc.get(2), 2 * PersistentCounter::COMMIT_EVERY);
+}
+
+TEST_MAIN()
@@ -0,0 +1,141 @@
+#include "harness.h"
+#include "EthernetDhcp.h"
+#include "shim/host_net.h"
+
+// EthernetDhcp terhadap server DHCP palsu (host::udpServer(67)): lease cache + umur dari jam epoch.
+
+static const uint8_t MAC[6] = { 0x02, 0, 0, 0x11, 0x22, 0x33 };
+static const IPAddress SERVER(192, 168, 10, 1), OFFER(192, 168, 10, 77);
+static const uint64_t EPOCH0 = 1750000000000ULL;
+static uint64_t epochMs(){ return EPOCH0 + host::nowUs() / 1000; }
+
+// skrip server: diam, atau jawab (OFFER untuk DISCOVER, ACK/NAK untuk REQUEST)
+struct FakeDhcp {
+  enum Mode { SILENT, ACK, NAK } mode = SILENT;
+  uint32_t leaseS = 3600;
+  int discovers = 0, requests = 0;
+  IPAddress requested;
+  void install(){
+    host::udpServer(67, [this](const host::UdpRequest& rq, host::UdpReply reply){
+      if (rq.len < 244) return;
+      uint8_t type = 0;
+      for (size_t i = 240; i + 1 < rq.len && rq.data[i] != 255; ) {
+        const uint8_t opt = rq.data[i++], ol = rq.data[i++];
+        if (opt == 53) type = rq.data[i];
+        if (opt == 50 && ol == 4) requested = IPAddress(rq.data[i], rq.data[i + 1], rq.data[i + 2], rq.data[i + 3]);
+        i += ol;
+      }
+      if (type == 1) discovers++; else if (type == 3) requests++;
+      if (mode == SILENT) return;
+      uint8_t p[300] = { 0 };
+      p[0] = 2; p[1] = 1; p[2] = 6;
+      memcpy(p + 4, rq.data + 4, 4);   // xid
+      memcpy(p + 28, rq.data + 28, 6); // chaddr
+      const IPAddress yi = type == 3 && requested != IPAddress() ? requested : OFFER;
+      for (int i = 0; i < 4; i++) p[16 + i] = yi[i];
+      p[236] = 0x63; p[237] = 0x82; p[238] = 0x53; p[239] = 0x63;
+      size_t n = 240;
+      const uint8_t reply53 = type == 1 ? 2 : mode == NAK ? 6 : 5;
+      p[n++] = 53; p[n++] = 1; p[n++] = reply53;
+      p[n++] = 54; p[n++] = 4; for (int i = 0; i < 4; i++) p[n++] = SERVER[i];
+      p[n++] = 1; p[n++] = 4; p[n++] = 255; p[n++] = 255; p[n++] = 255; p[n++] = 0;
+      p[n++] = 3; p[n++] = 4; for (int i = 0; i < 4; i++) p[n++] = SERVER[i];
+      p[n++] = 51; p[n++] = 4; p[n++] = leaseS >> 24; p[n++] = leaseS >> 16; p[n++] = leaseS >> 8; p[n++] = leaseS;
+      p[n++] = 255;
+      reply(p, sizeof(p), SERVER, 67, 2000);
+    });
+  }
+};
+
+static EthernetDhcp::Lease cachedLease(uint64_t ageS){
+  EthernetDhcp::Lease l;
+  l.ip = IPAddress(192, 168, 10, 50); l.subnet = IPAddress(255, 255, 255, 0);
+  l.gateway = l.server = SERVER;
+  l.leaseS = 3600; l.t1S = 1800; l.t2S = 3150;
+  l.acquiredMs = EPOCH0 + host::nowUs() / 1000 - ageS * 1000;
+  return l;
+}
+
+static void run(EthernetDhcp& d, uint32_t ms){
+  for (uint32_t i = 0; i < ms / 10; i++) { d.loop(); host::advance(10000); }
+}
+
+TEST(silent_server_keeps_remaining_lease){
+  FakeDhcp srv; srv.install();
+  EthernetDhcp d; d.setClock(epochMs);
+  const EthernetDhcp::Lease l = cachedLease(600);
+  d.start(MAC, "t", &l);
+  CHECK_EQ(d.state(), EthernetDhcp::REBOOTING);
+  CHECK(Ethernet.localIP() == l.ip);
+  run(d, 60000);
+  CHECK_EQ(d.state(), EthernetDhcp::BOUND);
+  CHECK(srv.requests >= 3);
+  // sisa = 3600 - 600 - ~28 s menunggu balasan, bukan lease penuh
+  CHECK(d.remainingS() <= 3000 - 20);
+  CHECK(d.remainingS() > 2900);
+}
+
+TEST(expired_cached_lease_goes_to_init){
+  FakeDhcp srv; srv.mode = FakeDhcp::ACK; srv.install();
+  EthernetDhcp d; d.setClock(epochMs);
+  const EthernetDhcp::Lease l = cachedLease(7200);
+  d.start(MAC, "t", &l);
+  CHECK_EQ(d.state(), EthernetDhcp::SELECTING);
+  CHECK(Ethernet.localIP() != l.ip);
+  CHECK_EQ(srv.discovers, 1);
+  run(d, 1000);
+  CHECK_EQ(d.state(), EthernetDhcp::BOUND);
+  CHECK(d.lease().ip == OFFER);
+  CHECK(d.lease().acquiredMs > EPOCH0);
+  CHECK(d.remainingS() >= 3599);
+}
+
+TEST(lease_runs_out_while_rebooting){
+  FakeDhcp srv; srv.install();
+  EthernetDhcp d; d.setClock(epochMs);
+  const EthernetDhcp::Lease l = cachedLease(3590);
+  d.start(MAC, "t", &l);
+  CHECK_EQ(d.state(), EthernetDhcp::REBOOTING);
+  run(d, 15000);
+  CHECK_EQ(d.state(), EthernetDhcp::SELECTING);
+  CHECK(Ethernet.localIP() == IPAddress());
+}
+
+TEST(unknown_age_never_claims_cached_address){
+  FakeDhcp srv; srv.install();
+  EthernetDhcp d; // tanpa jam
+  EthernetDhcp::Lease l = cachedLease(0); l.acquiredMs = 0;
+  d.start(MAC, "t", &l);
+  CHECK_EQ(d.state(), EthernetDhcp::REBOOTING);
+  run(d, 60000);
+  CHECK_EQ(d.state(), EthernetDhcp::SELECTING);
+  CHECK(srv.discovers >= 1);
+}
+
+TEST(ack_to_init_reboot_restarts_full_lease){
+  FakeDhcp srv; srv.mode = FakeDhcp::ACK; srv.install();
+  EthernetDhcp d; d.setClock(epochMs);
+  int saved = 0; uint64_t savedAt = 0;
+  d.onLease([&](const EthernetDhcp::Lease& x){ saved++; savedAt = x.acquiredMs; });
+  const EthernetDhcp::Lease l = cachedLease(3000);
+  d.start(MAC, "t", &l);
+  run(d, 1000);
+  CHECK_EQ(d.state(), EthernetDhcp::BOUND);
+  CHECK(srv.requested == l.ip);
+  CHECK(d.lease().ip == l.ip);
+  CHECK_EQ(saved, 1); // alamat sama, tapi waktu perolehan baru tetap disimpan
+  CHECK(savedAt > l.acquiredMs);
+  CHECK(d.remainingS() >= 3598);
+}
+
+TEST(nak_to_init_reboot_restarts_discovery){
+  FakeDhcp srv; srv.mode = FakeDhcp::NAK; srv.install();
+  EthernetDhcp d; d.setClock(epochMs);
+  const EthernetDhcp::Lease l = cachedLease(60);
+  d.start(MAC, "t", &l);
+  run(d, 100);
+  CHECK_EQ(d.state(), EthernetDhcp::SELECTING);
+  CHECK(srv.discovers >= 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,197 @@
+#include "harness.h"
+#include "BarcodeScannerGM66.h"
+#include <string>
+#include <vector>
+
+// Protokol serial GM66 terhadap modul simulasi di Serial1: zone bit, baud, simpan ke flash modul.
+
+// Modul: menjawab hanya jika baud UART host sama dengan baud modul; perubahan baud (zone 0x2A)
+// berlaku setelah respons tulis terkirim.
+struct Gm66Sim {
+  uint8_t zone[256] = { 0 }, flash[256] = { 0 };
+  uint32_t baud = 9600;
+  int commands = 0, badCrc = 0, saves = 0;
+  bool corruptNext = false, silent = false;
+  std::string scanBefore, scanAfter; // byte scan (mode continuous) yang mengapit frame respons
+
+  // pembagi 3 MHz tidak pas (26 -> 115384): UART toleran ~2%, modul dianggap di baud standar terdekat
+  static uint32_t snap(uint32_t b){
+    for (uint32_t s : { 9600u, 19200u, 38400u, 57600u, 115200u }) if (b * 50 > s * 49 && b * 50 < s * 51) return s;
+    return b;
+  }
+  void install(){
+    zone[BarcodeScannerGM66::ZONE_FLAGS] = BarcodeScannerGM66::MODE_CONTINUOUS;
+    Serial1.onHostTx([this](const uint8_t* p, size_t n){ rx(p, n); });
+  }
+  void reply(uint8_t status, const uint8_t* data, uint8_t len, uint32_t atBaud){
+    std::vector<uint8_t> r = { 0x02, 0x00, status, len };
+    r.insert(r.end(), data, data + len);
+    const uint16_t crc = BarcodeScannerGM66::crc16(r.data() + 2, 2 + len);
+    r.push_back(crc >> 8); r.push_back(crc & 0xFF);
+    if (corruptNext) { r.back() ^= 0x55; corruptNext = false; }
+    r.insert(r.begin(), scanBefore.begin(), scanBefore.end());
+    r.insert(r.end(), scanAfter.begin(), scanAfter.end());
+    const uint64_t wire = (uint64_t)r.size() * 10 * 1000000 / atBaud;
+    host::at(host::nowUs() + 1000 + wire, [r](){ Serial1.hostRx(r.data(), r.size()); });
+  }
+  void rx(const uint8_t* p, size_t n){
+    if (silent || Serial1.baudRate() != baud) return; // baud beda: modul hanya melihat sampah
+    if (n < 8 || p[0] != 0x7E || p[1] != 0x00 || n != (size_t)8 + p[3]) return;
+    if (BarcodeScannerGM66::crc16(p + 2, 4 + p[3]) != (((uint16_t)p[6 + p[3]] << 8) | p[7 + p[3]])) { badCrc++; return; }
+    commands++;
+    const uint8_t type = p[2], len = p[3];
+    const uint16_t addr = ((uint16_t)p[4] << 8) | p[5];
+    const uint8_t* d = p + 6;
+    if (type == 0x07) { reply(0x00, zone + addr, d[0], baud); return; }
+    if (type == 0x08) {
+      memcpy(zone + addr, d, len);
+      reply(0x00, nullptr, 0, baud);
+      if (addr == BarcodeScannerGM66::ZONE_BAUD) baud = snap(3000000UL / (zone[addr] | (zone[addr + 1] << 8)));
+      return;
+    }
+    if (type == 0x09) { memcpy(flash, zone, sizeof(zone)); saves++; reply(0x00, nullptr, 0, baud); return; }
+    const uint8_t none = 0; reply(0x01, &none, 0, baud);
+  }
+};
+
+TEST(crc_is_ccitt_xmodem){
+  CHECK_EQ(BarcodeScannerGM66::crc16((const uint8_t*)"123456789", 9), (uint16_t)0x31C3);
+  CHECK_EQ(BarcodeScannerGM66::crc16(nullptr, 0), (uint16_t)0);
+}
+
+TEST(build_command_framing){
+  uint8_t out[16];
+  const uint8_t n = 1;
+  CHECK_EQ(BarcodeScannerGM66::buildCommand(0x07, 0x002A, &n, 1, out, sizeof(out)), (size_t)9);
+  const uint8_t head[] = { 0x7E, 0x00, 0x07, 0x01, 0x00, 0x2A, 0x01 };
+  CHECK(memcmp(out, head, sizeof(head)) == 0);
+  const uint16_t crc = BarcodeScannerGM66::crc16(out + 2, 5);
+  CHECK_EQ(out[7], (uint8_t)(crc >> 8));
+  CHECK_EQ(out[8], (uint8_t)(crc & 0xFF));
+  CHECK_EQ(BarcodeScannerGM66::buildCommand(0x08, 0, out, 9, out, 16), (size_t)0); // 6+9+2 > cap
+}
+
+TEST(parse_response_partial_bad_and_ok){
+  const uint8_t body[] = { 0x02, 0x00, 0x00, 0x02, 0xAB, 0xCD };
+  uint8_t f[8]; memcpy(f, body, 6);
+  const uint16_t crc = BarcodeScannerGM66::crc16(f + 2, 4);
+  f[6] = crc >> 8; f[7] = crc & 0xFF;
+  const uint8_t* d = nullptr; uint8_t len = 0;
+  for (size_t n = 0; n < sizeof(f); n++) CHECK_EQ(BarcodeScannerGM66::parseResponse(f, n, &d, &len), 0); // belum lengkap
+  CHECK_EQ(BarcodeScannerGM66::parseResponse(f, sizeof(f), &d, &len), 8);
+  CHECK_EQ(len, (uint8_t)2);
+  CHECK(d == f + 4);
+  uint8_t bad[8]; memcpy(bad, f, 8); bad[7] ^= 1;
+  CHECK_EQ(BarcodeScannerGM66::parseResponse(bad, 8, &d, &len), -1);
+  memcpy(bad, f, 8); bad[0] = 0x7E;
+  CHECK_EQ(BarcodeScannerGM66::parseResponse(bad, 8, &d, &len), -1);
+}
+
+TEST(auto_baud_detects_module){
+  Gm66Sim m; m.baud = 57600; m.install();
+  BarcodeScannerGM66 sc;
+  sc.begin(Serial1, -1, -1, 0);
+  CHECK_EQ(sc.baud(), (uint32_t)57600);
+  CHECK_EQ(Serial1.baudRate(), (uint32_t)57600);
+  CHECK_EQ(sc.mode(), (int)BarcodeScannerGM66::MODE_CONTINUOUS);
+}
+
+TEST(silent_module_falls_back_to_9600){
+  Gm66Sim m; m.silent = true; m.install();
+  BarcodeScannerGM66 sc;
+  const uint64_t t0 = host::nowUs();
+  sc.begin(Serial1, -1, -1, 0);
+  CHECK_EQ(sc.baud(), (uint32_t)9600);
+  CHECK_EQ(sc.mode(), -1);
+  // 5 baud + baca mode, masing-masing dibatasi CMD_TIMEOUT_MS
+  CHECK(host::nowUs() - t0 <= 6ULL * (BarcodeScannerGM66::CMD_TIMEOUT_MS + 5) * 1000);
+  CHECK_EQ(sc.stats().cmdFail, (uint32_t)6);
+}
+
+TEST(switch_to_115200_and_save){
+  Gm66Sim m; m.install();
+  BarcodeScannerGM66 sc;
+  sc.begin(Serial1, -1, -1, 9600);
+  REQUIRE(sc.setBaud(115200));
+  CHECK_EQ(m.baud, (uint32_t)115200);
+  CHECK_EQ(sc.baud(), (uint32_t)115200);
+  CHECK_EQ(Serial1.baudRate(), (uint32_t)115200);
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_BAUD], (uint8_t)26); // 3000000/115200 = 26
+  CHECK(m.saves >= 1);
+  // modul menolak baud (diam setelah tulis): UART kembali ke baud lama
+  m.silent = true;
+  CHECK(!sc.setBaud(57600));
+  CHECK_EQ(Serial1.baudRate(), (uint32_t)115200);
+}
+
+TEST(mode_and_read_timing_zones){
+  Gm66Sim m; m.install();
+  BarcodeScannerGM66 sc;
+  sc.begin(Serial1, -1, -1, 9600);
+  m.zone[BarcodeScannerGM66::ZONE_FLAGS] |= 0x40; // bit lain tidak boleh ikut berubah
+  REQUIRE(sc.setMode(BarcodeScannerGM66::MODE_SENSOR));
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_FLAGS], (uint8_t)(0x40 | BarcodeScannerGM66::MODE_SENSOR));
+  CHECK_EQ(sc.mode(), (int)BarcodeScannerGM66::MODE_SENSOR);
+  REQUIRE(sc.setReadTiming(1500, 300));
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_READ_TIME], (uint8_t)15);
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_INTERVAL], (uint8_t)3);
+  CHECK_EQ(m.badCrc, 0);
+}
+
+TEST(read_timing_partial_update_and_range){
+  Gm66Sim m; m.install();
+  BarcodeScannerGM66 sc;
+  sc.begin(Serial1, -1, -1, 9600);
+  REQUIRE(sc.setReadTiming(3000, 800));
+  // hanya interval: waktu baca di modul tidak boleh jadi 0 (= baca tanpa batas)
+  REQUIRE(sc.setReadTiming(-1, 500));
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_READ_TIME], (uint8_t)30);
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_INTERVAL], (uint8_t)5);
+  REQUIRE(sc.setReadTiming(0, -1));
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_READ_TIME], (uint8_t)0);
+  CHECK_EQ(m.flash[BarcodeScannerGM66::ZONE_INTERVAL], (uint8_t)5);
+  // di luar rentang: ditolak tanpa menyentuh modul
+  const int cmds = m.commands;
+  CHECK(!sc.setReadTiming(50, -1));     // < 100 ms akan terbulatkan ke 0 = tanpa batas
+  CHECK(!sc.setReadTiming(70000, -1));  // tidak muat satu byte x100 ms
+  CHECK(!sc.setReadTiming(-1, 25600));
+  CHECK(!sc.setReadTiming(-2, -1));
+  CHECK_EQ(m.commands, cmds);
+  CHECK(BarcodeScannerGM66::validReadTiming(25500, 0));
+}
+
+TEST(corrupt_reply_fails_transaction){
+  Gm66Sim m; m.install();
+  BarcodeScannerGM66 sc;
+  sc.begin(Serial1, -1, -1, 9600);
+  const uint32_t fail0 = sc.stats().cmdFail;
+  m.corruptNext = true;
+  uint8_t v = 0;
+  CHECK(!sc.readZone(BarcodeScannerGM66::ZONE_FLAGS, &v, 1));
+  CHECK_EQ(sc.stats().cmdFail, fail0 + 1);
+  CHECK(sc.readZone(BarcodeScannerGM66::ZONE_FLAGS, &v, 1)); // transaksi berikut bersih
+  CHECK_EQ(v, (uint8_t)BarcodeScannerGM66::MODE_CONTINUOUS);
+}
+
+TEST(scan_bytes_around_reply_reach_line_assembler){
+  Gm66Sim m; m.install();
+  BarcodeScannerGM66 sc;
+  sc.begin(Serial1, -1, -1, 9600);
+  sc.setDedup(0, 1);
+  std::vector<std::string> got;
+  sc.onScan([&](const char* k, size_t n){ got.emplace_back(k, n); });
+  // kode utuh + awal kode berikut sebelum header 0x02, sisanya setelah CRC
+  m.scanBefore = "4006381333931\r\nINT-";
+  m.scanAfter = "00042\r\n";
+  uint8_t v = 0;
+  REQUIRE(sc.readZone(BarcodeScannerGM66::ZONE_FLAGS, &v, 1));
+  CHECK_EQ(v, (uint8_t)BarcodeScannerGM66::MODE_CONTINUOUS);
+  host::advance(5000); // sisa setelah frame bisa tiba sesudah transact() selesai
+  sc.loop();
+  REQUIRE(got.size() == 2);
+  CHECK(got[0] == "4006381333931");
+  CHECK(got[1] == "INT-00042");
+  CHECK_EQ(sc.stats().interleaved.load(), (uint32_t)(m.scanBefore.size() + m.scanAfter.size()));
+}
+
+TEST_MAIN()
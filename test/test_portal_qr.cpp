@@ -0,0 +1,158 @@
+// Jalur API portal di host: sketch qr-scanner di-boot, request lewat AsyncWebServer shim.
+#include "harness.h"
+#include "shim/host_http.h"
+#include "../qr-scanner/qr-scanner.ino"
+
+TEST(status_serializes_augmented_fields){
+  setup();
+  host::advance(2000000);
+  host::HttpResponse r = host::http("GET", "/api/status");
+  CHECK_EQ(r.code, 200);
+  JsonDocument d;
+  REQUIRE(!deserializeJson(d, r.body));
+  CHECK(d["queue"]["count"].is<uint32_t>());
+  CHECK(d["flash"].is<JsonObject>());
+  CHECK(measureJson(d) == r.body.size());
+}
+
+TEST(unknown_route_is_404){
+  setup();
+  host::advance(2000000);
+  CHECK_EQ(host::http("GET", "/api/tidak-ada").code, 404);
+}
+
+TEST(app_routes_fit_with_headroom_and_overflow_is_reported){
+  host::clearSerialLog();
+  setup();
+  host::advance(2000000);
+  CHECK(host::serialLog().find("[BOOT] ERROR") == std::string::npos);
+  CHECK(host::serialLog().find("[HTTP] 12 route aplikasi, tabel 32 slot") != std::string::npos);
+  JsonDocument d;
+  REQUIRE(!deserializeJson(d, host::http("GET", "/api/routes").body));
+  CHECK_EQ(d["routes"].size(), (size_t)(11 + 12)); // bawaan + aplikasi
+  // sesudah begin() tabel tidak tumbuh: route tambahan masuk sampai penuh, lalu ditolak dengan log
+  static char paths[40][16];
+  int added = 0;
+  for (int i = 0; i < 40; i++) {
+    snprintf(paths[i], sizeof(paths[i]), "/api/x%d", i);
+    if (!portal.addRoute("GET", paths[i], [](const ApiRequest&, String&, int&){ return String("{\"x\":1}"); })) break;
+    added++;
+  }
+  CHECK_EQ(added, 32 - 12);
+  CHECK(host::serialLog().find("[HTTP] Route table full (32), drop GET /api/x20") != std::string::npos);
+  CHECK_EQ(host::http("GET", "/api/x0").code, 200);
+  CHECK_EQ(host::http("GET", "/api/x19").code, 200);
+  CHECK_EQ(host::http("GET", "/api/x20").code, 404);
+  CHECK_EQ(host::http("GET", "/api/tally").code, 200); // route sketch tetap terjangkau di tabel penuh
+}
+
+TEST(jobs_coalesce_only_identical_payloads){
+  setup();
+  host::advance(2000000);
+  const std::string dhcp = "{\"mode\":\"dhcp\"}";
+  const std::string fixed = "{\"mode\":\"static\",\"ip\":\"10.0.0.9\",\"gateway\":\"10.0.0.1\",\"subnet\":\"255.255.255.0\"}";
+  JsonDocument a, b, c, ja, jc;
+  REQUIRE(!deserializeJson(a, host::http("POST", "/api/eth/set", dhcp).body));
+  REQUIRE(!deserializeJson(b, host::http("POST", "/api/eth/set", dhcp).body));
+  CHECK_EQ(b["job"].as<uint32_t>(), a["job"].as<uint32_t>());
+  CHECK(b["coalesced"].as<bool>());
+  REQUIRE(!deserializeJson(c, host::http("POST", "/api/eth/set", fixed).body));
+  CHECK(c["job"].as<uint32_t>() != a["job"].as<uint32_t>());
+  CHECK(!c["coalesced"].as<bool>());
+  const std::string pa = "/api/jobs/" + std::to_string(a["job"].as<uint32_t>());
+  REQUIRE(!deserializeJson(ja, host::http("GET", pa.c_str()).body));
+  CHECK(ja["state"] == "superseded");
+  CHECK_EQ(ja["superseded_by"].as<uint32_t>(), c["job"].as<uint32_t>());
+  for (int i = 0; i < 5; i++) { loop(); host::advance(10000); }
+  const std::string pc = "/api/jobs/" + std::to_string(c["job"].as<uint32_t>());
+  REQUIRE(!deserializeJson(jc, host::http("GET", pc.c_str()).body));
+  CHECK(jc["state"] == "done");
+  CHECK(portal.config().eth_ip == "10.0.0.9"); // parameter request pertama tidak pernah dijalankan
+  CHECK(portal.config().eth_mode == "static");
+}
+
+TEST(scanner_config_rejects_out_of_range_timing){
+  setup();
+  host::advance(2000000);
+  CHECK_EQ(host::http("POST", "/api/scanner/config", "{\"read_ms\":50}").code, 400);        // -> 0 = tanpa batas
+  CHECK_EQ(host::http("POST", "/api/scanner/config", "{\"read_ms\":70000}").code, 400);     // terpotong uint16
+  CHECK_EQ(host::http("POST", "/api/scanner/config", "{\"interval_ms\":-5}").code, 400);
+  CHECK_EQ(host::http("POST", "/api/scanner/config", "{\"interval_ms\":500}").code, 202);
+}
+
+TEST(rejected_tally_settings_change_nothing){
+  setup();
+  host::advance(2000000);
+  const std::string before = tally.schedule().c_str();
+  CHECK_EQ(host::http("POST", "/api/tally/settings", "{\"shifts\":\"07:00,19:00\",\"snapshot_s\":5}").code, 400);
+  CHECK(before == tally.schedule().c_str());
+  CHECK_EQ(host::http("POST", "/api/tally/settings", "{\"shifts\":\"07:00,07:00\"}").code, 400);
+  CHECK(before == tally.schedule().c_str());
+  CHECK_EQ(host::http("POST", "/api/tally/settings", "{\"shifts\":\"19:00,07:00\",\"snapshot_s\":30}").code, 200);
+  CHECK(tally.schedule() == "07:00,19:00");
+  CHECK_EQ(tallySnapshotS, (uint32_t)30);
+}
+
+TEST(wifi_scan_runs_as_job_without_blocking_handler){
+  setup();
+  host::advance(2000000);
+  host::setWifi(true);
+  const uint64_t t0 = host::nowUs();
+  const host::HttpResponse r = host::http("GET", "/api/scan");
+  CHECK_EQ(r.code, 202);
+  CHECK(host::nowUs() - t0 < 50000); // handler tidak menunggu scan 13 channel
+  JsonDocument a, j;
+  REQUIRE(!deserializeJson(a, r.body));
+  const std::string poll = "/api/jobs/" + std::to_string(a["job"].as<uint32_t>());
+  for (int i = 0; i < 1000; i++) {
+    loop(); host::advance(10000);
+    REQUIRE(!deserializeJson(j, host::http("GET", poll.c_str()).body));
+    if (j["state"] == "done") break;
+  }
+  REQUIRE(j["state"] == "done");
+  CHECK_EQ(j["code"].as<int>(), 200);
+  CHECK_EQ(j["result"]["aps"].size(), (size_t)1);
+  CHECK(j["result"]["aps"][0]["ssid"].is<const char*>());
+}
+
+TEST(factory_reset_leaves_no_config_to_fall_back_to){
+  File f = LittleFS.open("/config.json", "w");
+  f.print("{\"wifi_ssid\":\"lini\",\"wifi_pass\":\"x\",\"mqtt_host\":\"old.lan\",\"mqtt_port\":1883}"); f.close();
+  setup();
+  host::advance(2000000);
+  const std::string body = "{\"host\":\"broker.lan\",\"port\":1883,\"topic\":\"t\"}";
+  REQUIRE(host::http("POST", "/api/mqtt/set", body).code == 200); // saveConfig: config lama -> .bak
+  CHECK(LittleFS.exists("/config.json.bak"));
+  bool restarted = false;
+  try { host::http("POST", "/api/reset"); } catch (const host::Restart&) { restarted = true; }
+  CHECK(restarted);
+  CHECK(!LittleFS.exists("/config.json"));
+  CHECK(!LittleFS.exists("/config.json.bak"));
+  CHECK(!LittleFS.exists("/config.json.tmp"));
+  // boot ulang: default, bukan salinan cadangan (portal global di host: snapshot lama tidak ditimpa,
+  // jadi yang dicek jalur loadConfig-nya)
+  host::clearSerialLog();
+  setup();
+  CHECK(host::serialLog().find("[CFG] No config file, using defaults.") != std::string::npos);
+  CHECK(host::serialLog().find("loaded backup") == std::string::npos);
+}
+
+TEST(config_update_burst_never_frees_live_snapshot){
+  setup();
+  host::advance(10000000); // snapshot retired dari test sebelumnya (portal global) lewat grace
+  const AppConfig& held = portal.config(); // pembaca (mis. loop()) memegang snapshot ini
+  const std::string body = "{\"host\":\"broker.lan\",\"port\":1883,\"topic\":\"t\"}";
+  int ok = 0, busy = 0;
+  for (int i = 0; i < 8; i++) {
+    const int c = host::http("POST", "/api/mqtt/set", body).code;
+    if (c == 200) ok++; else if (c == 503) busy++;
+  }
+  CHECK_EQ(ok, 4);   // satu per slot retired
+  CHECK_EQ(busy, 4); // sisanya ditolak, tidak ada snapshot yang di-free dalam grace period
+  CHECK(held.mqtt_port == 1883 || held.mqtt_port == 0); // masih bisa dibaca
+  host::advance(5000000);
+  CHECK_EQ(host::http("POST", "/api/mqtt/set", body).code, 200);
+  CHECK(portal.config().mqtt_host == "broker.lan");
+}
+
+TEST_MAIN()
@@ -0,0 +1,66 @@
+// Payload publish qr-scanner dari sketch asli: kode GS1 panjang (payload + topic > 256 B buffer
+// PubSubClient) harus terkirim, baik langsung maupun dari antrian offline, dan tiap AI muncul sekali.
+#include "harness.h"
+#include "../qr-scanner/qr-scanner.ino"
+
+static const char* CONFIG =
+  "{\"wifi_ssid\":\"lini\",\"wifi_pass\":\"x\",\"eth_mode\":\"static\",\"eth_ip\":\"192.168.10.60\","
+  "\"eth_gateway\":\"192.168.10.1\",\"eth_subnet\":\"255.255.255.0\",\"mqtt_host\":\"broker.lan\","
+  "\"mqtt_port\":1883,\"mqtt_topic\":\"lini/gudang-utara/scanner-dock-07\"}";
+
+static const char* GS1 = "(01)09501101530003(17)251231(10)LOT-2024-11-A(21)SN00012345678(91)ABC-9-INTERNAL";
+
+static void run(uint64_t us){
+  const uint64_t end = host::nowUs() + us;
+  while (host::nowUs() < end) { loop(); host::advance(20000); }
+}
+
+static void scan(const char* kode){
+  const std::string line = std::string(kode) + "\r";
+  Serial1.hostRx((const uint8_t*)line.data(), line.size());
+}
+
+TEST(gs1_events_fit_and_queue_drains){
+  host::broker().onMessage = nullptr;
+  File f = LittleFS.open("/config.json", "w"); f.print(CONFIG); f.close();
+  setup();
+  run(30000000);
+  REQUIRE(mqtt.connected());
+  host::broker().messages.clear();
+
+  // langsung
+  scan(GS1);
+  run(2000000);
+  REQUIRE(host::broker().messages.size() == 1);
+  const host::Message& m = host::broker().messages[0];
+  CHECK(m.payload.size() + m.topic.size() > MQTT_MAX_PACKET_SIZE);
+  JsonDocument d;
+  REQUIRE(!deserializeJson(d, m.payload));
+  CHECK(d["gtin"] == "09501101530003");
+  CHECK(d["lot"] == "LOT-2024-11-A");
+  CHECK(d["serial"] == "SN00012345678");
+  CHECK(d["expiry"] == "251231");
+  CHECK_EQ(d["gs1"].size(), (size_t)1);   // hanya AI tanpa nama
+  CHECK(d["gs1"]["91"] == "ABC-9-INTERNAL");
+  CHECK(!d["gs1"]["01"].is<const char*>());
+
+  // lewat antrian: broker mati, 3 scan GS1 + 1 EAN, broker hidup lagi -> semua terkirim
+  host::setBroker(false);
+  run(5000000);
+  char k[96];
+  for (int i = 0; i < 3; i++) {
+    snprintf(k, sizeof(k), "(01)09501101530003(10)LOT-%02d-PANJANG-XY(21)SN%011d(91)X", i, i);
+    scan(k); run(1500000);
+  }
+  scan("4006381333931"); run(1500000);
+  CHECK_EQ(queue.count(), (size_t)4);
+  host::broker().messages.clear();
+  host::setBroker(true);
+  run(60000000);
+  CHECK_EQ(queue.count(), (size_t)0);
+  CHECK_EQ(host::broker().messages.size(), (size_t)4);
+  CHECK_EQ(host::broker().oversize, (uint32_t)0);
+  CHECK_EQ(publishDeadLetters, (uint32_t)0);
+}
+
+TEST_MAIN()
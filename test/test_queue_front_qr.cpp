@@ -0,0 +1,112 @@
+#include "harness.h"
+#include "OfflineQueue.h"
+#include <map>
+
+// Tier depan PSRAM di atas allocator tersimulasi (host::setPsram) & LittleFS host.
+
+static const char* QP = "/front_q.ndjson";
+
+static ScanEvent ev(int i){
+  char kode[16]; snprintf(kode, sizeof(kode), "EV-%05d", i);
+  return ScanEvent{ "10.0.0.7", kode, 1700000000000ULL + i };
+}
+static int idOf(const ScanEvent& e){ return atoi(e.kode_barang.c_str() + 3); }
+
+TEST(no_psram_goes_direct){
+  host::setPsram(false);
+  OfflineQueue q; REQUIRE(q.begin(QP));
+  CHECK(!q.beginFront(128));
+  CHECK_EQ(q.frontCapacity(), (size_t)0);
+  for (int i = 0; i < 10; i++) CHECK(q.enqueue(ev(i)));
+  CHECK_EQ(q.frontStats().direct, (uint32_t)10);
+  CHECK_EQ(q.count(), (size_t)10);
+}
+
+TEST(psram_alloc_failure_goes_direct){
+  host::setPsram(true, 0); // ps_malloc pertama gagal
+  OfflineQueue q; REQUIRE(q.begin(QP));
+  CHECK(!q.beginFront(128));
+  CHECK(q.enqueue(ev(1)));
+  CHECK_EQ(q.frontStats().direct, (uint32_t)1);
+  host::setPsram(true); // percobaan berikut berhasil
+  CHECK(q.beginFront(128));
+  CHECK_EQ(q.frontCapacity(), (size_t)128);
+}
+
+TEST(short_outage_never_touches_flash){
+  host::setPsram(true);
+  OfflineQueue q; REQUIRE(q.begin(QP));
+  REQUIRE(q.beginFront(256));
+  const uint64_t w0 = host::fsBytesWritten();
+  for (int i = 0; i < 100; i++) { q.enqueue(ev(i)); host::advance(100000); q.loop(); } // 10 s < spillAfterMs
+  CHECK_EQ(q.frontCount(), (size_t)100);
+  std::map<int, int> sent;
+  CHECK_EQ(q.flush([&](const ScanEvent& e){ sent[idOf(e)]++; return true; }), (size_t)100);
+  CHECK_EQ(host::fsBytesWritten(), w0);
+  CHECK_EQ(q.frontStats().drained, (uint32_t)100);
+  for (int i = 0; i < 100; i++) CHECK_EQ(sent[i], 1);
+}
+
+TEST(spill_by_age_and_by_bound){
+  host::setPsram(true);
+  OfflineQueue q; REQUIRE(q.begin(QP));
+  REQUIRE(q.beginFront(256));
+  OfflineQueue::FrontSettings s; s.spillAfterMs = 5000; s.maxUndurable = 50; q.setFrontSettings(s);
+  for (int i = 0; i < 10; i++) q.enqueue(ev(i));
+  host::advance(4000000); q.loop();
+  CHECK_EQ(q.frontCount(), (size_t)10);
+  host::advance(1100000); q.loop(); // event tertua > 5 s
+  CHECK_EQ(q.frontCount(), (size_t)0);
+  CHECK_EQ(q.frontStats().spills, (uint32_t)1);
+  for (int i = 10; i < 60; i++) q.enqueue(ev(i)); // ke-50 di ring -> spill langsung
+  CHECK_EQ(q.frontCount(), (size_t)0);
+  CHECK_EQ(q.frontStats().spilled, (uint32_t)60);
+  CHECK_EQ(q.count(), (size_t)60);
+}
+
+TEST(power_loss_bounded_by_max_undurable){
+  host::setPsram(true);
+  const int N = 137, BOUND = 20;
+  {
+    OfflineQueue q; REQUIRE(q.begin(QP));
+    REQUIRE(q.beginFront(256));
+    OfflineQueue::FrontSettings s; s.maxUndurable = BOUND; q.setFrontSettings(s);
+    for (int i = 0; i < N; i++) q.enqueue(ev(i));
+    CHECK(q.frontCount() < (size_t)BOUND);
+  } // padam: ring hilang
+  OfflineQueue r; REQUIRE(r.begin(QP));
+  CHECK(r.count() >= (size_t)(N - BOUND + 1));
+  std::map<int, int> sent;
+  r.flush([&](const ScanEvent& e){ sent[idOf(e)]++; return true; }, 1000);
+  for (int i = 0; i < N - BOUND + 1; i++) CHECK_EQ(sent[i], 1); // yang hilang hanya ekor yang belum tahan padam
+}
+
+TEST(oversize_rejected_up_front){
+  host::setPsram(true);
+  OfflineQueue q; REQUIRE(q.begin(QP));
+  REQUIRE(q.beginFront(16));
+  char kode[201]; memset(kode, 0x01, 200); kode[200] = 0; // di-escape \u0001 -> > LINE_MAX
+  CHECK(!q.enqueue(ScanEvent{ "10.0.0.7", kode, 1 }));
+  CHECK_EQ(q.frontStats().rejected, (uint32_t)1);
+  CHECK_EQ(q.frontCount(), (size_t)0);
+  CHECK(q.enqueue(ev(1)));
+  CHECK(q.spill());
+  CHECK_EQ(q.count(), (size_t)1);
+}
+
+TEST(spill_failure_keeps_events_in_ring){
+  host::setPsram(true);
+  OfflineQueue q; REQUIRE(q.begin(QP));
+  REQUIRE(q.beginFront(64));
+  for (int i = 0; i < 30; i++) q.enqueue(ev(i));
+  host::fsSetTotal(LittleFS.usedBytes()); // flash penuh
+  CHECK(!q.spill());
+  CHECK(q.frontCount() > 0); // tidak ada event yang di-pop tanpa tertulis
+  host::fsSetTotal(0x160000);
+  CHECK(q.spill());
+  std::map<int, int> sent;
+  q.flush([&](const ScanEvent& e){ sent[idOf(e)]++; return true; }, 1000);
+  for (int i = 0; i < 30; i++) CHECK(sent[i] >= 1);
+}
+
+TEST_MAIN()
@@ -0,0 +1,7 @@
+#include "harness.h"
+#include "OfflineQueue.h"
+
+static ScanEvent ev(int i){ return ScanEvent{ "10.0.0.7", (uint32_t)i, 1700000000000ULL + i, (uint8_t)(1 + i % 4) }; }
+static int idOf(const ScanEvent& e){ return (int)e.count; }
+
+#include "queue_powercut.inc"
@@ -0,0 +1,10 @@
+#include "harness.h"
+#include "OfflineQueue.h"
+
+static ScanEvent ev(int i){
+  char kode[16]; snprintf(kode, sizeof(kode), "EV-%05d", i);
+  return ScanEvent{ "10.0.0.7", kode, 1700000000000ULL + i };
+}
+static int idOf(const ScanEvent& e){ return atoi(e.kode_barang.c_str() + 3); }
+
+#include "queue_powercut.inc"
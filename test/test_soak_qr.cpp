@@ -0,0 +1,70 @@
+// Soak qr-scanner: setup()/loop() sketch asli selama seminggu waktu virtual. Scan lewat UART GM66,
+// request HTTP portal, broker & Wi-Fi putus tiap hari. Heap hidup (operator new/delete host)
+// diukur tiap akhir hari setelah antrian terkuras: harus datar, tidak tumbuh hari demi hari.
+#include "harness.h"
+#include "shim/host_http.h"
+#include "../qr-scanner/qr-scanner.ino"
+
+static const char* CONFIG =
+  "{\"wifi_ssid\":\"lini\",\"wifi_pass\":\"x\",\"eth_mode\":\"static\",\"eth_ip\":\"192.168.10.60\","
+  "\"eth_gateway\":\"192.168.10.1\",\"eth_subnet\":\"255.255.255.0\",\"mqtt_host\":\"broker.lan\","
+  "\"mqtt_port\":1883,\"mqtt_topic\":\"lini/scan\"}";
+
+static const uint64_t MIN_US = 60000000ULL, DAY_US = 1440 * MIN_US;
+static const uint32_t STEP_US = 20000;             // loop() tiap 20 ms (+ delay(2) di loop)
+static const char* URLS[] = { "/", "/api/status", "/api/routes", "/api/jobs", "/api/tally",
+                              "/api/queue/events?from=0&limit=20", "/api/products/lookup?code=8991234567890" };
+
+TEST(week_of_scans_and_requests_keeps_heap_flat){
+  host::broker().onMessage = nullptr;
+  File f = LittleFS.open("/config.json", "w"); f.print(CONFIG); f.close();
+  setup();
+  const uint64_t t0 = host::nowUs();
+  uint64_t nextScan = t0 + 10000000, nextHttp = t0 + 15000000;
+  uint32_t scans = 0, requests = 0, httpFail = 0, x = 0x9E3779B9;
+  std::vector<uint64_t> live;
+  for (int day = 0; day < 7; day++) {
+    const uint64_t d0 = t0 + day * DAY_US;
+    // broker mati 30 menit jam 03:00, Wi-Fi hilang 10 menit jam 15:00
+    host::at(d0 + 180 * MIN_US, [](){ host::setBroker(false); });
+    host::at(d0 + 210 * MIN_US, [](){ host::setBroker(true); });
+    host::at(d0 + 900 * MIN_US, [](){ host::setWifi(false); });
+    host::at(d0 + 910 * MIN_US, [](){ host::setWifi(true); });
+    while (host::nowUs() < d0 + DAY_US) {
+      loop();
+      host::advance(STEP_US);
+      const uint64_t now = host::nowUs();
+      if (now >= nextScan) {
+        char kode[24]; snprintf(kode, sizeof(kode), "SOAK-%07lu\r", (unsigned long)scans++);
+        Serial1.hostRx((const uint8_t*)kode, strlen(kode));
+        x ^= x << 13; x ^= x >> 17; x ^= x << 5;
+        nextScan = now + 5000000 + x % 10000000;   // ~6 scan/menit
+      }
+      if (now >= nextHttp && host::wifiUp()) {
+        const host::HttpResponse r = host::http("GET", URLS[requests++ % (sizeof(URLS) / sizeof(URLS[0]))]);
+        if (r.code != 200) httpFail++;
+        nextHttp = now + 2 * MIN_US;
+      }
+      if (host::broker().messages.size() > 1000) host::broker().messages.clear();
+    }
+    host::broker().messages.clear(); host::clearSerialLog();
+    live.push_back(host::heapLive());
+    printf("  hari %d: %u scan, %u request, antrian %u, heap hidup %llu B\n", day + 1, scans, requests,
+           (unsigned)queue.count(), (unsigned long long)live.back());
+    CHECK_EQ(queue.count(), (size_t)0);
+  }
+  CHECK(scans > 7 * 1440 * 5);
+  CHECK_EQ(httpFail, (uint32_t)0);
+  // hari pertama mengisi cache/buffer sekali; sesudahnya datar
+  const uint64_t lo = *std::min_element(live.begin() + 1, live.end()), hi = *std::max_element(live.begin() + 1, live.end());
+  CHECK(hi - lo <= 1024);
+  CHECK(live.back() <= live[1] + 1024);
+  const host::HttpResponse st = host::http("GET", "/api/status");
+  JsonDocument d;
+  REQUIRE(!deserializeJson(d, st.body));
+  CHECK(d["heap"]["min_free"].is<uint32_t>());
+  CHECK(d["heap"]["min_largest_block"].is<uint32_t>());
+  CHECK_EQ(d["heap"]["arena_overflows"].as<uint32_t>(), (uint32_t)0);
+}
+
+TEST_MAIN()
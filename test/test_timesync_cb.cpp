@@ -0,0 +1,167 @@
+#include "harness.h"
+#include "TimeSync.h"
+#include <esp_timer.h>
+#include <cmath>
+
+// TimeSync: DriftEstimator terhadap jejak offset sinkron per jam (format log "[TIME] Sync"), lalu
+// layanan lengkap melawan server SNTP palsu (host::udpServer(123)) dengan RTC model ber-drift.
+
+// jejak: RTC +12.4 ppm, jitter jaringan +-3.5 ms, sinkron ~tiap jam (t = detik server, err = raw - server)
+static const struct { uint32_t t; int64_t err; } TRACE[] = {
+  { 1760003600u, 1843860 }, { 1760007227u, 1889332 }, { 1760010819u, 1928983 }, { 1760014391u, 1978851 },
+  { 1760017980u, 2022602 }, { 1760021620u, 2063492 }, { 1760025208u, 2113419 }, { 1760028833u, 2155786 },
+  { 1760032387u, 2198365 }, { 1760035983u, 2244117 }, { 1760039609u, 2292314 }, { 1760043169u, 2331657 },
+  { 1760046839u, 2376151 }, { 1760050376u, 2422933 },
+};
+static const size_t TRACE_N = sizeof(TRACE) / sizeof(TRACE[0]);
+
+TEST(estimator_fits_recorded_trace){
+  DriftEstimator e;
+  for (size_t i = 0; i < TRACE_N; i++) {
+    e.add(TRACE[i].t, TRACE[i].err);
+    if (e.spanS() < DriftEstimator::MIN_SPAN_S) CHECK(!e.ready()); // < 4 jam: laju belum dipercaya
+  }
+  REQUIRE(e.ready());
+  CHECK_EQ(e.count(), DriftEstimator::N);
+  printf("  jejak: %ld ppb, rms %lld us\n", (long)e.ppb(), (long long)e.residualUs());
+  CHECK(std::abs(e.ppb() - 12400) <= 500);
+  CHECK(e.residualUs() < 3500);
+  // RTC ditulis ulang di tengah jejak (raw melompat -2.3 s): shift menjaga kemiringan
+  DriftEstimator s;
+  for (size_t i = 0; i < TRACE_N; i++) {
+    if (i == 9) s.shift(-2300000);
+    s.add(TRACE[i].t, TRACE[i].err - (i >= 9 ? 2300000 : 0));
+  }
+  CHECK_EQ(s.ppb(), e.ppb());
+  // simpan/muat (/time.json) tidak mengubah hasil
+  JsonDocument d;
+  e.toJson(d["samples"].to<JsonArray>());
+  DriftEstimator r; r.fromJson(d["samples"].as<JsonArrayConst>());
+  CHECK_EQ(r.ppb(), e.ppb());
+  CHECK_EQ(r.count(), e.count());
+  // jam server mundur: riwayat dibuang
+  r.add(TRACE[0].t, 0);
+  CHECK_EQ(r.count(), (uint8_t)1);
+}
+
+TEST(estimator_follows_drift_change){
+  // drift bergeser 8 -> 15 ppm (suhu kabinet naik) setelah 12 jam: jendela 8 sampel menyusul
+  DriftEstimator e;
+  int64_t err = 0;
+  for (uint32_t h = 0; h < 24; h++) {
+    err += (h < 12 ? 8 : 15) * 3600;
+    e.add(1760000000u + h * 3600, err + ((h * 7919) % 2001) - 1000);
+    if (h == 11) CHECK(std::abs(e.ppb() - 8000) <= 300);
+  }
+  CHECK(std::abs(e.ppb() - 15000) <= 300);
+}
+
+// ---- layanan lengkap ----
+
+static const uint64_t TRUE0_US = 1760000000ULL * 1000000ULL; // waktu UTC sebenarnya saat host 0
+static uint64_t trueUs(){ return TRUE0_US + host::nowUs(); }
+
+static void ntpStamp(uint64_t epochUs, uint8_t* b){
+  const uint32_t sec = (uint32_t)(epochUs / 1000000ULL + 2208988800ULL);
+  const uint32_t frac = (uint32_t)(((epochUs % 1000000ULL) << 32) / 1000000ULL);
+  for (int i = 0; i < 4; i++) { b[i] = sec >> (24 - 8 * i); b[4 + i] = frac >> (24 - 8 * i); }
+}
+
+// server stratum 2 dengan jalur asimetris acak (keluar 2..30 ms, kembali 2..12 ms)
+struct FakeNtp {
+  uint32_t seed = 1, requests = 0;
+  void install(){
+    host::udpServer(TimeSync::NTP_PORT, [this](const host::UdpRequest& rq, host::UdpReply reply){
+      if (rq.len < 48) return;
+      requests++;
+      seed = seed * 1664525u + 1013904223u;
+      const uint64_t out = 2000 + (seed >> 8) % 28000, back = 2000 + (seed >> 4) % 10000;
+      uint8_t p[48] = { 0 };
+      p[0] = 0x24; p[1] = 2;
+      memcpy(p + 24, rq.data + 40, 8);          // originate = transmit kita
+      ntpStamp(trueUs() + out, p + 32);         // T2
+      ntpStamp(trueUs() + out + 40, p + 40);    // T3
+      reply(p, sizeof(p), IPAddress(10, 0, 0, 123), TimeSync::NTP_PORT, out + 40 + back);
+    });
+  }
+};
+
+struct Rig {
+  RTCClockDS3231 rtc;
+  TimeSync ts;
+  int64_t maxErrUs = 0;
+  uint32_t writes0 = 0;
+  // corrected time - waktu sebenarnya
+  int64_t errUs(){ return (int64_t)rtc.nowMs() * 1000 - (int64_t)trueUs(); }
+  void boot(double ppm, int64_t rtcOffsetUs){
+    RTCClockDS3231::initTz(RTCClockDS3231::DEFAULT_TZ_S);
+    host::rtc().ppm = ppm; host::rtc().sqwPin = 4;
+    host::rtcSet((uint32_t)((TRUE0_US + rtcOffsetUs) / 1000000ULL) + RTCClockDS3231::DEFAULT_TZ_S);
+    WiFi.begin("line", "pw");
+    ts.begin(rtc);
+    REQUIRE(rtc.begin(4));
+  }
+  // loop() tiap 50 ms selama durS; error dicatat setelah fromS
+  void run(uint32_t durS, uint32_t fromS = 0){
+    const uint64_t end = host::nowUs() + (uint64_t)durS * 1000000, from = host::nowUs() + (uint64_t)fromS * 1000000;
+    while (host::nowUs() < end) {
+      rtc.loopClock();
+      ts.loop(host::wifiUp(), false);
+      if (host::nowUs() >= from && ts.stats().syncs) maxErrUs = std::max(maxErrUs, std::abs(errUs()));
+      host::advance(50000);
+    }
+  }
+};
+
+TEST(service_disciplines_drifting_rtc_over_a_day){
+  FakeNtp ntp; ntp.install();
+  Rig r;
+  r.boot(30, 1700000); // RTC 1.7 s lebih cepat, +30 ppm
+  r.run(120);
+  CHECK_EQ(r.ts.stats().syncs, (uint32_t)1);
+  CHECK_EQ(r.rtc.clockStats().rtcWrites, (uint32_t)1);      // 1.7 s > ambang 500 ms: RTC ditulis
+  CHECK(std::abs(r.errUs()) < 20000);
+  r.run(6 * 3600);
+  REQUIRE(r.ts.estimator().ready());
+  r.maxErrUs = 0;
+  const uint32_t writes = r.rtc.clockStats().rtcWrites;
+  r.run(18 * 3600, 60);
+  const TimeSync::Stats& st = r.ts.stats();
+  printf("  24 jam: %u sync, drift %.3f ppm, err maks %.1f ms, %u tulis RTC, offset terakhir %ld us\n", st.syncs,
+         r.rtc.correctionPpb() / 1000.0, r.maxErrUs / 1000.0, r.rtc.clockStats().rtcWrites, (long)st.offsetUs);
+  CHECK(std::abs(r.rtc.correctionPpb() - 30000) <= 1500);
+  CHECK(r.maxErrUs < 25000);                                 // drift dikoreksi di antara sinkron
+  CHECK(std::abs(st.offsetUs) < 25000);
+  // 30 ppm = 108 ms/jam: RTC ditulis hanya tiap kali error mentahnya lewat 500 ms (~4.6 jam)
+  CHECK(r.rtc.clockStats().rtcWrites - writes <= 18 * 108 / 500 + 1);
+  CHECK(st.syncs >= 24 && st.syncs <= 26);
+  CHECK_EQ(st.failures, (uint32_t)0);
+  JsonDocument d; r.ts.toJson(d.to<JsonObject>());
+  CHECK(d["drift_ready"].as<bool>());
+  CHECK(std::fabs(d["drift_ppm"].as<float>() - 30.0f) <= 1.5f);
+  CHECK(std::string(d["nic"] | "") == "wifi");
+}
+
+TEST(persisted_correction_holds_across_reboot_without_network){
+  FakeNtp ntp; ntp.install();
+  {
+    Rig r;
+    r.boot(-25, 0);
+    r.run(8 * 3600);
+    REQUIRE(r.ts.estimator().ready());
+  }
+  // reboot tanpa jaringan 6 jam: koreksi /time.json (offset + laju) tetap berlaku
+  host::setWifi(false);
+  host::udpServer(TimeSync::NTP_PORT, nullptr);
+  Rig r;
+  r.ts.begin(r.rtc);
+  REQUIRE(r.rtc.begin(4));
+  r.run(5);
+  const int64_t e0 = r.errUs();
+  r.run(6 * 3600);
+  printf("  tanpa jaringan: err %.1f -> %.1f ms (tanpa koreksi laju: %.0f ms)\n", e0 / 1000.0, r.errUs() / 1000.0, -25e-6 * 6 * 3600 * 1000);
+  CHECK(std::abs(r.errUs() - e0) < 30000); // laju tersimpan menahan drift -25 ppm (540 ms / 6 jam)
+  CHECK(std::abs(e0) < 30000);          // RTC (tetap berjalan) + koreksi tersimpan langsung benar setelah boot
+}
+
+TEST_MAIN()